@@ -12,8 +12,29 @@ pub fn build(b: *std.Build) void {
         }),
     });
 
+    // The keyword lookup tables and the README's keyword tables are generated from
+    // src/config_names.h by a small host tool.
+    const names_gen = b.addExecutable(.{
+        .name = "config_names_gen",
+        .root_module = b.createModule(.{
+            .target = b.graph.host,
+            .optimize = .Debug,
+        }),
+    });
+    names_gen.addCSourceFiles(.{
+        .files = &.{ "tools/config_names_gen.c", "src/name_table.c" },
+    });
+    names_gen.addIncludePath(b.path("src"));
+    names_gen.linkLibC();
+
+    const gen_tables = b.addRunArtifact(names_gen);
+    gen_tables.addArg("tables");
+    const name_tables = gen_tables.addOutputFileArg("config_name_tables.h");
+    exe.addIncludePath(name_tables.dirname());
+    exe.addIncludePath(b.path("src"));
+
     exe.addCSourceFiles(.{
-        .files = &.{ "src/main.c", "src/cJSON.c" },
+        .files = &.{ "src/main.c", "src/hotkeys.c", "src/wheel_accumulator.c", "src/input_batch.c", "src/input_trace.c", "src/config_cache.c", "src/config_compile.c", "src/name_table.c", "src/arena.c", "src/action_queue.c", "src/histogram.c", "src/log_buffer.c", "src/png_writer.c", "src/qoi_writer.c", "src/apng_writer.c", "src/replay_buffer.c", "src/replay_export.c", "src/deflate.c", "src/checksum.c", "src/cpu_features.c", "src/pixel_convert.c", "src/frame_buffer.c", "src/clipboard_cache.c", "src/cJSON.c" },
         .flags = &.{ "-DUNICODE", "-D_UNICODE" },
     });
 
@@ -22,6 +43,7 @@ pub fn build(b: *std.Build) void {
     exe.linkSystemLibrary("shell32");
     exe.linkSystemLibrary("ole32");
     exe.linkSystemLibrary("gdi32");
+    exe.linkSystemLibrary("wtsapi32");
 
     exe.subsystem = .Windows;
     exe.mingw_unicode_entry_point = true;
@@ -33,4 +55,10 @@ pub fn build(b: *std.Build) void {
 
     const run_step = b.step("run", "Run MediaKeys");
     run_step.dependOn(&run_cmd.step);
+
+    const gen_readme = b.addRunArtifact(names_gen);
+    gen_readme.addArg("readme");
+    gen_readme.addFileArg(b.path("README.md"));
+    const readme_step = b.step("readme", "Regenerate the README's keyword tables from src/config_names.h");
+    readme_step.dependOn(&gen_readme.step);
 }
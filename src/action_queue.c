@@ -0,0 +1,69 @@
+#include "action_queue.h"
+
+void ActionQueueInit(ActionQueue *queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->pushed, 0);
+    atomic_init(&queue->dropped, 0);
+    atomic_init(&queue->maxDepth, 0);
+    atomic_init(&queue->completed, 0);
+    atomic_init(&queue->totalLatencyTicks, 0);
+    atomic_init(&queue->maxLatencyTicks, 0);
+}
+
+int ActionQueuePush(ActionQueue *queue, int action, unsigned long long nowTicks) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head - tail >= ACTION_QUEUE_CAPACITY) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    QueuedAction *slot = &queue->slots[head % ACTION_QUEUE_CAPACITY];
+    slot->action = action;
+    slot->enqueueTicks = nowTicks;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&queue->pushed, 1, memory_order_relaxed);
+    unsigned int depth = head + 1 - tail;
+    if (depth > atomic_load_explicit(&queue->maxDepth, memory_order_relaxed))
+        atomic_store_explicit(&queue->maxDepth, depth, memory_order_relaxed);
+    return 1;
+}
+
+int ActionQueuePop(ActionQueue *queue, QueuedAction *out) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail == head)
+        return 0;
+
+    *out = queue->slots[tail % ACTION_QUEUE_CAPACITY];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+void ActionQueueComplete(ActionQueue *queue, const QueuedAction *item, unsigned long long nowTicks) {
+    unsigned long long latency = nowTicks - item->enqueueTicks;
+
+    atomic_fetch_add_explicit(&queue->completed, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&queue->totalLatencyTicks, latency, memory_order_relaxed);
+    if (latency > atomic_load_explicit(&queue->maxLatencyTicks, memory_order_relaxed))
+        atomic_store_explicit(&queue->maxLatencyTicks, latency, memory_order_relaxed);
+}
+
+unsigned int ActionQueueDepth(ActionQueue *queue) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    return head - tail;
+}
+
+void ActionQueueGetStats(ActionQueue *queue, ActionQueueStats *stats) {
+    stats->pushed = atomic_load_explicit(&queue->pushed, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+    stats->completed = atomic_load_explicit(&queue->completed, memory_order_relaxed);
+    stats->maxDepth = atomic_load_explicit(&queue->maxDepth, memory_order_relaxed);
+    stats->totalLatencyTicks = atomic_load_explicit(&queue->totalLatencyTicks, memory_order_relaxed);
+    stats->maxLatencyTicks = atomic_load_explicit(&queue->maxLatencyTicks, memory_order_relaxed);
+}
@@ -0,0 +1,56 @@
+#ifndef ACTION_QUEUE_H
+#define ACTION_QUEUE_H
+
+#include <stdatomic.h>
+
+/* Bounded single-producer/single-consumer queue used to hand actions from the input hook
+ * thread to the worker thread. Push never blocks or allocates; when the queue is full the
+ * action is dropped and counted. Timestamps are opaque ticks supplied by the caller. */
+
+#define ACTION_QUEUE_CAPACITY 16
+
+typedef struct {
+    int action;
+    unsigned long long enqueueTicks;
+} QueuedAction;
+
+typedef struct {
+    unsigned int pushed;
+    unsigned int dropped;
+    unsigned int completed;
+    unsigned int maxDepth;
+    unsigned long long totalLatencyTicks;
+    unsigned long long maxLatencyTicks;
+} ActionQueueStats;
+
+typedef struct {
+    QueuedAction slots[ACTION_QUEUE_CAPACITY];
+    atomic_uint head; /* written by the producer only */
+    atomic_uint tail; /* written by the consumer only */
+
+    /* Producer-owned counters. */
+    atomic_uint pushed;
+    atomic_uint dropped;
+    atomic_uint maxDepth;
+
+    /* Consumer-owned counters. */
+    atomic_uint completed;
+    atomic_ullong totalLatencyTicks;
+    atomic_ullong maxLatencyTicks;
+} ActionQueue;
+
+void ActionQueueInit(ActionQueue *queue);
+
+/* Producer side. Returns 0 if the queue was full. */
+int ActionQueuePush(ActionQueue *queue, int action, unsigned long long nowTicks);
+
+/* Consumer side. Returns 0 if the queue was empty. */
+int ActionQueuePop(ActionQueue *queue, QueuedAction *out);
+
+/* Consumer side. Records the latency from push to nowTicks for the popped action. */
+void ActionQueueComplete(ActionQueue *queue, const QueuedAction *item, unsigned long long nowTicks);
+
+unsigned int ActionQueueDepth(ActionQueue *queue);
+void ActionQueueGetStats(ActionQueue *queue, ActionQueueStats *stats);
+
+#endif
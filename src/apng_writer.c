@@ -0,0 +1,141 @@
+#include <string.h>
+#include "apng_writer.h"
+#include "checksum.h"
+
+static void Put32(unsigned char *p, unsigned int value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static unsigned int Get32(const unsigned char *p) {
+    return (unsigned int)p[0] << 24 | (unsigned int)p[1] << 16 | (unsigned int)p[2] << 8 | p[3];
+}
+
+/* Writes a chunk whose data is prefix (may be empty) followed by data. */
+static void WriteChunk(ApngWriter *apng, const char *tag, const unsigned char *prefix,
+    int prefixLen, const unsigned char *data, int len) {
+    unsigned char header[8], trailer[4];
+    Put32(header, (unsigned int)(prefixLen + len));
+    memcpy(header + 4, tag, 4);
+
+    unsigned int crc = Crc32(0, header + 4, 4);
+    if (prefixLen)
+        crc = Crc32(crc, prefix, (size_t)prefixLen);
+    if (len)
+        crc = Crc32(crc, data, (size_t)len);
+    Put32(trailer, crc);
+
+    apng->write(apng->context, header, 8);
+    if (prefixLen)
+        apng->write(apng->context, (void *)prefix, prefixLen);
+    if (len)
+        apng->write(apng->context, (void *)data, len);
+    apng->write(apng->context, trailer, 4);
+}
+
+static void WriteFrameControl(ApngWriter *apng, int x, int y, int width, int height,
+    unsigned int delayMs) {
+    unsigned char fctl[26];
+    Put32(fctl, apng->sequence++);
+    Put32(fctl + 4, (unsigned int)width);
+    Put32(fctl + 8, (unsigned int)height);
+    Put32(fctl + 12, (unsigned int)x);
+    Put32(fctl + 16, (unsigned int)y);
+    if (delayMs > 0xffff)
+        delayMs = 0xffff;
+    fctl[20] = (unsigned char)(delayMs >> 8);
+    fctl[21] = (unsigned char)delayMs;
+    fctl[22] = 1000 >> 8; /* delay is in milliseconds */
+    fctl[23] = 1000 & 0xff;
+    fctl[24] = 0; /* dispose: leave the frame in place */
+    fctl[25] = 0; /* blend: replace the rectangle */
+    WriteChunk(apng, "fcTL", NULL, 0, fctl, sizeof(fctl));
+}
+
+void ApngBegin(ApngWriter *apng, stbi_write_func *write, void *context, int width, int height,
+    int comp, int frameCount, const PngEncodeOptions *options) {
+    memset(apng, 0, sizeof(*apng));
+    apng->write = write;
+    apng->context = context;
+    apng->width = width;
+    apng->height = height;
+    apng->comp = comp;
+    apng->frameCount = frameCount;
+    if (options)
+        apng->options = *options;
+    apng->failed = !write || width <= 0 || height <= 0 || frameCount <= 0;
+}
+
+int ApngWriteFrame(ApngWriter *apng, const unsigned char *pixels, int stride, int x, int y,
+    int width, int height, unsigned int delayMs) {
+    if (apng->failed || apng->framesWritten >= apng->frameCount || x < 0 || y < 0 ||
+        width <= 0 || height <= 0 || width > apng->width - x || height > apng->height - y) {
+        apng->failed = 1;
+        return 0;
+    }
+
+    int first = apng->framesWritten == 0;
+    if (first && (x || y || width != apng->width || height != apng->height)) {
+        apng->failed = 1;
+        return 0;
+    }
+
+    int len = 0;
+    unsigned char *png =
+        PngEncodeToMemory(pixels, stride, width, height, apng->comp, &apng->options, &len);
+    if (!png) {
+        apng->failed = 1;
+        return 0;
+    }
+
+    /* The encoder's output is signature, IHDR, IDAT and IEND, all well formed. */
+    const unsigned char *p = png + 8;
+    const unsigned char *end = png + len;
+    int controlWritten = 0;
+    if (first)
+        apng->write(apng->context, png, 8);
+
+    while (end - p >= 12) {
+        int chunkLen = (int)Get32(p);
+        const unsigned char *tag = p + 4;
+        const unsigned char *data = p + 8;
+        if (chunkLen < 0 || chunkLen > end - p - 12)
+            break;
+
+        if (memcmp(tag, "IHDR", 4) == 0 && first) {
+            unsigned char actl[8];
+            Put32(actl, (unsigned int)apng->frameCount);
+            Put32(actl + 4, 0); /* loop forever */
+            apng->write(apng->context, (void *)p, chunkLen + 12);
+            WriteChunk(apng, "acTL", NULL, 0, actl, sizeof(actl));
+            WriteFrameControl(apng, x, y, width, height, delayMs);
+            controlWritten = 1;
+        } else if (memcmp(tag, "IDAT", 4) == 0) {
+            if (first) {
+                apng->write(apng->context, (void *)p, chunkLen + 12);
+            } else {
+                unsigned char sequence[4];
+                if (!controlWritten) {
+                    WriteFrameControl(apng, x, y, width, height, delayMs);
+                    controlWritten = 1;
+                }
+                Put32(sequence, apng->sequence++);
+                WriteChunk(apng, "fdAT", sequence, 4, data, chunkLen);
+            }
+        }
+        p = data + chunkLen + 4;
+    }
+
+    PngFree(png);
+    apng->framesWritten++;
+    return 1;
+}
+
+int ApngEnd(ApngWriter *apng) {
+    if (apng->failed || apng->framesWritten != apng->frameCount)
+        return 0;
+    WriteChunk(apng, "IEND", NULL, 0, NULL, 0);
+    return 1;
+}
@@ -0,0 +1,38 @@
+#ifndef APNG_WRITER_H
+#define APNG_WRITER_H
+
+#include "png_writer.h"
+
+/* Animated PNG built from frames encoded by PngEncodeToMemory: each frame's IDAT data is
+ * re-wrapped in fdAT chunks behind an fcTL. Frames after the first may cover just a rectangle
+ * of the canvas, drawn over what the previous frame left, so only changed areas are encoded.
+ * Viewers without APNG support show the first frame. */
+
+typedef struct {
+    stbi_write_func *write;
+    void *context;
+    int width;
+    int height;
+    int comp;
+    PngEncodeOptions options;
+    int frameCount; /* announced up front in the acTL chunk */
+    int framesWritten;
+    unsigned int sequence;
+    int failed;
+} ApngWriter;
+
+/* Nothing is written until the first frame. options is copied, but anything it points to must
+ * outlive the writer. */
+void ApngBegin(ApngWriter *apng, stbi_write_func *write, void *context, int width, int height,
+    int comp, int frameCount, const PngEncodeOptions *options);
+
+/* Adds a frame covering width x height pixels at (x, y) of the canvas, shown for delayMs.
+ * pixels points at the rectangle's first pixel. The first frame must cover the whole canvas.
+ * Returns 0 once the animation has failed. */
+int ApngWriteFrame(ApngWriter *apng, const unsigned char *pixels, int stride, int x, int y,
+    int width, int height, unsigned int delayMs);
+
+/* Writes IEND. Returns 1 only if exactly frameCount frames were written. */
+int ApngEnd(ApngWriter *apng);
+
+#endif
@@ -0,0 +1,70 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;
+    size_t used;
+    size_t padding; /* keeps the data that follows aligned */
+};
+
+static size_t RoundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+void ArenaInit(Arena *arena, size_t firstBlockSize) {
+    memset(arena, 0, sizeof(*arena));
+    arena->nextBlockSize = RoundUp(firstBlockSize > ARENA_MIN_BLOCK ? firstBlockSize
+                                                                    : ARENA_MIN_BLOCK,
+        ARENA_MIN_BLOCK);
+}
+
+/* The first block of a round takes the learned size; later ones double, so a round that
+ * outgrows it still needs only a few more system allocations. */
+static ArenaBlock *AddBlock(Arena *arena, size_t needed) {
+    size_t size = arena->blocks ? arena->blocks->size * 2 : arena->nextBlockSize;
+    if (size < needed)
+        size = RoundUp(needed, ARENA_MIN_BLOCK);
+
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+    if (!block)
+        return NULL;
+    block->next = arena->blocks;
+    block->size = size;
+    block->used = 0;
+    arena->blocks = block;
+    arena->blockCount++;
+    return block;
+}
+
+void *ArenaAlloc(Arena *arena, size_t size) {
+    size = RoundUp(size ? size : 1, ARENA_ALIGNMENT);
+
+    ArenaBlock *block = arena->blocks;
+    if (!block || block->size - block->used < size) {
+        block = AddBlock(arena, size);
+        if (!block)
+            return NULL;
+    }
+
+    void *p = (unsigned char *)(block + 1) + block->used;
+    block->used += size;
+    arena->used += size;
+    arena->allocations++;
+    return p;
+}
+
+void ArenaReset(Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    /* An eighth of headroom so a config that grew a little still fits in one block. */
+    size_t learned = arena->allocations > 0 ? arena->used + arena->used / 8 : arena->nextBlockSize;
+    ArenaInit(arena, learned);
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator for short-lived allocations that all die together, such as a parsed config
+ * tree. Individual frees are no-ops; ArenaReset returns everything at once. It remembers how
+ * much the last round used, so the next round usually gets by with a single block. */
+
+#define ARENA_MIN_BLOCK 4096
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *blocks;      /* newest first */
+    size_t nextBlockSize;    /* size of the first block of the next round */
+    size_t used;             /* bytes handed out this round, padding included */
+
+    unsigned int allocations; /* this round */
+    unsigned int blockCount;  /* this round; each one is a system allocation */
+} Arena;
+
+void ArenaInit(Arena *arena, size_t firstBlockSize);
+
+/* Returns ARENA_ALIGNMENT-aligned memory, or NULL if the system is out of memory. */
+void *ArenaAlloc(Arena *arena, size_t size);
+
+/* Frees every block and sizes the next round's first block to fit what this round used. */
+void ArenaReset(Arena *arena);
+
+#endif
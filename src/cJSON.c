@@ -58,6 +58,22 @@
 
 #include "cJSON.h"
 
+/* SSE2 is part of x86-64. AVX2 is used when CJSON_CPU_HAS_AVX2() says so: by default that is whatever the application passed to cJSON_SetCpuHasAvx2, but a build can define it to its own CPU check. */
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(CJSON_DISABLE_SIMD)
+#define CJSON_X64
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifndef CJSON_CPU_HAS_AVX2
+#define CJSON_CPU_HAS_AVX2() cpu_has_avx2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CJSON_TARGET(features)
+#else
+#define CJSON_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
 /* define our own boolean type */
 #ifdef true
 #undef true
@@ -237,6 +253,13 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
+static cJSON_bool cpu_has_avx2 = false;
+
+CJSON_PUBLIC(void) cJSON_SetCpuHasAvx2(cJSON_bool has_avx2)
+{
+    cpu_has_avx2 = has_avx2;
+}
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 {
@@ -249,6 +272,8 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
     return node;
 }
 
+static void index_table_remove(const cJSON * const object);
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -270,6 +295,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
             global_hooks.deallocate(item->string);
             item->string = NULL;
         }
+        index_table_remove(item);
         global_hooks.deallocate(item);
         item = next;
     }
@@ -308,6 +334,7 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
 {
     double number = 0;
     unsigned char *after_end = NULL;
+    unsigned char number_stack[64];
     unsigned char *number_c_string;
     unsigned char decimal_point = get_decimal_point();
     size_t i = 0;
@@ -353,11 +380,15 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         }
     }
 loop_end:
-    /* malloc for temporary buffer, add 1 for '\0' */
-    number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
-    if (number_c_string == NULL)
+    /* use the stack for the temporary buffer unless the number is unusually long, add 1 for '\0' */
+    number_c_string = number_stack;
+    if (number_string_length >= sizeof(number_stack))
     {
-        return false; /* allocation failure */
+        number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
+        if (number_c_string == NULL)
+        {
+            return false; /* allocation failure */
+        }
     }
 
     memcpy(number_c_string, buffer_at_offset(input_buffer), number_string_length);
@@ -379,7 +410,10 @@ loop_end:
     if (number_c_string == after_end)
     {
         /* free the temporary buffer */
-        input_buffer->hooks.deallocate(number_c_string);
+        if (number_c_string != number_stack)
+        {
+            input_buffer->hooks.deallocate(number_c_string);
+        }
         return false; /* parse_error */
     }
 
@@ -403,7 +437,10 @@ loop_end:
 
     input_buffer->offset += (size_t)(after_end - number_c_string);
     /* free the temporary buffer */
-    input_buffer->hooks.deallocate(number_c_string);
+    if (number_c_string != number_stack)
+    {
+        input_buffer->hooks.deallocate(number_c_string);
+    }
     return true;
 }
 
@@ -815,13 +852,135 @@ fail:
     return 0;
 }
 
-/* Parse the input text into an unescaped cinput, and populate item. */
-static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+#ifdef CJSON_X64
+static unsigned int lowest_set_bit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+/* The scans below stop short of the last 32 bytes and leave them to the caller. */
+CJSON_TARGET("avx2")
+static const unsigned char *skip_whitespace_avx2(const unsigned char *pointer, const unsigned char * const end)
+{
+    const __m256i flip = _mm256_set1_epi8((char)0x80);
+    const __m256i space = _mm256_set1_epi8((char)(' ' ^ 0x80));
+    for (; (end - pointer) >= 32; pointer += 32)
+    {
+        __m256i chunk = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)pointer), flip);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(chunk, space));
+        if (mask != 0)
+        {
+            return pointer + lowest_set_bit(mask);
+        }
+    }
+    return pointer;
+}
+
+CJSON_TARGET("avx2")
+static const unsigned char *find_string_end_avx2(const unsigned char *pointer, const unsigned char * const end)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    for (; (end - pointer) >= 32; pointer += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)pointer);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return pointer + lowest_set_bit(mask);
+        }
+    }
+    return pointer;
+}
+
+/* The SSE2 scans ask for AVX2 only once a run gets past the first 16 bytes; most keys, values and indents end inside them. */
+static const unsigned char *skip_whitespace_sse2(const unsigned char *pointer, const unsigned char * const end)
+{
+    const __m128i flip = _mm_set1_epi8((char)0x80);
+    const __m128i space = _mm_set1_epi8((char)(' ' ^ 0x80));
+    for (; (end - pointer) >= 16; pointer += 16)
+    {
+        /* bytes compare signed, so flip the sign bit to compare them unsigned */
+        __m128i chunk = _mm_xor_si128(_mm_loadu_si128((const __m128i*)pointer), flip);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(chunk, space));
+        if (mask != 0)
+        {
+            return pointer + lowest_set_bit(mask);
+        }
+        if (((end - pointer) >= 16 + 64) && CJSON_CPU_HAS_AVX2())
+        {
+            return skip_whitespace_avx2(pointer + 16, end);
+        }
+    }
+    return pointer;
+}
+
+static const unsigned char *find_string_end_sse2(const unsigned char *pointer, const unsigned char * const end)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; (end - pointer) >= 16; pointer += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)pointer);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return pointer + lowest_set_bit(mask);
+        }
+        if (((end - pointer) >= 16 + 64) && CJSON_CPU_HAS_AVX2())
+        {
+            return find_string_end_avx2(pointer + 16, end);
+        }
+    }
+    return pointer;
+}
+#endif
+
+/* Returns the first byte in [pointer, end) above 32, or end. */
+static const unsigned char *skip_whitespace_bytes(const unsigned char *pointer, const unsigned char * const end)
+{
+    /* most runs are empty, so look before setting up vectors */
+    if ((pointer < end) && (*pointer > 32))
+    {
+        return pointer;
+    }
+#ifdef CJSON_X64
+    pointer = skip_whitespace_sse2(pointer, end);
+#endif
+    while ((pointer < end) && (*pointer <= 32))
+    {
+        pointer++;
+    }
+    return pointer;
+}
+
+/* Returns the first quote or backslash in [pointer, end), or end. */
+static const unsigned char *find_string_end(const unsigned char *pointer, const unsigned char * const end)
+{
+#ifdef CJSON_X64
+    pointer = find_string_end_sse2(pointer, end);
+#endif
+    while ((pointer < end) && (*pointer != '\"') && (*pointer != '\\'))
+    {
+        pointer++;
+    }
+    return pointer;
+}
+
+/* Decodes the string literal at the current offset into *output_string. The output goes into scratch when it fits there (scratch may be NULL), otherwise it is allocated with the buffer's hooks and the caller frees it. */
+static cJSON_bool parse_string_into(parse_buffer * const input_buffer, unsigned char * const scratch, const size_t scratch_size, unsigned char ** const output_string)
 {
     const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
     const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
     unsigned char *output_pointer = NULL;
     unsigned char *output = NULL;
+    size_t skipped_bytes = 0;
 
     /* not a string */
     if (buffer_at_offset(input_buffer)[0] != '\"')
@@ -832,21 +991,21 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     {
         /* calculate approximate size of the output (overestimate) */
         size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        const unsigned char * const content_end = input_buffer->content + input_buffer->length;
+        while ((input_end = find_string_end(input_end, content_end)) < content_end)
         {
-            /* is escape sequence */
-            if (input_end[0] == '\\')
+            if (*input_end == '\"')
             {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
+                break;
+            }
+            /* escape sequence */
+            if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
+            {
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
             }
-            input_end++;
+            skipped_bytes++;
+            input_end += 2;
         }
         if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
         {
@@ -855,14 +1014,28 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 
         /* This is at most how much we need for the output */
         allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
+        if ((scratch != NULL) && (allocation_length + sizeof("") <= scratch_size))
         {
-            goto fail; /* allocation failure */
+            output = scratch;
+        }
+        else
+        {
+            output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+            if (output == NULL)
+            {
+                goto fail; /* allocation failure */
+            }
         }
     }
 
     output_pointer = output;
+    if (skipped_bytes == 0)
+    {
+        /* no escapes, so the literal is the string */
+        memcpy(output_pointer, input_pointer, (size_t)(input_end - input_pointer));
+        output_pointer += input_end - input_pointer;
+        input_pointer = input_end;
+    }
     /* loop through the string literal */
     while (input_pointer < input_end)
     {
@@ -922,8 +1095,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     /* zero terminate the output */
     *output_pointer = '\0';
 
-    item->type = cJSON_String;
-    item->valuestring = (char*)output;
+    *output_string = output;
 
     input_buffer->offset = (size_t) (input_end - input_buffer->content);
     input_buffer->offset++;
@@ -931,7 +1103,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && (output != scratch))
     {
         input_buffer->hooks.deallocate(output);
         output = NULL;
@@ -945,6 +1117,21 @@ fail:
     return false;
 }
 
+/* Parse the input text into an unescaped cinput, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    unsigned char *output = NULL;
+
+    if (!parse_string_into(input_buffer, NULL, 0, &output))
+    {
+        return false;
+    }
+
+    item->type = cJSON_String;
+    item->valuestring = (char*)output;
+    return true;
+}
+
 /* Render the cstring provided to an escaped version that can be printed. */
 static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
 {
@@ -1094,10 +1281,7 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
         return buffer;
     }
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
-    {
-       buffer->offset++;
-    }
+    buffer->offset = (size_t)(skip_whitespace_bytes(buffer_at_offset(buffer), buffer->content + buffer->length) - buffer->content);
 
     if (buffer->offset == buffer->length)
     {
@@ -1229,6 +1413,214 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
     return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
 }
 
+/* Strings up to this long (with the terminator) are decoded without allocating. */
+#define CJSON_EVENTS_SCRATCH 256
+
+typedef struct
+{
+    parse_buffer buffer;
+    const cJSON_Events *events;
+    void *context;
+    unsigned char key[CJSON_EVENTS_SCRATCH];
+    unsigned char string[CJSON_EVENTS_SCRATCH];
+} event_parser;
+
+static cJSON_bool parse_value_events(event_parser * const parser, const char * const key);
+
+static void release_scratch(event_parser * const parser, unsigned char *output, const unsigned char * const scratch)
+{
+    if ((output != NULL) && (output != scratch))
+    {
+        parser->buffer.hooks.deallocate(output);
+    }
+}
+
+/* The same grammar as parse_array and parse_object, reporting members instead of linking them. */
+static cJSON_bool parse_container_events(event_parser * const parser, const char * const key, const cJSON_bool object)
+{
+    parse_buffer * const input_buffer = &parser->buffer;
+    const cJSON_Events * const events = parser->events;
+    const unsigned char close = object ? '}' : ']';
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (object ? ((events->start_object != NULL) && !events->start_object(parser->context, key)) : ((events->start_array != NULL) && !events->start_array(parser->context, key)))
+    {
+        return false;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == close))
+    {
+        goto success; /* empty */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        input_buffer->offset--;
+        return false;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    do
+    {
+        unsigned char *member_key = NULL;
+        cJSON_bool parsed = false;
+
+        if (object && cannot_access_at_index(input_buffer, 1))
+        {
+            return false; /* nothing comes after the comma */
+        }
+
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (object)
+        {
+            /* parse the name of the child */
+            if (!parse_string_into(input_buffer, parser->key, sizeof(parser->key), &member_key))
+            {
+                return false;
+            }
+            buffer_skip_whitespace(input_buffer);
+            if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+            {
+                release_scratch(parser, member_key, parser->key);
+                return false; /* invalid object */
+            }
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
+        }
+
+        parsed = parse_value_events(parser, (const char*)member_key);
+        release_scratch(parser, member_key, parser->key);
+        if (!parsed)
+        {
+            return false;
+        }
+        buffer_skip_whitespace(input_buffer);
+    }
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != close))
+    {
+        return false; /* expected end of array or object */
+    }
+
+success:
+    input_buffer->depth--;
+    input_buffer->offset++;
+
+    if (object)
+    {
+        return (events->end_object == NULL) || events->end_object(parser->context);
+    }
+    return (events->end_array == NULL) || events->end_array(parser->context);
+}
+
+static cJSON_bool parse_value_events(event_parser * const parser, const char * const key)
+{
+    parse_buffer * const input_buffer = &parser->buffer;
+    cJSON item;
+    unsigned char *output = NULL;
+    cJSON_bool reported = false;
+
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        return false; /* no input */
+    }
+
+    switch (buffer_at_offset(input_buffer)[0])
+    {
+        case '[':
+            return parse_container_events(parser, key, false);
+        case '{':
+            return parse_container_events(parser, key, true);
+        default:
+            break;
+    }
+
+    memset(&item, '\0', sizeof(item));
+    item.string = (char*)key;
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        item.type = cJSON_NULL;
+        input_buffer->offset += 4;
+    }
+    else if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        item.type = cJSON_False;
+        input_buffer->offset += 5;
+    }
+    else if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        item.type = cJSON_True;
+        item.valueint = 1;
+        input_buffer->offset += 4;
+    }
+    else if (buffer_at_offset(input_buffer)[0] == '\"')
+    {
+        if (!parse_string_into(input_buffer, parser->string, sizeof(parser->string), &output))
+        {
+            return false;
+        }
+        item.type = cJSON_String;
+        item.valuestring = (char*)output;
+    }
+    else if ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9')))
+    {
+        if (!parse_number(&item, input_buffer))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    reported = (parser->events->value == NULL) || parser->events->value(parser->context, &item);
+    release_scratch(parser, output, parser->string);
+    return reported;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseWithEvents(const char *value, size_t buffer_length, const cJSON_Events *events, void *context)
+{
+    event_parser parser;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (buffer_length == 0) || (events == NULL))
+    {
+        return false;
+    }
+
+    memset(&parser.buffer, '\0', sizeof(parser.buffer));
+    parser.buffer.content = (const unsigned char*)value;
+    parser.buffer.length = buffer_length;
+    parser.buffer.hooks = global_hooks;
+    parser.events = events;
+    parser.context = context;
+
+    buffer_skip_whitespace(skip_utf8_bom(&parser.buffer));
+    if (parse_value_events(&parser, NULL))
+    {
+        return true;
+    }
+
+    global_error.json = (const unsigned char*)value;
+    global_error.position = (parser.buffer.offset < parser.buffer.length) ? parser.buffer.offset : buffer_length - 1;
+    return false;
+}
+
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
@@ -1933,15 +2325,372 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
     return get_array_item(array, (size_t)index);
 }
 
+/* Member index of an object: open addressing with linear probing over the case-folded names. While every member has a name and no two names differ only in case, each name has at most one candidate, so both kinds of lookup can use it and still return what walking the list would. Otherwise the index is marked unusable and lookups walk. */
+typedef struct cJSON_ObjectIndex
+{
+    const cJSON *object;
+    size_t capacity; /* slots, a power of two */
+    size_t used; /* slots holding a member or a tombstone */
+    cJSON_bool unusable;
+    cJSON **slots;
+} cJSON_ObjectIndex;
+
+/* The indexes of all indexed objects, by object address, so struct cJSON stays as it is. Also open addressing with linear probing; the slots are freed with the last index. */
+static struct
+{
+    size_t capacity;
+    size_t count;
+    cJSON_ObjectIndex **slots;
+} index_table = { 0, 0, NULL };
+
+static cJSON index_tombstone;
+
+static size_t index_table_hash(const cJSON * const object)
+{
+    size_t hash = (size_t)object >> 4;
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3Bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/* Returns the slot holding the index of object, or the empty slot that ends its probe sequence. index_table must have slots. */
+static size_t index_table_find(const cJSON * const object)
+{
+    size_t mask = index_table.capacity - 1;
+    size_t slot = index_table_hash(object) & mask;
+
+    while ((index_table.slots[slot] != NULL) && (index_table.slots[slot]->object != object))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static cJSON_ObjectIndex *index_of(const cJSON * const object)
+{
+    cJSON_ObjectIndex *index = NULL;
+
+    if (index_table.count == 0)
+    {
+        return NULL;
+    }
+    index = index_table.slots[index_table_find(object)];
+    return ((index != NULL) && !index->unusable) ? index : NULL;
+}
+
+static cJSON_bool index_table_insert(cJSON_ObjectIndex * const index)
+{
+    if ((index_table.count + 1) * 4 > index_table.capacity * 3)
+    {
+        size_t capacity = (index_table.capacity == 0) ? 16 : index_table.capacity * 2;
+        cJSON_ObjectIndex **old_slots = index_table.slots;
+        size_t old_capacity = index_table.capacity;
+        size_t i = 0;
+
+        index_table.slots = (cJSON_ObjectIndex**)global_hooks.allocate(capacity * sizeof(cJSON_ObjectIndex*));
+        if (index_table.slots == NULL)
+        {
+            index_table.slots = old_slots;
+            return false;
+        }
+        memset(index_table.slots, '\0', capacity * sizeof(cJSON_ObjectIndex*));
+        index_table.capacity = capacity;
+        for (i = 0; i < old_capacity; i++)
+        {
+            if (old_slots[i] != NULL)
+            {
+                index_table.slots[index_table_find(old_slots[i]->object)] = old_slots[i];
+            }
+        }
+        if (old_slots != NULL)
+        {
+            global_hooks.deallocate(old_slots);
+        }
+    }
+
+    index_table.slots[index_table_find(index->object)] = index;
+    index_table.count++;
+    return true;
+}
+
+/* Frees the index of object, if any. */
+static void index_table_remove(const cJSON * const object)
+{
+    size_t mask = 0;
+    size_t hole = 0;
+    size_t slot = 0;
+    cJSON_ObjectIndex *index = NULL;
+
+    if (index_table.count == 0)
+    {
+        return;
+    }
+    hole = index_table_find(object);
+    index = index_table.slots[hole];
+    if (index == NULL)
+    {
+        return;
+    }
+    if (index->slots != NULL)
+    {
+        global_hooks.deallocate(index->slots);
+    }
+    global_hooks.deallocate(index);
+
+    if (--index_table.count == 0)
+    {
+        global_hooks.deallocate(index_table.slots);
+        index_table.slots = NULL;
+        index_table.capacity = 0;
+        return;
+    }
+
+    /* shift later entries of the probe run back, so no tombstones are needed */
+    mask = index_table.capacity - 1;
+    index_table.slots[hole] = NULL;
+    slot = hole;
+    for (;;)
+    {
+        size_t home = 0;
+
+        slot = (slot + 1) & mask;
+        if (index_table.slots[slot] == NULL)
+        {
+            break;
+        }
+        home = index_table_hash(index_table.slots[slot]->object) & mask;
+        /* it stays if its home lies cyclically in (hole, slot] */
+        if ((hole <= slot) ? ((hole < home) && (home <= slot)) : ((hole < home) || (home <= slot)))
+        {
+            continue;
+        }
+        index_table.slots[hole] = index_table.slots[slot];
+        index_table.slots[slot] = NULL;
+        hole = slot;
+    }
+}
+
+static size_t index_hash(const unsigned char *name)
+{
+    size_t hash = 2166136261u;
+    for (; *name != '\0'; name++)
+    {
+        hash = (hash ^ (size_t)tolower(*name)) * 16777619u;
+    }
+    /* FNV leaves the low bits, which pick the slot, poorly mixed */
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+/* Returns the slot of the member whose name matches case-insensitively, or of the empty slot that ends its probe sequence. */
+static cJSON **index_find(const cJSON_ObjectIndex * const index, const char * const name)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = index_hash((const unsigned char*)name) & mask;
+
+    while (index->slots[slot] != NULL)
+    {
+        if ((index->slots[slot] != &index_tombstone) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)index->slots[slot]->string) == 0))
+        {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &index->slots[slot];
+}
+
+static cJSON_bool index_fill(cJSON_ObjectIndex * const index);
+
+/* Adds a member that was just linked in, refilling the index bigger once it is three quarters full. */
+static void index_add(cJSON_ObjectIndex * const index, cJSON * const item)
+{
+    size_t position = 0;
+    size_t mask = index->capacity - 1;
+
+    if (item->string == NULL)
+    {
+        index->unusable = true;
+        return;
+    }
+    if ((index->used + 1) * 4 > index->capacity * 3)
+    {
+        index_fill(index);
+        return;
+    }
+    if (*index_find(index, item->string) != NULL)
+    {
+        index->unusable = true; /* the name is already there in some case */
+        return;
+    }
+
+    /* reuse the first tombstone on the way, if any */
+    position = index_hash((const unsigned char*)item->string) & mask;
+    while ((index->slots[position] != NULL) && (index->slots[position] != &index_tombstone))
+    {
+        position = (position + 1) & mask;
+    }
+    if (index->slots[position] == NULL)
+    {
+        index->used++;
+    }
+    index->slots[position] = item;
+}
+
+/* (Re)builds the index from the object's members. Out of memory leaves it unusable. */
+static cJSON_bool index_fill(cJSON_ObjectIndex * const index)
+{
+    cJSON *current_element = NULL;
+    size_t members = 0;
+    size_t capacity = 32;
+
+    for (current_element = index->object->child; current_element != NULL; current_element = current_element->next)
+    {
+        members++;
+    }
+    while (capacity < members * 2)
+    {
+        capacity *= 2;
+    }
+
+    if (index->slots != NULL)
+    {
+        global_hooks.deallocate(index->slots);
+    }
+    index->slots = (cJSON**)global_hooks.allocate(capacity * sizeof(cJSON*));
+    index->used = 0;
+    if (index->slots == NULL)
+    {
+        index->capacity = 0;
+        index->unusable = true;
+        return false;
+    }
+    memset(index->slots, '\0', capacity * sizeof(cJSON*));
+    index->capacity = capacity;
+    index->unusable = false;
+
+    for (current_element = index->object->child; (current_element != NULL) && !index->unusable; current_element = current_element->next)
+    {
+        index_add(index, current_element);
+    }
+    return true;
+}
+
+/* Called after a member was linked into object. */
+static void index_added(const cJSON * const object, cJSON * const item)
+{
+    cJSON_ObjectIndex *index = NULL;
+
+    if (index_table.count == 0)
+    {
+        return;
+    }
+    index = index_table.slots[index_table_find(object)];
+    if ((index != NULL) && !index->unusable)
+    {
+        index_add(index, item);
+    }
+}
+
+/* Called after a member was unlinked from object. The member that made an index unusable may be the one leaving, so those are refilled. Returns true if the index was refilled, which already accounts for any other change to the list. */
+static cJSON_bool index_removed(const cJSON * const object, const cJSON * const item)
+{
+    cJSON_ObjectIndex *index = NULL;
+    cJSON **slot = NULL;
+
+    if (index_table.count == 0)
+    {
+        return false;
+    }
+    index = index_table.slots[index_table_find(object)];
+    if (index == NULL)
+    {
+        return false;
+    }
+    if (index->unusable || (item->string == NULL))
+    {
+        index_fill(index);
+        return true;
+    }
+
+    slot = index_find(index, item->string);
+    if (*slot == item)
+    {
+        *slot = &index_tombstone;
+    }
+    return false;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_IndexObject(cJSON *object)
+{
+    cJSON_ObjectIndex *index = NULL;
+
+    /* references share their members with an object that can change behind their back */
+    if (!cJSON_IsObject(object) || (object->type & cJSON_IsReference))
+    {
+        return false;
+    }
+
+    index = (index_table.count == 0) ? NULL : index_table.slots[index_table_find(object)];
+    if (index == NULL)
+    {
+        index = (cJSON_ObjectIndex*)global_hooks.allocate(sizeof(cJSON_ObjectIndex));
+        if (index == NULL)
+        {
+            return false;
+        }
+        memset(index, '\0', sizeof(cJSON_ObjectIndex));
+        index->object = object;
+        if (!index_table_insert(index))
+        {
+            global_hooks.deallocate(index);
+            return false;
+        }
+    }
+
+    if (!index_fill(index))
+    {
+        index_table_remove(object);
+        return false;
+    }
+    return true;
+}
+
+CJSON_PUBLIC(void) cJSON_UnindexObject(cJSON *object)
+{
+    index_table_remove(object);
+}
+
+static cJSON *index_lookup(const cJSON_ObjectIndex * const index, const char * const name, const cJSON_bool case_sensitive)
+{
+    cJSON *current_element = *index_find(index, name);
+
+    /* names are unique ignoring case, so this is the only candidate */
+    if ((current_element != NULL) && case_sensitive && (strcmp(name, current_element->string) != 0))
+    {
+        return NULL;
+    }
+    return current_element;
+}
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
     cJSON *current_element = NULL;
+    const cJSON_ObjectIndex *index = NULL;
 
     if ((object == NULL) || (name == NULL))
     {
         return NULL;
     }
 
+    index = index_of(object);
+    if (index != NULL)
+    {
+        return index_lookup(index, name, case_sensitive);
+    }
+
     current_element = object->child;
     if (case_sensitive)
     {
@@ -2039,6 +2788,8 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         }
     }
 
+    index_added(array, item);
+
     return true;
 }
 
@@ -2273,6 +3024,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
     item->prev = NULL;
     item->next = NULL;
 
+    index_removed(parent, item);
+
     return item;
 }
 
@@ -2347,6 +3100,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON
     {
         newitem->prev->next = newitem;
     }
+    index_added(array, newitem);
     return true;
 }
 
@@ -2392,6 +3146,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
         }
     }
 
+    if (!index_removed(parent, item))
+    {
+        index_added(parent, replacement);
+    }
+
     item->next = NULL;
     item->prev = NULL;
     cJSON_Delete(item);
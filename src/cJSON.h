@@ -148,6 +148,8 @@ CJSON_PUBLIC(const char*) cJSON_Version(void);
 
 /* Supply malloc, realloc and free functions to cJSON */
 CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
+/* Tell the parser whether the CPU and OS support AVX2; cJSON does no CPU detection of its own and uses SSE2 only until told. Call it before parsing on other threads. Ignored when the build defines CJSON_CPU_HAS_AVX2() or on targets other than x86-64. */
+CJSON_PUBLIC(void) cJSON_SetCpuHasAvx2(cJSON_bool has_avx2);
 
 /* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
@@ -158,6 +160,18 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Event-driven parsing, for reading a document without building a tree. Any callback may be NULL; returning false from one stops the parse. key is the member name, or NULL inside an array. Scalars arrive as a temporary item whose string is the member name; copy whatever you want to keep, valuestring is only valid during the call. */
+typedef struct cJSON_Events
+{
+    cJSON_bool (*start_object)(void *context, const char *key);
+    cJSON_bool (*end_object)(void *context);
+    cJSON_bool (*start_array)(void *context, const char *key);
+    cJSON_bool (*end_array)(void *context);
+    cJSON_bool (*value)(void *context, const cJSON *item);
+} cJSON_Events;
+/* Parses like cJSON_ParseWithLength, reporting each value to events instead of building a tree. Returns true if the value parsed and no callback stopped it. */
+CJSON_PUBLIC(cJSON_bool) cJSON_ParseWithEvents(const char *value, size_t buffer_length, const cJSON_Events *events, void *context);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
@@ -178,6 +192,10 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+/* Build a hash index of an object's members, so the two lookups above stop walking the list. Worth it for objects with many members that are looked up often. The functions in this file keep the index up to date; code that relinks child/next or renames members by hand must call cJSON_UnindexObject first. Objects with unnamed members or names that differ only in case keep walking. Lookups never change an index, so they may run concurrently with each other, but not with indexing or changing any object. Returns false for a non-object, a reference or when out of memory. */
+CJSON_PUBLIC(cJSON_bool) cJSON_IndexObject(cJSON *object);
+/* Drop an object's index, if it has one. cJSON_Delete drops it too. */
+CJSON_PUBLIC(void) cJSON_UnindexObject(cJSON *object);
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
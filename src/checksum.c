@@ -0,0 +1,340 @@
+#include <stdatomic.h>
+#include "checksum.h"
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHECKSUM_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <smmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#define CHECKSUM_TARGET(features)
+#else
+#define CHECKSUM_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+#define CRC_POLY 0xedb88320u
+#define ADLER_BASE 65521
+/* Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits in 32 bits. */
+#define ADLER_NMAX 5552
+
+/* Tables and the CPU features are filled in once by whichever thread gets here first. */
+enum { INIT_NONE, INIT_RUNNING, INIT_DONE };
+static atomic_int initState;
+static unsigned int crcTable[8][256];
+static unsigned int cpuFeatures;
+
+static void EnsureInit(void) {
+    if (atomic_load_explicit(&initState, memory_order_acquire) == INIT_DONE)
+        return;
+
+    int expected = INIT_NONE;
+    if (!atomic_compare_exchange_strong(&initState, &expected, INIT_RUNNING)) {
+        while (atomic_load_explicit(&initState, memory_order_acquire) != INIT_DONE) {
+        }
+        return;
+    }
+
+    for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? CRC_POLY ^ (c >> 1) : c >> 1;
+        }
+        crcTable[0][n] = c;
+    }
+    for (unsigned int n = 0; n < 256; n++) {
+        for (int t = 1; t < 8; t++) {
+            unsigned int c = crcTable[t - 1][n];
+            crcTable[t][n] = (c >> 8) ^ crcTable[0][c & 0xff];
+        }
+    }
+    cpuFeatures = CpuFeatures();
+
+    atomic_store_explicit(&initState, INIT_DONE, memory_order_release);
+}
+
+static unsigned int Load32(const unsigned char *p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) |
+           ((unsigned int)p[3] << 24);
+}
+
+/* Slicing-by-8 on the pre-inverted CRC register. */
+static unsigned int Crc32Slice8(unsigned int crc, const unsigned char *p, size_t len) {
+    while (len && ((size_t)p & 7)) {
+        crc = crcTable[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        unsigned int lo = crc ^ Load32(p);
+        unsigned int hi = Load32(p + 4);
+        crc = crcTable[7][lo & 0xff] ^ crcTable[6][(lo >> 8) & 0xff] ^
+              crcTable[5][(lo >> 16) & 0xff] ^ crcTable[4][lo >> 24] ^ crcTable[3][hi & 0xff] ^
+              crcTable[2][(hi >> 8) & 0xff] ^ crcTable[1][(hi >> 16) & 0xff] ^
+              crcTable[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crcTable[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+/* Folds 64-byte blocks with carry-less multiplication, then Barrett-reduces to 32 bits, as in
+ * Intel's "Fast CRC Computation Using PCLMULQDQ". Needs len >= 64 and a multiple of 16; takes
+ * and returns the pre-inverted register. The constants are for the bit-reflected polynomial. */
+CHECKSUM_TARGET("pclmul,sse4.1")
+static unsigned int Crc32Clmul(unsigned int crc, const unsigned char *p, size_t len) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    p += 64;
+    len -= 64;
+
+    x0 = k1k2;
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+        p += 64;
+        len -= 64;
+    }
+
+    /* Fold the four lanes into one, then any remaining 16-byte blocks. */
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+    while (len >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+        p += 16;
+        len -= 16;
+    }
+
+    /* 128 -> 64 bits. */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x0 = k5k0;
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits. */
+    x0 = poly;
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (unsigned int)_mm_extract_epi32(x1, 1);
+}
+
+/* 32 bytes per step: SAD sums the bytes into s1 and a multiply-add against descending weights
+ * gives their contribution to s2. Stops every NMAX bytes to reduce modulo BASE. */
+CHECKSUM_TARGET("ssse3")
+static unsigned int Adler32Ssse3(unsigned int adler, const unsigned char *p, size_t len) {
+    unsigned int s1 = adler & 0xffff;
+    unsigned int s2 = adler >> 16;
+    size_t blocks = len / 32;
+    const __m128i tap1 =
+        _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    len -= blocks * 32;
+    while (blocks) {
+        unsigned int n = ADLER_NMAX / 32;
+        if (n > blocks)
+            n = (unsigned int)blocks;
+        blocks -= n;
+
+        /* vPrev accumulates s1 as it stood before each block; every such s1 adds 32 to s2. */
+        __m128i vPrev = _mm_cvtsi32_si128((int)(s1 * n));
+        __m128i vS2 = _mm_cvtsi32_si128((int)s2);
+        __m128i vS1 = _mm_setzero_si128();
+        do {
+            __m128i bytes1 = _mm_loadu_si128((const __m128i *)p);
+            __m128i bytes2 = _mm_loadu_si128((const __m128i *)(p + 16));
+            vPrev = _mm_add_epi32(vPrev, vS1);
+            vS1 = _mm_add_epi32(vS1, _mm_sad_epu8(bytes1, zero));
+            vS2 = _mm_add_epi32(vS2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            vS1 = _mm_add_epi32(vS1, _mm_sad_epu8(bytes2, zero));
+            vS2 = _mm_add_epi32(vS2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            p += 32;
+        } while (--n);
+        vS2 = _mm_add_epi32(vS2, _mm_slli_epi32(vPrev, 5));
+
+        vS1 = _mm_add_epi32(vS1, _mm_shuffle_epi32(vS1, _MM_SHUFFLE(2, 3, 0, 1)));
+        vS1 = _mm_add_epi32(vS1, _mm_shuffle_epi32(vS1, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (unsigned int)_mm_cvtsi128_si32(vS1);
+        vS2 = _mm_add_epi32(vS2, _mm_shuffle_epi32(vS2, _MM_SHUFFLE(2, 3, 0, 1)));
+        vS2 = _mm_add_epi32(vS2, _mm_shuffle_epi32(vS2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (unsigned int)_mm_cvtsi128_si32(vS2);
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+
+    while (len--) {
+        s1 += *p++;
+        s2 += s1;
+    }
+    return ((s2 % ADLER_BASE) << 16) | (s1 % ADLER_BASE);
+}
+
+/* Adler32Ssse3 with both 16-byte halves in one register. */
+CHECKSUM_TARGET("avx2")
+static unsigned int Adler32Avx2(unsigned int adler, const unsigned char *p, size_t len) {
+    unsigned int s1 = adler & 0xffff;
+    unsigned int s2 = adler >> 16;
+    size_t blocks = len / 32;
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19,
+        18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    len -= blocks * 32;
+    while (blocks) {
+        unsigned int n = ADLER_NMAX / 32;
+        if (n > blocks)
+            n = (unsigned int)blocks;
+        blocks -= n;
+
+        __m256i vPrev = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        __m256i vS2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        __m256i vS1 = _mm256_setzero_si256();
+        do {
+            __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+            vPrev = _mm256_add_epi32(vPrev, vS1);
+            vS1 = _mm256_add_epi32(vS1, _mm256_sad_epu8(bytes, zero));
+            vS2 = _mm256_add_epi32(vS2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, tap), ones));
+            p += 32;
+        } while (--n);
+        vS2 = _mm256_add_epi32(vS2, _mm256_slli_epi32(vPrev, 5));
+
+        __m128i sum1 = _mm_add_epi32(_mm256_castsi256_si128(vS1), _mm256_extracti128_si256(vS1, 1));
+        __m128i sum2 = _mm_add_epi32(_mm256_castsi256_si128(vS2), _mm256_extracti128_si256(vS2, 1));
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (unsigned int)_mm_cvtsi128_si32(sum1);
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (unsigned int)_mm_cvtsi128_si32(sum2);
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+
+    while (len--) {
+        s1 += *p++;
+        s2 += s1;
+    }
+    return ((s2 % ADLER_BASE) << 16) | (s1 % ADLER_BASE);
+}
+#endif
+
+unsigned int Crc32Portable(unsigned int crc, const void *data, size_t len) {
+    EnsureInit();
+    return ~Crc32Slice8(~crc, (const unsigned char *)data, len);
+}
+
+unsigned int Crc32(unsigned int crc, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+
+    EnsureInit();
+    crc = ~crc;
+#ifdef CHECKSUM_X86
+    if ((cpuFeatures & (CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE41)) ==
+            (CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE41) &&
+        len >= 64) {
+        size_t chunk = len & ~(size_t)15;
+        crc = Crc32Clmul(crc, p, chunk);
+        p += chunk;
+        len -= chunk;
+    }
+#endif
+    return ~Crc32Slice8(crc, p, len);
+}
+
+unsigned int Adler32Portable(unsigned int adler, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    unsigned int s1 = adler & 0xffff;
+    unsigned int s2 = adler >> 16;
+
+    while (len > 0) {
+        size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n--) {
+            s1 += *p++;
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+    return (s2 << 16) | s1;
+}
+
+unsigned int Adler32(unsigned int adler, const void *data, size_t len) {
+#ifdef CHECKSUM_X86
+    EnsureInit();
+    if (cpuFeatures & CPU_FEATURE_AVX2)
+        return Adler32Avx2(adler, (const unsigned char *)data, len);
+    if (cpuFeatures & CPU_FEATURE_SSSE3)
+        return Adler32Ssse3(adler, (const unsigned char *)data, len);
+#endif
+    return Adler32Portable(adler, data, len);
+}
+
+void ChecksumLimitFeatures(unsigned int features) {
+    EnsureInit();
+    cpuFeatures = CpuFeatures() & features;
+}
+
+/* Same arithmetic as zlib's adler32_combine. */
+unsigned int Adler32Combine(unsigned int adler1, unsigned int adler2, size_t len2) {
+    unsigned int rem = (unsigned int)(len2 % ADLER_BASE);
+    unsigned int sum1 = adler1 & 0xffff;
+    unsigned int sum2 = (unsigned int)(((unsigned long long)rem * sum1) % ADLER_BASE);
+
+    sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE)
+        sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE)
+        sum1 -= ADLER_BASE;
+    if (sum2 >= (ADLER_BASE << 1))
+        sum2 -= (ADLER_BASE << 1);
+    if (sum2 >= ADLER_BASE)
+        sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
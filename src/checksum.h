@@ -0,0 +1,24 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+
+/* CRC-32 (as used by PNG and gzip) and Adler-32 (zlib). Both take the running value and return
+ * the updated one, starting from 0 and 1 respectively like zlib's crc32 and adler32. The fastest
+ * implementation the CPU supports is picked on first use. */
+
+unsigned int Crc32(unsigned int crc, const void *data, size_t len);
+unsigned int Adler32(unsigned int adler, const void *data, size_t len);
+
+/* Adler-32 of A followed by B, given the checksums of each and the length of B. */
+unsigned int Adler32Combine(unsigned int adler1, unsigned int adler2, size_t len2);
+
+/* The portable implementations, for comparing against the accelerated ones. */
+unsigned int Crc32Portable(unsigned int crc, const void *data, size_t len);
+unsigned int Adler32Portable(unsigned int adler, const void *data, size_t len);
+
+/* Restricts the implementations picked to those needing only the given CPU_FEATURE_* bits, so
+ * each one can be checked against the others. Not safe while other threads are checksumming. */
+void ChecksumLimitFeatures(unsigned int features);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+#include "clipboard_cache.h"
+#include "png_writer.h"
+
+#define DIB_HEADER_SIZE 40
+
+static void FreeSnapshot(ClipboardCache *cache) {
+    free(cache->pixels);
+    PngFree(cache->png);
+    cache->pixels = NULL;
+    cache->png = NULL;
+    cache->pngLen = 0;
+    cache->width = 0;
+    cache->height = 0;
+    cache->offers = 0;
+    cache->ready = 0;
+}
+
+void ClipboardCacheInit(ClipboardCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+}
+
+unsigned char *ClipboardCachePackPixels(const unsigned char *pixels, int stride, int width,
+    int height) {
+    size_t rowBytes = (size_t)width * 4;
+    unsigned char *packed = (unsigned char *)malloc(rowBytes * height);
+    if (!packed)
+        return NULL;
+    for (int y = 0; y < height; y++) {
+        memcpy(packed + rowBytes * y, pixels + (size_t)stride * y, rowBytes);
+    }
+    return packed;
+}
+
+unsigned int ClipboardCacheSet(ClipboardCache *cache, unsigned char *pixels, int width,
+    int height, unsigned int offers) {
+    FreeSnapshot(cache);
+
+    if (++cache->generation == 0)
+        cache->generation = 1;
+
+    if (pixels) {
+        cache->pixels = pixels;
+        cache->width = width;
+        cache->height = height;
+    } else {
+        offers &= ~CLIPBOARD_OFFER_DIB;
+    }
+    cache->offers = offers;
+    cache->ready = offers & (CLIPBOARD_OFFER_DIB | CLIPBOARD_OFFER_FILE);
+    return cache->generation;
+}
+
+int ClipboardCacheSetPng(ClipboardCache *cache, unsigned int generation, unsigned char *png,
+    int len) {
+    if (!png || !ClipboardCacheIsCurrent(cache, generation) ||
+        !(cache->offers & CLIPBOARD_OFFER_PNG) || cache->png)
+        return 0;
+
+    cache->png = png;
+    cache->pngLen = len;
+    cache->ready |= CLIPBOARD_OFFER_PNG;
+    return 1;
+}
+
+int ClipboardCacheIsCurrent(const ClipboardCache *cache, unsigned int generation) {
+    return generation != 0 && generation == cache->generation && cache->offers != 0;
+}
+
+unsigned int ClipboardCacheReady(const ClipboardCache *cache, unsigned int generation) {
+    return ClipboardCacheIsCurrent(cache, generation) ? cache->ready : 0;
+}
+
+size_t ClipboardCacheDibSize(const ClipboardCache *cache) {
+    if (!cache->pixels)
+        return 0;
+    return DIB_HEADER_SIZE + (size_t)cache->width * 4 * cache->height;
+}
+
+static void Put16(unsigned char *p, unsigned int value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static void Put32(unsigned char *p, unsigned int value) {
+    Put16(p, value & 0xffff);
+    Put16(p + 2, value >> 16);
+}
+
+void ClipboardCacheWriteDib(const ClipboardCache *cache, unsigned char *dst) {
+    size_t rowBytes = (size_t)cache->width * 4;
+
+    memset(dst, 0, DIB_HEADER_SIZE);
+    Put32(dst, DIB_HEADER_SIZE);
+    Put32(dst + 4, (unsigned int)cache->width);
+    Put32(dst + 8, (unsigned int)cache->height); /* positive: bottom-up */
+    Put16(dst + 12, 1);                          /* planes */
+    Put16(dst + 14, 32);                         /* bits per pixel, BI_RGB */
+    Put32(dst + 20, (unsigned int)(rowBytes * cache->height));
+
+    unsigned char *rows = dst + DIB_HEADER_SIZE;
+    for (int y = 0; y < cache->height; y++) {
+        memcpy(rows + rowBytes * (cache->height - 1 - y), cache->pixels + rowBytes * y, rowBytes);
+    }
+}
+
+const unsigned char *ClipboardCachePng(const ClipboardCache *cache, int *len) {
+    *len = cache->pngLen;
+    return cache->png;
+}
+
+void ClipboardCacheRelease(ClipboardCache *cache, unsigned int generation) {
+    if (generation == cache->generation)
+        FreeSnapshot(cache);
+}
@@ -0,0 +1,62 @@
+#ifndef CLIPBOARD_CACHE_H
+#define CLIPBOARD_CACHE_H
+
+#include <stddef.h>
+
+/* Backing store for delay-rendered clipboard screenshots. The worker produces each format of a
+ * capture ahead of time and marks it ready; a paste only copies ready data out, so rendering
+ * never encodes or waits on the thread that owns the clipboard. Not thread-safe: callers
+ * serialize access, and do the slow work (packing, encoding) outside that serialization. */
+
+#define CLIPBOARD_OFFER_DIB 0x1
+#define CLIPBOARD_OFFER_PNG 0x2
+#define CLIPBOARD_OFFER_FILE 0x4 /* no pixel data; the caller supplies the file */
+
+typedef struct {
+    unsigned int generation; /* bumped by every ClipboardCacheSet, never 0 once set */
+    unsigned int offers;     /* CLIPBOARD_OFFER_* bits the snapshot will provide */
+    unsigned int ready;      /* the subset of offers that can be rendered now */
+
+    unsigned char *pixels; /* packed top-down BGRX copy of the capture */
+    int width;
+    int height;
+
+    unsigned char *png;
+    int pngLen;
+} ClipboardCache;
+
+void ClipboardCacheInit(ClipboardCache *cache);
+
+/* Packs a capture into the tightly packed copy ClipboardCacheSet takes. Returns NULL if it
+ * cannot be allocated. */
+unsigned char *ClipboardCachePackPixels(const unsigned char *pixels, int stride, int width,
+    int height);
+
+/* Replaces the snapshot, taking ownership of pixels from ClipboardCachePackPixels (NULL when
+ * the DIB is not offered). The DIB and the file are ready at once; the PNG once it is
+ * attached. Returns the new generation. */
+unsigned int ClipboardCacheSet(ClipboardCache *cache, unsigned char *pixels, int width,
+    int height, unsigned int offers);
+
+/* Attaches the PNG encode of a snapshot and takes ownership of it. Returns 0, leaving png with
+ * the caller, if generation is no longer current or does not offer a PNG. */
+int ClipboardCacheSetPng(ClipboardCache *cache, unsigned int generation, unsigned char *png,
+    int len);
+
+int ClipboardCacheIsCurrent(const ClipboardCache *cache, unsigned int generation);
+
+/* The CLIPBOARD_OFFER_* bits of generation that can be rendered now, 0 if it is not current. */
+unsigned int ClipboardCacheReady(const ClipboardCache *cache, unsigned int generation);
+
+/* CF_DIB layout: a 40-byte BITMAPINFOHEADER followed by bottom-up 32-bit rows. */
+size_t ClipboardCacheDibSize(const ClipboardCache *cache);
+void ClipboardCacheWriteDib(const ClipboardCache *cache, unsigned char *dst);
+
+/* The attached PNG, or NULL. The buffer stays owned by the cache. */
+const unsigned char *ClipboardCachePng(const ClipboardCache *cache, int *len);
+
+/* Drops the snapshot if generation is still the current one, so a clipboard release that races
+ * with a newer capture leaves the newer one alone. */
+void ClipboardCacheRelease(ClipboardCache *cache, unsigned int generation);
+
+#endif
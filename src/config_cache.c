@@ -0,0 +1,112 @@
+#include "config_cache.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "checksum.h"
+
+typedef struct {
+    unsigned char magic[4];
+    unsigned int version;
+    unsigned int payloadBytes;
+    unsigned int payloadCrc;
+    ConfigSource source;
+} ConfigCacheHeader;
+
+static const unsigned char cacheMagic[4] = {'M', 'K', 'C', 'C'};
+
+size_t ConfigCacheBytes(void) {
+    return sizeof(ConfigCacheHeader) + sizeof(CompiledConfig);
+}
+
+unsigned int ConfigCacheLayout(void) {
+    const unsigned int layout[] = {
+        CONFIG_CACHE_VERSION,
+        (unsigned int)sizeof(CompiledConfig),
+        (unsigned int)offsetof(CompiledConfig, bindingCount),
+        (unsigned int)offsetof(CompiledConfig, inputBatch),
+        (unsigned int)offsetof(CompiledConfig, wheel),
+        (unsigned int)offsetof(CompiledConfig, replayFps),
+        (unsigned int)offsetof(CompiledConfig, replaySeconds),
+        (unsigned int)offsetof(CompiledConfig, replayMemoryMb),
+        (unsigned int)sizeof(HotkeyBinding),
+        (unsigned int)offsetof(HotkeyBinding, triggerType),
+        (unsigned int)offsetof(HotkeyBinding, trigger),
+        (unsigned int)offsetof(HotkeyBinding, action),
+        (unsigned int)sizeof(WheelSettings),
+        MAX_BINDINGS,
+        DISPATCH_KEY_COUNT,
+        MOUSE_BUTTON_COUNT,
+        WHEEL_DIRECTION_COUNT,
+        ACTION_REPLAY_SAVE_PNG_SEQUENCE,
+    };
+    return Crc32(0, layout, sizeof(layout));
+}
+
+int ConfigSourceSameContent(const ConfigSource *a, const ConfigSource *b) {
+    return a->size == b->size && a->crc == b->crc && a->build == b->build;
+}
+
+void ConfigCacheBuild(unsigned char *image, const ConfigSource *source,
+    const CompiledConfig *config) {
+    ConfigCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = CONFIG_CACHE_VERSION;
+    header.payloadBytes = (unsigned int)sizeof(CompiledConfig);
+    header.payloadCrc = Crc32(0, config, sizeof(CompiledConfig));
+    header.source = *source;
+
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + sizeof(header), config, sizeof(CompiledConfig));
+}
+
+static int ModifierValid(ModifierState state) {
+    return state >= MODIFIER_NONE && state <= MODIFIER_BOTH;
+}
+
+/* The dispatch table indexes arrays by trigger, so an image that passes the CRC but was written
+ * by a build with other enums must still not reach it with out-of-range values. */
+static int BindingValid(const HotkeyBinding *b) {
+    if (!ModifierValid(b->ctrl) || !ModifierValid(b->shift) || !ModifierValid(b->alt) ||
+        !ModifierValid(b->win))
+        return 0;
+
+    switch (b->triggerType) {
+    case TRIGGER_KEYBOARD:
+        return b->trigger.keyCode < DISPATCH_KEY_COUNT;
+    case TRIGGER_MOUSE_BUTTON:
+        return (unsigned)b->trigger.mouseButton < MOUSE_BUTTON_COUNT;
+    case TRIGGER_MOUSE_WHEEL:
+        return (unsigned)b->trigger.wheelDir < WHEEL_DIRECTION_COUNT;
+    default:
+        return 0;
+    }
+}
+
+int ConfigCacheLoad(const unsigned char *image, size_t size, const ConfigSource *source,
+    CompiledConfig *config) {
+    ConfigCacheHeader header;
+    if (size != ConfigCacheBytes())
+        return 0;
+
+    memcpy(&header, image, sizeof(header));
+    if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+        header.version != CONFIG_CACHE_VERSION ||
+        header.payloadBytes != sizeof(CompiledConfig) ||
+        header.source.size != source->size || header.source.modified != source->modified ||
+        header.source.crc != source->crc || header.source.build != source->build)
+        return 0;
+
+    const unsigned char *payload = image + sizeof(header);
+    if (Crc32(0, payload, sizeof(CompiledConfig)) != header.payloadCrc)
+        return 0;
+
+    memcpy(config, payload, sizeof(CompiledConfig));
+    if (config->bindingCount < 0 || config->bindingCount > MAX_BINDINGS)
+        return 0;
+    for (int i = 0; i < config->bindingCount; i++) {
+        if (!BindingValid(&config->bindings[i]))
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,55 @@
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <stddef.h>
+#include "hotkeys.h"
+#include "wheel_accumulator.h"
+
+/* Everything LoadConfig derives from config.json, in the form the app uses it, so a later load
+ * of the same JSON can skip parsing. */
+typedef struct {
+    HotkeyBinding bindings[MAX_BINDINGS];
+    int bindingCount;
+    int inputBatch;
+    WheelSettings wheel;
+    int replayFps;
+    int replaySeconds;
+    int replayMemoryMb;
+} CompiledConfig;
+
+/* Identifies the JSON an image was compiled from. build should change whenever the program
+ * could compile the same JSON differently: the app mixes ConfigCacheLayout() with the size and
+ * write time of its own executable. */
+typedef struct {
+    unsigned long long size;
+    unsigned long long modified;
+    unsigned int crc;
+    unsigned int build;
+} ConfigSource;
+
+/* The image is a header ("MKCC", version, payload size and CRC-32, then the source key)
+ * followed by the CompiledConfig as it sits in memory, so it is only meaningful to the build
+ * that wrote it. Bump the version when CompiledConfig or the enums it holds change. */
+#define CONFIG_CACHE_VERSION 1
+
+size_t ConfigCacheBytes(void);
+
+/* A hash of the sizes and offsets in CompiledConfig and the enum ranges it holds, so an image
+ * from a build with another layout never loads even if the version was not bumped. */
+unsigned int ConfigCacheLayout(void);
+
+/* Nonzero if a and b name the same JSON for the same build. The write time is left out: saving
+ * a file without changing it compiles to the same config. */
+int ConfigSourceSameContent(const ConfigSource *a, const ConfigSource *b);
+
+/* Fills image, which must hold ConfigCacheBytes(). config should have been zeroed before it was
+ * filled in so the padding is the same every time. */
+void ConfigCacheBuild(unsigned char *image, const ConfigSource *source,
+    const CompiledConfig *config);
+
+/* Returns 1 and fills config if image is intact, from this version and compiled from source.
+ * A torn or stale image just reads as a miss. */
+int ConfigCacheLoad(const unsigned char *image, size_t size, const ConfigSource *source,
+    CompiledConfig *config);
+
+#endif
@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "config_compile.h"
+#include "config_name_tables.h"
+#include "config_names.h"
+#include "input_batch.h"
+
+static void IgnoreLog(const char *format, ...) {
+    (void)format;
+}
+
+/* Only set while CompileConfig runs. */
+static ConfigLogFunc configLog = IgnoreLog;
+static Arena *configArena;
+
+/* ASCII only, which is all the config keywords use. */
+static int CompareIgnoringCase(const char *a, const char *b) {
+    for (;; a++, b++) {
+        int ca = *a >= 'A' && *a <= 'Z' ? *a + ('a' - 'A') : *a;
+        int cb = *b >= 'A' && *b <= 'Z' ? *b + ('a' - 'A') : *b;
+        if (ca != cb || ca == 0)
+            return ca - cb;
+    }
+}
+
+#define NAME_COUNT(names) ((int)(sizeof(names) / sizeof(names[0])))
+
+static ModifierState ParseModifierState(const char *str) {
+    if (!str)
+        return MODIFIER_NONE;
+    const NameEntry *entry = NameTableFind(&modifierTable, str);
+    if (entry)
+        return (ModifierState)entry->value;
+    configLog("Warning: unrecognized modifier '%s', using 'none'", str);
+    return MODIFIER_NONE;
+}
+
+static MediaAction ParseAction(const char *str) {
+    if (!str) {
+        configLog("Warning: missing action");
+        return ACTION_NONE;
+    }
+    const NameEntry *entry = NameTableFind(&actionTable, str);
+    if (entry)
+        return (MediaAction)entry->value;
+    configLog("Warning: unrecognized action '%s'", str);
+    return ACTION_NONE;
+}
+
+static int ParseTrigger(const char *str, TriggerType *type, HotkeyBinding *binding) {
+    if (!str) {
+        configLog("Warning: missing trigger");
+        return 0;
+    }
+
+    /* Values are packed by TRIGGER_NAME_VALUE. */
+    const NameEntry *entry = NameTableFind(&triggerTable, str);
+    if (entry) {
+        int code = entry->value & 0xFFFF;
+        *type = (TriggerType)(entry->value >> 16);
+        if (*type == TRIGGER_MOUSE_WHEEL)
+            binding->trigger.wheelDir = (WheelDirection)code;
+        else if (*type == TRIGGER_MOUSE_BUTTON)
+            binding->trigger.mouseButton = (MouseButton)code;
+        else
+            binding->trigger.keyCode = (unsigned int)code;
+        return 1;
+    }
+
+    if (strncmp(str, "key_", 4) == 0) {
+        const char *keyName = str + 4;
+        char *endptr;
+        unsigned long code = strtoul(keyName, &endptr, 0);
+        if (endptr == keyName || *endptr != '\0' || code >= DISPATCH_KEY_COUNT) {
+            configLog("Warning: invalid key code '%s'", str);
+            return 0;
+        }
+        *type = TRIGGER_KEYBOARD;
+        binding->trigger.keyCode = (unsigned int)code;
+        return 1;
+    }
+
+    configLog("Warning: unrecognized trigger '%s'", str);
+    return 0;
+}
+
+static int ReadConfigInt(const cJSON *object, const char *name, int fallback, int min,
+    int max) {
+    const cJSON *item = cJSON_GetObjectItem(object, name);
+    if (!item)
+        return fallback;
+    if (!cJSON_IsNumber(item)) {
+        configLog("Warning: '%s' is not a number, using %d", name, fallback);
+        return fallback;
+    }
+
+    double value = cJSON_GetNumberValue(item);
+    if (value < min || value > max) {
+        configLog("Warning: '%s' must be between %d and %d, using %d", name, min, max,
+            fallback);
+        return fallback;
+    }
+    return (int)value;
+}
+
+/* A "replay" object turns background capture on; leaving it out (or fps 0) turns it off. */
+static void ReadReplaySettings(const cJSON *replay, CompiledConfig *config) {
+    config->replayFps = 0;
+    config->replaySeconds = REPLAY_DEFAULT_SECONDS;
+    config->replayMemoryMb = REPLAY_DEFAULT_MEMORY_MB;
+
+    if (cJSON_IsObject(replay)) {
+        config->replayFps = ReadConfigInt(replay, "fps", REPLAY_DEFAULT_FPS, 0, REPLAY_MAX_FPS);
+        config->replaySeconds = ReadConfigInt(replay, "seconds", REPLAY_DEFAULT_SECONDS, 1,
+            REPLAY_MAX_SECONDS);
+        config->replayMemoryMb = ReadConfigInt(replay, "memory_mb", REPLAY_DEFAULT_MEMORY_MB, 1,
+            REPLAY_MAX_MEMORY_MB);
+    }
+}
+
+/* Wheel bindings step their action once per notch by default, at most once per interval. */
+static void ReadWheelSettings(const cJSON *config, WheelSettings *settings) {
+    settings->stepsPerNotch = 1;
+    settings->intervalMs = WHEEL_DEFAULT_INTERVAL_MS;
+    settings->accelStartRate = WHEEL_DEFAULT_ACCEL_START;
+    settings->accelerationPercent = 0;
+
+    if (cJSON_IsObject(config)) {
+        settings->stepsPerNotch = ReadConfigInt(config, "step", 1, 1, 100);
+        settings->intervalMs = ReadConfigInt(config, "interval_ms", WHEEL_DEFAULT_INTERVAL_MS, 0,
+            1000);
+        settings->accelerationPercent = ReadConfigInt(config, "acceleration", 0, 0, 1000);
+        settings->accelStartRate = ReadConfigInt(config, "acceleration_start",
+            WHEEL_DEFAULT_ACCEL_START, 0, 100);
+    }
+}
+
+static void CompileSettings(const cJSON *root, CompiledConfig *config) {
+    config->inputBatch = ReadConfigInt(root, "input_batch", INPUT_BATCH_DEFAULT, 2,
+        INPUT_BATCH_CAPACITY);
+    ReadWheelSettings(cJSON_GetObjectItem(root, "wheel"), &config->wheel);
+    ReadReplaySettings(cJSON_GetObjectItem(root, "replay"), config);
+}
+
+/* The config is decoded from parse events rather than a cJSON tree. For each object it reads,
+ * a MemberSet keeps the first value of every member it wants, just as cJSON_GetObjectItem would
+ * find it. The members are also linked under a stand-in object so the settings readers above
+ * work on it unchanged. */
+#define MEMBER_SET_MAX 6
+#define MEMBER_TEXT_BYTES 512
+
+typedef struct {
+    const char *const *names;
+    int count;
+    cJSON object;
+    cJSON members[MEMBER_SET_MAX];
+    char text[MEMBER_TEXT_BYTES];
+    size_t textUsed;
+} MemberSet;
+
+static const char *const rootMemberNames[] = {"bindings", "input_batch", "wheel", "replay"};
+static const char *const wheelMemberNames[] = {
+    "step", "interval_ms", "acceleration", "acceleration_start"};
+static const char *const replayMemberNames[] = {"fps", "seconds", "memory_mb"};
+static const char *const bindingMemberNames[] = {
+    "ctrl", "shift", "alt", "win", "trigger", "action"};
+enum { BINDING_CTRL, BINDING_SHIFT, BINDING_ALT, BINDING_WIN, BINDING_TRIGGER, BINDING_ACTION };
+
+#define ROOT_MEMBER_BINDINGS 0
+#define ROOT_MEMBER_WHEEL 2
+#define ROOT_MEMBER_REPLAY 3
+
+static void MemberSetInit(MemberSet *set, const char *const *names, int count) {
+    memset(set, 0, sizeof(*set));
+    set->names = names;
+    set->count = count;
+    set->object.type = cJSON_Object;
+}
+
+/* Forgets the members found so far, for reading the next object of the same kind. */
+static void MemberSetClear(MemberSet *set) {
+    memset(set->members, 0, sizeof(set->members[0]) * (size_t)set->count);
+    set->object.child = NULL;
+    set->textUsed = 0;
+}
+
+/* The member's string value, or NULL if it is missing or not a string. */
+static const char *MemberSetString(const MemberSet *set, int index) {
+    return set->members[index].string ? cJSON_GetStringValue(&set->members[index]) : NULL;
+}
+
+/* Returns the member's node the first time one of the wanted names appears, otherwise NULL. */
+static cJSON *MemberSetClaim(MemberSet *set, const char *key) {
+    if (!key)
+        return NULL;
+    for (int i = 0; i < set->count; i++) {
+        if (CompareIgnoringCase(key, set->names[i]) != 0)
+            continue;
+        cJSON *node = &set->members[i];
+        if (node->string)
+            return NULL;
+        node->string = (char *)set->names[i];
+        node->next = set->object.child;
+        set->object.child = node;
+        return node;
+    }
+    return NULL;
+}
+
+/* Copies a scalar into node. Strings only live as long as the parse event, so they are kept in
+ * the set, or in the arena if they do not fit. */
+static int MemberSetCopy(MemberSet *set, cJSON *node, const cJSON *item) {
+    node->type = item->type;
+    node->valueint = item->valueint;
+    node->valuedouble = item->valuedouble;
+    if (!item->valuestring)
+        return 1;
+
+    size_t size = strlen(item->valuestring) + 1;
+    char *copy = set->text + set->textUsed;
+    if (size <= sizeof(set->text) - set->textUsed)
+        set->textUsed += size;
+    else if (!(copy = (char *)ArenaAlloc(configArena, size)))
+        return 0;
+    memcpy(copy, item->valuestring, size);
+    node->valuestring = copy;
+    return 1;
+}
+
+typedef enum { SECTION_OTHER, SECTION_BINDINGS, SECTION_WHEEL, SECTION_REPLAY } ConfigSection;
+
+typedef struct {
+    CompiledConfig *config;
+    int depth;             /* containers open around the current event */
+    int rootIsObject;
+    ConfigSection section; /* the root member being read, below depth 1 */
+    int inBinding;        /* inside a bindings element that is an object */
+    MemberSet root;
+    MemberSet wheel;
+    MemberSet replay;
+    MemberSet binding;
+} ConfigDecoder;
+
+static void CompileBinding(const MemberSet *fields, CompiledConfig *config) {
+    HotkeyBinding *b = &config->bindings[config->bindingCount];
+
+    b->ctrl = ParseModifierState(MemberSetString(fields, BINDING_CTRL));
+    b->shift = ParseModifierState(MemberSetString(fields, BINDING_SHIFT));
+    b->alt = ParseModifierState(MemberSetString(fields, BINDING_ALT));
+    b->win = ParseModifierState(MemberSetString(fields, BINDING_WIN));
+
+    if (!ParseTrigger(MemberSetString(fields, BINDING_TRIGGER), &b->triggerType, b)) {
+        memset(b, 0, sizeof(*b));
+        return;
+    }
+
+    b->action = ParseAction(MemberSetString(fields, BINDING_ACTION));
+    config->bindingCount++;
+}
+
+/* Elements of "bindings" that are not objects have no fields, like an empty object. */
+static void CompileEmptyBinding(ConfigDecoder *decoder) {
+    if (decoder->config->bindingCount < MAX_BINDINGS) {
+        MemberSetClear(&decoder->binding);
+        CompileBinding(&decoder->binding, decoder->config);
+    }
+}
+
+static MemberSet *SectionMembers(ConfigDecoder *decoder) {
+    if (decoder->depth == 1 && decoder->rootIsObject)
+        return &decoder->root;
+    if (decoder->depth == 2 && decoder->section == SECTION_WHEEL)
+        return &decoder->wheel;
+    if (decoder->depth == 2 && decoder->section == SECTION_REPLAY)
+        return &decoder->replay;
+    if (decoder->depth == 3 && decoder->inBinding)
+        return &decoder->binding;
+    return NULL;
+}
+
+static int DecodeContainerStart(ConfigDecoder *decoder, const char *key, int type) {
+    if (decoder->depth == 0) {
+        decoder->rootIsObject = type == cJSON_Object;
+    } else if (decoder->depth == 2 && decoder->section == SECTION_BINDINGS) {
+        if (type == cJSON_Object && decoder->config->bindingCount < MAX_BINDINGS) {
+            MemberSetClear(&decoder->binding);
+            decoder->inBinding = 1;
+        } else {
+            CompileEmptyBinding(decoder);
+        }
+    } else {
+        MemberSet *set = SectionMembers(decoder);
+        cJSON *node = set ? MemberSetClaim(set, key) : NULL;
+        if (node)
+            node->type = type;
+        if (set == &decoder->root) {
+            decoder->section = SECTION_OTHER;
+            if (node == &decoder->root.members[ROOT_MEMBER_BINDINGS] && type == cJSON_Array)
+                decoder->section = SECTION_BINDINGS;
+            else if (node == &decoder->root.members[ROOT_MEMBER_WHEEL] && type == cJSON_Object)
+                decoder->section = SECTION_WHEEL;
+            else if (node == &decoder->root.members[ROOT_MEMBER_REPLAY] && type == cJSON_Object)
+                decoder->section = SECTION_REPLAY;
+        }
+    }
+    decoder->depth++;
+    return 1;
+}
+
+static cJSON_bool DecodeObjectStart(void *context, const char *key) {
+    return DecodeContainerStart((ConfigDecoder *)context, key, cJSON_Object);
+}
+
+static cJSON_bool DecodeArrayStart(void *context, const char *key) {
+    return DecodeContainerStart((ConfigDecoder *)context, key, cJSON_Array);
+}
+
+static cJSON_bool DecodeContainerEnd(void *context) {
+    ConfigDecoder *decoder = (ConfigDecoder *)context;
+    decoder->depth--;
+    if (decoder->depth == 2 && decoder->inBinding) {
+        CompileBinding(&decoder->binding, decoder->config);
+        decoder->inBinding = 0;
+    } else if (decoder->depth == 1) {
+        decoder->section = SECTION_OTHER;
+    }
+    return 1;
+}
+
+static cJSON_bool DecodeValue(void *context, const cJSON *item) {
+    ConfigDecoder *decoder = (ConfigDecoder *)context;
+    if (decoder->depth == 2 && decoder->section == SECTION_BINDINGS) {
+        CompileEmptyBinding(decoder);
+        return 1;
+    }
+
+    MemberSet *set = SectionMembers(decoder);
+    cJSON *node = set ? MemberSetClaim(set, item->string) : NULL;
+    return !node || MemberSetCopy(set, node, item);
+}
+
+static void *CJSON_CDECL ConfigArenaAlloc(size_t size) {
+    return ArenaAlloc(configArena, size);
+}
+
+static void CJSON_CDECL ConfigArenaFree(void *p) {
+    (void)p;
+}
+
+/* Bindings are compiled as their objects close, so no tree is ever built. Anything cJSON still
+ * allocates (only very long strings and numbers) and any long member text goes in the arena,
+ * which is dropped in one reset. The cJSON hooks are only swapped for the parse, so callers
+ * must not use cJSON on another thread meanwhile. */
+int CompileConfig(const char *json, CompiledConfig *config, Arena *arena, ConfigLogFunc log) {
+    static ConfigDecoder decoder;
+    static const cJSON_Events events = {
+        DecodeObjectStart, DecodeContainerEnd, DecodeArrayStart, DecodeContainerEnd, DecodeValue};
+
+    configLog = log ? log : IgnoreLog;
+    configArena = arena;
+
+    /* Zeroed first so the padding, and with it the cache image, is the same every time. */
+    memset(config, 0, sizeof(*config));
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.config = config;
+    MemberSetInit(&decoder.root, rootMemberNames, NAME_COUNT(rootMemberNames));
+    MemberSetInit(&decoder.wheel, wheelMemberNames, NAME_COUNT(wheelMemberNames));
+    MemberSetInit(&decoder.replay, replayMemberNames, NAME_COUNT(replayMemberNames));
+    MemberSetInit(&decoder.binding, bindingMemberNames, NAME_COUNT(bindingMemberNames));
+
+    cJSON_Hooks hooks = {ConfigArenaAlloc, ConfigArenaFree};
+    cJSON_InitHooks(&hooks);
+    int compiled = cJSON_ParseWithEvents(json, strlen(json) + 1, &events, &decoder);
+    cJSON_InitHooks(NULL);
+
+    cJSON *bindingsNode = &decoder.root.members[ROOT_MEMBER_BINDINGS];
+    if (compiled && bindingsNode->string && bindingsNode->type == cJSON_Array) {
+        if (decoder.root.members[ROOT_MEMBER_WHEEL].type == cJSON_Object)
+            decoder.root.members[ROOT_MEMBER_WHEEL].child = decoder.wheel.object.child;
+        if (decoder.root.members[ROOT_MEMBER_REPLAY].type == cJSON_Object)
+            decoder.root.members[ROOT_MEMBER_REPLAY].child = decoder.replay.object.child;
+        CompileSettings(&decoder.root.object, config);
+    } else {
+        compiled = 0;
+    }
+
+    ArenaReset(configArena);
+    configArena = NULL;
+    configLog = IgnoreLog;
+    return compiled;
+}
+
+const char *ConfigActionName(MediaAction action) {
+    for (int i = 0; i < NAME_COUNT(actionNames); i++) {
+        if (actionNames[i].value == (int)action)
+            return actionNames[i].name;
+    }
+    return NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef CONFIG_COMPILE_H
+#define CONFIG_COMPILE_H
+
+#include "arena.h"
+#include "config_cache.h"
+
+/* Turns config.json into a CompiledConfig. Nothing in here depends on windows.h, so the same
+ * code that loads the app's config also loads the one an input trace was recorded with. */
+
+#define INPUT_BATCH_DEFAULT 64
+#define WHEEL_DEFAULT_INTERVAL_MS 40
+#define WHEEL_DEFAULT_ACCEL_START 5
+#define REPLAY_DEFAULT_FPS 10
+#define REPLAY_DEFAULT_SECONDS 30
+#define REPLAY_DEFAULT_MEMORY_MB 256
+#define REPLAY_MAX_FPS 60
+#define REPLAY_MAX_SECONDS 600
+#define REPLAY_MAX_MEMORY_MB 4096
+
+/* Receives the warnings about entries that were skipped or replaced by defaults. */
+typedef void (*ConfigLogFunc)(const char *format, ...);
+
+/* Compiles the NUL-terminated json into config. Scratch memory comes from arena, which is
+ * reset before returning. Returns 0 if the JSON does not parse or has no "bindings" array. Not
+ * reentrant: it uses the global cJSON hooks and a static decoder. */
+int CompileConfig(const char *json, CompiledConfig *config, Arena *arena, ConfigLogFunc log);
+
+/* The config keyword for an action, or NULL if it has none. */
+const char *ConfigActionName(MediaAction action);
+
+#endif
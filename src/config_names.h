@@ -0,0 +1,92 @@
+#ifndef CONFIG_NAMES_H
+#define CONFIG_NAMES_H
+
+/* Every keyword config.json accepts, as X-macro lists. tools/config_names_gen.c turns them into
+ * the lookup tables and into the README's Modifiers, Triggers and Actions tables, so edit them
+ * here and run `zig build readme`. Key codes are Win32 virtual keys, written out so the lists
+ * need no windows.h. */
+
+/* Name, ModifierState, then the README description. */
+#define CONFIG_MODIFIER_NAMES(X) \
+    X("none", MODIFIER_NONE, "Modifier must not be pressed (default)") \
+    X("left", MODIFIER_LEFT, "Only left modifier") \
+    X("right", MODIFIER_RIGHT, "Only right modifier") \
+    X("either", MODIFIER_EITHER, "Either left or right") \
+    X("both", MODIFIER_BOTH, "Both left and right must be pressed")
+
+/* Name, MediaAction, then the README description. */
+#define CONFIG_ACTION_NAMES(X) \
+    X("volume_up", ACTION_VOLUME_UP, "Increase volume") \
+    X("volume_down", ACTION_VOLUME_DOWN, "Decrease volume") \
+    X("volume_mute", ACTION_VOLUME_MUTE, "Toggle mute") \
+    X("play_pause", ACTION_PLAY_PAUSE, "Play/pause media") \
+    X("prev_track", ACTION_PREV_TRACK, "Previous track") \
+    X("next_track", ACTION_NEXT_TRACK, "Next track") \
+    X("screenshot_client_clipboard", ACTION_SCREENSHOT_CLIENT_CLIPBOARD, \
+        "Capture active window's client area to clipboard") \
+    X("screenshot_client_file", ACTION_SCREENSHOT_CLIENT_FILE, \
+        "Capture active window's client area to PNG file") \
+    X("screenshot_client_file_clipboard", ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD, \
+        "Capture to PNG file and copy the file to clipboard") \
+    X("screenshot_client_file_fast", ACTION_SCREENSHOT_CLIENT_FILE_FAST, \
+        "Capture to a larger PNG file that is much quicker to write, for bursts") \
+    X("screenshot_client_file_qoi", ACTION_SCREENSHOT_CLIENT_FILE_QOI, \
+        "Capture to a [QOI](https://qoiformat.org) file, the fastest to write") \
+    X("replay_save_apng", ACTION_REPLAY_SAVE_APNG, \
+        "Save the instant replay history as an animated PNG") \
+    X("replay_save_png_sequence", ACTION_REPLAY_SAVE_PNG_SEQUENCE, \
+        "Save the instant replay history as a folder of numbered PNG files")
+
+/* Name, TriggerType, the WheelDirection or MouseButton, then the README description. */
+#define CONFIG_MOUSE_TRIGGER_NAMES(X) \
+    X("wheel_up", TRIGGER_MOUSE_WHEEL, WHEEL_UP, "Mouse wheel up") \
+    X("wheel_down", TRIGGER_MOUSE_WHEEL, WHEEL_DOWN, "Mouse wheel down") \
+    X("mouse_left", TRIGGER_MOUSE_BUTTON, MOUSE_BUTTON_LEFT, "Left mouse button") \
+    X("mouse_right", TRIGGER_MOUSE_BUTTON, MOUSE_BUTTON_RIGHT, "Right mouse button") \
+    X("mouse_middle", TRIGGER_MOUSE_BUTTON, MOUSE_BUTTON_MIDDLE, "Middle mouse button") \
+    X("mouse_x1", TRIGGER_MOUSE_BUTTON, MOUSE_BUTTON_X1, "Mouse back button") \
+    X("mouse_x2", TRIGGER_MOUSE_BUTTON, MOUSE_BUTTON_X2, "Mouse forward button")
+
+/* Keyboard triggers, written key_<name> in the config. */
+#define CONFIG_KEY_NAMES(X) \
+    /* Letters */ \
+    X("a", 0x41) X("b", 0x42) X("c", 0x43) X("d", 0x44) \
+    X("e", 0x45) X("f", 0x46) X("g", 0x47) X("h", 0x48) \
+    X("i", 0x49) X("j", 0x4A) X("k", 0x4B) X("l", 0x4C) \
+    X("m", 0x4D) X("n", 0x4E) X("o", 0x4F) X("p", 0x50) \
+    X("q", 0x51) X("r", 0x52) X("s", 0x53) X("t", 0x54) \
+    X("u", 0x55) X("v", 0x56) X("w", 0x57) X("x", 0x58) \
+    X("y", 0x59) X("z", 0x5A) \
+    /* Digits */ \
+    X("0", 0x30) X("1", 0x31) X("2", 0x32) X("3", 0x33) \
+    X("4", 0x34) X("5", 0x35) X("6", 0x36) X("7", 0x37) \
+    X("8", 0x38) X("9", 0x39) \
+    /* Function keys */ \
+    X("f1", 0x70) X("f2", 0x71) X("f3", 0x72) X("f4", 0x73) \
+    X("f5", 0x74) X("f6", 0x75) X("f7", 0x76) X("f8", 0x77) \
+    X("f9", 0x78) X("f10", 0x79) X("f11", 0x7A) X("f12", 0x7B) \
+    /* Common keys */ \
+    X("space", 0x20) X("enter", 0x0D) X("tab", 0x09) \
+    X("escape", 0x1B) X("backspace", 0x08) X("delete", 0x2E) \
+    X("insert", 0x2D) X("home", 0x24) X("end", 0x23) \
+    X("pageup", 0x21) X("pagedown", 0x22) \
+    X("up", 0x26) X("down", 0x28) X("left", 0x25) X("right", 0x27) \
+    X("printscreen", 0x2C) X("scrolllock", 0x91) X("pause", 0x13) \
+    X("numlock", 0x90) X("capslock", 0x14) \
+    /* Numpad */ \
+    X("num0", 0x60) X("num1", 0x61) X("num2", 0x62) \
+    X("num3", 0x63) X("num4", 0x64) X("num5", 0x65) \
+    X("num6", 0x66) X("num7", 0x67) X("num8", 0x68) \
+    X("num9", 0x69) X("nummultiply", 0x6A) X("numadd", 0x6B) \
+    X("numsubtract", 0x6D) X("numdecimal", 0x6E) X("numdivide", 0x6F) \
+    /* Punctuation */ \
+    X("semicolon", 0xBA) X("equals", 0xBB) X("comma", 0xBC) \
+    X("minus", 0xBD) X("period", 0xBE) X("slash", 0xBF) \
+    X("backtick", 0xC0) X("lbracket", 0xDB) X("backslash", 0xDC) \
+    X("rbracket", 0xDD) X("quote", 0xDE)
+
+/* Trigger names map to the trigger type in the high half and the key code, button or wheel
+ * direction in the low half. */
+#define TRIGGER_NAME_VALUE(type, code) (((int)(type) << 16) | (int)(code))
+
+#endif
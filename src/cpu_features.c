@@ -0,0 +1,74 @@
+#include <stdatomic.h>
+#include "cpu_features.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+/* Set alongside the feature bits so a zero result is distinguishable from "not detected". */
+#define CPU_FEATURES_DETECTED 0x80000000u
+
+static atomic_uint cachedFeatures;
+
+#ifdef CPU_X86
+static unsigned long long ReadXcr0(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+static unsigned int DetectFeatures(void) {
+    unsigned int features = 0;
+#ifdef CPU_X86
+    unsigned int ecx, leaf7Ebx = 0;
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    ecx = (unsigned int)regs[2];
+    __cpuid(regs, 0);
+    if (regs[0] >= 7) {
+        __cpuidex(regs, 7, 0);
+        leaf7Ebx = (unsigned int)regs[1];
+    }
+#else
+    unsigned int eax, ebx, edx, leaf7Ecx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (__get_cpuid_max(0, 0) >= 7) {
+        /* leaf 7 gets its own ecx so leaf 1's AVX and OSXSAVE bits survive */
+        __cpuid_count(7, 0, eax, ebx, leaf7Ecx, edx);
+        leaf7Ebx = ebx;
+    }
+#endif
+    if (ecx & (1u << 9))
+        features |= CPU_FEATURE_SSSE3;
+    if (ecx & (1u << 19))
+        features |= CPU_FEATURE_SSE41;
+    if (ecx & (1u << 1))
+        features |= CPU_FEATURE_PCLMUL;
+    /* AVX needs OSXSAVE and XCR0 showing the XMM and YMM state enabled. */
+    if ((ecx & (1u << 27)) && (ecx & (1u << 28)) && (leaf7Ebx & (1u << 5)) &&
+        (ReadXcr0() & 6) == 6)
+        features |= CPU_FEATURE_AVX2;
+#endif
+    return features;
+}
+
+unsigned int CpuFeatures(void) {
+    unsigned int features = atomic_load_explicit(&cachedFeatures, memory_order_relaxed);
+    if (!features) {
+        features = DetectFeatures() | CPU_FEATURES_DETECTED;
+        atomic_store_explicit(&cachedFeatures, features, memory_order_relaxed);
+    }
+    return features & ~CPU_FEATURES_DETECTED;
+}
@@ -0,0 +1,14 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+/* Instruction set extensions that the SIMD kernels pick between at run time. */
+
+#define CPU_FEATURE_SSSE3 0x01
+#define CPU_FEATURE_SSE41 0x02
+#define CPU_FEATURE_PCLMUL 0x04
+#define CPU_FEATURE_AVX2 0x08 /* only when the OS also saves the YMM registers */
+
+/* Returns the CPU_FEATURE_* bits of the running CPU. Cheap after the first call. */
+unsigned int CpuFeatures(void);
+
+#endif
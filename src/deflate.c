@@ -0,0 +1,696 @@
+#include <stdlib.h>
+#include <string.h>
+#include "checksum.h"
+#include "deflate.h"
+
+#define WINDOW_SIZE 32768
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+/* One short of the window so a chain never reaches the slot the current position reuses. */
+#define MAX_DISTANCE (WINDOW_SIZE - 1)
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+/* Symbols buffered per block before its Huffman codes are built and it is written out. */
+#define BLOCK_SYMBOLS 16384
+#define MAX_STORED 65535
+
+#define LITLEN_CODES 286
+#define DIST_CODES 30
+#define CODELEN_CODES 19
+#define MAX_CODE_BITS 15
+#define MAX_CODELEN_BITS 7
+#define END_OF_BLOCK 256
+
+typedef struct {
+    /* Match finder: head[hash] is the newest position with that hash and prev[] chains each
+     * position to the previous one, indexed modulo the window. -1 ends a chain. */
+    int head[HASH_SIZE];
+    int prev[WINDOW_SIZE];
+    int insertPos;
+
+    /* Current block. A symbol with dist 0 is a literal, otherwise litLen is a match length. */
+    unsigned short symLitLen[BLOCK_SYMBOLS];
+    unsigned short symDist[BLOCK_SYMBOLS];
+    int symCount;
+    int blockStart;
+    int emittedPos;
+    unsigned int litFreq[LITLEN_CODES];
+    unsigned int distFreq[DIST_CODES];
+
+    const unsigned char *data;
+    unsigned char *out;
+    size_t outPos;
+    unsigned long long bitBuffer;
+    int bitCount;
+} DeflateState;
+
+typedef struct {
+    unsigned short code[LITLEN_CODES];
+    unsigned char length[LITLEN_CODES];
+} HuffmanCode;
+
+static const DeflateParams levels[10] = {
+    {0, 0, 0, 0},    {4, 8, 0, 0},    {8, 16, 0, 0},    {16, 32, 0, 0},   {8, 16, 8, 0},
+    {16, 32, 16, 0}, {16, 64, 32, 0}, {32, 128, 32, 0}, {64, 258, 64, 0}, {1024, 258, 258, 0},
+};
+
+static const unsigned short lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23,
+    27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+    8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const unsigned char codeLengthOrder[CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+DeflateParams DeflateParamsForLevel(int level) {
+    if (level < 0)
+        level = 0;
+    if (level > 9)
+        level = 9;
+    return levels[level];
+}
+
+size_t DeflateBound(int len) {
+    /* Every block but the last covers at least BLOCK_SYMBOLS bytes and is never larger than
+     * the same bytes stored, so the overhead is a few bytes per block and per stored chunk. */
+    return (size_t)len + ((size_t)len >> 10) + 64;
+}
+
+size_t DeflateMemoryBound(int len) {
+    return sizeof(DeflateState) + DeflateBound(len) + 6;
+}
+
+static int FloorLog2(unsigned int value) {
+    int bits = 0;
+    while (value >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+/* Length 3..258 to length code 0..28 (symbol 257 + code). */
+static int LengthCode(int length) {
+    unsigned int x = (unsigned int)(length - MIN_MATCH);
+    if (x < 8)
+        return (int)x;
+    if (length == MAX_MATCH)
+        return 28;
+    int n = FloorLog2(x);
+    return 4 * (n - 1) + (int)((x >> (n - 2)) & 3);
+}
+
+/* Distance 1..32768 to distance code 0..29. */
+static int DistCode(int dist) {
+    unsigned int x = (unsigned int)(dist - 1);
+    if (x < 4)
+        return (int)x;
+    int n = FloorLog2(x);
+    return 2 * n + (int)((x >> (n - 1)) & 1);
+}
+
+static void PutBits(DeflateState *s, unsigned int value, int count) {
+    s->bitBuffer |= (unsigned long long)value << s->bitCount;
+    s->bitCount += count;
+    while (s->bitCount >= 8) {
+        s->out[s->outPos++] = (unsigned char)s->bitBuffer;
+        s->bitBuffer >>= 8;
+        s->bitCount -= 8;
+    }
+}
+
+static void AlignToByte(DeflateState *s) {
+    if (s->bitCount > 0)
+        PutBits(s, 0, 8 - s->bitCount);
+}
+
+static unsigned int ReverseBits(unsigned int code, int length) {
+    unsigned int reversed = 0;
+    while (length--) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+/* Moffat and Katajainen's in-place minimum-redundancy code: a[] holds the weights of n leaves
+ * in ascending order and is overwritten with their code lengths. */
+static void MinimumRedundancy(unsigned int *a, int n) {
+    int root, leaf, next, avail, used, depth;
+
+    if (n == 1) {
+        a[0] = 1;
+        return;
+    }
+
+    a[0] += a[1];
+    root = 0;
+    leaf = 2;
+    for (next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = (unsigned int)next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = (unsigned int)next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+
+    a[n - 2] = 0;
+    for (next = n - 3; next >= 0; next--) {
+        a[next] = a[a[next]] + 1;
+    }
+
+    avail = 1;
+    used = depth = 0;
+    root = n - 2;
+    next = n - 1;
+    while (avail > 0) {
+        while (root >= 0 && (int)a[root] == depth) {
+            used++;
+            root--;
+        }
+        while (avail > used) {
+            a[next--] = (unsigned int)depth;
+            avail--;
+        }
+        avail = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+/* Builds length-limited canonical Huffman codes, stored bit-reversed for LSB-first output. */
+static void BuildHuffman(HuffmanCode *huff, const unsigned int *freq, int count, int maxBits) {
+    unsigned int keys[LITLEN_CODES];
+    unsigned int weights[LITLEN_CODES];
+    int lengthCount[MAX_CODE_BITS + 2];
+    int used = 0;
+
+    memset(huff->length, 0, sizeof(huff->length));
+    memset(lengthCount, 0, sizeof(lengthCount));
+
+    /* Sort used symbols by frequency; frequencies fit in 17 bits since blocks are bounded. */
+    for (int sym = 0; sym < count; sym++) {
+        if (!freq[sym])
+            continue;
+        unsigned int key = (freq[sym] << 9) | (unsigned int)sym;
+        int i = used++;
+        while (i > 0 && keys[i - 1] > key) {
+            keys[i] = keys[i - 1];
+            i--;
+        }
+        keys[i] = key;
+    }
+
+    /* A decoder needs a complete code, so a lone symbol gets a one-bit partner. */
+    if (used < 2) {
+        int sym = used ? (int)(keys[0] & 511) : 0;
+        huff->length[sym] = 1;
+        huff->length[sym == 0 ? 1 : 0] = 1;
+        lengthCount[1] = 2;
+    } else {
+        for (int i = 0; i < used; i++) {
+            weights[i] = keys[i] >> 9;
+        }
+        MinimumRedundancy(weights, used);
+
+        for (int i = 0; i < used; i++) {
+            int bits = weights[i] > (unsigned int)maxBits ? maxBits : (int)weights[i];
+            lengthCount[bits]++;
+        }
+
+        /* Clamping overfilled the code. Each pass takes a code off the limit and pairs it with
+         * the longest code below the limit, which grows by one bit; that lowers the Kraft sum
+         * by one unit of 2^-maxBits until it is exactly one again. */
+        unsigned int total = 0;
+        for (int bits = maxBits; bits > 0; bits--) {
+            total += (unsigned int)lengthCount[bits] << (maxBits - bits);
+        }
+        while (total != (1u << maxBits)) {
+            lengthCount[maxBits]--;
+            for (int bits = maxBits - 1; bits > 0; bits--) {
+                if (lengthCount[bits]) {
+                    lengthCount[bits]--;
+                    lengthCount[bits + 1] += 2;
+                    break;
+                }
+            }
+            total--;
+        }
+
+        /* Longest codes go to the least frequent symbols. */
+        int i = 0;
+        for (int bits = maxBits; bits > 0; bits--) {
+            for (int k = lengthCount[bits]; k > 0; k--) {
+                huff->length[keys[i++] & 511] = (unsigned char)bits;
+            }
+        }
+    }
+
+    unsigned int nextCode[MAX_CODE_BITS + 2];
+    unsigned int code = 0;
+    lengthCount[0] = 0;
+    for (int bits = 1; bits <= maxBits; bits++) {
+        code = (code + (unsigned int)lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+    for (int sym = 0; sym < count; sym++) {
+        int bits = huff->length[sym];
+        if (bits)
+            huff->code[sym] = (unsigned short)ReverseBits(nextCode[bits]++, bits);
+    }
+}
+
+static void BuildFixedHuffman(HuffmanCode *lit, HuffmanCode *dist) {
+    unsigned int code;
+    for (int sym = 0; sym < LITLEN_CODES; sym++) {
+        if (sym < 144) {
+            code = 0x30 + sym;
+            lit->length[sym] = 8;
+        } else if (sym < 256) {
+            code = 0x190 + (sym - 144);
+            lit->length[sym] = 9;
+        } else if (sym < 280) {
+            code = sym - 256;
+            lit->length[sym] = 7;
+        } else {
+            code = 0xc0 + (sym - 280);
+            lit->length[sym] = 8;
+        }
+        lit->code[sym] = (unsigned short)ReverseBits(code, lit->length[sym]);
+    }
+    for (int sym = 0; sym < DIST_CODES; sym++) {
+        dist->length[sym] = 5;
+        dist->code[sym] = (unsigned short)ReverseBits((unsigned int)sym, 5);
+    }
+}
+
+/* Bits for the block's symbols under the given codes, excluding the block header. */
+static unsigned long long SymbolBits(const DeflateState *s, const HuffmanCode *lit,
+    const HuffmanCode *dist) {
+    unsigned long long bits = 0;
+    for (int sym = 0; sym < LITLEN_CODES; sym++) {
+        bits += (unsigned long long)s->litFreq[sym] * lit->length[sym];
+        if (sym > END_OF_BLOCK)
+            bits += (unsigned long long)s->litFreq[sym] * lengthExtra[sym - END_OF_BLOCK - 1];
+    }
+    for (int sym = 0; sym < DIST_CODES; sym++) {
+        bits += (unsigned long long)s->distFreq[sym] * (dist->length[sym] + distExtra[sym]);
+    }
+    return bits;
+}
+
+static void WriteSymbols(DeflateState *s, const HuffmanCode *lit, const HuffmanCode *dist) {
+    for (int i = 0; i < s->symCount; i++) {
+        int value = s->symLitLen[i];
+        int distance = s->symDist[i];
+        if (!distance) {
+            PutBits(s, lit->code[value], lit->length[value]);
+            continue;
+        }
+
+        int lc = LengthCode(value);
+        PutBits(s, lit->code[END_OF_BLOCK + 1 + lc], lit->length[END_OF_BLOCK + 1 + lc]);
+        if (lengthExtra[lc])
+            PutBits(s, (unsigned int)(value - lengthBase[lc]), lengthExtra[lc]);
+
+        int dc = DistCode(distance);
+        PutBits(s, dist->code[dc], dist->length[dc]);
+        if (distExtra[dc])
+            PutBits(s, (unsigned int)(distance - distBase[dc]), distExtra[dc]);
+    }
+    PutBits(s, lit->code[END_OF_BLOCK], lit->length[END_OF_BLOCK]);
+}
+
+static void WriteStored(DeflateState *s, int start, int end, int final) {
+    do {
+        int chunk = end - start > MAX_STORED ? MAX_STORED : end - start;
+        int chunkFinal = final && start + chunk == end;
+        PutBits(s, (unsigned int)chunkFinal, 3);
+        AlignToByte(s);
+        PutBits(s, (unsigned int)chunk, 16);
+        PutBits(s, (unsigned int)chunk ^ 0xffff, 16);
+        memcpy(s->out + s->outPos, s->data + start, chunk);
+        s->outPos += chunk;
+        start += chunk;
+    } while (start < end);
+}
+
+/* Writes the buffered symbols as whichever of stored, fixed or dynamic is smallest. */
+static void FlushBlock(DeflateState *s, int final) {
+    HuffmanCode lit, dist, fixedLit, fixedDist, codeLen;
+    unsigned int codeLenFreq[CODELEN_CODES];
+    unsigned char lengths[LITLEN_CODES + DIST_CODES];
+    unsigned char ops[LITLEN_CODES + DIST_CODES];
+    unsigned char opExtra[LITLEN_CODES + DIST_CODES];
+    int opCount = 0;
+
+    s->litFreq[END_OF_BLOCK] = 1;
+    BuildHuffman(&lit, s->litFreq, LITLEN_CODES, MAX_CODE_BITS);
+    BuildHuffman(&dist, s->distFreq, DIST_CODES, MAX_CODE_BITS);
+    BuildFixedHuffman(&fixedLit, &fixedDist);
+
+    int litCount = LITLEN_CODES;
+    while (litCount > 257 && !lit.length[litCount - 1]) {
+        litCount--;
+    }
+    int distCount = DIST_CODES;
+    while (distCount > 1 && !dist.length[distCount - 1]) {
+        distCount--;
+    }
+
+    /* Run-length encode the code lengths with the code-length alphabet's repeat symbols. */
+    int total = litCount + distCount;
+    memcpy(lengths, lit.length, litCount);
+    memcpy(lengths + litCount, dist.length, distCount);
+    memset(codeLenFreq, 0, sizeof(codeLenFreq));
+    for (int i = 0; i < total;) {
+        int value = lengths[i];
+        int run = 1;
+        while (i + run < total && lengths[i + run] == value) {
+            run++;
+        }
+        i += run;
+
+        if (value == 0) {
+            while (run >= 11) {
+                int n = run > 138 ? 138 : run;
+                ops[opCount] = 18;
+                opExtra[opCount++] = (unsigned char)(n - 11);
+                run -= n;
+            }
+            if (run >= 3) {
+                ops[opCount] = 17;
+                opExtra[opCount++] = (unsigned char)(run - 3);
+                run = 0;
+            }
+        } else {
+            ops[opCount] = (unsigned char)value;
+            opExtra[opCount++] = 0;
+            run--;
+            while (run >= 3) {
+                int n = run > 6 ? 6 : run;
+                ops[opCount] = 16;
+                opExtra[opCount++] = (unsigned char)(n - 3);
+                run -= n;
+            }
+        }
+        while (run-- > 0) {
+            ops[opCount] = (unsigned char)value;
+            opExtra[opCount++] = 0;
+        }
+    }
+    for (int i = 0; i < opCount; i++) {
+        codeLenFreq[ops[i]]++;
+    }
+    BuildHuffman(&codeLen, codeLenFreq, CODELEN_CODES, MAX_CODELEN_BITS);
+
+    int codeLenCount = CODELEN_CODES;
+    while (codeLenCount > 4 && !codeLen.length[codeLengthOrder[codeLenCount - 1]]) {
+        codeLenCount--;
+    }
+
+    unsigned long long dynamicBits = 3 + 14 + 3 * (unsigned long long)codeLenCount;
+    for (int sym = 0; sym < CODELEN_CODES; sym++) {
+        dynamicBits += (unsigned long long)codeLenFreq[sym] * codeLen.length[sym];
+    }
+    dynamicBits += 2 * codeLenFreq[16] + 3 * codeLenFreq[17] + 7 * codeLenFreq[18];
+    dynamicBits += SymbolBits(s, &lit, &dist);
+
+    unsigned long long fixedBits = 3 + SymbolBits(s, &fixedLit, &fixedDist);
+
+    int blockBytes = s->emittedPos - s->blockStart;
+    int chunks = blockBytes ? (blockBytes + MAX_STORED - 1) / MAX_STORED : 1;
+    unsigned long long storedBits =
+        (unsigned long long)blockBytes * 8 + (unsigned long long)chunks * 42;
+
+    if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+        WriteStored(s, s->blockStart, s->emittedPos, final);
+    } else if (fixedBits <= dynamicBits) {
+        PutBits(s, (unsigned int)final | (1 << 1), 3);
+        WriteSymbols(s, &fixedLit, &fixedDist);
+    } else {
+        PutBits(s, (unsigned int)final | (2 << 1), 3);
+        PutBits(s, (unsigned int)(litCount - 257), 5);
+        PutBits(s, (unsigned int)(distCount - 1), 5);
+        PutBits(s, (unsigned int)(codeLenCount - 4), 4);
+        for (int i = 0; i < codeLenCount; i++) {
+            PutBits(s, codeLen.length[codeLengthOrder[i]], 3);
+        }
+        for (int i = 0; i < opCount; i++) {
+            PutBits(s, codeLen.code[ops[i]], codeLen.length[ops[i]]);
+            if (ops[i] == 16)
+                PutBits(s, opExtra[i], 2);
+            else if (ops[i] == 17)
+                PutBits(s, opExtra[i], 3);
+            else if (ops[i] == 18)
+                PutBits(s, opExtra[i], 7);
+        }
+        WriteSymbols(s, &lit, &dist);
+    }
+
+    s->symCount = 0;
+    s->blockStart = s->emittedPos;
+    memset(s->litFreq, 0, sizeof(s->litFreq));
+    memset(s->distFreq, 0, sizeof(s->distFreq));
+}
+
+static void EmitLiteral(DeflateState *s, int value) {
+    s->symLitLen[s->symCount] = (unsigned short)value;
+    s->symDist[s->symCount++] = 0;
+    s->litFreq[value]++;
+    s->emittedPos++;
+    if (s->symCount == BLOCK_SYMBOLS)
+        FlushBlock(s, 0);
+}
+
+static void EmitMatch(DeflateState *s, int length, int distance) {
+    s->symLitLen[s->symCount] = (unsigned short)length;
+    s->symDist[s->symCount++] = (unsigned short)distance;
+    s->litFreq[END_OF_BLOCK + 1 + LengthCode(length)]++;
+    s->distFreq[DistCode(distance)]++;
+    s->emittedPos += length;
+    if (s->symCount == BLOCK_SYMBOLS)
+        FlushBlock(s, 0);
+}
+
+static unsigned int Hash3(const unsigned char *p) {
+    unsigned int v = ((unsigned int)p[0] << 16) | ((unsigned int)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Links every position up to and including pos into the hash chains. */
+static void InsertUpTo(DeflateState *s, int pos, int end) {
+    while (s->insertPos <= pos && s->insertPos + MIN_MATCH <= end) {
+        unsigned int h = Hash3(s->data + s->insertPos);
+        s->prev[s->insertPos & WINDOW_MASK] = s->head[h];
+        s->head[h] = s->insertPos;
+        s->insertPos++;
+    }
+}
+
+static int MatchLength(const unsigned char *a, const unsigned char *b, int maxLen) {
+    int len = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    /* Compare eight bytes at a time; the lowest differing bit gives the first mismatch. */
+    while (len + 8 <= maxLen) {
+        unsigned long long x, y;
+        memcpy(&x, a + len, 8);
+        memcpy(&y, b + len, 8);
+        if (x != y)
+            return len + (__builtin_ctzll(x ^ y) >> 3);
+        len += 8;
+    }
+#endif
+    while (len < maxLen && a[len] == b[len]) {
+        len++;
+    }
+    return len;
+}
+
+/* Returns the longest match at pos that beats bestLen, or 0 if there is none. */
+static int FindMatch(DeflateState *s, const DeflateParams *params, int pos, int end, int bestLen,
+    int *bestDist) {
+    const unsigned char *data = s->data;
+    int maxLen = end - pos > MAX_MATCH ? MAX_MATCH : end - pos;
+    if (maxLen < MIN_MATCH || bestLen >= maxLen)
+        return 0;
+
+    int limit = pos > MAX_DISTANCE ? pos - MAX_DISTANCE : 0;
+    int chain = params->chainDepth;
+    int found = 0;
+
+    for (int cand = s->prev[pos & WINDOW_MASK]; cand >= limit && chain > 0; chain--) {
+        if (data[cand + bestLen] == data[pos + bestLen] && data[cand] == data[pos] &&
+            data[cand + 1] == data[pos + 1]) {
+            int len = MatchLength(data + cand, data + pos, maxLen);
+            if (len > bestLen) {
+                bestLen = len;
+                *bestDist = pos - cand;
+                found = 1;
+                if (len >= params->niceLength || len >= maxLen)
+                    break;
+            }
+        }
+        cand = s->prev[cand & WINDOW_MASK];
+    }
+    return found ? bestLen : 0;
+}
+
+static void CompressRange(DeflateState *s, const DeflateParams *params, int pos, int end) {
+    int pendingLen = 0, pendingDist = 0;
+
+    while (pos < end) {
+        int dist = 0;
+        InsertUpTo(s, pos, end);
+        int len = FindMatch(s, params, pos, end, pendingLen ? pendingLen : MIN_MATCH - 1, &dist);
+
+        if (pendingLen) {
+            if (!len) {
+                /* Nothing longer one byte on: take the deferred match starting at pos - 1. */
+                EmitMatch(s, pendingLen, pendingDist);
+                pos += pendingLen - 1;
+                pendingLen = 0;
+                continue;
+            }
+            EmitLiteral(s, s->data[pos - 1]);
+            pendingLen = 0;
+        }
+
+        if (!len) {
+            EmitLiteral(s, s->data[pos]);
+            pos++;
+        } else if (len < params->lazyLength && pos + 1 < end) {
+            pendingLen = len;
+            pendingDist = dist;
+            pos++;
+        } else {
+            EmitMatch(s, len, dist);
+            pos += len;
+        }
+    }
+    if (pendingLen)
+        EmitMatch(s, pendingLen, pendingDist);
+}
+
+/* Distance-1 matches only. There is no search, so the hash chains are never touched. */
+static void CompressRuns(DeflateState *s, int pos, int end) {
+    const unsigned char *data = s->data;
+
+    while (pos < end) {
+        int maxLen = end - pos > MAX_MATCH ? MAX_MATCH : end - pos;
+        if (pos > 0 && maxLen >= MIN_MATCH && data[pos] == data[pos - 1]) {
+            int len = MatchLength(data + pos - 1, data + pos, maxLen);
+            if (len >= MIN_MATCH) {
+                EmitMatch(s, len, 1);
+                pos += len;
+                continue;
+            }
+        }
+        EmitLiteral(s, data[pos]);
+        pos++;
+    }
+}
+
+static DeflateState *CreateState(const unsigned char *data, int dictLen, int len) {
+    DeflateState *s = (DeflateState *)malloc(sizeof(DeflateState));
+    if (!s)
+        return NULL;
+    s->out = (unsigned char *)malloc(DeflateBound(len) + 6);
+    if (!s->out) {
+        free(s);
+        return NULL;
+    }
+
+    memset(s->head, 0xff, sizeof(s->head));
+    memset(s->litFreq, 0, sizeof(s->litFreq));
+    memset(s->distFreq, 0, sizeof(s->distFreq));
+    s->data = data;
+    s->insertPos = dictLen > MAX_DISTANCE ? dictLen - MAX_DISTANCE : 0;
+    s->symCount = 0;
+    s->blockStart = dictLen;
+    s->emittedPos = dictLen;
+    s->outPos = 0;
+    s->bitBuffer = 0;
+    s->bitCount = 0;
+    return s;
+}
+
+static void CompressInto(DeflateState *s, const DeflateParams *params, int dictLen, int len,
+    int last) {
+    int end = dictLen + len;
+
+    if (params->chainDepth <= 0 && !params->runLength) {
+        s->emittedPos = end;
+        if (len || last)
+            WriteStored(s, dictLen, end, last);
+    } else {
+        if (params->runLength) {
+            CompressRuns(s, dictLen, end);
+        } else {
+            if (dictLen > 0)
+                InsertUpTo(s, dictLen - 1, end);
+            CompressRange(s, params, dictLen, end);
+        }
+        if (s->symCount || last)
+            FlushBlock(s, last);
+    }
+
+    /* Sync flush: an empty stored block leaves the stream byte aligned and open. */
+    if (!last)
+        WriteStored(s, end, end, 0);
+    AlignToByte(s);
+}
+
+unsigned char *DeflateRaw(const unsigned char *data, int dictLen, int len,
+    const DeflateParams *params, int last, int *outLen) {
+    if (!data || dictLen < 0 || len < 0)
+        return NULL;
+
+    DeflateState *s = CreateState(data, dictLen, len);
+    if (!s)
+        return NULL;
+
+    CompressInto(s, params, dictLen, len, last);
+
+    unsigned char *out = s->out;
+    *outLen = (int)s->outPos;
+    free(s);
+    return out;
+}
+
+unsigned char *DeflateZlib(unsigned char *data, int len, int *outLen, int quality) {
+    DeflateParams params = DeflateParamsForLevel(quality);
+
+    if (!data || len < 0)
+        return NULL;
+
+    DeflateState *s = CreateState(data, 0, len);
+    if (!s)
+        return NULL;
+
+    /* 32K window; FLEVEL only tells a decoder how hard the encoder tried. */
+    s->out[s->outPos++] = 0x78;
+    s->out[s->outPos++] = params.chainDepth <= 8 ? 0x01 : (params.chainDepth < 1024 ? 0x9c : 0xda);
+    CompressInto(s, &params, 0, len, 1);
+
+    unsigned int adler = Adler32(1, data, (size_t)len);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        s->out[s->outPos++] = (unsigned char)(adler >> shift);
+    }
+
+    unsigned char *out = s->out;
+    *outLen = (int)s->outPos;
+    free(s);
+    return out;
+}
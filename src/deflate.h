@@ -0,0 +1,36 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stddef.h>
+
+/* Raw deflate (RFC 1951) compressor with hash chains over a 32K window and per-block choice of
+ * stored, fixed or dynamic Huffman coding. All match-finder state lives in one fixed-size
+ * allocation, so peak memory for an input is known before compressing it. */
+
+typedef struct {
+    int chainDepth; /* hash chain links followed per position; 0 stores unless runLength is set */
+    int niceLength; /* stop searching once a match this long is found */
+    int lazyLength; /* defer a match shorter than this by one byte to look for a longer one */
+    int runLength;  /* nonzero: only match repeats of the previous byte, like zlib's Z_RLE */
+} DeflateParams;
+
+/* zlib-like presets for level 0 (store) to 9 (smallest). Out of range levels are clamped. */
+DeflateParams DeflateParamsForLevel(int level);
+
+/* Upper bound on the raw deflate output for len input bytes. */
+size_t DeflateBound(int len);
+
+/* Peak heap usage of one DeflateRaw or DeflateZlib call on len input bytes. */
+size_t DeflateMemoryBound(int len);
+
+/* Compresses data[dictLen, dictLen + len). The dictLen bytes before it are history that
+ * matches may refer back to, which lets independently compressed pieces of one stream keep
+ * their compression ratio. If last is zero the output ends with a sync flush instead of a final
+ * block, so another raw deflate stream can be appended. Returns a malloc'd buffer or NULL. */
+unsigned char *DeflateRaw(const unsigned char *data, int dictLen, int len,
+    const DeflateParams *params, int last, int *outLen);
+
+/* Compresses data into a zlib stream. The signature matches STBIW_ZLIB_COMPRESS. */
+unsigned char *DeflateZlib(unsigned char *data, int len, int *outLen, int quality);
+
+#endif
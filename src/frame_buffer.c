@@ -0,0 +1,74 @@
+#include <string.h>
+#include "frame_buffer.h"
+
+static int RoundUp(int value) {
+    return (value + FRAME_BUFFER_GRANULARITY - 1) / FRAME_BUFFER_GRANULARITY *
+           FRAME_BUFFER_GRANULARITY;
+}
+
+void FrameBufferInit(FrameBuffer *buffer, const FrameSurfaceOps *ops) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->ops = *ops;
+}
+
+int FrameBufferReserve(FrameBuffer *buffer, int width, int height) {
+    if (width <= 0 || height <= 0)
+        return 0;
+
+    if (buffer->surface && width <= buffer->width && height <= buffer->height &&
+        (long long)width * height * 4 >= (long long)buffer->width * buffer->height)
+        return 1;
+
+    /* The old surface goes only once the new one exists, so a failed capture keeps it. */
+    int allocWidth = RoundUp(width);
+    int allocHeight = RoundUp(height);
+    unsigned char *pixels = NULL;
+    int stride = 0;
+    void *surface = buffer->ops.create(buffer->ops.user, allocWidth, allocHeight, &pixels, &stride);
+    if (!surface)
+        return 0;
+
+    FrameBufferRelease(buffer);
+    buffer->surface = surface;
+    buffer->pixels = pixels;
+    buffer->width = allocWidth;
+    buffer->height = allocHeight;
+    buffer->stride = stride;
+    buffer->allocations++;
+    return 1;
+}
+
+int FrameBufferView(const FrameBuffer *buffer, int x, int y, int width, int height,
+    FrameView *view) {
+    if (!buffer->surface)
+        return 0;
+
+    int right = x + width;
+    int bottom = y + height;
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+    if (right > buffer->width)
+        right = buffer->width;
+    if (bottom > buffer->height)
+        bottom = buffer->height;
+    if (right <= x || bottom <= y)
+        return 0;
+
+    view->pixels = buffer->pixels + (long long)y * buffer->stride + (long long)x * 4;
+    view->width = right - x;
+    view->height = bottom - y;
+    view->stride = buffer->stride;
+    return 1;
+}
+
+void FrameBufferRelease(FrameBuffer *buffer) {
+    if (buffer->surface)
+        buffer->ops.destroy(buffer->ops.user, buffer->surface);
+    buffer->surface = NULL;
+    buffer->pixels = NULL;
+    buffer->width = 0;
+    buffer->height = 0;
+    buffer->stride = 0;
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+/* A persistent 32-bit top-down capture surface that is reused across screenshots and only
+ * reallocated when a capture no longer fits (or leaves most of it unused). The surface itself
+ * comes from the platform through FrameSurfaceOps, so the sizing and stride logic here can run
+ * against any pixel source. */
+
+/* Dimensions are rounded up to this so small window resizes don't force a new surface. */
+#define FRAME_BUFFER_GRANULARITY 64
+
+typedef struct {
+    /* Creates a surface of at least width x height 4-byte pixels. Returns an opaque handle and
+     * sets *pixels to the first row and *stride to the bytes between rows, or returns NULL. */
+    void *(*create)(void *user, int width, int height, unsigned char **pixels, int *stride);
+    void (*destroy)(void *user, void *surface);
+    void *user;
+} FrameSurfaceOps;
+
+typedef struct {
+    FrameSurfaceOps ops;
+    void *surface;
+    unsigned char *pixels;
+    int width;
+    int height;
+    int stride;
+    unsigned int allocations; /* surfaces created over the buffer's lifetime */
+} FrameBuffer;
+
+/* A rectangle of a frame, read in place. */
+typedef struct {
+    const unsigned char *pixels;
+    int width;
+    int height;
+    int stride;
+} FrameView;
+
+void FrameBufferInit(FrameBuffer *buffer, const FrameSurfaceOps *ops);
+
+/* Makes the surface at least width x height, keeping the current one when it fits and is not
+ * more than four times the area needed. Returns 0 if a new surface could not be created, in
+ * which case the current one is left as it was. */
+int FrameBufferReserve(FrameBuffer *buffer, int width, int height);
+
+/* Clips the rectangle to the surface and describes it without copying. Returns 0 if nothing of
+ * it lies inside the surface. */
+int FrameBufferView(const FrameBuffer *buffer, int x, int y, int width, int height,
+    FrameView *view);
+
+void FrameBufferRelease(FrameBuffer *buffer);
+
+#endif
@@ -0,0 +1,49 @@
+#include <string.h>
+#include "histogram.h"
+
+void HistogramReset(Histogram *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+unsigned long long HistogramBucketLow(int bucket) {
+    if (bucket < HISTOGRAM_SUB_COUNT)
+        return (unsigned long long)bucket;
+
+    int shift = bucket / HISTOGRAM_SUB_COUNT - 1;
+    unsigned long long sub = (unsigned long long)(bucket % HISTOGRAM_SUB_COUNT);
+    return (HISTOGRAM_SUB_COUNT + sub) << shift;
+}
+
+unsigned long long HistogramBucketHigh(int bucket) {
+    if (bucket < HISTOGRAM_SUB_COUNT)
+        return (unsigned long long)bucket;
+    if (bucket >= HISTOGRAM_BUCKETS - 1)
+        return ~0ULL;
+
+    int shift = bucket / HISTOGRAM_SUB_COUNT - 1;
+    return HistogramBucketLow(bucket) + (1ULL << shift) - 1;
+}
+
+unsigned long long HistogramPercentile(const Histogram *histogram, double quantile) {
+    if (histogram->count == 0)
+        return 0;
+
+    if (quantile < 0.0)
+        quantile = 0.0;
+    if (quantile > 1.0)
+        quantile = 1.0;
+
+    unsigned long long rank = (unsigned long long)(quantile * (double)histogram->count + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            unsigned long long high = HistogramBucketHigh(i);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
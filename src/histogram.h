@@ -0,0 +1,61 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+/* Log-linear histogram: each power of two is split into 8 linear sub-buckets, giving about
+ * 12% relative precision from 1 up to 2^40. Values above that land in the last bucket.
+ * Recording is a handful of integer ops and never allocates or locks; a histogram has a
+ * single writer, and readers see counts that are at worst a few samples stale. */
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_EXPONENT 39
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_COUNT)
+
+typedef struct {
+    unsigned int counts[HISTOGRAM_BUCKETS];
+    unsigned long long count;
+    unsigned long long max;
+} Histogram;
+
+static inline int HistogramHighBit(unsigned long long value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+#endif
+}
+
+static inline int HistogramBucket(unsigned long long value) {
+    if (value < HISTOGRAM_SUB_COUNT)
+        return (int)value;
+
+    int exponent = HistogramHighBit(value);
+    if (exponent > HISTOGRAM_MAX_EXPONENT)
+        return HISTOGRAM_BUCKETS - 1;
+
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    int sub = (int)(value >> shift) & (HISTOGRAM_SUB_COUNT - 1);
+    return (shift + 1) * HISTOGRAM_SUB_COUNT + sub;
+}
+
+static inline void HistogramRecord(Histogram *histogram, unsigned long long value) {
+    histogram->counts[HistogramBucket(value)]++;
+    histogram->count++;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+void HistogramReset(Histogram *histogram);
+
+/* Smallest and largest values that map to a bucket. */
+unsigned long long HistogramBucketLow(int bucket);
+unsigned long long HistogramBucketHigh(int bucket);
+
+/* Upper bound of the bucket holding the given quantile (0.0 - 1.0), capped at the recorded
+ * maximum. Returns 0 for an empty histogram. */
+unsigned long long HistogramPercentile(const Histogram *histogram, double quantile);
+
+#endif
@@ -0,0 +1,189 @@
+#include <string.h>
+#include "hotkeys.h"
+
+/* Windows virtual key codes for the modifier keys. */
+#define KEY_SHIFT 0x10
+#define KEY_CONTROL 0x11
+#define KEY_MENU 0x12
+#define KEY_LWIN 0x5B
+#define KEY_RWIN 0x5C
+#define KEY_LSHIFT 0xA0
+#define KEY_RSHIFT 0xA1
+#define KEY_LCONTROL 0xA2
+#define KEY_RCONTROL 0xA3
+#define KEY_LMENU 0xA4
+#define KEY_RMENU 0xA5
+
+int ActionsAreInverse(MediaAction a, MediaAction b) {
+    return (a == ACTION_VOLUME_UP && b == ACTION_VOLUME_DOWN) ||
+           (a == ACTION_VOLUME_DOWN && b == ACTION_VOLUME_UP) ||
+           (a == ACTION_PREV_TRACK && b == ACTION_NEXT_TRACK) ||
+           (a == ACTION_NEXT_TRACK && b == ACTION_PREV_TRACK);
+}
+
+int ActionRepeatLimit(MediaAction action, int count) {
+    int limit = action >= ACTION_SCREENSHOT_CLIENT_CLIPBOARD ? 1 : ACTION_MAX_REPEAT;
+    if (action == ACTION_NONE || count <= 0)
+        return 0;
+    return count > limit ? limit : count;
+}
+
+static void CompileSingleModifier(ModifierMask *mask, ModifierState state, unsigned int leftBit) {
+    unsigned int rightBit = leftBit << 1;
+
+    switch (state) {
+    case MODIFIER_NONE:
+        mask->forbidden |= leftBit | rightBit;
+        break;
+    case MODIFIER_LEFT:
+        mask->required |= leftBit;
+        mask->forbidden |= rightBit;
+        break;
+    case MODIFIER_RIGHT:
+        mask->required |= rightBit;
+        mask->forbidden |= leftBit;
+        break;
+    case MODIFIER_EITHER:
+        mask->either |= leftBit;
+        break;
+    case MODIFIER_BOTH:
+        mask->required |= leftBit | rightBit;
+        break;
+    }
+}
+
+ModifierMask CompileModifierMask(const HotkeyBinding *binding) {
+    ModifierMask mask = {0};
+    CompileSingleModifier(&mask, binding->ctrl, MODIFIER_BIT_LCTRL);
+    CompileSingleModifier(&mask, binding->shift, MODIFIER_BIT_LSHIFT);
+    CompileSingleModifier(&mask, binding->alt, MODIFIER_BIT_LALT);
+    CompileSingleModifier(&mask, binding->win, MODIFIER_BIT_LWIN);
+    return mask;
+}
+
+unsigned int ModifierBitForKey(unsigned int keyCode, int extended) {
+    switch (keyCode) {
+    case KEY_LCONTROL:
+        return MODIFIER_BIT_LCTRL;
+    case KEY_RCONTROL:
+        return MODIFIER_BIT_RCTRL;
+    case KEY_CONTROL:
+        return extended ? MODIFIER_BIT_RCTRL : MODIFIER_BIT_LCTRL;
+    case KEY_LSHIFT:
+    case KEY_SHIFT:
+        return MODIFIER_BIT_LSHIFT;
+    case KEY_RSHIFT:
+        return MODIFIER_BIT_RSHIFT;
+    case KEY_LMENU:
+        return MODIFIER_BIT_LALT;
+    case KEY_RMENU:
+        return MODIFIER_BIT_RALT;
+    case KEY_MENU:
+        return extended ? MODIFIER_BIT_RALT : MODIFIER_BIT_LALT;
+    case KEY_LWIN:
+        return MODIFIER_BIT_LWIN;
+    case KEY_RWIN:
+        return MODIFIER_BIT_RWIN;
+    }
+    return 0;
+}
+
+int ModifierTrackerUpdate(ModifierTracker *tracker, unsigned int keyCode, int extended, int pressed) {
+    unsigned int bit = ModifierBitForKey(keyCode, extended);
+    if (!bit)
+        return 0;
+
+    if (pressed)
+        tracker->down |= bit;
+    else
+        tracker->down &= ~bit;
+    return 1;
+}
+
+static void AppendCandidate(unsigned char *slot, unsigned char *next, int index) {
+    while (*slot != DISPATCH_END) {
+        slot = &next[*slot];
+    }
+    *slot = (unsigned char)index;
+}
+
+void BuildDispatchTable(DispatchTable *table, const HotkeyBinding *bindings, int count) {
+    memset(table, DISPATCH_END, sizeof(*table));
+
+    if (count > MAX_BINDINGS)
+        count = MAX_BINDINGS;
+
+    for (int i = 0; i < count; i++) {
+        const HotkeyBinding *b = &bindings[i];
+
+        table->mods[i] = CompileModifierMask(b);
+
+        switch (b->triggerType) {
+        case TRIGGER_KEYBOARD:
+            if (b->trigger.keyCode < DISPATCH_KEY_COUNT)
+                AppendCandidate(&table->keyFirst[b->trigger.keyCode], table->next, i);
+            break;
+        case TRIGGER_MOUSE_BUTTON:
+            if ((unsigned)b->trigger.mouseButton < MOUSE_BUTTON_COUNT)
+                AppendCandidate(&table->buttonFirst[b->trigger.mouseButton], table->next, i);
+            break;
+        case TRIGGER_MOUSE_WHEEL:
+            if ((unsigned)b->trigger.wheelDir < WHEEL_DIRECTION_COUNT)
+                AppendCandidate(&table->wheelFirst[b->trigger.wheelDir], table->next, i);
+            break;
+        }
+    }
+}
+
+void HookEngineInit(HookEngine *engine, const DispatchTable *dispatch) {
+    memset(engine, 0, sizeof(*engine));
+    engine->dispatch = dispatch;
+}
+
+/* Picks the first candidate whose modifiers match, in config order. */
+static void MatchTrigger(HookEngine *engine, int candidate, int fire, HookDecision *decision) {
+    const DispatchTable *table = engine->dispatch;
+    for (; candidate != DISPATCH_END; candidate = DispatchNext(table, candidate)) {
+        if (!DispatchMatches(table, candidate, engine->modifiers.down))
+            continue;
+
+        decision->swallow = 1;
+        if (fire) {
+            decision->binding = candidate;
+            if (engine->modifiers.down & (MODIFIER_BIT_LWIN | MODIFIER_BIT_RWIN))
+                engine->suppressWinKeyUp = 1;
+        }
+        return;
+    }
+}
+
+HookDecision HookEngineKey(HookEngine *engine, unsigned int keyCode, int extended, int pressed) {
+    HookDecision decision = {0, -1, 0};
+    int isModifier = ModifierTrackerUpdate(&engine->modifiers, keyCode, extended, pressed);
+
+    if ((keyCode == KEY_LWIN || keyCode == KEY_RWIN) && !pressed && engine->suppressWinKeyUp) {
+        engine->suppressWinKeyUp = 0;
+        decision.tapControl = 1;
+    }
+
+    if (pressed && !isModifier)
+        MatchTrigger(engine, DispatchFirstKey(engine->dispatch, keyCode), 1, &decision);
+    return decision;
+}
+
+HookDecision HookEngineButton(HookEngine *engine, MouseButton button, int pressed) {
+    HookDecision decision = {0, -1, 0};
+    int xButton = button == MOUSE_BUTTON_X1 || button == MOUSE_BUTTON_X2;
+
+    if (pressed || xButton)
+        MatchTrigger(engine, DispatchFirstButton(engine->dispatch, button), pressed, &decision);
+    return decision;
+}
+
+HookDecision HookEngineWheel(HookEngine *engine, int delta) {
+    HookDecision decision = {0, -1, 0};
+    WheelDirection dir = delta > 0 ? WHEEL_UP : WHEEL_DOWN;
+
+    MatchTrigger(engine, DispatchFirstWheel(engine->dispatch, dir), 1, &decision);
+    return decision;
+}
@@ -0,0 +1,175 @@
+#ifndef HOTKEYS_H
+#define HOTKEYS_H
+
+/* Platform-independent binding model and trigger dispatch. Nothing in here may depend on
+ * windows.h so the matching logic can be built and exercised on any platform. */
+
+#define MAX_BINDINGS 64
+
+typedef enum {
+    MODIFIER_NONE,
+    MODIFIER_LEFT,
+    MODIFIER_RIGHT,
+    MODIFIER_EITHER,
+    MODIFIER_BOTH
+} ModifierState;
+
+typedef enum { TRIGGER_KEYBOARD, TRIGGER_MOUSE_BUTTON, TRIGGER_MOUSE_WHEEL } TriggerType;
+
+typedef enum {
+    MOUSE_BUTTON_LEFT,
+    MOUSE_BUTTON_RIGHT,
+    MOUSE_BUTTON_MIDDLE,
+    MOUSE_BUTTON_X1,
+    MOUSE_BUTTON_X2,
+    MOUSE_BUTTON_COUNT
+} MouseButton;
+
+typedef enum { WHEEL_UP, WHEEL_DOWN, WHEEL_DIRECTION_COUNT } WheelDirection;
+
+typedef enum {
+    ACTION_NONE,
+    ACTION_VOLUME_UP,
+    ACTION_VOLUME_DOWN,
+    ACTION_VOLUME_MUTE,
+    ACTION_PLAY_PAUSE,
+    ACTION_PREV_TRACK,
+    ACTION_NEXT_TRACK,
+    ACTION_SCREENSHOT_CLIENT_CLIPBOARD,
+    ACTION_SCREENSHOT_CLIENT_FILE,
+    ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD,
+    ACTION_SCREENSHOT_CLIENT_FILE_FAST,
+    ACTION_SCREENSHOT_CLIENT_FILE_QOI,
+    ACTION_REPLAY_SAVE_APNG,
+    ACTION_REPLAY_SAVE_PNG_SEQUENCE
+} MediaAction;
+
+typedef struct {
+    ModifierState ctrl;
+    ModifierState shift;
+    ModifierState alt;
+    ModifierState win;
+
+    TriggerType triggerType;
+    union {
+        unsigned int keyCode;
+        MouseButton mouseButton;
+        WheelDirection wheelDir;
+    } trigger;
+
+    MediaAction action;
+} HotkeyBinding;
+
+/* Nonzero if a and b undo each other, like volume up and down, so running one after the other
+ * the same number of times is the same as running neither. */
+int ActionsAreInverse(MediaAction a, MediaAction b);
+
+#define ACTION_MAX_REPEAT 32
+
+/* How many of count requested runs of action one wheel flush or event may do: key presses up to
+ * ACTION_MAX_REPEAT, captures and replay saves once, as each writes a file or the clipboard. */
+int ActionRepeatLimit(MediaAction action, int count);
+
+/* Modifier state is tracked as a bitmask with a left/right pair of bits per modifier. */
+#define MODIFIER_BIT_LCTRL 0x01
+#define MODIFIER_BIT_RCTRL 0x02
+#define MODIFIER_BIT_LSHIFT 0x04
+#define MODIFIER_BIT_RSHIFT 0x08
+#define MODIFIER_BIT_LALT 0x10
+#define MODIFIER_BIT_RALT 0x20
+#define MODIFIER_BIT_LWIN 0x40
+#define MODIFIER_BIT_RWIN 0x80
+#define MODIFIER_BITS_LEFT 0x55
+
+/* A binding's four ModifierStates reduced to masks. "either" holds the left bit of each pair
+ * where at least one side must be down; every other state is a plain required/forbidden test. */
+typedef struct {
+    unsigned char required;
+    unsigned char forbidden;
+    unsigned char either;
+} ModifierMask;
+
+ModifierMask CompileModifierMask(const HotkeyBinding *binding);
+
+static inline int ModifierMaskMatches(const ModifierMask *mask, unsigned int down) {
+    unsigned int pairsDown = (down | (down >> 1)) & MODIFIER_BITS_LEFT;
+    return (down & mask->required) == mask->required && (down & mask->forbidden) == 0 &&
+           (pairsDown & mask->either) == mask->either;
+}
+
+/* Shadow copy of which modifier keys are held, maintained from the key events the keyboard
+ * hook already sees so matching never has to query the OS. */
+typedef struct {
+    unsigned char down;
+} ModifierTracker;
+
+/* Returns the modifier bit for a virtual key code, or 0 if it is not a modifier. The generic
+ * Ctrl/Alt codes use the extended-key flag to tell right from left. */
+unsigned int ModifierBitForKey(unsigned int keyCode, int extended);
+
+/* Applies a key event to the tracker. Returns nonzero if the key was a modifier. */
+int ModifierTrackerUpdate(ModifierTracker *tracker, unsigned int keyCode, int extended, int pressed);
+
+/* Virtual key codes are a single byte, so keyboard triggers index a flat table. */
+#define DISPATCH_KEY_COUNT 256
+#define DISPATCH_END 0xFF
+
+/* Bindings compiled into per-trigger candidate lists. Each slot holds the index of the first
+ * binding for that trigger (or DISPATCH_END), and next[] chains the remaining candidates in
+ * config order, so an unbound trigger costs a single table load. */
+typedef struct {
+    unsigned char keyFirst[DISPATCH_KEY_COUNT];
+    unsigned char buttonFirst[MOUSE_BUTTON_COUNT];
+    unsigned char wheelFirst[WHEEL_DIRECTION_COUNT];
+    unsigned char next[MAX_BINDINGS];
+    ModifierMask mods[MAX_BINDINGS];
+} DispatchTable;
+
+void BuildDispatchTable(DispatchTable *table, const HotkeyBinding *bindings, int count);
+
+static inline int DispatchFirstKey(const DispatchTable *table, unsigned int keyCode) {
+    return keyCode < DISPATCH_KEY_COUNT ? table->keyFirst[keyCode] : DISPATCH_END;
+}
+
+static inline int DispatchFirstButton(const DispatchTable *table, MouseButton button) {
+    return (unsigned)button < MOUSE_BUTTON_COUNT ? table->buttonFirst[button] : DISPATCH_END;
+}
+
+static inline int DispatchFirstWheel(const DispatchTable *table, WheelDirection dir) {
+    return (unsigned)dir < WHEEL_DIRECTION_COUNT ? table->wheelFirst[dir] : DISPATCH_END;
+}
+
+static inline int DispatchNext(const DispatchTable *table, int index) {
+    return table->next[index];
+}
+
+static inline int DispatchMatches(const DispatchTable *table, int index, unsigned int modifiers) {
+    return ModifierMaskMatches(&table->mods[index], modifiers);
+}
+
+/* Everything the input hooks decide about one event, so the decisions can be replayed from a
+ * recorded trace without Windows. The hooks carry the decision out. */
+typedef struct {
+    const DispatchTable *dispatch;
+    ModifierTracker modifiers;
+    int suppressWinKeyUp; /* a binding fired with Win held; its release must not open Start */
+} HookEngine;
+
+typedef struct {
+    int swallow;    /* keep the event from the rest of the system */
+    int binding;    /* index of the binding to run, or -1 */
+    int tapControl; /* tap Ctrl before the Win release goes through, so Start stays closed */
+} HookDecision;
+
+void HookEngineInit(HookEngine *engine, const DispatchTable *dispatch);
+
+HookDecision HookEngineKey(HookEngine *engine, unsigned int keyCode, int extended, int pressed);
+
+/* Left, right and middle bindings fire on the press and let the release through. X button
+ * bindings swallow both so the application never sees a lone release. */
+HookDecision HookEngineButton(HookEngine *engine, MouseButton button, int pressed);
+
+/* Positive delta is wheel_up. */
+HookDecision HookEngineWheel(HookEngine *engine, int delta);
+
+#endif
@@ -0,0 +1,60 @@
+#include "input_batch.h"
+
+#include <string.h>
+
+static int ClampBatch(int maxBatch) {
+    if (maxBatch < 2)
+        return 2;
+    return maxBatch > INPUT_BATCH_CAPACITY ? INPUT_BATCH_CAPACITY : maxBatch;
+}
+
+void InputBatchInit(InputBatch *batch, int maxBatch, InputBatchSendFunc send, void *context) {
+    memset(batch, 0, sizeof(*batch));
+    batch->maxBatch = ClampBatch(maxBatch);
+    batch->send = send;
+    batch->context = context;
+}
+
+void InputBatchSetMax(InputBatch *batch, int maxBatch) {
+    InputBatchFlush(batch);
+    batch->maxBatch = ClampBatch(maxBatch);
+}
+
+/* Makes room for needed more events, sending the pending ones first if they would not fit. */
+static void Reserve(InputBatch *batch, int needed) {
+    if (batch->count + needed > batch->maxBatch)
+        InputBatchFlush(batch);
+}
+
+static void Append(InputBatch *batch, unsigned short keyCode, int keyUp) {
+    batch->keys[batch->count].keyCode = keyCode;
+    batch->keys[batch->count].keyUp = keyUp ? 1 : 0;
+    batch->count++;
+}
+
+void InputBatchKey(InputBatch *batch, unsigned short keyCode, int keyUp) {
+    Reserve(batch, 1);
+    Append(batch, keyCode, keyUp);
+    batch->submissions++;
+}
+
+void InputBatchTap(InputBatch *batch, unsigned short keyCode, int count) {
+    for (int i = 0; i < count; i++) {
+        Reserve(batch, 2);
+        Append(batch, keyCode, 0);
+        Append(batch, keyCode, 1);
+        batch->submissions++;
+    }
+}
+
+int InputBatchFlush(InputBatch *batch) {
+    if (batch->count == 0)
+        return 0;
+
+    int sent = batch->send(batch->context, batch->keys, batch->count);
+    batch->calls++;
+    if (sent < batch->count)
+        batch->rejected += (unsigned int)(batch->count - (sent > 0 ? sent : 0));
+    batch->count = 0;
+    return sent > 0 ? sent : 0;
+}
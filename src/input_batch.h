@@ -0,0 +1,50 @@
+#ifndef INPUT_BATCH_H
+#define INPUT_BATCH_H
+
+/* Collects the synthetic key events produced while handling one input event and hands them to
+ * the platform in as few calls as possible. Events always go out in the order they were added.
+ * A batch is sent early only when the next event would not fit, and never between the press
+ * and release of one tap, so a tap is never split across calls. */
+
+#define INPUT_BATCH_CAPACITY 128
+
+typedef struct {
+    unsigned short keyCode;
+    unsigned char keyUp;
+} SyntheticKey;
+
+/* Sends count events in order. Returns how many the platform accepted. */
+typedef int (*InputBatchSendFunc)(void *context, const SyntheticKey *keys, int count);
+
+typedef struct {
+    SyntheticKey keys[INPUT_BATCH_CAPACITY];
+    int count;
+    int maxBatch;
+    InputBatchSendFunc send;
+    void *context;
+
+    unsigned int submissions; /* taps and single events added, each once its own call */
+    unsigned int calls;       /* calls actually made to send */
+    unsigned int rejected;    /* events send did not accept */
+} InputBatch;
+
+/* maxBatch is clamped to 2..INPUT_BATCH_CAPACITY so a tap always fits. */
+void InputBatchInit(InputBatch *batch, int maxBatch, InputBatchSendFunc send, void *context);
+
+void InputBatchSetMax(InputBatch *batch, int maxBatch);
+
+/* Adds a single press or release. */
+void InputBatchKey(InputBatch *batch, unsigned short keyCode, int keyUp);
+
+/* Adds a press and release of keyCode, repeated count times. */
+void InputBatchTap(InputBatch *batch, unsigned short keyCode, int count);
+
+/* Sends whatever is pending. Returns the number of events sent. */
+int InputBatchFlush(InputBatch *batch);
+
+/* Calls that batching avoided compared with one call per submission. */
+static inline unsigned int InputBatchCallsSaved(const InputBatch *batch) {
+    return batch->submissions > batch->calls ? batch->submissions - batch->calls : 0;
+}
+
+#endif
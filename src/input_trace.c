@@ -0,0 +1,202 @@
+#include "input_trace.h"
+
+#include <string.h>
+
+#define FLAG_TYPE_MASK 0x07
+#define FLAG_EXTENDED 0x08
+#define FLAG_INJECTED 0x10
+#define FLAG_SWALLOWED 0x20
+#define FLAG_BINDING 0x40
+
+static const unsigned char traceMagic[4] = {'M', 'K', 'T', 'R'};
+
+static unsigned char *PutVarint(unsigned char *out, unsigned int value) {
+    while (value >= 0x80) {
+        *out++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+    return out;
+}
+
+static int GetVarint(TraceReader *reader, unsigned int *value) {
+    unsigned int result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (reader->pos >= reader->size)
+            return 0;
+        unsigned char byte = reader->data[reader->pos++];
+        result |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int TraceRecorderInit(TraceRecorder *recorder, unsigned char *buffer, size_t capacity,
+    const char *config, size_t configLength) {
+    memset(recorder, 0, sizeof(*recorder));
+    if (configLength > INPUT_TRACE_MAX_CONFIG_BYTES ||
+        capacity < INPUT_TRACE_HEADER_BYTES + configLength)
+        return 0;
+
+    recorder->data = buffer;
+    recorder->capacity = capacity;
+    memcpy(buffer, traceMagic, sizeof(traceMagic));
+    buffer[4] = INPUT_TRACE_VERSION;
+    buffer[5] = buffer[6] = buffer[7] = 0;
+    for (int i = 0; i < 4; i++)
+        buffer[8 + i] = (unsigned char)(configLength >> (8 * i));
+    if (configLength)
+        memcpy(buffer + INPUT_TRACE_HEADER_BYTES, config, configLength);
+    recorder->used = INPUT_TRACE_HEADER_BYTES + configLength;
+    return 1;
+}
+
+int TraceRecorderAdd(TraceRecorder *recorder, const TraceEvent *event) {
+    if (recorder->full || recorder->capacity - recorder->used < INPUT_TRACE_MAX_RECORD_BYTES) {
+        recorder->full = 1;
+        return 0;
+    }
+
+    unsigned char flags = (unsigned char)(event->type & FLAG_TYPE_MASK);
+    if (event->extended)
+        flags |= FLAG_EXTENDED;
+    if (event->injected)
+        flags |= FLAG_INJECTED;
+    if (event->swallowed)
+        flags |= FLAG_SWALLOWED;
+    if (event->binding >= 0)
+        flags |= FLAG_BINDING;
+
+    unsigned int elapsed = event->timeMs - recorder->lastTimeMs; /* the first is absolute */
+    unsigned char *out = recorder->data + recorder->used;
+    *out++ = flags;
+    out = PutVarint(out, elapsed);
+    *out++ = event->modifiers;
+    if (event->type == TRACE_WHEEL) {
+        unsigned int delta = (unsigned int)event->wheelDelta;
+        out = PutVarint(out, (delta << 1) ^ (event->wheelDelta < 0 ? 0xFFFFFFFFu : 0));
+    } else {
+        *out++ = (unsigned char)event->code;
+    }
+    if (event->binding >= 0)
+        *out++ = (unsigned char)event->binding;
+
+    recorder->used = (size_t)(out - recorder->data);
+    recorder->lastTimeMs = event->timeMs;
+    recorder->events++;
+    return 1;
+}
+
+int TraceReaderInit(TraceReader *reader, const unsigned char *data, size_t size) {
+    memset(reader, 0, sizeof(*reader));
+    if (size < INPUT_TRACE_HEADER_BYTES || memcmp(data, traceMagic, sizeof(traceMagic)) != 0 ||
+        data[4] != INPUT_TRACE_VERSION)
+        return 0;
+
+    size_t configLength = (size_t)data[8] | (size_t)data[9] << 8 | (size_t)data[10] << 16 |
+                          (size_t)data[11] << 24;
+    if (configLength > INPUT_TRACE_MAX_CONFIG_BYTES ||
+        configLength > size - INPUT_TRACE_HEADER_BYTES)
+        return 0;
+
+    reader->data = data;
+    reader->size = size;
+    reader->config = (const char *)data + INPUT_TRACE_HEADER_BYTES;
+    reader->configLength = configLength;
+    reader->pos = INPUT_TRACE_HEADER_BYTES + configLength;
+    return 1;
+}
+
+int TraceReaderNext(TraceReader *reader, TraceEvent *event) {
+    if (reader->pos >= reader->size)
+        return 0;
+
+    unsigned char flags = reader->data[reader->pos++];
+    unsigned int elapsed;
+    if ((flags & FLAG_TYPE_MASK) >= TRACE_EVENT_TYPE_COUNT || (flags & 0x80) ||
+        !GetVarint(reader, &elapsed) || reader->pos >= reader->size)
+        return -1;
+
+    memset(event, 0, sizeof(*event));
+    event->type = (TraceEventType)(flags & FLAG_TYPE_MASK);
+    event->extended = (flags & FLAG_EXTENDED) != 0;
+    event->injected = (flags & FLAG_INJECTED) != 0;
+    event->swallowed = (flags & FLAG_SWALLOWED) != 0;
+    event->modifiers = reader->data[reader->pos++];
+    reader->timeMs += elapsed;
+    event->timeMs = reader->timeMs;
+
+    if (event->type == TRACE_WHEEL) {
+        unsigned int zigzag;
+        if (!GetVarint(reader, &zigzag))
+            return -1;
+        event->wheelDelta = (int)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+    } else {
+        if (reader->pos >= reader->size)
+            return -1;
+        event->code = reader->data[reader->pos++];
+        if ((event->type == TRACE_BUTTON_DOWN || event->type == TRACE_BUTTON_UP) &&
+            event->code >= MOUSE_BUTTON_COUNT)
+            return -1;
+    }
+
+    event->binding = -1;
+    if (flags & FLAG_BINDING) {
+        if (reader->pos >= reader->size || reader->data[reader->pos] >= MAX_BINDINGS)
+            return -1;
+        event->binding = reader->data[reader->pos++];
+    }
+    return 1;
+}
+
+static HookDecision Decide(HookEngine *engine, const TraceEvent *event) {
+    switch (event->type) {
+    case TRACE_KEY_DOWN:
+    case TRACE_KEY_UP:
+        return HookEngineKey(engine, event->code, event->extended,
+            event->type == TRACE_KEY_DOWN);
+    case TRACE_BUTTON_DOWN:
+    case TRACE_BUTTON_UP:
+        return HookEngineButton(engine, (MouseButton)event->code,
+            event->type == TRACE_BUTTON_DOWN);
+    default:
+        return HookEngineWheel(engine, event->wheelDelta);
+    }
+}
+
+/* The live hooks also resync modifiers from the OS (on a foreground change, say), so the
+ * recorded state wins; a difference is only counted, not carried forward. */
+int TraceReplay(const unsigned char *data, size_t size, HookEngine *engine, TraceReplayFunc func,
+    void *context, TraceReplayStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    TraceReader reader;
+    if (!TraceReaderInit(&reader, data, size))
+        return 0;
+
+    TraceEvent event;
+    int result;
+    while ((result = TraceReaderNext(&reader, &event)) == 1) {
+        if (stats->events > 0 && engine->modifiers.down != event.modifiers)
+            stats->modifierMismatches++;
+        engine->modifiers.down = event.modifiers;
+
+        HookDecision decision = Decide(engine, &event);
+        stats->events++;
+        if (decision.swallow)
+            stats->swallowed++;
+        if (decision.binding >= 0)
+            stats->fired++;
+        if (decision.tapControl)
+            stats->controlTaps++;
+        if (decision.swallow != event.swallowed || decision.binding != event.binding)
+            stats->decisionMismatches++;
+
+        if (func)
+            func(context, &event, &decision);
+    }
+    return result == 0;
+}
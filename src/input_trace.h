@@ -0,0 +1,98 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <stddef.h>
+#include "hotkeys.h"
+
+/* Compact binary recording of the key, button and wheel events the hooks saw, together with
+ * the modifier state and what the hooks decided, so a session can be replayed through
+ * HookEngine anywhere and checked for changed decisions.
+ *
+ * The file starts with a 12-byte header ("MKTR", version, three zero bytes, then the length of
+ * the config as 4 little-endian bytes) followed by the config.json text the bindings were
+ * compiled from, so a replay uses the same bindings without relying on this build's in-memory
+ * layout. Then comes one record per event: a flags byte (type in bits 0-2, then extended,
+ * injected, swallowed, has-binding), the milliseconds since the previous event as a varint
+ * (the first event's time as is), the modifier bits before the event, the key code or mouse
+ * button byte (zigzag varint delta for the wheel) and, if flagged, the binding index. */
+
+#define INPUT_TRACE_VERSION 2
+#define INPUT_TRACE_HEADER_BYTES 12
+#define INPUT_TRACE_MAX_CONFIG_BYTES (1u << 20)
+#define INPUT_TRACE_MAX_RECORD_BYTES 13
+
+typedef enum {
+    TRACE_KEY_DOWN,
+    TRACE_KEY_UP,
+    TRACE_BUTTON_DOWN,
+    TRACE_BUTTON_UP,
+    TRACE_WHEEL,
+    TRACE_EVENT_TYPE_COUNT
+} TraceEventType;
+
+typedef struct {
+    unsigned int timeMs;     /* event time from the hook; wraps like GetTickCount */
+    TraceEventType type;
+    unsigned int code;       /* virtual key code, or MouseButton */
+    int wheelDelta;
+    int extended;
+    int injected;
+    unsigned char modifiers; /* ModifierTracker bits before the event */
+    int swallowed;           /* as decided while recording */
+    int binding;             /* as decided while recording; -1 for none */
+} TraceEvent;
+
+/* Writes into a buffer supplied by the caller and never allocates, so it can run inside the
+ * hooks. Recording stops once the buffer is full. */
+typedef struct {
+    unsigned char *data;
+    size_t capacity;
+    size_t used;
+    unsigned int lastTimeMs;
+    unsigned int events;
+    int full;
+} TraceRecorder;
+
+/* Writes the header with config, the JSON the current bindings were compiled from. Returns 0
+ * if capacity cannot even hold the header or the config is too long. */
+int TraceRecorderInit(TraceRecorder *recorder, unsigned char *buffer, size_t capacity,
+    const char *config, size_t configLength);
+
+/* Returns 0 once the buffer is full; the event is not recorded. */
+int TraceRecorderAdd(TraceRecorder *recorder, const TraceEvent *event);
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+    unsigned int timeMs;
+    const char *config; /* points into data; not NUL-terminated */
+    size_t configLength;
+} TraceReader;
+
+/* Returns 0 if the header is missing, from another version or cut short. */
+int TraceReaderInit(TraceReader *reader, const unsigned char *data, size_t size);
+
+/* Returns 1 for an event, 0 at the end of the trace and -1 for a truncated or corrupt record. */
+int TraceReaderNext(TraceReader *reader, TraceEvent *event);
+
+typedef struct {
+    unsigned int events;
+    unsigned int swallowed;
+    unsigned int fired;
+    unsigned int controlTaps;
+    unsigned int decisionMismatches; /* swallow or binding differs from the recording */
+    unsigned int modifierMismatches; /* the engine's modifier state differs from the recording */
+} TraceReplayStats;
+
+/* Receives every event with the decision the engine made for it. */
+typedef void (*TraceReplayFunc)(void *context, const TraceEvent *event,
+    const HookDecision *decision);
+
+/* Feeds the trace through engine, which should be freshly initialised over the bindings
+ * compiled from the trace's config. func may be NULL. Returns 1 if the whole trace was read, 0 if it
+ * was not a trace or was cut short. */
+int TraceReplay(const unsigned char *data, size_t size, HookEngine *engine, TraceReplayFunc func,
+    void *context, TraceReplayStats *stats);
+
+#endif
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include "log_buffer.h"
+
+#define LOG_BUFFER_MASK (LOG_BUFFER_CAPACITY - 1)
+
+void LogBufferInit(LogBuffer *buffer) {
+    for (unsigned int i = 0; i < LOG_BUFFER_CAPACITY; i++) {
+        atomic_init(&buffer->records[i].sequence, i);
+    }
+    atomic_init(&buffer->writePos, 0);
+    atomic_init(&buffer->readPos, 0);
+    atomic_init(&buffer->dropped, 0);
+}
+
+unsigned int LogBufferWrite(
+    LogBuffer *buffer, unsigned long long timestamp, const char *format, va_list args) {
+    unsigned int pos = atomic_load_explicit(&buffer->writePos, memory_order_relaxed);
+    LogRecord *record;
+
+    for (;;) {
+        record = &buffer->records[pos & LOG_BUFFER_MASK];
+        unsigned int sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        int diff = (int)(sequence - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &buffer->writePos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&buffer->writePos, memory_order_relaxed);
+        }
+    }
+
+    int length = vsnprintf(record->text, LOG_RECORD_TEXT, format, args);
+    if (length < 0)
+        length = 0;
+    if (length >= LOG_RECORD_TEXT)
+        length = LOG_RECORD_TEXT - 1;
+    record->length = (unsigned int)length;
+    record->timestamp = timestamp;
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+
+    return pos + 1 - atomic_load_explicit(&buffer->readPos, memory_order_relaxed);
+}
+
+const LogRecord *LogBufferPeek(LogBuffer *buffer) {
+    unsigned int readPos = atomic_load_explicit(&buffer->readPos, memory_order_relaxed);
+    LogRecord *record = &buffer->records[readPos & LOG_BUFFER_MASK];
+    unsigned int sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+    if (sequence != readPos + 1)
+        return NULL;
+    return record;
+}
+
+void LogBufferRelease(LogBuffer *buffer) {
+    unsigned int readPos = atomic_load_explicit(&buffer->readPos, memory_order_relaxed);
+    LogRecord *record = &buffer->records[readPos & LOG_BUFFER_MASK];
+    atomic_store_explicit(&record->sequence, readPos + LOG_BUFFER_CAPACITY, memory_order_release);
+    atomic_store_explicit(&buffer->readPos, readPos + 1, memory_order_relaxed);
+}
+
+unsigned int LogBufferTakeDropped(LogBuffer *buffer) {
+    return atomic_exchange_explicit(&buffer->dropped, 0, memory_order_relaxed);
+}
@@ -0,0 +1,43 @@
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <stdarg.h>
+#include <stdatomic.h>
+
+/* Preallocated multi-producer/single-consumer ring of formatted log lines. Writers format
+ * straight into a claimed slot and never block or allocate; when the ring is full the line is
+ * dropped and counted. A single flusher drains records in order. */
+
+#define LOG_BUFFER_CAPACITY 128 /* must be a power of two */
+#define LOG_RECORD_TEXT 512
+
+typedef struct {
+    atomic_uint sequence;
+    unsigned long long timestamp;
+    unsigned int length;
+    char text[LOG_RECORD_TEXT];
+} LogRecord;
+
+typedef struct {
+    LogRecord records[LOG_BUFFER_CAPACITY];
+    atomic_uint writePos;
+    atomic_uint readPos; /* written by the consumer only */
+    atomic_uint dropped;
+} LogBuffer;
+
+void LogBufferInit(LogBuffer *buffer);
+
+/* Formats a line into the ring. The timestamp is opaque and handed back to the consumer.
+ * Returns the number of records waiting after this write, or 0 if the line was dropped. */
+unsigned int LogBufferWrite(
+    LogBuffer *buffer, unsigned long long timestamp, const char *format, va_list args);
+
+/* Consumer side: returns the oldest completed record, or NULL if none is ready. The record
+ * stays valid until LogBufferRelease. */
+const LogRecord *LogBufferPeek(LogBuffer *buffer);
+void LogBufferRelease(LogBuffer *buffer);
+
+/* Returns and clears the number of lines dropped since the last call. */
+unsigned int LogBufferTakeDropped(LogBuffer *buffer);
+
+#endif
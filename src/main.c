@@ -5,91 +5,148 @@
 #include <windows.h>
 #include <shellapi.h>
 #include <shlobj.h>
+#include <wtsapi32.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "action_queue.h"
+#include "arena.h"
 #include "cJSON.h"
+#include "checksum.h"
+#include "clipboard_cache.h"
+#include "config_cache.h"
+#include "config_compile.h"
+#include "cpu_features.h"
+#include "frame_buffer.h"
+#include "histogram.h"
+#include "hotkeys.h"
 #include "icon_data.h"
+#include "input_batch.h"
+#include "input_trace.h"
+#include "log_buffer.h"
+#include "png_writer.h"
+#include "qoi_writer.h"
+#include "replay_buffer.h"
+#include "replay_export.h"
 #include "version.h"
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include "wheel_accumulator.h"
 
 #define CONFIG_FILENAME L"config.json"
+#define CONFIG_CACHE_FILENAME L"config.cache"
 #define APP_FOLDER L"MediaKeys"
 
 #define APP_NAME L"MediaKeys"
 #define WM_TRAYICON (WM_USER + 1)
+#define WM_CLIPBOARD_OFFER (WM_USER + 2)
 #define ID_TRAY_ICON 1
 #define ID_TRAY_EXIT 1001
 #define ID_TRAY_STARTUP 1002
 #define ID_TRAY_VIEWLOG 1003
 #define ID_TRAY_EDITCONFIG 1004
-#define MAX_BINDINGS 64
+#define ID_TRAY_STATS 1005
+#define ID_TRAY_TRACE 1006
 #define ID_TIMER_CONFIG_RELOAD 1
 #define CONFIG_RELOAD_DELAY_MS 200
-
-typedef enum {
-    MODIFIER_NONE,
-    MODIFIER_LEFT,
-    MODIFIER_RIGHT,
-    MODIFIER_EITHER,
-    MODIFIER_BOTH
-} ModifierState;
-
-typedef enum { TRIGGER_KEYBOARD, TRIGGER_MOUSE_BUTTON, TRIGGER_MOUSE_WHEEL } TriggerType;
-
-typedef enum {
-    MOUSE_BUTTON_LEFT,
-    MOUSE_BUTTON_RIGHT,
-    MOUSE_BUTTON_MIDDLE,
-    MOUSE_BUTTON_X1,
-    MOUSE_BUTTON_X2
-} MouseButton;
-
-typedef enum { WHEEL_UP, WHEEL_DOWN } WheelDirection;
-
-typedef enum {
-    ACTION_NONE,
-    ACTION_VOLUME_UP,
-    ACTION_VOLUME_DOWN,
-    ACTION_VOLUME_MUTE,
-    ACTION_PLAY_PAUSE,
-    ACTION_PREV_TRACK,
-    ACTION_NEXT_TRACK,
-    ACTION_SCREENSHOT_CLIENT_CLIPBOARD,
-    ACTION_SCREENSHOT_CLIENT_FILE,
-    ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD
-} MediaAction;
-
-typedef struct {
-    ModifierState ctrl;
-    ModifierState shift;
-    ModifierState alt;
-    ModifierState win;
-
-    TriggerType triggerType;
-    union {
-        DWORD keyCode;
-        MouseButton mouseButton;
-        WheelDirection wheelDir;
-    } trigger;
-
-    MediaAction action;
-} HotkeyBinding;
+#define ID_TIMER_STATS_DUMP 2
+#define ID_TIMER_WHEEL_FLUSH 3
+#define STATS_DUMP_INTERVAL_MS (60 * 60 * 1000)
+#define ACTION_WORKER_STOP_TIMEOUT_MS 5000
+#define LOG_FLUSH_INTERVAL_MS 500
+#define LOG_FLUSHER_STOP_TIMEOUT_MS 2000
+#define SCREENSHOT_STREAM_MIN_PIXELS (3840 * 2160)
+#define REPLAY_KEYFRAME_SECONDS 2
+#define INPUT_TRACE_BUFFER_BYTES (8 * 1024 * 1024)
 
 static HWND mainWindow = NULL;
 static NOTIFYICONDATAW notifyIconData = {0};
 static HMENU trayMenu = NULL;
 static HHOOK keyboardHook = NULL;
 static HHOOK mouseHook = NULL;
+static HWINEVENTHOOK foregroundHook = NULL;
 static HotkeyBinding bindings[MAX_BINDINGS] = {0};
 static int bindingCount = 0;
-static BOOL suppressWinKeyUp = FALSE;
+static DispatchTable dispatch;
+static WheelAccumulator wheel; /* hook thread only, like the bindings */
+static MediaAction wheelActions[WHEEL_DIRECTION_COUNT] = {0}; /* what pending steps will run */
+static HookEngine hookEngine;
+static InputBatch inputBatch; /* synthetic keys from the current hook callback or timer */
+static TraceRecorder traceRecorder;
+static unsigned char *traceBuffer = NULL; /* non-NULL while recording; window thread only */
 static HICON appIcon = NULL;
 static WCHAR logFilePath[MAX_PATH] = {0};
 static WCHAR configFilePath[MAX_PATH] = {0};
+/* Backs the cJSON tree while a config is compiled; sized from the previous parse. */
+static Arena configArena;
+/* The config.json text the current bindings came from, for the header of input traces. */
+static char *appliedConfigJson = NULL;
+static size_t appliedConfigLength = 0;
+/* Which file and build those bindings came from. The directory watch fires for every write to
+ * log.txt and config.cache too, and reapplying would reset the wheel and replay history. */
+static ConfigSource appliedSource;
+static BOOL configApplied = FALSE;
 static WCHAR dataDir[MAX_PATH] = {0};
 static UINT WM_TASKBARCREATED = 0;
+static LARGE_INTEGER perfFrequency = {0};
+static ActionQueue actionQueue;
+static HANDLE actionEvent = NULL;
+static HANDLE actionWorker = NULL;
+static volatile LONG actionWorkerStopping = 0;
+static LogBuffer logBuffer;
+static HANDLE logEvent = NULL;
+static HANDLE logFlusher = NULL;
+static volatile LONG logFlusherStopping = 0;
+static FILE *logFile = NULL;
+/* Reused capture surface; only the thread running screenshot actions touches it. */
+static FrameBuffer captureBuffer;
+
+/* Instant replay. LoadConfig publishes the settings and raises replaySettingsChanged; the
+ * action worker owns the timer and the history and applies them. fps 0 means not recording. */
+typedef struct {
+    LONG fps;
+    LONG seconds;
+    LONG memoryMb;
+} ReplaySettings;
+
+static volatile LONG replayFps = 0;
+static volatile LONG replaySeconds = REPLAY_DEFAULT_SECONDS;
+static volatile LONG replayMemoryMb = REPLAY_DEFAULT_MEMORY_MB;
+static volatile LONG replaySettingsChanged = 1;
+static HANDLE replayTimer = NULL;
+static ReplayBuffer replayBuffer;
+static ReplaySettings replayActive = {0}; /* worker thread only */
+/* Delay-rendered clipboard screenshots. The worker produces every format into the cache under
+ * clipboardLock and announces each one once it is ready; the window owns the clipboard and only
+ * copies ready data out when a format is pasted, since it also runs the input hooks. */
+static CRITICAL_SECTION clipboardLock;
+static ClipboardCache clipboardCache;
+static WCHAR clipboardFilePath[MAX_PATH] = {0};
+static unsigned int clipboardOffered = 0; /* generation on the clipboard; window thread only */
+static UINT pngClipboardFormat = 0;
+
+typedef enum {
+    SCREENSHOT_FORMAT_PNG,
+    SCREENSHOT_FORMAT_PNG_FAST, /* Up filter and run-length deflate, for bursts */
+    SCREENSHOT_FORMAT_QOI
+} ScreenshotFormat;
+
+static const WCHAR *screenshotExtensions[] = {L"png", L"png", L"qoi"};
+
+typedef enum {
+    HOOK_EVENT_KEY,
+    HOOK_EVENT_BUTTON,
+    HOOK_EVENT_WHEEL,
+    HOOK_EVENT_MOVE,
+    HOOK_EVENT_COUNT
+} HookEventType;
+
+static const char *hookEventNames[HOOK_EVENT_COUNT] = {"keyboard", "mouse button", "mouse wheel",
+    "mouse move"};
+
+/* Time spent inside the hook procs in nanoseconds, indexed by [event type][matched]. Only the
+ * hook thread writes these. */
+static Histogram hookLatency[HOOK_EVENT_COUNT][2];
+static unsigned long long hookEventsAtLastDump = 0;
 
 static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam);
@@ -101,31 +158,43 @@ static BOOL RegisterWindowClass(HINSTANCE hInstance);
 static HWND CreateMessageWindow(HINSTANCE hInstance);
 static BOOL InstallHooks(void);
 static void RemoveHooks(void);
-static BOOL CheckModifiers(const HotkeyBinding *binding);
-static void ExecuteAction(MediaAction action);
+static void ResyncModifierState(void);
+static void ExecuteAction(MediaAction action, int count);
+static int SendSyntheticKeys(void *context, const SyntheticKey *keys, int count);
+static BOOL StartActionWorker(void);
+static void StopActionWorker(void);
 static BOOL InitDataDir(void);
-static BOOL LoadConfig(void);
+static BOOL LoadConfig(BOOL *applied);
 static BOOL GetConfigPath(WCHAR *path, DWORD pathLen);
 static BOOL CreateDefaultConfig(const WCHAR *path);
-static ModifierState ParseModifierState(const char *str);
-static BOOL ParseTrigger(const char *str, TriggerType *type, HotkeyBinding *binding);
-static MediaAction ParseAction(const char *str);
 static HICON LoadIconFromMemory(const unsigned char *data, unsigned int size);
 static BOOL GetStartupShortcutPath(WCHAR *path, DWORD pathLen);
 static BOOL IsStartupEnabled(void);
 static BOOL EnableStartup(void);
 static BOOL DisableStartup(void);
 static BOOL InitLogFile(void);
+static void CloseLogFile(void);
 static void LogMessage(const char *format, ...);
+static void LogMessageV(const char *format, va_list args);
 static void ViewLogFile(void);
+static void ShowHookStats(void);
+static void LogHookStats(void);
 static void EditConfigFile(void);
 static BOOL IsFirstRun(void);
 static void MarkFirstRunComplete(void);
-static HBITMAP CaptureClientArea(int *outWidth, int *outHeight);
+static void ToggleInputTrace(void);
+static BOOL CaptureClientArea(FrameView *view, BOOL quiet);
+static void *CreateCaptureSurface(void *user, int width, int height, unsigned char **pixels,
+    int *stride);
+static void DestroyCaptureSurface(void *user, void *surface);
+static void InitScreenshotPngOptions(PngEncodeOptions *options, BOOL fast);
 static void CaptureClientAreaToClipboard(void);
-static BOOL CaptureClientAreaToFile(WCHAR *outPath, DWORD outPathLen);
+static BOOL CaptureClientAreaToFile(ScreenshotFormat format);
 static void CaptureClientAreaToFileClipboard(void);
-static void CopyFileToClipboard(const WCHAR *filePath);
+static void RenderAllClipboardFormats(HWND hwnd);
+static void ApplyReplaySettings(void);
+static void CaptureReplayFrame(void);
+static void SaveReplay(BOOL sequence);
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow) {
     MSG msg;
@@ -137,6 +206,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     InitDataDir();
     InitLogFile();
     LogMessage("MediaKeys %s started", VERSION);
+    QueryPerformanceFrequency(&perfFrequency);
 
     appIcon = LoadIconFromMemory(icon_ico, icon_ico_len);
     if (!appIcon) {
@@ -145,12 +215,14 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
 
     if (!RegisterWindowClass(hInstance)) {
         MessageBoxW(NULL, L"Failed to register window class", APP_NAME, MB_ICONERROR);
+        CloseLogFile();
         return 1;
     }
 
     mainWindow = CreateMessageWindow(hInstance);
     if (!mainWindow) {
         MessageBoxW(NULL, L"Failed to create window", APP_NAME, MB_ICONERROR);
+        CloseLogFile();
         return 1;
     }
 
@@ -159,6 +231,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     if (!InitTrayIcon(mainWindow)) {
         MessageBoxW(NULL, L"Failed to create tray icon", APP_NAME, MB_ICONERROR);
         DestroyWindow(mainWindow);
+        CloseLogFile();
         return 1;
     }
 
@@ -168,24 +241,47 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
         AppendMenuW(trayMenu, startupFlags, ID_TRAY_STARTUP, L"Run at startup");
         AppendMenuW(trayMenu, MF_STRING, ID_TRAY_EDITCONFIG, L"Edit Config");
         AppendMenuW(trayMenu, MF_STRING, ID_TRAY_VIEWLOG, L"View Log");
+        AppendMenuW(trayMenu, MF_STRING, ID_TRAY_STATS, L"Stats");
+        AppendMenuW(trayMenu, MF_STRING, ID_TRAY_TRACE, L"Record Input Trace");
         AppendMenuW(trayMenu, MF_SEPARATOR, 0, NULL);
         AppendMenuW(trayMenu, MF_STRING, ID_TRAY_EXIT, L"Exit");
     }
 
-    if (!LoadConfig()) {
+    InputBatchInit(&inputBatch, INPUT_BATCH_DEFAULT, SendSyntheticKeys, NULL);
+    ArenaInit(&configArena, ARENA_MIN_BLOCK);
+    HookEngineInit(&hookEngine, &dispatch);
+    cJSON_SetCpuHasAvx2((CpuFeatures() & CPU_FEATURE_AVX2) != 0);
+
+    if (!LoadConfig(NULL)) {
         MessageBoxW(NULL, L"Failed to load configuration", APP_NAME, MB_ICONERROR);
         RemoveTrayIcon();
         DestroyWindow(mainWindow);
+        CloseLogFile();
         return 1;
     }
 
+    FrameSurfaceOps surfaceOps = {CreateCaptureSurface, DestroyCaptureSurface, NULL};
+    FrameBufferInit(&captureBuffer, &surfaceOps);
+
+    InitializeCriticalSection(&clipboardLock);
+    ClipboardCacheInit(&clipboardCache);
+    pngClipboardFormat = RegisterClipboardFormatW(L"PNG");
+
+    if (!StartActionWorker()) {
+        LogMessage("Warning: could not start action worker, running actions inline");
+    }
+
     if (!InstallHooks()) {
         MessageBoxW(NULL, L"Failed to install hooks", APP_NAME, MB_ICONERROR);
+        StopActionWorker();
         RemoveTrayIcon();
         DestroyWindow(mainWindow);
+        CloseLogFile();
         return 1;
     }
 
+    SetTimer(mainWindow, ID_TIMER_STATS_DUMP, STATS_DUMP_INTERVAL_MS, NULL);
+
     HANDLE configWatch = FindFirstChangeNotificationW(dataDir, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE);
     if (configWatch == INVALID_HANDLE_VALUE) {
         LogMessage("Warning: could not watch config directory for changes");
@@ -225,6 +321,13 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
         FindCloseChangeNotification(configWatch);
     }
     RemoveHooks();
+    if (traceBuffer)
+        ToggleInputTrace();
+    LogHookStats();
+    StopActionWorker();
+    FrameBufferRelease(&captureBuffer);
+    RenderAllClipboardFormats(mainWindow);
+    ClipboardCacheRelease(&clipboardCache, clipboardCache.generation);
     RemoveTrayIcon();
     if (trayMenu) {
         DestroyMenu(trayMenu);
@@ -232,6 +335,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
     if (appIcon) {
         DestroyIcon(appIcon);
     }
+    CloseLogFile();
 
     return (int)msg.wParam;
 }
@@ -248,155 +352,6 @@ static const char *DEFAULT_CONFIG =
     "  ]\n"
     "}\n";
 
-static ModifierState ParseModifierState(const char *str) {
-    if (!str || strcmp(str, "none") == 0)
-        return MODIFIER_NONE;
-    if (strcmp(str, "left") == 0)
-        return MODIFIER_LEFT;
-    if (strcmp(str, "right") == 0)
-        return MODIFIER_RIGHT;
-    if (strcmp(str, "either") == 0)
-        return MODIFIER_EITHER;
-    if (strcmp(str, "both") == 0)
-        return MODIFIER_BOTH;
-    LogMessage("Warning: unrecognized modifier '%s', using 'none'", str);
-    return MODIFIER_NONE;
-}
-
-static MediaAction ParseAction(const char *str) {
-    if (!str) {
-        LogMessage("Warning: missing action");
-        return ACTION_NONE;
-    }
-    if (strcmp(str, "volume_up") == 0)
-        return ACTION_VOLUME_UP;
-    if (strcmp(str, "volume_down") == 0)
-        return ACTION_VOLUME_DOWN;
-    if (strcmp(str, "volume_mute") == 0)
-        return ACTION_VOLUME_MUTE;
-    if (strcmp(str, "play_pause") == 0)
-        return ACTION_PLAY_PAUSE;
-    if (strcmp(str, "prev_track") == 0)
-        return ACTION_PREV_TRACK;
-    if (strcmp(str, "next_track") == 0)
-        return ACTION_NEXT_TRACK;
-    if (strcmp(str, "screenshot_client_clipboard") == 0)
-        return ACTION_SCREENSHOT_CLIENT_CLIPBOARD;
-    if (strcmp(str, "screenshot_client_file") == 0)
-        return ACTION_SCREENSHOT_CLIENT_FILE;
-    if (strcmp(str, "screenshot_client_file_clipboard") == 0)
-        return ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD;
-    LogMessage("Warning: unrecognized action '%s'", str);
-    return ACTION_NONE;
-}
-
-static BOOL ParseTrigger(const char *str, TriggerType *type, HotkeyBinding *binding) {
-    if (!str) {
-        LogMessage("Warning: missing trigger");
-        return FALSE;
-    }
-
-    if (strcmp(str, "wheel_up") == 0) {
-        *type = TRIGGER_MOUSE_WHEEL;
-        binding->trigger.wheelDir = WHEEL_UP;
-        return TRUE;
-    }
-    if (strcmp(str, "wheel_down") == 0) {
-        *type = TRIGGER_MOUSE_WHEEL;
-        binding->trigger.wheelDir = WHEEL_DOWN;
-        return TRUE;
-    }
-
-    if (strcmp(str, "mouse_left") == 0) {
-        *type = TRIGGER_MOUSE_BUTTON;
-        binding->trigger.mouseButton = MOUSE_BUTTON_LEFT;
-        return TRUE;
-    }
-    if (strcmp(str, "mouse_right") == 0) {
-        *type = TRIGGER_MOUSE_BUTTON;
-        binding->trigger.mouseButton = MOUSE_BUTTON_RIGHT;
-        return TRUE;
-    }
-    if (strcmp(str, "mouse_middle") == 0) {
-        *type = TRIGGER_MOUSE_BUTTON;
-        binding->trigger.mouseButton = MOUSE_BUTTON_MIDDLE;
-        return TRUE;
-    }
-    if (strcmp(str, "mouse_x1") == 0) {
-        *type = TRIGGER_MOUSE_BUTTON;
-        binding->trigger.mouseButton = MOUSE_BUTTON_X1;
-        return TRUE;
-    }
-    if (strcmp(str, "mouse_x2") == 0) {
-        *type = TRIGGER_MOUSE_BUTTON;
-        binding->trigger.mouseButton = MOUSE_BUTTON_X2;
-        return TRUE;
-    }
-
-    if (strncmp(str, "key_", 4) == 0) {
-        static const struct { const char *name; DWORD vk; } namedKeys[] = {
-            /* Letters */
-            {"a", 0x41}, {"b", 0x42}, {"c", 0x43}, {"d", 0x44},
-            {"e", 0x45}, {"f", 0x46}, {"g", 0x47}, {"h", 0x48},
-            {"i", 0x49}, {"j", 0x4A}, {"k", 0x4B}, {"l", 0x4C},
-            {"m", 0x4D}, {"n", 0x4E}, {"o", 0x4F}, {"p", 0x50},
-            {"q", 0x51}, {"r", 0x52}, {"s", 0x53}, {"t", 0x54},
-            {"u", 0x55}, {"v", 0x56}, {"w", 0x57}, {"x", 0x58},
-            {"y", 0x59}, {"z", 0x5A},
-            /* Digits */
-            {"0", 0x30}, {"1", 0x31}, {"2", 0x32}, {"3", 0x33},
-            {"4", 0x34}, {"5", 0x35}, {"6", 0x36}, {"7", 0x37},
-            {"8", 0x38}, {"9", 0x39},
-            /* Function keys */
-            {"f1", VK_F1}, {"f2", VK_F2}, {"f3", VK_F3}, {"f4", VK_F4},
-            {"f5", VK_F5}, {"f6", VK_F6}, {"f7", VK_F7}, {"f8", VK_F8},
-            {"f9", VK_F9}, {"f10", VK_F10}, {"f11", VK_F11}, {"f12", VK_F12},
-            /* Common keys */
-            {"space", VK_SPACE}, {"enter", VK_RETURN}, {"tab", VK_TAB},
-            {"escape", VK_ESCAPE}, {"backspace", VK_BACK}, {"delete", VK_DELETE},
-            {"insert", VK_INSERT}, {"home", VK_HOME}, {"end", VK_END},
-            {"pageup", VK_PRIOR}, {"pagedown", VK_NEXT},
-            {"up", VK_UP}, {"down", VK_DOWN}, {"left", VK_LEFT}, {"right", VK_RIGHT},
-            {"printscreen", VK_SNAPSHOT}, {"scrolllock", VK_SCROLL}, {"pause", VK_PAUSE},
-            {"numlock", VK_NUMLOCK}, {"capslock", VK_CAPITAL},
-            /* Numpad */
-            {"num0", VK_NUMPAD0}, {"num1", VK_NUMPAD1}, {"num2", VK_NUMPAD2},
-            {"num3", VK_NUMPAD3}, {"num4", VK_NUMPAD4}, {"num5", VK_NUMPAD5},
-            {"num6", VK_NUMPAD6}, {"num7", VK_NUMPAD7}, {"num8", VK_NUMPAD8},
-            {"num9", VK_NUMPAD9}, {"nummultiply", VK_MULTIPLY}, {"numadd", VK_ADD},
-            {"numsubtract", VK_SUBTRACT}, {"numdecimal", VK_DECIMAL}, {"numdivide", VK_DIVIDE},
-            /* Punctuation */
-            {"semicolon", VK_OEM_1}, {"equals", VK_OEM_PLUS}, {"comma", VK_OEM_COMMA},
-            {"minus", VK_OEM_MINUS}, {"period", VK_OEM_PERIOD}, {"slash", VK_OEM_2},
-            {"backtick", VK_OEM_3}, {"lbracket", VK_OEM_4}, {"backslash", VK_OEM_5},
-            {"rbracket", VK_OEM_6}, {"quote", VK_OEM_7},
-        };
-
-        const char *keyName = str + 4;
-
-        for (int i = 0; i < (int)(sizeof(namedKeys) / sizeof(namedKeys[0])); i++) {
-            if (strcmp(keyName, namedKeys[i].name) == 0) {
-                *type = TRIGGER_KEYBOARD;
-                binding->trigger.keyCode = namedKeys[i].vk;
-                return TRUE;
-            }
-        }
-
-        char *endptr;
-        unsigned long code = strtoul(keyName, &endptr, 0);
-        if (endptr == keyName || *endptr != '\0') {
-            LogMessage("Warning: invalid key code '%s'", str);
-            return FALSE;
-        }
-        *type = TRIGGER_KEYBOARD;
-        binding->trigger.keyCode = (DWORD)code;
-        return TRUE;
-    }
-
-    LogMessage("Warning: unrecognized trigger '%s'", str);
-    return FALSE;
-}
-
 static BOOL InitDataDir(void) {
     WCHAR exePath[MAX_PATH];
     if (GetModuleFileNameW(NULL, exePath, MAX_PATH) > 0) {
@@ -446,9 +401,110 @@ static BOOL CreateDefaultConfig(const WCHAR *path) {
     return TRUE;
 }
 
-static BOOL LoadConfig(void) {
+static void ApplyCompiledConfig(const CompiledConfig *config) {
+    /* A trace carries the config it was recorded with, so it cannot span a change of bindings. */
+    if (traceBuffer) {
+        LogMessage("Trace: the config changed, so the recording stops here");
+        ToggleInputTrace();
+    }
+
+    CopyMemory(bindings, config->bindings, sizeof(bindings));
+    bindingCount = config->bindingCount;
+    BuildDispatchTable(&dispatch, bindings, bindingCount);
+    InputBatchSetMax(&inputBatch, config->inputBatch);
+
+    KillTimer(mainWindow, ID_TIMER_WHEEL_FLUSH);
+    WheelAccumulatorConfigure(&wheel, &config->wheel);
+    ZeroMemory(wheelActions, sizeof(wheelActions));
+
+    InterlockedExchange(&replayFps, config->replayFps);
+    InterlockedExchange(&replaySeconds, config->replaySeconds);
+    InterlockedExchange(&replayMemoryMb, config->replayMemoryMb);
+    InterlockedExchange(&replaySettingsChanged, 1);
+    if (actionEvent)
+        SetEvent(actionEvent);
+}
+
+static void GetConfigCachePath(WCHAR *path, DWORD pathLen) {
+    swprintf_s(path, pathLen, L"%s\\%s", dataDir, CONFIG_CACHE_FILENAME);
+}
+
+static BOOL ReadConfigCache(const ConfigSource *source, CompiledConfig *config) {
+    WCHAR cachePath[MAX_PATH];
+    GetConfigCachePath(cachePath, MAX_PATH);
+
+    FILE *f = _wfopen(cachePath, L"rb");
+    if (!f)
+        return FALSE;
+
+    size_t imageSize = ConfigCacheBytes();
+    unsigned char *image = (unsigned char *)malloc(imageSize + 1);
+    if (!image) {
+        fclose(f);
+        return FALSE;
+    }
+
+    /* Asks for one byte more than an image holds so a longer file is not mistaken for one. */
+    size_t bytesRead = fread(image, 1, imageSize + 1, f);
+    fclose(f);
+    BOOL loaded = ConfigCacheLoad(image, bytesRead, source, config);
+    free(image);
+    return loaded;
+}
+
+/* Best effort: without a cache the next load just parses the JSON again. */
+static void WriteConfigCache(const ConfigSource *source, const CompiledConfig *config) {
+    WCHAR cachePath[MAX_PATH];
+    GetConfigCachePath(cachePath, MAX_PATH);
+
+    size_t imageSize = ConfigCacheBytes();
+    unsigned char *image = (unsigned char *)malloc(imageSize);
+    if (!image)
+        return;
+    ConfigCacheBuild(image, source, config);
+
+    FILE *f = _wfopen(cachePath, L"wb");
+    if (f) {
+        BOOL written = fwrite(image, 1, imageSize, f) == imageSize;
+        if (fclose(f) != 0 || !written)
+            DeleteFileW(cachePath);
+    }
+    free(image);
+}
+
+/* Identifies this build for the config cache: the compiled layout plus the size and write time
+ * of the executable, so any rebuild, even one that keeps VERSION, misses the old image. */
+static unsigned int GetBuildId(void) {
+    static unsigned int buildId = 0;
+    if (buildId)
+        return buildId;
+
+    unsigned int id[5] = {ConfigCacheLayout(), 0, 0, 0, 0};
+    WCHAR exePath[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetModuleFileNameW(NULL, exePath, MAX_PATH) > 0 &&
+        GetFileAttributesExW(exePath, GetFileExInfoStandard, &attributes)) {
+        id[1] = attributes.nFileSizeHigh;
+        id[2] = attributes.nFileSizeLow;
+        id[3] = attributes.ftLastWriteTime.dwHighDateTime;
+        id[4] = attributes.ftLastWriteTime.dwLowDateTime;
+    } else {
+        id[1] = Crc32(0, VERSION, sizeof(VERSION) - 1);
+    }
+    buildId = Crc32(0, id, sizeof(id));
+    return buildId;
+}
+
+/* The compiled bindings and settings are cached next to config.json, keyed by its size, write
+ * time and CRC and the build, so startup and reloads of an unchanged file skip the parse. A
+ * load of the JSON that is already applied changes nothing; applied (optional) says whether
+ * the bindings were replaced. */
+static BOOL LoadConfig(BOOL *applied) {
     WCHAR configPath[MAX_PATH];
 
+    if (applied)
+        *applied = FALSE;
+
     if (!GetConfigPath(configPath, MAX_PATH)) {
         return FALSE;
     }
@@ -460,6 +516,20 @@ static BOOL LoadConfig(void) {
         }
     }
 
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(configPath, GetFileExInfoStandard, &attributes))
+        return FALSE;
+
+    ConfigSource source;
+    source.size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    source.modified = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+                      attributes.ftLastWriteTime.dwLowDateTime;
+    source.build = GetBuildId();
+    /* Most wakeups are the log or the cache being written; those leave config.json untouched. */
+    if (configApplied && source.size == appliedSource.size &&
+        source.modified == appliedSource.modified && source.build == appliedSource.build)
+        return TRUE;
+
     FILE *f = _wfopen(configPath, L"rb");
     if (!f)
         return FALSE;
@@ -486,91 +556,203 @@ static BOOL LoadConfig(void) {
     }
     jsonStr[fileSize] = '\0';
 
-    cJSON *root = cJSON_Parse(jsonStr);
-    free(jsonStr);
+    source.size = (unsigned long long)fileSize;
+    source.crc = Crc32(0, jsonStr, (size_t)fileSize);
+    if (configApplied && ConfigSourceSameContent(&source, &appliedSource)) {
+        appliedSource.modified = source.modified;
+        free(jsonStr);
+        return TRUE;
+    }
 
-    if (!root) {
-        return FALSE;
+    /* Static: the image is well over a kilobyte and this runs on the window thread. */
+    static CompiledConfig config;
+    if (!ReadConfigCache(&source, &config)) {
+        if (!CompileConfig(jsonStr, &config, &configArena, LogMessage)) {
+            free(jsonStr);
+            return FALSE;
+        }
+        WriteConfigCache(&source, &config);
     }
 
-    cJSON *bindingsArray = cJSON_GetObjectItem(root, "bindings");
-    if (!cJSON_IsArray(bindingsArray)) {
-        cJSON_Delete(root);
-        return FALSE;
+    ApplyCompiledConfig(&config);
+    free(appliedConfigJson);
+    appliedConfigJson = jsonStr;
+    appliedConfigLength = bytesRead;
+    appliedSource = source;
+    configApplied = TRUE;
+    if (applied)
+        *applied = TRUE;
+    return TRUE;
+}
+
+static void ResyncModifierState(void) {
+    static const struct { int vk; unsigned char bit; } modifierKeys[] = {
+        {VK_LCONTROL, MODIFIER_BIT_LCTRL}, {VK_RCONTROL, MODIFIER_BIT_RCTRL},
+        {VK_LSHIFT, MODIFIER_BIT_LSHIFT}, {VK_RSHIFT, MODIFIER_BIT_RSHIFT},
+        {VK_LMENU, MODIFIER_BIT_LALT}, {VK_RMENU, MODIFIER_BIT_RALT},
+        {VK_LWIN, MODIFIER_BIT_LWIN}, {VK_RWIN, MODIFIER_BIT_RWIN},
+    };
+
+    unsigned char down = 0;
+    for (int i = 0; i < (int)(sizeof(modifierKeys) / sizeof(modifierKeys[0])); i++) {
+        if (GetAsyncKeyState(modifierKeys[i].vk) & 0x8000)
+            down |= modifierKeys[i].bit;
     }
+    hookEngine.modifiers.down = down;
+}
 
-    bindingCount = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, bindingsArray) {
-        if (bindingCount >= MAX_BINDINGS)
-            break;
+static void CALLBACK ForegroundEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject,
+    LONG idChild, DWORD eventThread, DWORD eventTime) {
+    (void)hook;
+    (void)event;
+    (void)hwnd;
+    (void)idObject;
+    (void)idChild;
+    (void)eventThread;
+    (void)eventTime;
+
+    ResyncModifierState();
+}
+
+static ULONGLONG ReadTicks(void) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (ULONGLONG)now.QuadPart;
+}
+
+static double TicksToMs(ULONGLONG ticks) {
+    if (perfFrequency.QuadPart == 0)
+        return 0.0;
+    return (double)ticks * 1000.0 / (double)perfFrequency.QuadPart;
+}
 
-        HotkeyBinding *b = &bindings[bindingCount];
+/* Runs on the action worker thread, away from the input hooks. */
+static void RunQueuedAction(MediaAction action) {
+    switch (action) {
+    case ACTION_SCREENSHOT_CLIENT_CLIPBOARD:
+        CaptureClientAreaToClipboard();
+        break;
+    case ACTION_SCREENSHOT_CLIENT_FILE:
+        CaptureClientAreaToFile(SCREENSHOT_FORMAT_PNG);
+        break;
+    case ACTION_SCREENSHOT_CLIENT_FILE_FAST:
+        CaptureClientAreaToFile(SCREENSHOT_FORMAT_PNG_FAST);
+        break;
+    case ACTION_SCREENSHOT_CLIENT_FILE_QOI:
+        CaptureClientAreaToFile(SCREENSHOT_FORMAT_QOI);
+        break;
+    case ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD:
+        CaptureClientAreaToFileClipboard();
+        break;
+    case ACTION_REPLAY_SAVE_APNG:
+        SaveReplay(FALSE);
+        break;
+    case ACTION_REPLAY_SAVE_PNG_SEQUENCE:
+        SaveReplay(TRUE);
+        break;
+    default:
+        break;
+    }
+}
 
-        cJSON *ctrl = cJSON_GetObjectItem(item, "ctrl");
-        cJSON *shift = cJSON_GetObjectItem(item, "shift");
-        cJSON *alt = cJSON_GetObjectItem(item, "alt");
-        cJSON *win = cJSON_GetObjectItem(item, "win");
-        cJSON *trigger = cJSON_GetObjectItem(item, "trigger");
-        cJSON *action = cJSON_GetObjectItem(item, "action");
+/* Also records the instant replay: replayTimer fires at the configured rate and each tick
+ * captures one frame between queued actions. */
+static DWORD WINAPI ActionWorkerProc(LPVOID param) {
+    (void)param;
 
-        b->ctrl = ParseModifierState(cJSON_GetStringValue(ctrl));
-        b->shift = ParseModifierState(cJSON_GetStringValue(shift));
-        b->alt = ParseModifierState(cJSON_GetStringValue(alt));
-        b->win = ParseModifierState(cJSON_GetStringValue(win));
+    HANDLE waitHandles[2] = {actionEvent, replayTimer};
+    DWORD waitCount = replayTimer ? 2 : 1;
+    while (!actionWorkerStopping) {
+        if (InterlockedExchange(&replaySettingsChanged, 0))
+            ApplyReplaySettings();
 
-        if (!ParseTrigger(cJSON_GetStringValue(trigger), &b->triggerType, b)) {
+        DWORD result = WaitForMultipleObjects(waitCount, waitHandles, FALSE, INFINITE);
+        if (result == WAIT_OBJECT_0 + 1) {
+            CaptureReplayFrame();
             continue;
         }
 
-        b->action = ParseAction(cJSON_GetStringValue(action));
-        bindingCount++;
+        QueuedAction item;
+        while (ActionQueuePop(&actionQueue, &item)) {
+            ULONGLONG started = ReadTicks();
+            ActionQueueComplete(&actionQueue, &item, started);
+            RunQueuedAction((MediaAction)item.action);
+            LogMessage("Action %d: waited %.2f ms, ran %.2f ms", item.action,
+                TicksToMs(started - item.enqueueTicks), TicksToMs(ReadTicks() - started));
+        }
     }
 
-    cJSON_Delete(root);
-    return TRUE;
+    ReplayBufferRelease(&replayBuffer);
+    return 0;
 }
 
-static BOOL CheckSingleModifier(ModifierState required, int vkLeft, int vkRight) {
-    BOOL leftDown = (GetAsyncKeyState(vkLeft) & 0x8000) != 0;
-    BOOL rightDown = (GetAsyncKeyState(vkRight) & 0x8000) != 0;
-
-    switch (required) {
-    case MODIFIER_NONE:
-        return !leftDown && !rightDown;
-    case MODIFIER_LEFT:
-        return leftDown && !rightDown;
-    case MODIFIER_RIGHT:
-        return !leftDown && rightDown;
-    case MODIFIER_EITHER:
-        return leftDown || rightDown;
-    case MODIFIER_BOTH:
-        return leftDown && rightDown;
-    }
-    return FALSE;
-}
+static BOOL StartActionWorker(void) {
+    ActionQueueInit(&actionQueue);
 
-static BOOL CheckModifiers(const HotkeyBinding *binding) {
-    if (!CheckSingleModifier(binding->ctrl, VK_LCONTROL, VK_RCONTROL))
+    actionEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!actionEvent)
         return FALSE;
-    if (!CheckSingleModifier(binding->shift, VK_LSHIFT, VK_RSHIFT))
-        return FALSE;
-    if (!CheckSingleModifier(binding->alt, VK_LMENU, VK_RMENU))
-        return FALSE;
-    if (!CheckSingleModifier(binding->win, VK_LWIN, VK_RWIN))
+
+    replayTimer = CreateWaitableTimerW(NULL, FALSE, NULL);
+    if (!replayTimer)
+        LogMessage("Warning: could not create replay timer, instant replay is off");
+
+    actionWorker = CreateThread(NULL, 0, ActionWorkerProc, NULL, 0, NULL);
+    if (!actionWorker) {
+        if (replayTimer)
+            CloseHandle(replayTimer);
+        CloseHandle(actionEvent);
+        replayTimer = NULL;
+        actionEvent = NULL;
         return FALSE;
+    }
     return TRUE;
 }
 
-static void MarkWinKeyForSuppression(void) {
-    if ((GetAsyncKeyState(VK_LWIN) & 0x8000) || (GetAsyncKeyState(VK_RWIN) & 0x8000)) {
-        suppressWinKeyUp = TRUE;
+static void StopActionWorker(void) {
+    if (!actionWorker)
+        return;
+
+    InterlockedExchange(&actionWorkerStopping, 1);
+    SetEvent(actionEvent);
+    if (WaitForSingleObject(actionWorker, ACTION_WORKER_STOP_TIMEOUT_MS) != WAIT_OBJECT_0) {
+        LogMessage("Warning: action worker did not stop in time");
+    }
+    CloseHandle(actionWorker);
+    CloseHandle(actionEvent);
+    if (replayTimer)
+        CloseHandle(replayTimer);
+    actionWorker = NULL;
+    actionEvent = NULL;
+    replayTimer = NULL;
+
+    ActionQueueStats stats;
+    ActionQueueGetStats(&actionQueue, &stats);
+    LogMessage("Action queue: %u queued, %u dropped, max depth %u, avg wait %.2f ms, max wait %.2f ms",
+        stats.pushed, stats.dropped, stats.maxDepth,
+        stats.completed ? TicksToMs(stats.totalLatencyTicks / stats.completed) : 0.0,
+        TicksToMs(stats.maxLatencyTicks));
+}
+
+/* Slow actions are handed to the worker thread so the hook returns immediately; Windows
+ * silently removes low-level hooks that exceed LowLevelHooksTimeout. */
+static void QueueAction(MediaAction action) {
+    if (!actionWorker) {
+        RunQueuedAction(action);
+        return;
     }
+
+    if (ActionQueuePush(&actionQueue, action, ReadTicks()))
+        SetEvent(actionEvent);
 }
 
-static void ExecuteAction(MediaAction action) {
+/* Runs action count times, limited by ActionRepeatLimit. Key presses are only added to
+ * inputBatch; whoever is handling the current event flushes it once, when done. */
+static void ExecuteAction(MediaAction action, int count) {
     WORD vk = 0;
 
+    count = ActionRepeatLimit(action, count);
+
     switch (action) {
     case ACTION_NONE:
         return;
@@ -593,45 +775,66 @@ static void ExecuteAction(MediaAction action) {
         vk = VK_MEDIA_NEXT_TRACK;
         break;
     case ACTION_SCREENSHOT_CLIENT_CLIPBOARD:
-        CaptureClientAreaToClipboard();
-        return;
     case ACTION_SCREENSHOT_CLIENT_FILE:
-        CaptureClientAreaToFile(NULL, 0);
-        return;
     case ACTION_SCREENSHOT_CLIENT_FILE_CLIPBOARD:
-        CaptureClientAreaToFileClipboard();
+    case ACTION_SCREENSHOT_CLIENT_FILE_FAST:
+    case ACTION_SCREENSHOT_CLIENT_FILE_QOI:
+    case ACTION_REPLAY_SAVE_APNG:
+    case ACTION_REPLAY_SAVE_PNG_SEQUENCE:
+        if (count > 0)
+            QueueAction(action);
         return;
     default:
         return;
     }
 
-    INPUT inputs[2] = {0};
-    inputs[0].type = INPUT_KEYBOARD;
-    inputs[0].ki.wVk = vk;
-    inputs[1].type = INPUT_KEYBOARD;
-    inputs[1].ki.wVk = vk;
-    inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
-    SendInput(2, inputs, sizeof(INPUT));
+    InputBatchTap(&inputBatch, vk, count);
+}
+
+static int SendSyntheticKeys(void *context, const SyntheticKey *keys, int count) {
+    (void)context;
+
+    INPUT inputs[INPUT_BATCH_CAPACITY];
+    ZeroMemory(inputs, sizeof(INPUT) * count);
+    for (int i = 0; i < count; i++) {
+        inputs[i].type = INPUT_KEYBOARD;
+        inputs[i].ki.wVk = keys[i].keyCode;
+        inputs[i].ki.dwFlags = keys[i].keyUp ? KEYEVENTF_KEYUP : 0;
+    }
+    return (int)SendInput((UINT)count, inputs, sizeof(INPUT));
 }
 
-static HBITMAP CaptureClientArea(int *outWidth, int *outHeight) {
+static void LogCaptureFailure(BOOL quiet, const char *format, ...) {
+    if (quiet)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    LogMessageV(format, args);
+    va_end(args);
+}
+
+/* Renders the foreground window into the reusable top-down DIB section and returns its client
+ * area as a view into that surface. The view stays valid until the next capture. quiet keeps
+ * failures out of the log, for the replay timer that captures several times a second. */
+static BOOL CaptureClientArea(FrameView *view, BOOL quiet) {
     HWND hwnd = GetForegroundWindow();
     if (!hwnd) {
-        LogMessage("Screenshot: no foreground window");
-        return NULL;
+        LogCaptureFailure(quiet, "Screenshot: no foreground window");
+        return FALSE;
     }
 
     RECT windowRect;
     if (!GetWindowRect(hwnd, &windowRect)) {
-        LogMessage("Screenshot: GetWindowRect failed");
-        return NULL;
+        LogCaptureFailure(quiet, "Screenshot: GetWindowRect failed");
+        return FALSE;
     }
 
     int winWidth = windowRect.right - windowRect.left;
     int winHeight = windowRect.bottom - windowRect.top;
     if (winWidth <= 0 || winHeight <= 0) {
-        LogMessage("Screenshot: invalid window rect (%dx%d)", winWidth, winHeight);
-        return NULL;
+        LogCaptureFailure(quiet, "Screenshot: invalid window rect (%dx%d)", winWidth, winHeight);
+        return FALSE;
     }
 
     POINT clientOrigin = {0, 0};
@@ -641,117 +844,241 @@ static HBITMAP CaptureClientArea(int *outWidth, int *outHeight) {
 
     RECT clientRect;
     if (!GetClientRect(hwnd, &clientRect)) {
-        LogMessage("Screenshot: GetClientRect failed");
-        return NULL;
+        LogCaptureFailure(quiet, "Screenshot: GetClientRect failed");
+        return FALSE;
     }
 
     int clientWidth = clientRect.right - clientRect.left;
     int clientHeight = clientRect.bottom - clientRect.top;
     if (clientWidth <= 0 || clientHeight <= 0) {
-        LogMessage("Screenshot: invalid client rect (%dx%d)", clientWidth, clientHeight);
-        return NULL;
+        LogCaptureFailure(quiet, "Screenshot: invalid client rect (%dx%d)", clientWidth,
+            clientHeight);
+        return FALSE;
     }
 
-    HDC screenDC = GetDC(NULL);
-    if (!screenDC) {
-        LogMessage("Screenshot: GetDC failed");
-        return NULL;
+    if (!FrameBufferReserve(&captureBuffer, winWidth, winHeight)) {
+        LogCaptureFailure(quiet, "Screenshot: failed to allocate capture surface (%dx%d)",
+            winWidth, winHeight);
+        return FALSE;
     }
 
-    HDC fullDC = CreateCompatibleDC(screenDC);
-    HDC clientDC = CreateCompatibleDC(screenDC);
-    HBITMAP fullBitmap = CreateCompatibleBitmap(screenDC, winWidth, winHeight);
-    HBITMAP clientBitmap = CreateCompatibleBitmap(screenDC, clientWidth, clientHeight);
-    ReleaseDC(NULL, screenDC);
-
-    if (!fullDC || !clientDC || !fullBitmap || !clientBitmap) {
-        LogMessage("Screenshot: failed to allocate GDI resources");
-        if (clientBitmap) DeleteObject(clientBitmap);
-        if (fullBitmap) DeleteObject(fullBitmap);
-        if (clientDC) DeleteDC(clientDC);
-        if (fullDC) DeleteDC(fullDC);
-        return NULL;
+    HDC memDC = CreateCompatibleDC(NULL);
+    if (!memDC) {
+        LogCaptureFailure(quiet, "Screenshot: CreateCompatibleDC failed");
+        return FALSE;
     }
 
 #ifndef PW_RENDERFULLCONTENT
 #define PW_RENDERFULLCONTENT 0x00000002
 #endif
 
-    HBITMAP oldFull = (HBITMAP)SelectObject(fullDC, fullBitmap);
-    if (!PrintWindow(hwnd, fullDC, PW_RENDERFULLCONTENT)) {
-        LogMessage("Screenshot: PrintWindow failed");
-        SelectObject(fullDC, oldFull);
-        DeleteObject(clientBitmap);
-        DeleteObject(fullBitmap);
-        DeleteDC(clientDC);
-        DeleteDC(fullDC);
-        return NULL;
+    HBITMAP oldBitmap = (HBITMAP)SelectObject(memDC, (HBITMAP)captureBuffer.surface);
+    BOOL printed = PrintWindow(hwnd, memDC, PW_RENDERFULLCONTENT);
+    SelectObject(memDC, oldBitmap);
+    DeleteDC(memDC);
+
+    if (!printed) {
+        LogCaptureFailure(quiet, "Screenshot: PrintWindow failed");
+        return FALSE;
     }
 
-    HBITMAP oldClient = (HBITMAP)SelectObject(clientDC, clientBitmap);
-    BitBlt(clientDC, 0, 0, clientWidth, clientHeight, fullDC, clientOffsetX, clientOffsetY, SRCCOPY);
+    /* GDI may batch the drawing; make sure it has landed before the pixels are read. */
+    GdiFlush();
 
-    SelectObject(clientDC, oldClient);
-    SelectObject(fullDC, oldFull);
-    DeleteObject(fullBitmap);
-    DeleteDC(clientDC);
-    DeleteDC(fullDC);
+    if (!FrameBufferView(&captureBuffer, clientOffsetX, clientOffsetY, clientWidth, clientHeight,
+            view)) {
+        LogCaptureFailure(quiet, "Screenshot: client area lies outside the window");
+        return FALSE;
+    }
+    return TRUE;
+}
 
-    *outWidth = clientWidth;
-    *outHeight = clientHeight;
-    return clientBitmap;
+static void *CreateCaptureSurface(void *user, int width, int height, unsigned char **pixels,
+    int *stride) {
+    (void)user;
+
+    BITMAPINFO bmi = {0};
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void *bits = NULL;
+    HBITMAP dib = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (!dib)
+        return NULL;
+
+    *pixels = (unsigned char *)bits;
+    *stride = width * 4;
+    return dib;
+}
+
+static void DestroyCaptureSurface(void *user, void *surface) {
+    (void)user;
+    DeleteObject((HBITMAP)surface);
 }
 
+/* The DIB is offered as soon as the capture is copied, and the PNG is encoded straight after on
+ * this thread and added to the offer when it is done. The window thread only copies them out
+ * when something is pasted, so it never encodes while the hooks wait behind it. */
 static void CaptureClientAreaToClipboard(void) {
-    int width, height;
-    HBITMAP bitmap = CaptureClientArea(&width, &height);
-    if (!bitmap) return;
+    FrameView view;
+    if (!CaptureClientArea(&view, FALSE)) return;
 
-    if (OpenClipboard(NULL)) {
-        EmptyClipboard();
-        SetClipboardData(CF_BITMAP, bitmap);
-        CloseClipboard();
-        LogMessage("Screenshot: copied to clipboard (%dx%d)", width, height);
-    } else {
-        DeleteObject(bitmap);
-        LogMessage("Screenshot: OpenClipboard failed");
+    unsigned char *pixels =
+        ClipboardCachePackPixels(view.pixels, view.stride, view.width, view.height);
+    if (!pixels) {
+        LogMessage("Screenshot: out of memory for clipboard snapshot");
+        return;
+    }
+
+    EnterCriticalSection(&clipboardLock);
+    unsigned int generation = ClipboardCacheSet(&clipboardCache, pixels, view.width,
+        view.height, CLIPBOARD_OFFER_DIB | CLIPBOARD_OFFER_PNG);
+    LeaveCriticalSection(&clipboardLock);
+
+    PostMessageW(mainWindow, WM_CLIPBOARD_OFFER, generation, 0);
+    LogMessage("Screenshot: offered to clipboard (%dx%d)", view.width, view.height);
+
+    PngEncodeOptions options;
+    InitScreenshotPngOptions(&options, FALSE);
+    int len = 0;
+    unsigned char *png =
+        PngEncodeToMemory(view.pixels, view.stride, view.width, view.height, 3, &options, &len);
+    if (!png) {
+        LogMessage("Screenshot: failed to encode clipboard PNG");
+        return;
+    }
+
+    EnterCriticalSection(&clipboardLock);
+    BOOL attached = ClipboardCacheSetPng(&clipboardCache, generation, png, len);
+    LeaveCriticalSection(&clipboardLock);
+
+    if (attached)
+        PostMessageW(mainWindow, WM_CLIPBOARD_OFFER, generation, CLIPBOARD_OFFER_PNG);
+    else
+        PngFree(png); /* a newer capture replaced this one while it was encoding */
+}
+
+typedef struct {
+    PngParallelBody body;
+    void *context;
+    int count;
+    volatile LONG next;
+} ParallelJob;
+
+static void RunParallelJobs(ParallelJob *job) {
+    LONG index;
+    while ((index = InterlockedIncrement(&job->next) - 1) < job->count) {
+        job->body(job->context, (int)index);
     }
 }
 
-static BOOL CaptureClientAreaToFile(WCHAR *outPath, DWORD outPathLen) {
-    int width, height;
-    HBITMAP bitmap = CaptureClientArea(&width, &height);
-    if (!bitmap) return FALSE;
+static VOID CALLBACK ParallelWorkCallback(PTP_CALLBACK_INSTANCE instance, PVOID param, PTP_WORK work) {
+    (void)instance;
+    (void)work;
+    RunParallelJobs((ParallelJob *)param);
+}
 
-    BITMAPINFOHEADER bi = {0};
-    bi.biSize = sizeof(bi);
-    bi.biWidth = width;
-    bi.biHeight = -height;
-    bi.biPlanes = 1;
-    bi.biBitCount = 32;
-    bi.biCompression = BI_RGB;
+/* PngParallelFor on the process thread pool. The calling thread works through indices too,
+ * so the encode still completes if no pool thread picks the work up. */
+static void ThreadPoolParallelFor(PngParallelBody body, void *context, int count, void *user) {
+    (void)user;
 
-    unsigned char *pixels = (unsigned char *)malloc(width * height * 4);
-    if (!pixels) {
-        DeleteObject(bitmap);
-        LogMessage("Screenshot: malloc failed");
-        return FALSE;
+    ParallelJob job = {body, context, count, 0};
+    PTP_WORK work = CreateThreadpoolWork(ParallelWorkCallback, &job, NULL);
+    if (work) {
+        for (int i = 1; i < count; i++) {
+            SubmitThreadpoolWork(work);
+        }
+    }
+    RunParallelJobs(&job);
+    if (work) {
+        WaitForThreadpoolWorkCallbacks(work, FALSE);
+        CloseThreadpoolWork(work);
+    }
+}
+
+static void InitPngOptions(PngEncodeOptions *options) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+
+    ZeroMemory(options, sizeof(*options));
+    options->parallelFor = ThreadPoolParallelFor;
+    options->threads = (int)si.dwNumberOfProcessors;
+}
+
+/* The fast profile matches runs only; with the Up filter an unchanged area is a run of zeros. */
+static void InitScreenshotPngOptions(PngEncodeOptions *options, BOOL fast) {
+    static const DeflateParams fastDeflate = {0, 0, 0, 1};
+
+    InitPngOptions(options);
+    options->source = PNG_SOURCE_BGRX;
+    if (fast) {
+        options->filter = PNG_FILTER_UP;
+        options->deflate = &fastDeflate;
     }
+}
+
+static void WriteFileBytes(void *context, void *data, int size) {
+    fwrite(data, 1, (size_t)size, (FILE *)context);
+}
+
+/* Encodes 32-bit BGRX pixels as it reads them; GDI's fourth byte is not real alpha, so the PNG
+ * is written as RGB. Captures past SCREENSHOT_STREAM_MIN_PIXELS are streamed to the file on
+ * this thread rather than encoded in parallel, so their memory does not grow with the image. */
+static BOOL WritePngFile(const WCHAR *path, int width, int height, const unsigned char *pixels,
+    int stride, BOOL fast) {
+    PngEncodeOptions options;
+    InitScreenshotPngOptions(&options, fast);
 
-    HDC dc = GetDC(NULL);
-    GetDIBits(dc, bitmap, 0, height, pixels, (BITMAPINFO *)&bi, DIB_RGB_COLORS);
-    ReleaseDC(NULL, dc);
-    DeleteObject(bitmap);
+    FILE *f = _wfopen(path, L"wb");
+    if (!f)
+        return FALSE;
 
-    for (int i = 0; i < width * height; i++) {
-        unsigned char tmp = pixels[i * 4];
-        pixels[i * 4] = pixels[i * 4 + 2];
-        pixels[i * 4 + 2] = tmp;
+    BOOL success = FALSE;
+    if ((long long)width * height > SCREENSHOT_STREAM_MIN_PIXELS) {
+        PngStream *stream = PngStreamBegin(WriteFileBytes, f, width, height, 3, &options);
+        success = PngStreamWriteRows(stream, pixels, stride, height);
+        success = PngStreamEnd(stream) && success && !ferror(f);
+    } else {
+        int len = 0;
+        unsigned char *png = PngEncodeToMemory(pixels, stride, width, height, 3, &options, &len);
+        if (png)
+            success = fwrite(png, 1, len, f) == (size_t)len;
+        PngFree(png);
     }
 
+    if (fclose(f) != 0)
+        success = FALSE;
+    if (!success)
+        DeleteFileW(path);
+    return success;
+}
+
+static BOOL WriteQoiFile(const WCHAR *path, int width, int height, const unsigned char *pixels,
+    int stride) {
+    FILE *f = _wfopen(path, L"wb");
+    if (!f)
+        return FALSE;
+
+    BOOL success = QoiWriteBgrx(WriteFileBytes, f, pixels, stride, width, height, 3) && !ferror(f);
+    if (fclose(f) != 0)
+        success = FALSE;
+    if (!success)
+        DeleteFileW(path);
+    return success;
+}
+
+/* Names files <prefix>_<date>_<time><suffix> in Pictures\Screenshots, to the second. A burst
+ * that lands in the same second gets milliseconds added so it does not overwrite the earlier
+ * shots. */
+static BOOL BuildCapturePath(WCHAR *filePath, DWORD filePathLen, const WCHAR *prefix,
+    const WCHAR *suffix) {
     WCHAR picturesPath[MAX_PATH];
     if (FAILED(SHGetFolderPathW(NULL, CSIDL_MYPICTURES, NULL, 0, picturesPath))) {
-        free(pixels);
         LogMessage("Screenshot: failed to get Pictures path");
         return FALSE;
     }
@@ -763,200 +1090,580 @@ static BOOL CaptureClientAreaToFile(WCHAR *outPath, DWORD outPathLen) {
     SYSTEMTIME st;
     GetLocalTime(&st);
 
-    WCHAR filePath[MAX_PATH];
-    swprintf_s(filePath, MAX_PATH,
-               L"%s\\Screenshot_%04d%02d%02d_%02d%02d%02d.png",
-               screenshotsDir, st.wYear, st.wMonth, st.wDay,
-               st.wHour, st.wMinute, st.wSecond);
+    swprintf_s(filePath, filePathLen,
+               L"%s\\%s_%04d%02d%02d_%02d%02d%02d%s",
+               screenshotsDir, prefix, st.wYear, st.wMonth, st.wDay,
+               st.wHour, st.wMinute, st.wSecond, suffix);
+    if (GetFileAttributesW(filePath) != INVALID_FILE_ATTRIBUTES) {
+        swprintf_s(filePath, filePathLen,
+                   L"%s\\%s_%04d%02d%02d_%02d%02d%02d_%03d%s",
+                   screenshotsDir, prefix, st.wYear, st.wMonth, st.wDay,
+                   st.wHour, st.wMinute, st.wSecond, st.wMilliseconds, suffix);
+    }
+    return TRUE;
+}
 
+static BOOL BuildScreenshotPath(WCHAR *filePath, DWORD filePathLen, ScreenshotFormat format) {
+    WCHAR suffix[8];
+    swprintf_s(suffix, 8, L".%s", screenshotExtensions[format]);
+    return BuildCapturePath(filePath, filePathLen, L"Screenshot", suffix);
+}
+
+static BOOL SaveScreenshot(const FrameView *view, const WCHAR *filePath,
+    ScreenshotFormat format) {
     char filePathA[MAX_PATH];
     WideCharToMultiByte(CP_UTF8, 0, filePath, -1, filePathA, MAX_PATH, NULL, NULL);
 
-    BOOL success = FALSE;
-    if (stbi_write_png(filePathA, width, height, 4, pixels, width * 4)) {
-        LogMessage("Screenshot: saved to %s", filePathA);
-        if (outPath)
-            wcscpy_s(outPath, outPathLen, filePath);
-        success = TRUE;
+    BOOL success;
+    if (format == SCREENSHOT_FORMAT_QOI) {
+        success = WriteQoiFile(filePath, view->width, view->height, view->pixels, view->stride);
     } else {
-        LogMessage("Screenshot: failed to write PNG");
+        success = WritePngFile(filePath, view->width, view->height, view->pixels, view->stride,
+            format == SCREENSHOT_FORMAT_PNG_FAST);
+    }
+    if (!success) {
+        LogMessage("Screenshot: failed to write %s", filePathA);
+        return FALSE;
     }
 
-    free(pixels);
+    LogMessage("Screenshot: saved to %s", filePathA);
+    return TRUE;
+}
+
+static BOOL CaptureClientAreaToFile(ScreenshotFormat format) {
+    FrameView view;
+    if (!CaptureClientArea(&view, FALSE)) return FALSE;
+
+    WCHAR filePath[MAX_PATH];
+    if (!BuildScreenshotPath(filePath, MAX_PATH, format)) return FALSE;
+
+    return SaveScreenshot(&view, filePath, format);
+}
+
+/* The file is only put on the clipboard once it is written, so a paste never has to wait for
+ * it on the window thread. */
+static void CaptureClientAreaToFileClipboard(void) {
+    FrameView view;
+    if (!CaptureClientArea(&view, FALSE)) return;
+
+    WCHAR filePath[MAX_PATH];
+    if (!BuildScreenshotPath(filePath, MAX_PATH, SCREENSHOT_FORMAT_PNG)) return;
+    if (!SaveScreenshot(&view, filePath, SCREENSHOT_FORMAT_PNG)) return;
+
+    EnterCriticalSection(&clipboardLock);
+    unsigned int generation = ClipboardCacheSet(&clipboardCache, NULL, 0, 0, CLIPBOARD_OFFER_FILE);
+    wcscpy_s(clipboardFilePath, MAX_PATH, filePath);
+    LeaveCriticalSection(&clipboardLock);
+
+    PostMessageW(mainWindow, WM_CLIPBOARD_OFFER, generation, 0);
+}
+
+/* Runs on the action worker whenever LoadConfig has published settings. The history is only
+ * thrown away when they actually changed, so saving an unrelated config edit keeps it. */
+static void ApplyReplaySettings(void) {
+    ReplaySettings settings = {replayFps, replaySeconds, replayMemoryMb};
+    if (!replayTimer || memcmp(&settings, &replayActive, sizeof(settings)) == 0)
+        return;
+
+    CancelWaitableTimer(replayTimer);
+    ReplayBufferRelease(&replayBuffer);
+    if (replayActive.fps)
+        LogMessage("Replay: stopped recording");
+    ZeroMemory(&replayActive, sizeof(replayActive));
+    if (settings.fps == 0) {
+        replayActive = settings;
+        return;
+    }
+
+    int maxFrames = settings.fps * (settings.seconds + 1);
+    if (!ReplayBufferInit(&replayBuffer, (size_t)settings.memoryMb << 20, maxFrames,
+            settings.fps * REPLAY_KEYFRAME_SECONDS, (unsigned long long)settings.seconds * 1000)) {
+        LogMessage("Replay: failed to allocate %ld MB", settings.memoryMb);
+        return;
+    }
+
+    LONG periodMs = 1000 / settings.fps;
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)periodMs * 10000;
+    if (!SetWaitableTimer(replayTimer, &due, periodMs, NULL, NULL, FALSE)) {
+        LogMessage("Replay: SetWaitableTimer failed (%lu)", GetLastError());
+        ReplayBufferRelease(&replayBuffer);
+        return;
+    }
+
+    replayActive = settings;
+    LogMessage("Replay: recording the last %ld s at %ld fps in up to %ld MB", settings.seconds,
+        settings.fps, settings.memoryMb);
+}
+
+/* Missed captures (no foreground window, a minimized one) just leave a longer gap. */
+static void CaptureReplayFrame(void) {
+    if (replayActive.fps == 0)
+        return;
+
+    FrameView view;
+    if (!CaptureClientArea(&view, TRUE))
+        return;
+    ReplayBufferPush(&replayBuffer, view.pixels, view.stride, view.width, view.height,
+        GetTickCount64());
+}
+
+static BOOL SaveReplayApng(WCHAR *filePath, int *frames) {
+    if (!BuildCapturePath(filePath, MAX_PATH, L"Replay", L".png"))
+        return FALSE;
+
+    FILE *f = _wfopen(filePath, L"wb");
+    if (!f)
+        return FALSE;
+
+    PngEncodeOptions options;
+    InitScreenshotPngOptions(&options, TRUE);
+    *frames = ReplayExportApng(&replayBuffer, WriteFileBytes, f, &options,
+        1000 / replayActive.fps);
+
+    BOOL success = *frames > 0 && !ferror(f);
+    if (fclose(f) != 0)
+        success = FALSE;
+    if (!success)
+        DeleteFileW(filePath);
     return success;
 }
 
-static void CopyFileToClipboard(const WCHAR *filePath) {
+static int WriteReplaySequenceFrame(void *context, int index, const unsigned char *pixels,
+    int width, int height, unsigned long long timeMs) {
+    (void)timeMs;
+
+    WCHAR framePath[MAX_PATH];
+    swprintf_s(framePath, MAX_PATH, L"%s\\frame_%04d.png", (const WCHAR *)context, index);
+    return WritePngFile(framePath, width, height, pixels, width * 4, TRUE);
+}
+
+static BOOL SaveReplaySequence(WCHAR *folderPath, int *frames) {
+    if (!BuildCapturePath(folderPath, MAX_PATH, L"Replay", L""))
+        return FALSE;
+    if (!CreateDirectoryW(folderPath, NULL))
+        return FALSE;
+
+    *frames = ReplayExportFrames(&replayBuffer, WriteReplaySequenceFrame, folderPath);
+    return *frames > 0;
+}
+
+/* Recording pauses while the history is written out, since both happen on the action worker.
+ * Frames are written with the fast PNG profile. */
+static void SaveReplay(BOOL sequence) {
+    if (replayActive.fps == 0) {
+        LogMessage("Replay: not recording; add a \"replay\" section to the config");
+        return;
+    }
+    if (replayBuffer.count == 0) {
+        LogMessage("Replay: nothing recorded yet");
+        return;
+    }
+
+    ULONGLONG started = ReadTicks();
+    WCHAR path[MAX_PATH];
+    int frames = 0;
+    BOOL saved = sequence ? SaveReplaySequence(path, &frames) : SaveReplayApng(path, &frames);
+
+    char pathA[MAX_PATH];
+    WideCharToMultiByte(CP_UTF8, 0, path, -1, pathA, MAX_PATH, NULL, NULL);
+    if (!saved) {
+        LogMessage("Replay: failed to write %s", pathA);
+        return;
+    }
+
+    double spanSeconds = ReplayBufferSpanMs(&replayBuffer) / 1000.0;
+    double heldMb = ReplayBufferBytesUsed(&replayBuffer) / (1024.0 * 1024.0);
+    LogMessage("Replay: saved %d frames (%.1f s) to %s in %.0f ms", frames, spanSeconds, pathA,
+        TicksToMs(ReadTicks() - started));
+    LogMessage("Replay: history holds %.1f MB, %.2f MB per second, %u frames dropped", heldMb,
+        spanSeconds > 0 ? heldMb / spanSeconds : 0.0, replayBuffer.dropped);
+}
+
+static HGLOBAL CreateDropFiles(const WCHAR *filePath) {
     DWORD len = (DWORD)(wcslen(filePath) + 1);
     DWORD dropFilesSize = sizeof(DROPFILES) + (len + 1) * sizeof(WCHAR);
 
     HGLOBAL hGlobal = GlobalAlloc(GHND, dropFilesSize);
-    if (!hGlobal) {
-        LogMessage("Screenshot: GlobalAlloc failed");
-        return;
-    }
+    if (!hGlobal)
+        return NULL;
 
     DROPFILES *df = (DROPFILES *)GlobalLock(hGlobal);
+    if (!df) {
+        GlobalFree(hGlobal);
+        return NULL;
+    }
+
     df->pFiles = sizeof(DROPFILES);
     df->fWide = TRUE;
     WCHAR *fileList = (WCHAR *)((char *)df + sizeof(DROPFILES));
     wcscpy_s(fileList, len, filePath);
     fileList[len] = L'\0';
     GlobalUnlock(hGlobal);
+    return hGlobal;
+}
 
-    if (OpenClipboard(NULL)) {
-        EmptyClipboard();
-        SetClipboardData(CF_HDROP, hGlobal);
-        CloseClipboard();
-        LogMessage("Screenshot: file copied to clipboard");
-    } else {
+static HGLOBAL CopyToGlobal(const void *data, size_t size) {
+    HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, size);
+    if (!hGlobal)
+        return NULL;
+
+    void *dst = GlobalLock(hGlobal);
+    if (!dst) {
         GlobalFree(hGlobal);
-        LogMessage("Screenshot: OpenClipboard failed");
+        return NULL;
     }
+
+    memcpy(dst, data, size);
+    GlobalUnlock(hGlobal);
+    return hGlobal;
 }
 
-static void CaptureClientAreaToFileClipboard(void) {
-    WCHAR filePath[MAX_PATH];
-    if (CaptureClientAreaToFile(filePath, MAX_PATH)) {
-        CopyFileToClipboard(filePath);
+static HGLOBAL RenderClipboardDib(void) {
+    size_t size = ClipboardCacheDibSize(&clipboardCache);
+    HGLOBAL hGlobal = size ? GlobalAlloc(GMEM_MOVEABLE, size) : NULL;
+    if (!hGlobal)
+        return NULL;
+
+    unsigned char *dst = (unsigned char *)GlobalLock(hGlobal);
+    if (!dst) {
+        GlobalFree(hGlobal);
+        return NULL;
     }
+
+    ClipboardCacheWriteDib(&clipboardCache, dst);
+    GlobalUnlock(hGlobal);
+    return hGlobal;
 }
 
-static BOOL IsModifierKey(DWORD vkCode) {
-    return vkCode == VK_LCONTROL || vkCode == VK_RCONTROL || vkCode == VK_LSHIFT ||
-           vkCode == VK_RSHIFT || vkCode == VK_LMENU || vkCode == VK_RMENU || vkCode == VK_LWIN ||
-           vkCode == VK_RWIN;
+static HGLOBAL RenderClipboardPng(void) {
+    int len = 0;
+    const unsigned char *png = ClipboardCachePng(&clipboardCache, &len);
+    return png ? CopyToGlobal(png, (size_t)len) : NULL;
 }
 
-static BOOL ProcessKeyboardTrigger(DWORD vkCode) {
-    for (int i = 0; i < bindingCount; i++) {
-        HotkeyBinding *b = &bindings[i];
+/* Formats are only offered once the worker has made them ready, so this copies and never
+ * encodes or waits. */
+static HGLOBAL RenderClipboardFormat(UINT format) {
+    HGLOBAL hGlobal = NULL;
+    EnterCriticalSection(&clipboardLock);
+    unsigned int ready = ClipboardCacheReady(&clipboardCache, clipboardOffered);
+    if (format == CF_DIB && (ready & CLIPBOARD_OFFER_DIB))
+        hGlobal = RenderClipboardDib();
+    else if (format != 0 && format == pngClipboardFormat && (ready & CLIPBOARD_OFFER_PNG))
+        hGlobal = RenderClipboardPng();
+    else if (format == CF_HDROP && (ready & CLIPBOARD_OFFER_FILE))
+        hGlobal = CreateDropFiles(clipboardFilePath);
+    LeaveCriticalSection(&clipboardLock);
+
+    if (!hGlobal)
+        LogMessage("Screenshot: failed to render clipboard format %u", format);
+    return hGlobal;
+}
 
-        if (b->triggerType != TRIGGER_KEYBOARD)
-            continue;
-        if (b->trigger.keyCode != vkCode)
-            continue;
-        if (!CheckModifiers(b))
-            continue;
+static void SetRenderedClipboardData(UINT format) {
+    HGLOBAL hGlobal = RenderClipboardFormat(format);
+    if (hGlobal && !SetClipboardData(format, hGlobal))
+        GlobalFree(hGlobal);
+}
 
-        MarkWinKeyForSuppression();
-        ExecuteAction(b->action);
-        return TRUE;
+/* Ready offer bits of the generation, limited to mask and mapped to their clipboard formats. */
+static int ReadyClipboardFormats(unsigned int generation, unsigned int mask, UINT *formats) {
+    EnterCriticalSection(&clipboardLock);
+    unsigned int offers = ClipboardCacheReady(&clipboardCache, generation) & mask;
+    LeaveCriticalSection(&clipboardLock);
+
+    int count = 0;
+    if (offers & CLIPBOARD_OFFER_DIB)
+        formats[count++] = CF_DIB;
+    if ((offers & CLIPBOARD_OFFER_PNG) && pngClipboardFormat)
+        formats[count++] = pngClipboardFormat;
+    if (offers & CLIPBOARD_OFFER_FILE)
+        formats[count++] = CF_HDROP;
+    return count;
+}
+
+/* added is 0 to take the clipboard for a new capture, or the offer bits that have become ready
+ * for the capture already on it. Those are only added while it is still ours and still that
+ * capture, so a later copy by the user is never overwritten. */
+static void OfferClipboardFormats(HWND hwnd, unsigned int generation, unsigned int added) {
+    if (added && generation != clipboardOffered)
+        return;
+
+    UINT formats[3];
+    int count = ReadyClipboardFormats(generation, added ? added : ~0u, formats);
+    if (!count)
+        return;
+
+    if (!OpenClipboard(hwnd)) {
+        LogMessage("Screenshot: OpenClipboard failed");
+        return;
     }
-    return FALSE;
+
+    if (!added) {
+        EmptyClipboard();
+        clipboardOffered = generation;
+    } else if (GetClipboardOwner() != hwnd) {
+        count = 0;
+    }
+    for (int i = 0; i < count; i++)
+        SetClipboardData(formats[i], NULL);
+    CloseClipboard();
 }
 
-static BOOL ProcessMouseButtonTrigger(MouseButton button) {
-    for (int i = 0; i < bindingCount; i++) {
-        HotkeyBinding *b = &bindings[i];
+/* Called when the window is going away while it still owns delay-rendered data, so the
+ * clipboard keeps the screenshot after the app exits. */
+static void RenderAllClipboardFormats(HWND hwnd) {
+    if (!clipboardOffered || GetClipboardOwner() != hwnd)
+        return;
 
-        if (b->triggerType != TRIGGER_MOUSE_BUTTON)
-            continue;
-        if (b->trigger.mouseButton != button)
-            continue;
-        if (!CheckModifiers(b))
-            continue;
+    if (!OpenClipboard(hwnd))
+        return;
 
-        MarkWinKeyForSuppression();
-        ExecuteAction(b->action);
-        return TRUE;
+    if (GetClipboardOwner() == hwnd) {
+        UINT formats[3];
+        int count = ReadyClipboardFormats(clipboardOffered, ~0u, formats);
+        for (int i = 0; i < count; i++)
+            SetRenderedClipboardData(formats[i]);
     }
-    return FALSE;
+    CloseClipboard();
 }
 
-static BOOL ProcessMouseWheelTrigger(WheelDirection dir) {
-    for (int i = 0; i < bindingCount; i++) {
-        HotkeyBinding *b = &bindings[i];
+static void RunWheelSteps(int steps) {
+    if (steps > 0)
+        ExecuteAction(wheelActions[WHEEL_UP], steps);
+    else if (steps < 0)
+        ExecuteAction(wheelActions[WHEEL_DOWN], -steps);
+}
 
-        if (b->triggerType != TRIGGER_MOUSE_WHEEL)
-            continue;
-        if (b->trigger.wheelDir != dir)
-            continue;
-        if (!CheckModifiers(b))
-            continue;
+static void ScheduleWheelFlush(ULONGLONG now) {
+    int dueIn = WheelAccumulatorDueIn(&wheel, now);
+    if (dueIn >= 0)
+        SetTimer(mainWindow, ID_TIMER_WHEEL_FLUSH, dueIn > 0 ? dueIn : USER_TIMER_MINIMUM, NULL);
+}
 
-        MarkWinKeyForSuppression();
-        ExecuteAction(b->action);
-        return TRUE;
+/* Each wheel event only adds its delta to the accumulator. Steps run in batches at most once
+ * per wheel interval; whatever is held back goes from ID_TIMER_WHEEL_FLUSH. Held-back steps
+ * run before a reversal is added unless the two directions undo each other, so turning back
+ * within an interval never swallows actions that cannot cancel out. */
+static void AccumulateWheel(MediaAction action, int delta) {
+    WheelDirection dir = delta > 0 ? WHEEL_UP : WHEEL_DOWN;
+    ULONGLONG now = GetTickCount64();
+    if (action != wheelActions[dir]) {
+        RunWheelSteps(WheelAccumulatorTake(&wheel, now));
+        wheelActions[dir] = action;
+    } else if (WheelAccumulatorReverses(&wheel, delta) &&
+               !ActionsAreInverse(wheelActions[WHEEL_UP], wheelActions[WHEEL_DOWN])) {
+        RunWheelSteps(WheelAccumulatorTake(&wheel, now));
+    }
+    RunWheelSteps(WheelAccumulatorAdd(&wheel, delta, now));
+    ScheduleWheelFlush(now);
+}
+
+/* Carries out what the hook engine decided and adds the event to the trace being recorded.
+ * Returns TRUE if the event is to be swallowed. */
+static BOOL ApplyHookDecision(const HookDecision *decision, TraceEvent *event) {
+    if (decision->tapControl)
+        InputBatchTap(&inputBatch, VK_CONTROL, 1);
+
+    if (decision->binding >= 0) {
+        MediaAction action = bindings[decision->binding].action;
+        if (event->type == TRACE_WHEEL)
+            AccumulateWheel(action, event->wheelDelta);
+        else
+            ExecuteAction(action, 1);
     }
-    return FALSE;
+
+    if (traceBuffer) {
+        event->swallowed = decision->swallow;
+        event->binding = decision->binding;
+        TraceRecorderAdd(&traceRecorder, event);
+    }
+    return decision->swallow;
+}
+
+static void RecordHookLatency(HookEventType type, BOOL matched, ULONGLONG startTicks) {
+    ULONGLONG elapsed = ReadTicks() - startTicks;
+    HistogramRecord(&hookLatency[type][matched ? 1 : 0],
+        elapsed * 1000000000ULL / (ULONGLONG)perfFrequency.QuadPart);
+}
+
+static BOOL HandleKeyboardEvent(WPARAM wParam, const KBDLLHOOKSTRUCT *kb) {
+    BOOL pressed = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
+
+    TraceEvent event = {0};
+    event.timeMs = kb->time;
+    event.type = pressed ? TRACE_KEY_DOWN : TRACE_KEY_UP;
+    event.code = kb->vkCode;
+    event.extended = (kb->flags & LLKHF_EXTENDED) != 0;
+    event.injected = (kb->flags & LLKHF_INJECTED) != 0;
+    event.modifiers = hookEngine.modifiers.down;
+
+    HookDecision decision = HookEngineKey(&hookEngine, kb->vkCode, event.extended, pressed);
+    return ApplyHookDecision(&decision, &event);
 }
 
 static LRESULT CALLBACK KeyboardHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (nCode >= 0) {
-        KBDLLHOOKSTRUCT *kb = (KBDLLHOOKSTRUCT *)lParam;
+        ULONGLONG startTicks = ReadTicks();
+        BOOL matched = HandleKeyboardEvent(wParam, (KBDLLHOOKSTRUCT *)lParam);
+        InputBatchFlush(&inputBatch);
+        RecordHookLatency(HOOK_EVENT_KEY, matched, startTicks);
+        if (matched)
+            return 1;
+    }
+    return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+}
 
-        if ((kb->vkCode == VK_LWIN || kb->vkCode == VK_RWIN) &&
-            (wParam == WM_KEYUP || wParam == WM_SYSKEYUP) && suppressWinKeyUp) {
+static HookEventType MouseEventType(WPARAM wParam) {
+    switch (wParam) {
+    case WM_MOUSEMOVE:
+        return HOOK_EVENT_MOVE;
+    case WM_MOUSEWHEEL:
+    case WM_MOUSEHWHEEL:
+        return HOOK_EVENT_WHEEL;
+    default:
+        return HOOK_EVENT_BUTTON;
+    }
+}
 
-            suppressWinKeyUp = FALSE;
+static BOOL HandleMouseEvent(WPARAM wParam, const MSLLHOOKSTRUCT *ms) {
+    TraceEvent event = {0};
+    event.timeMs = ms->time;
+    event.injected = (ms->flags & LLMHF_INJECTED) != 0;
+    event.modifiers = hookEngine.modifiers.down;
 
-            INPUT inputs[2] = {0};
-            inputs[0].type = INPUT_KEYBOARD;
-            inputs[0].ki.wVk = VK_CONTROL;
-            inputs[1].type = INPUT_KEYBOARD;
-            inputs[1].ki.wVk = VK_CONTROL;
-            inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
-            SendInput(2, inputs, sizeof(INPUT));
-        }
+    switch (wParam) {
+    case WM_LBUTTONDOWN:
+    case WM_LBUTTONUP:
+        event.code = MOUSE_BUTTON_LEFT;
+        break;
+    case WM_RBUTTONDOWN:
+    case WM_RBUTTONUP:
+        event.code = MOUSE_BUTTON_RIGHT;
+        break;
+    case WM_MBUTTONDOWN:
+    case WM_MBUTTONUP:
+        event.code = MOUSE_BUTTON_MIDDLE;
+        break;
+    case WM_XBUTTONDOWN:
+    case WM_XBUTTONUP:
+        event.code = HIWORD(ms->mouseData) == XBUTTON1 ? MOUSE_BUTTON_X1 : MOUSE_BUTTON_X2;
+        break;
+    case WM_MOUSEWHEEL:
+        event.type = TRACE_WHEEL;
+        event.wheelDelta = (short)HIWORD(ms->mouseData);
+        break;
+    default:
+        return FALSE;
+    }
 
-        if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-            if (!IsModifierKey(kb->vkCode)) {
-                if (ProcessKeyboardTrigger(kb->vkCode)) {
-                    return 1;
-                }
-            }
-        }
+    HookDecision decision;
+    if (event.type == TRACE_WHEEL) {
+        decision = HookEngineWheel(&hookEngine, event.wheelDelta);
+    } else {
+        BOOL pressed = wParam == WM_LBUTTONDOWN || wParam == WM_RBUTTONDOWN ||
+                       wParam == WM_MBUTTONDOWN || wParam == WM_XBUTTONDOWN;
+        event.type = pressed ? TRACE_BUTTON_DOWN : TRACE_BUTTON_UP;
+        decision = HookEngineButton(&hookEngine, (MouseButton)event.code, pressed);
     }
-    return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+    return ApplyHookDecision(&decision, &event);
 }
 
 static LRESULT CALLBACK MouseHookProc(int nCode, WPARAM wParam, LPARAM lParam) {
     if (nCode >= 0) {
-        MSLLHOOKSTRUCT *ms = (MSLLHOOKSTRUCT *)lParam;
+        ULONGLONG startTicks = ReadTicks();
+        BOOL matched = HandleMouseEvent(wParam, (MSLLHOOKSTRUCT *)lParam);
+        InputBatchFlush(&inputBatch);
+        RecordHookLatency(MouseEventType(wParam), matched, startTicks);
+        if (matched)
+            return 1;
+    }
+    return CallNextHookEx(mouseHook, nCode, wParam, lParam);
+}
 
-        switch (wParam) {
-        case WM_LBUTTONDOWN:
-            if (ProcessMouseButtonTrigger(MOUSE_BUTTON_LEFT))
-                return 1;
-            break;
+static int FormatHookStats(char *buffer, size_t bufferLen) {
+    size_t used = 0;
+    int lines = 0;
+    buffer[0] = '\0';
+
+    for (int type = 0; type < HOOK_EVENT_COUNT; type++) {
+        for (int matched = 1; matched >= 0; matched--) {
+            const Histogram *h = &hookLatency[type][matched];
+            if (h->count == 0)
+                continue;
+
+            int written = snprintf(buffer + used, bufferLen - used,
+                "%s %s: %llu events, p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+                hookEventNames[type], matched ? "matched" : "unmatched", h->count,
+                HistogramPercentile(h, 0.5) / 1000.0, HistogramPercentile(h, 0.99) / 1000.0,
+                HistogramPercentile(h, 0.999) / 1000.0, h->max / 1000.0);
+            if (written < 0 || (size_t)written >= bufferLen - used)
+                return lines;
+            used += written;
+            lines++;
+        }
+    }
 
-        case WM_RBUTTONDOWN:
-            if (ProcessMouseButtonTrigger(MOUSE_BUTTON_RIGHT))
-                return 1;
-            break;
+    if (wheel.events) {
+        int written = snprintf(buffer + used, bufferLen - used,
+            "mouse wheel batching: %u events, %u flushes, %u steps\n", wheel.events,
+            wheel.flushes, wheel.steps);
+        if (written < 0 || (size_t)written >= bufferLen - used)
+            return lines;
+        used += written;
+        lines++;
+    }
+
+    if (inputBatch.calls) {
+        int written = snprintf(buffer + used, bufferLen - used,
+            "synthetic input: %u presses in %u SendInput calls (%u saved), %u rejected\n",
+            inputBatch.submissions, inputBatch.calls, InputBatchCallsSaved(&inputBatch),
+            inputBatch.rejected);
+        if (written > 0 && (size_t)written < bufferLen - used)
+            lines++;
+    }
+    return lines;
+}
+
+static unsigned long long TotalHookEvents(void) {
+    unsigned long long total = 0;
+    for (int type = 0; type < HOOK_EVENT_COUNT; type++) {
+        total += hookLatency[type][0].count + hookLatency[type][1].count;
+    }
+    return total;
+}
 
-        case WM_MBUTTONDOWN:
-            if (ProcessMouseButtonTrigger(MOUSE_BUTTON_MIDDLE))
-                return 1;
+static void LogHookStats(void) {
+    unsigned long long total = TotalHookEvents();
+    if (total == hookEventsAtLastDump)
+        return;
+    hookEventsAtLastDump = total;
+
+    char text[1024];
+    FormatHookStats(text, sizeof(text));
+
+    char *line = text;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end)
+            *end = '\0';
+        LogMessage("Hook latency: %s", line);
+        if (!end)
             break;
+        line = end + 1;
+    }
+}
 
-        case WM_XBUTTONDOWN:
-        case WM_XBUTTONUP: {
-            WORD xButton = HIWORD(ms->mouseData);
-            MouseButton btn = (xButton == XBUTTON1) ? MOUSE_BUTTON_X1 : MOUSE_BUTTON_X2;
-            for (int i = 0; i < bindingCount; i++) {
-                HotkeyBinding *b = &bindings[i];
-                if (b->triggerType == TRIGGER_MOUSE_BUTTON &&
-                    b->trigger.mouseButton == btn && CheckModifiers(b)) {
-                    if (wParam == WM_XBUTTONDOWN) {
-                        MarkWinKeyForSuppression();
-                        ExecuteAction(b->action);
-                    }
-                    return 1;
-                }
-            }
-        } break;
-
-        case WM_MOUSEWHEEL: {
-            short delta = (short)HIWORD(ms->mouseData);
-            WheelDirection dir = (delta > 0) ? WHEEL_UP : WHEEL_DOWN;
-            if (ProcessMouseWheelTrigger(dir))
-                return 1;
-        } break;
-        }
+static void ShowHookStats(void) {
+    char text[1024];
+    if (FormatHookStats(text, sizeof(text)) == 0) {
+        strcpy(text, "No input events recorded yet.");
     }
-    return CallNextHookEx(mouseHook, nCode, wParam, lParam);
+
+    WCHAR wideText[1024];
+    MultiByteToWideChar(CP_UTF8, 0, text, -1, wideText, 1024);
+    MessageBoxW(NULL, wideText, APP_NAME L" - Hook Latency", MB_OK | MB_ICONINFORMATION);
 }
 
 static BOOL InstallHooks(void) {
@@ -971,10 +1678,27 @@ static BOOL InstallHooks(void) {
         return FALSE;
     }
 
+    /* The modifier shadow state can drift whenever input goes somewhere the hooks don't see,
+     * such as the secure desktop or another session, so resync it on focus and session changes. */
+    ResyncModifierState();
+    foregroundHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL,
+        ForegroundEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    if (!foregroundHook) {
+        LogMessage("Warning: could not watch foreground changes");
+    }
+    if (!WTSRegisterSessionNotification(mainWindow, NOTIFY_FOR_THIS_SESSION)) {
+        LogMessage("Warning: could not register for session notifications");
+    }
+
     return TRUE;
 }
 
 static void RemoveHooks(void) {
+    WTSUnRegisterSessionNotification(mainWindow);
+    if (foregroundHook) {
+        UnhookWinEvent(foregroundHook);
+        foregroundHook = NULL;
+    }
     if (mouseHook) {
         UnhookWindowsHookEx(mouseHook);
         mouseHook = NULL;
@@ -1061,18 +1785,113 @@ static BOOL DisableStartup(void) {
     return DeleteFileW(shortcutPath);
 }
 
+static ULONGLONG ReadLogTimestamp(void) {
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return ((ULONGLONG)now.dwHighDateTime << 32) | now.dwLowDateTime;
+}
+
+/* Only the flusher thread formats timestamps, and lines arrive in bursts, so the formatted
+ * prefix is cached and only rebuilt when the second changes. */
+static const char *FormatLogTimestamp(ULONGLONG timestamp) {
+    static ULONGLONG cachedSecond = ~0ULL;
+    static char cachedPrefix[32];
+
+    ULONGLONG second = timestamp / 10000000ULL;
+    if (second != cachedSecond) {
+        FILETIME utc, local;
+        SYSTEMTIME st;
+        utc.dwLowDateTime = (DWORD)timestamp;
+        utc.dwHighDateTime = (DWORD)(timestamp >> 32);
+        FileTimeToLocalFileTime(&utc, &local);
+        FileTimeToSystemTime(&local, &st);
+        snprintf(cachedPrefix, sizeof(cachedPrefix), "[%04d-%02d-%02d %02d:%02d:%02d] ",
+            st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+        cachedSecond = second;
+    }
+    return cachedPrefix;
+}
+
+static void FlushLogBuffer(void) {
+    const LogRecord *record = LogBufferPeek(&logBuffer);
+    unsigned int dropped = LogBufferTakeDropped(&logBuffer);
+    if (!record && dropped == 0)
+        return;
+
+    if (!logFile) {
+        logFile = _wfopen(logFilePath, L"a");
+    }
+
+    for (; record; record = LogBufferPeek(&logBuffer)) {
+        if (logFile) {
+            fputs(FormatLogTimestamp(record->timestamp), logFile);
+            fwrite(record->text, 1, record->length, logFile);
+            fputc('\n', logFile);
+        }
+        LogBufferRelease(&logBuffer);
+    }
+
+    if (logFile) {
+        if (dropped) {
+            fprintf(logFile, "%sWarning: %u log messages dropped\n",
+                FormatLogTimestamp(ReadLogTimestamp()), dropped);
+        }
+        fflush(logFile);
+    }
+}
+
+static DWORD WINAPI LogFlusherProc(LPVOID param) {
+    (void)param;
+
+    while (!logFlusherStopping) {
+        WaitForSingleObject(logEvent, LOG_FLUSH_INTERVAL_MS);
+        FlushLogBuffer();
+    }
+    FlushLogBuffer();
+    return 0;
+}
+
 static BOOL InitLogFile(void) {
     if (dataDir[0] == L'\0')
         return FALSE;
 
     swprintf_s(logFilePath, MAX_PATH, L"%s\\log.txt", dataDir);
+
+    LogBufferInit(&logBuffer);
+    logEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (logEvent) {
+        logFlusher = CreateThread(NULL, 0, LogFlusherProc, NULL, 0, NULL);
+        if (logFlusher) {
+            SetThreadPriority(logFlusher, THREAD_PRIORITY_BELOW_NORMAL);
+        } else {
+            CloseHandle(logEvent);
+            logEvent = NULL;
+        }
+    }
     return TRUE;
 }
 
-static void LogMessage(const char *format, ...) {
-    if (logFilePath[0] == L'\0')
-        return;
+/* If the flusher does not stop in time it may still be using the event and the file, so they
+ * are left for process exit to reclaim rather than closed under it. */
+static void CloseLogFile(void) {
+    if (logFlusher) {
+        InterlockedExchange(&logFlusherStopping, 1);
+        SetEvent(logEvent);
+        if (WaitForSingleObject(logFlusher, LOG_FLUSHER_STOP_TIMEOUT_MS) != WAIT_OBJECT_0)
+            return;
+        CloseHandle(logFlusher);
+        CloseHandle(logEvent);
+        logFlusher = NULL;
+        logEvent = NULL;
+    }
+    if (logFile) {
+        fclose(logFile);
+        logFile = NULL;
+    }
+}
 
+/* Fallback used when the flusher thread isn't running. */
+static void WriteLogDirect(const char *format, va_list args) {
     FILE *f = _wfopen(logFilePath, L"a");
     if (!f)
         return;
@@ -1081,14 +1900,31 @@ static void LogMessage(const char *format, ...) {
     GetLocalTime(&st);
     fprintf(f, "[%04d-%02d-%02d %02d:%02d:%02d] ",
             st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    vfprintf(f, format, args);
+    fprintf(f, "\n");
+    fclose(f);
+}
 
+/* Safe to call from any thread, including the input hooks: the line is formatted into a
+ * preallocated ring and written out by the flusher thread. */
+static void LogMessage(const char *format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(f, format, args);
+    LogMessageV(format, args);
     va_end(args);
+}
 
-    fprintf(f, "\n");
-    fclose(f);
+static void LogMessageV(const char *format, va_list args) {
+    if (logFilePath[0] == L'\0')
+        return;
+
+    if (logFlusher) {
+        unsigned int pending = LogBufferWrite(&logBuffer, ReadLogTimestamp(), format, args);
+        if (pending == 0 || pending >= LOG_BUFFER_CAPACITY / 2)
+            SetEvent(logEvent);
+    } else {
+        WriteLogDirect(format, args);
+    }
 }
 
 static void ViewLogFile(void) {
@@ -1105,6 +1941,50 @@ static void EditConfigFile(void) {
     ShellExecuteW(NULL, L"open", configFilePath, NULL, NULL, SW_SHOWNORMAL);
 }
 
+/* Records what the hooks see and decide into memory, to replay through HookEngine later. The
+ * hooks run on this thread too, so starting and stopping needs no locking. The file is only
+ * written when recording stops. */
+static void ToggleInputTrace(void) {
+    if (!traceBuffer) {
+        traceBuffer = (unsigned char *)malloc(INPUT_TRACE_BUFFER_BYTES);
+        if (!traceBuffer || !TraceRecorderInit(&traceRecorder, traceBuffer,
+                                INPUT_TRACE_BUFFER_BYTES, appliedConfigJson,
+                                appliedConfigLength)) {
+            LogMessage("Trace: failed to allocate the recording buffer");
+            free(traceBuffer);
+            traceBuffer = NULL;
+            return;
+        }
+        CheckMenuItem(trayMenu, ID_TRAY_TRACE, MF_CHECKED);
+        LogMessage("Trace: recording input");
+        return;
+    }
+
+    CheckMenuItem(trayMenu, ID_TRAY_TRACE, MF_UNCHECKED);
+
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    WCHAR tracePath[MAX_PATH];
+    swprintf_s(tracePath, MAX_PATH, L"%s\\input_%04d%02d%02d_%02d%02d%02d.mktrace", dataDir,
+               st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    char tracePathA[MAX_PATH];
+    WideCharToMultiByte(CP_UTF8, 0, tracePath, -1, tracePathA, MAX_PATH, NULL, NULL);
+
+    FILE *f = _wfopen(tracePath, L"wb");
+    BOOL saved = f && fwrite(traceBuffer, 1, traceRecorder.used, f) == traceRecorder.used;
+    if (f && fclose(f) != 0)
+        saved = FALSE;
+
+    if (saved) {
+        LogMessage("Trace: saved %u events (%zu bytes%s) to %s", traceRecorder.events,
+            traceRecorder.used, traceRecorder.full ? ", buffer filled up" : "", tracePathA);
+    } else {
+        LogMessage("Trace: failed to write %s", tracePathA);
+    }
+    free(traceBuffer);
+    traceBuffer = NULL;
+}
+
 static BOOL IsFirstRun(void) {
     if (dataDir[0] == L'\0')
         return FALSE;
@@ -1206,6 +2086,12 @@ static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
         case ID_TRAY_VIEWLOG:
             ViewLogFile();
             return 0;
+        case ID_TRAY_STATS:
+            ShowHookStats();
+            return 0;
+        case ID_TRAY_TRACE:
+            ToggleInputTrace();
+            return 0;
         case ID_TRAY_EXIT:
             PostQuitMessage(0);
             return 0;
@@ -1215,15 +2101,58 @@ static LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
     case WM_TIMER:
         if (wParam == ID_TIMER_CONFIG_RELOAD) {
             KillTimer(hwnd, ID_TIMER_CONFIG_RELOAD);
-            if (LoadConfig()) {
-                LogMessage("Config reloaded (%d bindings)", bindingCount);
+            BOOL applied;
+            if (LoadConfig(&applied)) {
+                if (applied)
+                    LogMessage("Config reloaded (%d bindings)", bindingCount);
             } else {
                 LogMessage("Warning: config reload failed, keeping previous bindings");
             }
             return 0;
         }
+        if (wParam == ID_TIMER_WHEEL_FLUSH) {
+            KillTimer(hwnd, ID_TIMER_WHEEL_FLUSH);
+            ULONGLONG now = GetTickCount64();
+            RunWheelSteps(WheelAccumulatorFlush(&wheel, now));
+            InputBatchFlush(&inputBatch);
+            ScheduleWheelFlush(now);
+            return 0;
+        }
+        if (wParam == ID_TIMER_STATS_DUMP) {
+            LogHookStats();
+            return 0;
+        }
+        break;
+
+    case WM_WTSSESSION_CHANGE:
+        ResyncModifierState();
+        return 0;
+
+    case WM_POWERBROADCAST:
+        if (wParam == PBT_APMRESUMEAUTOMATIC) {
+            ResyncModifierState();
+        }
         break;
 
+    case WM_CLIPBOARD_OFFER:
+        OfferClipboardFormats(hwnd, (unsigned int)wParam, (unsigned int)lParam);
+        return 0;
+
+    case WM_RENDERFORMAT:
+        SetRenderedClipboardData((UINT)wParam);
+        return 0;
+
+    case WM_RENDERALLFORMATS:
+        RenderAllClipboardFormats(hwnd);
+        return 0;
+
+    case WM_DESTROYCLIPBOARD:
+        EnterCriticalSection(&clipboardLock);
+        ClipboardCacheRelease(&clipboardCache, clipboardOffered);
+        LeaveCriticalSection(&clipboardLock);
+        clipboardOffered = 0;
+        return 0;
+
     case WM_DESTROY:
         PostQuitMessage(0);
         return 0;
@@ -0,0 +1,136 @@
+#include "name_table.h"
+
+#include <string.h>
+
+#define MAX_SEEDS 64
+#define MAX_DISPLACEMENT 0xFFFF
+
+/* FNV-1a, 64-bit, with the seed folded into the offset basis. The high half picks the bucket
+ * and the low half, mixed with the bucket's displacement, picks the slot. */
+static unsigned long long HashName(const char *name, unsigned int seed) {
+    unsigned long long h = 0xCBF29CE484222325ULL ^ seed;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static unsigned int Mix(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static int BucketOf(const NameTable *table, unsigned long long hash) {
+    return (int)((unsigned int)(hash >> 32) % (unsigned int)table->buckets);
+}
+
+static int SlotOf(const NameTable *table, unsigned long long hash, unsigned int displace) {
+    return (int)(Mix((unsigned int)hash + displace * 0x9E3779B9u) % (unsigned int)table->count);
+}
+
+/* Places buckets largest first, giving each the smallest displacement that puts all of its
+ * names in free slots. */
+static int TrySeed(NameTable *table, const unsigned long long *hashes) {
+    int bucketSize[NAME_TABLE_MAX];
+    int order[NAME_TABLE_MAX];
+    int members[NAME_TABLE_MAX];
+    int memberStart[NAME_TABLE_MAX + 1];
+    unsigned char used[NAME_TABLE_MAX];
+    int n = table->count;
+
+    memset(bucketSize, 0, sizeof(bucketSize));
+    for (int i = 0; i < n; i++)
+        bucketSize[BucketOf(table, hashes[i])]++;
+
+    memberStart[0] = 0;
+    for (int b = 0; b < table->buckets; b++)
+        memberStart[b + 1] = memberStart[b] + bucketSize[b];
+    int fill[NAME_TABLE_MAX];
+    memcpy(fill, memberStart, sizeof(int) * (size_t)table->buckets);
+    for (int i = 0; i < n; i++)
+        members[fill[BucketOf(table, hashes[i])]++] = i;
+
+    int ordered = 0;
+    for (int size = n; size > 0; size--) {
+        for (int b = 0; b < table->buckets; b++) {
+            if (bucketSize[b] == size)
+                order[ordered++] = b;
+        }
+    }
+
+    memset(used, 0, sizeof(used));
+    memset(table->displace, 0, sizeof(table->displace));
+    for (int o = 0; o < ordered; o++) {
+        int b = order[o];
+        const int *names = members + memberStart[b];
+        int size = bucketSize[b];
+        int slots[NAME_TABLE_MAX];
+        int placed = 0;
+
+        for (unsigned int d = 0; d <= MAX_DISPLACEMENT && !placed; d++) {
+            placed = 1;
+            for (int k = 0; k < size && placed; k++) {
+                slots[k] = SlotOf(table, hashes[names[k]], d);
+                if (used[slots[k]])
+                    placed = 0;
+                for (int j = 0; j < k && placed; j++) {
+                    if (slots[j] == slots[k])
+                        placed = 0;
+                }
+            }
+            if (placed) {
+                table->displace[b] = (unsigned short)d;
+                for (int k = 0; k < size; k++) {
+                    used[slots[k]] = 1;
+                    table->slots[slots[k]] = (unsigned char)names[k];
+                }
+            }
+        }
+        if (!placed)
+            return 0;
+    }
+    return 1;
+}
+
+int NameTableBuild(NameTable *table, const NameEntry *entries, int count) {
+    memset(table, 0, sizeof(*table));
+    if (count <= 0 || count > NAME_TABLE_MAX)
+        return 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(entries[i].name, entries[j].name) == 0)
+                return 0;
+        }
+    }
+
+    table->entries = entries;
+    table->count = count;
+    table->buckets = (count + 1) / 2;
+
+    unsigned long long hashes[NAME_TABLE_MAX];
+    for (unsigned int seed = 0; seed < MAX_SEEDS; seed++) {
+        table->seed = seed;
+        for (int i = 0; i < count; i++)
+            hashes[i] = HashName(entries[i].name, seed);
+        if (TrySeed(table, hashes))
+            return 1;
+    }
+
+    memset(table, 0, sizeof(*table));
+    return 0;
+}
+
+const NameEntry *NameTableFind(const NameTable *table, const char *name) {
+    if (table->count == 0 || !name)
+        return NULL;
+
+    unsigned long long hash = HashName(name, table->seed);
+    int slot = SlotOf(table, hash, table->displace[BucketOf(table, hash)]);
+    const NameEntry *entry = &table->entries[table->slots[slot]];
+    return strcmp(entry->name, name) == 0 ? entry : NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+/* Minimal perfect hash over a fixed list of names, for looking up config keywords. Every name
+ * hashes to its own slot, so a lookup is one hash of the input and a single string compare. */
+
+#define NAME_TABLE_MAX 256
+
+typedef struct {
+    const char *name;
+    int value;
+} NameEntry;
+
+typedef struct {
+    const NameEntry *entries;
+    int count;
+    int buckets;
+    unsigned int seed;
+    unsigned short displace[NAME_TABLE_MAX];
+    unsigned char slots[NAME_TABLE_MAX]; /* slot -> index into entries */
+} NameTable;
+
+/* entries must outlive the table. Returns 0 for an empty or oversized list, a duplicate name,
+ * or (in theory) a list no seed could place. */
+int NameTableBuild(NameTable *table, const NameEntry *entries, int count);
+
+/* Returns the entry named name, or NULL. */
+const NameEntry *NameTableFind(const NameTable *table, const char *name);
+
+#endif
@@ -0,0 +1,98 @@
+#include "cpu_features.h"
+#include "pixel_convert.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXEL_X86
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#define PIXEL_TARGET(features)
+#else
+#define PIXEL_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+void ConvertBgrxToRgbPortable(unsigned char *dst, const unsigned char *src, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst += 3;
+        src += 4;
+    }
+}
+
+void ConvertBgraToRgbaPortable(unsigned char *dst, const unsigned char *src, int count) {
+    for (int i = 0; i < count; i++) {
+        unsigned char b = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = b;
+        dst[3] = src[3];
+        dst += 4;
+        src += 4;
+    }
+}
+
+#ifdef PIXEL_X86
+/* Four pixels per shuffle. Each 16-byte store carries 12 useful bytes, so the vector loop stops
+ * while at least two more pixels of output remain to absorb the overhang. */
+PIXEL_TARGET("ssse3")
+static void ConvertBgrxToRgbSsse3(unsigned char *dst, const unsigned char *src, int count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    int i = 0;
+
+    for (; i + 16 + 2 <= count; i += 16) {
+        __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 0)), shuffle);
+        __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 16)), shuffle);
+        __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 32)), shuffle);
+        __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 48)), shuffle);
+        _mm_storeu_si128((__m128i *)(dst + 0), p0);
+        _mm_storeu_si128((__m128i *)(dst + 12), p1);
+        _mm_storeu_si128((__m128i *)(dst + 24), p2);
+        _mm_storeu_si128((__m128i *)(dst + 36), p3);
+        src += 64;
+        dst += 48;
+    }
+    for (; i + 4 + 2 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *)dst,
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), shuffle));
+        src += 16;
+        dst += 12;
+    }
+    ConvertBgrxToRgbPortable(dst, src, count - i);
+}
+
+PIXEL_TARGET("ssse3")
+static void ConvertBgraToRgbaSsse3(unsigned char *dst, const unsigned char *src, int count) {
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *)dst,
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), shuffle));
+        src += 16;
+        dst += 16;
+    }
+    ConvertBgraToRgbaPortable(dst, src, count - i);
+}
+#endif
+
+void ConvertBgrxToRgb(unsigned char *dst, const unsigned char *src, int count) {
+#ifdef PIXEL_X86
+    if (CpuFeatures() & CPU_FEATURE_SSSE3) {
+        ConvertBgrxToRgbSsse3(dst, src, count);
+        return;
+    }
+#endif
+    ConvertBgrxToRgbPortable(dst, src, count);
+}
+
+void ConvertBgraToRgba(unsigned char *dst, const unsigned char *src, int count) {
+#ifdef PIXEL_X86
+    if (CpuFeatures() & CPU_FEATURE_SSSE3) {
+        ConvertBgraToRgbaSsse3(dst, src, count);
+        return;
+    }
+#endif
+    ConvertBgraToRgbaPortable(dst, src, count);
+}
@@ -0,0 +1,17 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+/* Conversions from the 32-bit BGRX/BGRA layout GDI captures into to the byte orders image
+ * encoders expect. The fastest implementation the CPU supports is picked at run time. */
+
+/* Drops the fourth byte and swaps B and R. dst holds count * 3 bytes. */
+void ConvertBgrxToRgb(unsigned char *dst, const unsigned char *src, int count);
+
+/* Swaps B and R, keeping the fourth byte. dst may equal src. */
+void ConvertBgraToRgba(unsigned char *dst, const unsigned char *src, int count);
+
+/* The portable implementations, for comparing against the accelerated ones. */
+void ConvertBgrxToRgbPortable(unsigned char *dst, const unsigned char *src, int count);
+void ConvertBgraToRgbaPortable(unsigned char *dst, const unsigned char *src, int count);
+
+#endif
@@ -0,0 +1,488 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checksum.h"
+#include "cpu_features.h"
+#include "deflate.h"
+#include "pixel_convert.h"
+#include "png_writer.h"
+
+#define STBIW_ZLIB_COMPRESS DeflateZlib
+#define STBIW_CRC32(buffer, len) Crc32(0, buffer, (size_t)(len))
+#define STBIW_CPU_HAS_AVX2() ((CpuFeatures() & CPU_FEATURE_AVX2) != 0)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+/* Below this many bytes of pixel data the thread handoff costs more than it saves. */
+#define PNG_PARALLEL_MIN_BYTES (1024 * 1024)
+#define PNG_MIN_BAND_ROWS 32
+
+/* History each band is primed with so it can match against the end of the previous band. */
+#define PNG_DICT_BYTES 32768
+
+/* Filtered bytes a stream deflates per call. Each call ends in a sync flush, so bigger blocks
+ * cost fewer flush markers but more memory. */
+#define PNG_STREAM_BLOCK_BYTES (256 * 1024)
+
+static const int pngColorType[5] = {-1, 0, 4, 2, 6};
+static const unsigned char pngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+typedef struct {
+    const unsigned char *pixels;
+    int stride;
+    int width;
+    int height;
+    int comp;
+    PngSourceFormat source;
+    PngFilterMode filter;
+    int rowsPerBand;
+    int bandCount;
+    DeflateParams params;
+
+    /* Per band: raw deflate data and the Adler-32 of the bytes it encodes. */
+    unsigned char *deflated[PNG_MAX_BANDS];
+    int deflateLen[PNG_MAX_BANDS];
+    unsigned int adler[PNG_MAX_BANDS];
+    int filteredLen[PNG_MAX_BANDS];
+} PngBandJob;
+
+/* Brings one source row into PNG channel order. */
+static void CopySourceRow(PngSourceFormat source, int comp, int width, const unsigned char *src,
+    unsigned char *out) {
+    if (source != PNG_SOURCE_BGRX)
+        memcpy(out, src, (size_t)width * comp);
+    else if (comp == 3)
+        ConvertBgrxToRgb(out, src, width);
+    else
+        ConvertBgraToRgba(out, src, width);
+}
+
+static void ConvertRow(const PngBandJob *job, int y, unsigned char *out) {
+    CopySourceRow(job->source, job->comp, job->width, job->pixels + (size_t)y * job->stride, out);
+}
+
+/* Converted rows go into a two-row ring, alternating slots so the previous row is always the
+ * other one. Returns the base, stride and row index that make stbiw__encode_png_line see row y
+ * with the previous one above it. */
+static unsigned char *RingView(unsigned char *ring, int rowBytes, int y, int *stride, int *ringY) {
+    if (y == 0) {
+        *stride = rowBytes;
+        *ringY = 0;
+        return ring;
+    }
+    *ringY = 1;
+    *stride = (y & 1) ? rowBytes : -rowBytes;
+    return (y & 1) ? ring : ring + rowBytes;
+}
+
+/* Adaptive mode uses the same per-row filter selection as stbi_write_png_to_mem, so the
+ * filtered bytes match it. Writes the filter type byte followed by the filtered row to out. */
+static void FilterRow(PngFilterMode mode, unsigned char *base, int stride, int width, int height,
+    int y, int comp, signed char *lineBuffer, unsigned char *out) {
+    int bestFilter = 0, bestEstimate = 0x7fffffff;
+
+    if (mode == PNG_FILTER_UP) {
+        /* No trial encodes; the first row has nothing above it and goes out unfiltered. */
+        const unsigned char *row = base + (ptrdiff_t)stride * y;
+        int rowBytes = width * comp;
+        out[0] = y == 0 ? 0 : 2;
+        if (y == 0) {
+            memcpy(out + 1, row, rowBytes);
+        } else {
+            for (int i = 0; i < rowBytes; i++) {
+                out[1 + i] = (unsigned char)(row[i] - row[i - stride]);
+            }
+        }
+        return;
+    }
+
+    for (int filter = 0; filter < 5; filter++) {
+        int estimate =
+            stbiw__encode_png_line(base, stride, width, height, y, comp, filter, lineBuffer);
+        if (estimate < bestEstimate) {
+            bestEstimate = estimate;
+            bestFilter = filter;
+        }
+    }
+    if (bestFilter != 4)
+        stbiw__encode_png_line(base, stride, width, height, y, comp, bestFilter, lineBuffer);
+
+    out[0] = (unsigned char)bestFilter;
+    memcpy(out + 1, lineBuffer, (size_t)width * comp);
+}
+
+static void FilterRows(const PngBandJob *job, int firstRow, int rowCount, unsigned char *out,
+    signed char *lineBuffer, unsigned char *ring) {
+    int rowBytes = job->width * job->comp;
+
+    if (ring && firstRow > 0)
+        ConvertRow(job, firstRow - 1, ring + ((firstRow - 1) & 1) * rowBytes);
+
+    for (int r = 0; r < rowCount; r++) {
+        int y = firstRow + r;
+        unsigned char *base = (unsigned char *)job->pixels;
+        int stride = job->stride, height = job->height, rowY = y;
+
+        if (ring) {
+            ConvertRow(job, y, ring + (y & 1) * rowBytes);
+            base = RingView(ring, rowBytes, y, &stride, &rowY);
+            height = 2;
+        }
+
+        FilterRow(job->filter, base, stride, job->width, height, rowY, job->comp, lineBuffer,
+            out + (size_t)r * (rowBytes + 1));
+    }
+}
+
+static void EncodeBand(void *context, int band) {
+    PngBandJob *job = (PngBandJob *)context;
+    int rowBytes = job->width * job->comp;
+    int firstRow = band * job->rowsPerBand;
+    int rowCount = job->height - firstRow;
+    if (rowCount > job->rowsPerBand)
+        rowCount = job->rowsPerBand;
+
+    /* Filtering is deterministic, so re-filtering the rows just above the band reproduces the
+     * tail of the previous band's data exactly and can serve as its dictionary. */
+    int dictRows = (PNG_DICT_BYTES + rowBytes) / (rowBytes + 1);
+    if (dictRows > firstRow)
+        dictRows = firstRow;
+
+    int dictLen = (rowBytes + 1) * dictRows;
+    int filteredLen = (rowBytes + 1) * rowCount;
+    unsigned char *filtered = (unsigned char *)malloc((size_t)dictLen + filteredLen);
+    signed char *lineBuffer = (signed char *)malloc(rowBytes);
+    unsigned char *ring = NULL;
+    if (job->source == PNG_SOURCE_BGRX)
+        ring = (unsigned char *)malloc((size_t)rowBytes * 2);
+    if (!filtered || !lineBuffer || (job->source == PNG_SOURCE_BGRX && !ring)) {
+        free(filtered);
+        free(lineBuffer);
+        free(ring);
+        return;
+    }
+
+    FilterRows(job, firstRow - dictRows, dictRows + rowCount, filtered, lineBuffer, ring);
+    free(lineBuffer);
+    free(ring);
+
+    /* Every band but the last ends in a sync flush so the deflate streams can be joined. */
+    int zlen = 0;
+    unsigned char *deflated = DeflateRaw(filtered, dictLen, filteredLen, &job->params,
+        band == job->bandCount - 1, &zlen);
+    if (!deflated) {
+        free(filtered);
+        return;
+    }
+
+    job->adler[band] = Adler32(1, filtered + dictLen, filteredLen);
+    free(filtered);
+    job->deflateLen[band] = zlen;
+    job->filteredLen[band] = filteredLen;
+    job->deflated[band] = deflated;
+}
+
+#define PNG_HEADER_BYTES (8 + 12 + 13)
+
+/* Writes the signature and IHDR chunk. */
+static unsigned char *WriteHeader(unsigned char *o, int width, int height, int comp) {
+    memcpy(o, pngSignature, 8);
+    o += 8;
+    stbiw__wp32(o, 13);
+    stbiw__wptag(o, "IHDR");
+    stbiw__wp32(o, width);
+    stbiw__wp32(o, height);
+    *o++ = 8;
+    *o++ = STBIW_UCHAR(pngColorType[comp]);
+    *o++ = 0;
+    *o++ = 0;
+    *o++ = 0;
+    stbiw__wpcrc(&o, 13);
+    return o;
+}
+
+static unsigned char *AssemblePng(const PngBandJob *job, int *outLen) {
+    long long zlen = 2 + 4;
+    for (int band = 0; band < job->bandCount; band++) {
+        zlen += job->deflateLen[band];
+    }
+    if (zlen > 0x7fffffff - 64)
+        return NULL;
+
+    int total = PNG_HEADER_BYTES + 12 + (int)zlen + 12;
+    unsigned char *out = (unsigned char *)STBIW_MALLOC(total);
+    if (!out)
+        return NULL;
+
+    unsigned char *o = WriteHeader(out, job->width, job->height, job->comp);
+
+    stbiw__wp32(o, (int)zlen);
+    stbiw__wptag(o, "IDAT");
+    *o++ = 0x78; /* 32K window, default compression */
+    *o++ = 0x9c;
+    unsigned int adler = 1;
+    for (int band = 0; band < job->bandCount; band++) {
+        memcpy(o, job->deflated[band], job->deflateLen[band]);
+        o += job->deflateLen[band];
+        adler = Adler32Combine(adler, job->adler[band], (size_t)job->filteredLen[band]);
+    }
+    stbiw__wp32(o, adler);
+    stbiw__wpcrc(&o, (int)zlen);
+
+    stbiw__wp32(o, 0);
+    stbiw__wptag(o, "IEND");
+    stbiw__wpcrc(&o, 0);
+
+    *outLen = total;
+    return out;
+}
+
+unsigned char *PngEncodeToMemory(const unsigned char *pixels, int stride, int width, int height,
+    int comp, const PngEncodeOptions *options, int *outLen) {
+    PngSourceFormat source = options ? options->source : PNG_SOURCE_NATIVE;
+    if (!pixels || width <= 0 || height <= 0 || comp < 1 || comp > 4)
+        return NULL;
+    if (source == PNG_SOURCE_BGRX && comp < 3)
+        return NULL;
+    if (stride == 0)
+        stride = width * (source == PNG_SOURCE_BGRX ? 4 : comp);
+
+    int bands = options ? options->threads : 1;
+    if (bands > PNG_MAX_BANDS)
+        bands = PNG_MAX_BANDS;
+    if (bands > height / PNG_MIN_BAND_ROWS)
+        bands = height / PNG_MIN_BAND_ROWS;
+    if (bands < 1 || !options || !options->parallelFor ||
+        (long long)width * height * comp < PNG_PARALLEL_MIN_BYTES)
+        bands = 1;
+
+    PngBandJob job;
+    memset(&job, 0, sizeof(job));
+    job.pixels = pixels;
+    job.stride = stride;
+    job.width = width;
+    job.height = height;
+    job.comp = comp;
+    job.source = source;
+    job.filter = options ? options->filter : PNG_FILTER_ADAPTIVE;
+    job.rowsPerBand = (height + bands - 1) / bands;
+    job.bandCount = (height + job.rowsPerBand - 1) / job.rowsPerBand;
+    job.params = options && options->deflate ? *options->deflate
+                                             : DeflateParamsForLevel(PNG_DEFAULT_LEVEL);
+
+    if (job.bandCount > 1)
+        options->parallelFor(EncodeBand, &job, job.bandCount, options->parallelUser);
+    else
+        EncodeBand(&job, 0);
+
+    unsigned char *png = NULL;
+    int complete = 1;
+    for (int band = 0; band < job.bandCount; band++) {
+        if (!job.deflated[band])
+            complete = 0;
+    }
+    if (complete)
+        png = AssemblePng(&job, outLen);
+
+    for (int band = 0; band < job.bandCount; band++) {
+        free(job.deflated[band]);
+    }
+    return png;
+}
+
+void PngFree(void *png) {
+    STBIW_FREE(png);
+}
+
+struct PngStream {
+    stbi_write_func *write;
+    void *context;
+    int width;
+    int height;
+    int comp;
+    PngSourceFormat source;
+    PngFilterMode filter;
+    DeflateParams params;
+    int rowBytes;
+    int rowsWritten;
+    int failed;
+
+    unsigned char *ring; /* current and previous row in PNG channel order */
+    signed char *lineBuffer;
+
+    /* dictLen bytes of already deflated history followed by pendingLen filtered bytes. */
+    unsigned char *filtered;
+    int dictLen;
+    int pendingLen;
+    unsigned int adler;
+
+    /* Length, tag, up to PNG_STREAM_IDAT_BYTES of zlib data and room for the CRC. */
+    unsigned char *chunk;
+    int chunkLen;
+};
+
+static void FlushIdat(PngStream *stream) {
+    if (!stream->chunkLen)
+        return;
+
+    unsigned char *o = stream->chunk;
+    stbiw__wp32(o, stream->chunkLen);
+    stbiw__wptag(o, "IDAT");
+    o += stream->chunkLen;
+    stbiw__wpcrc(&o, stream->chunkLen);
+    stream->write(stream->context, stream->chunk, stream->chunkLen + 12);
+    stream->chunkLen = 0;
+}
+
+static void AppendIdat(PngStream *stream, const unsigned char *data, int len) {
+    while (len > 0) {
+        int n = PNG_STREAM_IDAT_BYTES - stream->chunkLen;
+        if (n > len)
+            n = len;
+        memcpy(stream->chunk + 8 + stream->chunkLen, data, n);
+        stream->chunkLen += n;
+        data += n;
+        len -= n;
+        if (stream->chunkLen == PNG_STREAM_IDAT_BYTES)
+            FlushIdat(stream);
+    }
+}
+
+/* Deflates the pending rows against the history before them, then keeps the last 32K of
+ * filtered bytes as the history for the next call. */
+static void DeflatePending(PngStream *stream, int last) {
+    unsigned char *data = stream->filtered + stream->dictLen;
+    int zlen = 0;
+    unsigned char *deflated = DeflateRaw(stream->filtered, stream->dictLen, stream->pendingLen,
+        &stream->params, last, &zlen);
+    if (!deflated) {
+        stream->failed = 1;
+        return;
+    }
+
+    stream->adler = Adler32(stream->adler, data, (size_t)stream->pendingLen);
+    AppendIdat(stream, deflated, zlen);
+    free(deflated);
+
+    int total = stream->dictLen + stream->pendingLen;
+    int keep = total < PNG_DICT_BYTES ? total : PNG_DICT_BYTES;
+    memmove(stream->filtered, stream->filtered + total - keep, keep);
+    stream->dictLen = keep;
+    stream->pendingLen = 0;
+}
+
+static void FreeStream(PngStream *stream) {
+    free(stream->ring);
+    free(stream->lineBuffer);
+    free(stream->filtered);
+    free(stream->chunk);
+    free(stream);
+}
+
+PngStream *PngStreamBegin(stbi_write_func *write, void *context, int width, int height,
+    int comp, const PngEncodeOptions *options) {
+    PngSourceFormat source = options ? options->source : PNG_SOURCE_NATIVE;
+    if (!write || width <= 0 || height <= 0 || comp < 1 || comp > 4)
+        return NULL;
+    if (source == PNG_SOURCE_BGRX && comp < 3)
+        return NULL;
+    if ((long long)width * comp + 1 > 0x7fffffff - PNG_DICT_BYTES - PNG_STREAM_BLOCK_BYTES)
+        return NULL;
+
+    PngStream *stream = (PngStream *)calloc(1, sizeof(PngStream));
+    if (!stream)
+        return NULL;
+
+    stream->write = write;
+    stream->context = context;
+    stream->width = width;
+    stream->height = height;
+    stream->comp = comp;
+    stream->source = source;
+    stream->filter = options ? options->filter : PNG_FILTER_ADAPTIVE;
+    stream->params = options && options->deflate ? *options->deflate
+                                                 : DeflateParamsForLevel(PNG_DEFAULT_LEVEL);
+    stream->rowBytes = width * comp;
+    stream->adler = 1;
+
+    /* A row wider than a block is deflated on its own. */
+    int blockBytes = stream->rowBytes + 1;
+    if (blockBytes < PNG_STREAM_BLOCK_BYTES)
+        blockBytes = PNG_STREAM_BLOCK_BYTES;
+
+    stream->ring = (unsigned char *)malloc((size_t)stream->rowBytes * 2);
+    stream->lineBuffer = (signed char *)malloc(stream->rowBytes);
+    stream->filtered = (unsigned char *)malloc((size_t)PNG_DICT_BYTES + blockBytes);
+    stream->chunk = (unsigned char *)malloc(PNG_STREAM_IDAT_BYTES + 12);
+    if (!stream->ring || !stream->lineBuffer || !stream->filtered || !stream->chunk) {
+        FreeStream(stream);
+        return NULL;
+    }
+
+    unsigned char header[PNG_HEADER_BYTES];
+    WriteHeader(header, width, height, comp);
+    write(context, header, PNG_HEADER_BYTES);
+
+    static const unsigned char zlibHeader[2] = {0x78, 0x9c};
+    AppendIdat(stream, zlibHeader, 2);
+    return stream;
+}
+
+int PngStreamWriteRows(PngStream *stream, const unsigned char *rows, int stride, int rowCount) {
+    if (!stream || stream->failed)
+        return 0;
+    if (!rows || rowCount < 0 || rowCount > stream->height - stream->rowsWritten) {
+        stream->failed = 1;
+        return 0;
+    }
+    if (stride == 0)
+        stride = stream->width * (stream->source == PNG_SOURCE_BGRX ? 4 : stream->comp);
+
+    int filteredRow = stream->rowBytes + 1;
+    for (int r = 0; r < rowCount; r++) {
+        if (stream->pendingLen && stream->pendingLen + filteredRow > PNG_STREAM_BLOCK_BYTES) {
+            DeflatePending(stream, 0);
+            if (stream->failed)
+                return 0;
+        }
+
+        int y = stream->rowsWritten;
+        int ringStride, ringY;
+        CopySourceRow(stream->source, stream->comp, stream->width, rows + (size_t)r * stride,
+            stream->ring + (y & 1) * stream->rowBytes);
+        unsigned char *base = RingView(stream->ring, stream->rowBytes, y, &ringStride, &ringY);
+        FilterRow(stream->filter, base, ringStride, stream->width, 2, ringY, stream->comp,
+            stream->lineBuffer, stream->filtered + stream->dictLen + stream->pendingLen);
+
+        stream->pendingLen += filteredRow;
+        stream->rowsWritten++;
+    }
+    return 1;
+}
+
+int PngStreamEnd(PngStream *stream) {
+    if (!stream)
+        return 0;
+
+    int complete = !stream->failed && stream->rowsWritten == stream->height;
+    if (complete) {
+        DeflatePending(stream, 1);
+        complete = !stream->failed;
+    }
+    if (complete) {
+        unsigned char trailer[12];
+        unsigned char *o = trailer;
+        stbiw__wp32(o, stream->adler);
+        AppendIdat(stream, trailer, 4);
+        FlushIdat(stream);
+
+        o = trailer;
+        stbiw__wp32(o, 0);
+        stbiw__wptag(o, "IEND");
+        stbiw__wpcrc(&o, 0);
+        stream->write(stream->context, trailer, 12);
+    }
+
+    FreeStream(stream);
+    return complete;
+}
@@ -0,0 +1,66 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include "deflate.h"
+#include "stb_image_write.h"
+
+/* PNG encoding for screenshots, using stb_image_write's row filters and the deflate module.
+ * Large images are split into horizontal bands that are filtered and deflated independently on
+ * the caller's thread pool, then stitched into a single IDAT. */
+
+#define PNG_MAX_BANDS 16
+#define PNG_DEFAULT_LEVEL 6
+
+/* Runs body(context, index) for every index in [0, count), possibly concurrently, and returns
+ * once all calls have finished. */
+typedef void (*PngParallelBody)(void *context, int index);
+typedef void (*PngParallelFor)(PngParallelBody body, void *context, int count, void *user);
+
+typedef enum {
+    PNG_SOURCE_NATIVE, /* pixels already hold comp channels in PNG order */
+    PNG_SOURCE_BGRX    /* 4-byte B,G,R,X pixels; X is dropped unless comp is 4 */
+} PngSourceFormat;
+
+typedef enum {
+    PNG_FILTER_ADAPTIVE, /* best of the five filters per row, as stb_image_write picks it */
+    PNG_FILTER_UP        /* Up on every row: one pass instead of five, somewhat larger output */
+} PngFilterMode;
+
+typedef struct {
+    PngParallelFor parallelFor; /* NULL encodes on the calling thread */
+    void *parallelUser;
+    int threads;
+    const DeflateParams *deflate; /* NULL uses PNG_DEFAULT_LEVEL */
+    PngSourceFormat source;
+    PngFilterMode filter;
+} PngEncodeOptions;
+
+/* Encodes 8-bit pixels into a PNG with comp channels (1-4, or 3-4 for BGRX sources). A stride
+ * of 0 means tightly packed rows. Returns a malloc'd PNG file image or NULL. */
+unsigned char *PngEncodeToMemory(const unsigned char *pixels, int stride, int width, int height,
+    int comp, const PngEncodeOptions *options, int *outLen);
+
+void PngFree(void *png);
+
+/* Streaming encoder for images too large to hold encoded in memory. Rows are filtered and
+ * deflated as they arrive and written out as IDAT chunks of at most PNG_STREAM_IDAT_BYTES, so
+ * memory use depends on the row size but not the image height. It runs on the calling thread
+ * and ignores the parallel options. */
+
+#define PNG_STREAM_IDAT_BYTES 65536
+
+typedef struct PngStream PngStream;
+
+/* Writes the signature and IHDR. Returns NULL for bad arguments or if allocation fails. */
+PngStream *PngStreamBegin(stbi_write_func *write, void *context, int width, int height,
+    int comp, const PngEncodeOptions *options);
+
+/* Appends rowCount rows in the source format given to PngStreamBegin. A stride of 0 means
+ * tightly packed rows. Returns 0 once the stream has failed or more rows than the height are
+ * written. */
+int PngStreamWriteRows(PngStream *stream, const unsigned char *rows, int stride, int rowCount);
+
+/* Finishes the file and frees the stream. Returns 1 only if every row was written. */
+int PngStreamEnd(PngStream *stream);
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "qoi_writer.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_MAX_RUN 62
+
+/* Output is staged here and handed to the write callback whenever less than one pixel's worst
+ * case is left: a pending run followed by an RGBA op. */
+#define QOI_BUFFER_BYTES 65536
+#define QOI_MAX_PIXEL_BYTES 6
+
+typedef struct {
+    unsigned char r, g, b, a;
+} QoiPixel;
+
+typedef struct {
+    QoiWriteFunc *write;
+    void *context;
+    unsigned char *buffer;
+    int len;
+} QoiOutput;
+
+static void Flush(QoiOutput *out) {
+    if (out->len) {
+        out->write(out->context, out->buffer, out->len);
+        out->len = 0;
+    }
+}
+
+static void Put32(unsigned char *p, unsigned int value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static int Equal(QoiPixel a, QoiPixel b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static int Hash(QoiPixel p) {
+    return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) & 63;
+}
+
+static void EncodePixel(unsigned char *o, int *len, QoiPixel px, QoiPixel prev) {
+    int n = *len;
+
+    if (px.a != prev.a) {
+        o[n++] = QOI_OP_RGBA;
+        o[n++] = px.r;
+        o[n++] = px.g;
+        o[n++] = px.b;
+        o[n++] = px.a;
+        *len = n;
+        return;
+    }
+
+    signed char vr = (signed char)(px.r - prev.r);
+    signed char vg = (signed char)(px.g - prev.g);
+    signed char vb = (signed char)(px.b - prev.b);
+    signed char vgr = (signed char)(vr - vg);
+    signed char vgb = (signed char)(vb - vg);
+
+    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+        o[n++] = (unsigned char)(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+    } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+        o[n++] = (unsigned char)(QOI_OP_LUMA | (vg + 32));
+        o[n++] = (unsigned char)((vgr + 8) << 4 | (vgb + 8));
+    } else {
+        o[n++] = QOI_OP_RGB;
+        o[n++] = px.r;
+        o[n++] = px.g;
+        o[n++] = px.b;
+    }
+    *len = n;
+}
+
+int QoiWriteBgrx(QoiWriteFunc *write, void *context, const unsigned char *pixels, int stride,
+    int width, int height, int channels) {
+    static const unsigned char padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+    if (!write || !pixels || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+        return 0;
+    if (stride == 0)
+        stride = width * 4;
+
+    QoiOutput out = {write, context, (unsigned char *)malloc(QOI_BUFFER_BYTES), 0};
+    if (!out.buffer)
+        return 0;
+
+    unsigned char *o = out.buffer;
+    memcpy(o, "qoif", 4);
+    Put32(o + 4, (unsigned int)width);
+    Put32(o + 8, (unsigned int)height);
+    o[12] = (unsigned char)channels;
+    o[13] = 0; /* sRGB with linear alpha */
+    out.len = 14;
+
+    QoiPixel index[64];
+    memset(index, 0, sizeof(index));
+    QoiPixel prev = {0, 0, 0, 255};
+    int run = 0;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char *src = pixels + (size_t)y * stride;
+        int lastRow = y == height - 1;
+
+        for (int x = 0; x < width; x++, src += 4) {
+            QoiPixel px = {src[2], src[1], src[0], channels == 4 ? src[3] : 255};
+
+            if (out.len > QOI_BUFFER_BYTES - QOI_MAX_PIXEL_BYTES)
+                Flush(&out);
+
+            if (Equal(px, prev)) {
+                run++;
+                if (run == QOI_MAX_RUN || (lastRow && x == width - 1)) {
+                    out.buffer[out.len++] = (unsigned char)(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run) {
+                out.buffer[out.len++] = (unsigned char)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            int h = Hash(px);
+            if (Equal(index[h], px)) {
+                out.buffer[out.len++] = (unsigned char)(QOI_OP_INDEX | h);
+            } else {
+                index[h] = px;
+                EncodePixel(out.buffer, &out.len, px, prev);
+            }
+            prev = px;
+        }
+    }
+
+    if (out.len > QOI_BUFFER_BYTES - (int)sizeof(padding))
+        Flush(&out);
+    memcpy(out.buffer + out.len, padding, sizeof(padding));
+    out.len += (int)sizeof(padding);
+    Flush(&out);
+
+    free(out.buffer);
+    return 1;
+}
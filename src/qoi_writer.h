@@ -0,0 +1,16 @@
+#ifndef QOI_WRITER_H
+#define QOI_WRITER_H
+
+/* Encoder for the QOI image format (https://qoiformat.org). It is a single pass with no
+ * entropy coding, so it runs many times faster than PNG at a moderately larger file size.
+ * Input is 4-byte B,G,R,X pixels, the layout GDI captures come in. */
+
+/* Receives the encoded bytes in pieces. Same shape as stbi_write_func. */
+typedef void QoiWriteFunc(void *context, void *data, int size);
+
+/* Encodes BGRX pixels as a QOI image with 3 channels (X dropped) or 4 (X kept as alpha). A
+ * stride of 0 means tightly packed rows. Returns 0 on bad arguments or allocation failure. */
+int QoiWriteBgrx(QoiWriteFunc *write, void *context, const unsigned char *pixels, int stride,
+    int width, int height, int channels);
+
+#endif
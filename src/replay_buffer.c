@@ -0,0 +1,443 @@
+#include <stdlib.h>
+#include <string.h>
+#include "replay_buffer.h"
+
+/* A frame is a sequence of tokens over its pixels in row order. Each starts with a varint of
+ * count << 2 | type; FILL is followed by one 3-byte XOR value and LITERAL by count of them. */
+#define TOKEN_SKIP 0    /* count pixels unchanged */
+#define TOKEN_FILL 1    /* count pixels changed by the same XOR value */
+#define TOKEN_LITERAL 2 /* count pixels, each with its own XOR value */
+#define TOKEN_NONE -1
+
+#define LITERAL_MAX 128
+#define MIN_FILL 3
+
+/* Keeps count << 2 within 32 bits. */
+#define REPLAY_MAX_PIXELS (1u << 29)
+
+/* No token costs more than 4 bytes per pixel it covers, plus the trailing flush. */
+#define ENCODED_BOUND(pixels) ((pixels) * 4 + 16)
+
+typedef struct {
+    unsigned char *out;
+    size_t len;
+    int type;
+    unsigned int count;
+    unsigned int value;
+    unsigned int literal[LITERAL_MAX];
+} DeltaWriter;
+
+static void PutVarint(DeltaWriter *w, unsigned int value) {
+    while (value >= 0x80) {
+        w->out[w->len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    w->out[w->len++] = (unsigned char)value;
+}
+
+static void PutValue(DeltaWriter *w, unsigned int value) {
+    w->out[w->len++] = (unsigned char)value;
+    w->out[w->len++] = (unsigned char)(value >> 8);
+    w->out[w->len++] = (unsigned char)(value >> 16);
+}
+
+static void FlushToken(DeltaWriter *w) {
+    if (w->type == TOKEN_NONE)
+        return;
+
+    PutVarint(w, w->count << 2 | (unsigned int)w->type);
+    if (w->type == TOKEN_FILL) {
+        PutValue(w, w->value);
+    } else if (w->type == TOKEN_LITERAL) {
+        for (unsigned int i = 0; i < w->count; i++) {
+            PutValue(w, w->literal[i]);
+        }
+    }
+    w->type = TOKEN_NONE;
+}
+
+static void StartToken(DeltaWriter *w, int type, unsigned int count, unsigned int value) {
+    w->type = type;
+    w->count = count;
+    w->value = value;
+    if (type == TOKEN_LITERAL)
+        w->literal[0] = value;
+}
+
+static void AddDiff(DeltaWriter *w, unsigned int diff) {
+    if (diff == 0) {
+        if (w->type == TOKEN_SKIP) {
+            w->count++;
+            return;
+        }
+        FlushToken(w);
+        StartToken(w, TOKEN_SKIP, 1, 0);
+        return;
+    }
+
+    if (w->type == TOKEN_FILL && w->value == diff) {
+        w->count++;
+        return;
+    }
+
+    if (w->type == TOKEN_LITERAL) {
+        /* A third equal value in a row is cheaper as a fill. */
+        if (w->count >= MIN_FILL - 1 && w->literal[w->count - 1] == diff &&
+            w->literal[w->count - 2] == diff) {
+            w->count -= MIN_FILL - 1;
+            if (w->count)
+                FlushToken(w);
+            StartToken(w, TOKEN_FILL, MIN_FILL, diff);
+            return;
+        }
+        if (w->count < LITERAL_MAX) {
+            w->literal[w->count++] = diff;
+            return;
+        }
+    }
+
+    FlushToken(w);
+    StartToken(w, TOKEN_LITERAL, 1, diff);
+}
+
+/* Encodes the frame against previous (or black for a keyframe) into scratch, leaving the frame
+ * in previous for the next delta. */
+static size_t EncodeFrame(ReplayBuffer *buffer, const unsigned char *pixels, int stride,
+    int width, int height, int keyframe) {
+    DeltaWriter w;
+    w.out = buffer->scratch;
+    w.len = 0;
+    w.type = TOKEN_NONE;
+
+    if (keyframe)
+        memset(buffer->previous, 0, (size_t)width * height * sizeof(unsigned int));
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char *src = pixels + (size_t)y * stride;
+        unsigned int *prev = buffer->previous + (size_t)y * width;
+
+        for (int x = 0; x < width; x++, src += 4) {
+            unsigned int pixel = src[0] | (unsigned int)src[1] << 8 | (unsigned int)src[2] << 16;
+            AddDiff(&w, pixel ^ prev[x]);
+            prev[x] = pixel;
+        }
+    }
+    FlushToken(&w);
+    return w.len;
+}
+
+static int EnsureFrameStorage(ReplayBuffer *buffer, size_t pixels) {
+    if (pixels <= buffer->previousPixels)
+        return 1;
+
+    unsigned int *previous = (unsigned int *)malloc(pixels * sizeof(unsigned int));
+    unsigned char *scratch = (unsigned char *)malloc(ENCODED_BOUND(pixels));
+    if (!previous || !scratch) {
+        free(previous);
+        free(scratch);
+        return 0;
+    }
+
+    free(buffer->previous);
+    free(buffer->scratch);
+    buffer->previous = previous;
+    buffer->scratch = scratch;
+    buffer->previousPixels = pixels;
+    buffer->scratchSize = ENCODED_BOUND(pixels);
+    buffer->needKeyframe = 1;
+    return 1;
+}
+
+static void DropOldestGroup(ReplayBuffer *buffer) {
+    do {
+        buffer->used -= buffer->frames[buffer->first].length;
+        buffer->first = (buffer->first + 1) % buffer->frameCapacity;
+        buffer->count--;
+    } while (buffer->count > 0 && !buffer->frames[buffer->first].keyframe);
+
+    if (buffer->count == 0)
+        buffer->head = 0;
+}
+
+/* Drops the oldest group while the history would still reach back maxAgeMs without it. */
+static void TrimToAge(ReplayBuffer *buffer, unsigned long long nowMs) {
+    if (!buffer->maxAgeMs)
+        return;
+
+    while (buffer->count > 0) {
+        int next = 1;
+        while (next < buffer->count && !ReplayBufferFrame(buffer, next)->keyframe) {
+            next++;
+        }
+        if (next == buffer->count)
+            return;
+
+        unsigned long long nextTime = ReplayBufferFrame(buffer, next)->timeMs;
+        if (nowMs < nextTime || nowMs - nextTime < buffer->maxAgeMs)
+            return;
+        DropOldestGroup(buffer);
+    }
+}
+
+/* Finds where len bytes fit after the newest frame, wrapping to the start of the ring if the
+ * space at the end is too short. */
+static int FindSpace(const ReplayBuffer *buffer, size_t len, size_t *offset) {
+    if (buffer->count == 0) {
+        *offset = 0;
+        return len <= buffer->capacity;
+    }
+
+    size_t tail = buffer->frames[buffer->first].offset;
+    size_t head = buffer->head;
+    if (head > tail) {
+        if (len <= buffer->capacity - head) {
+            *offset = head;
+            return 1;
+        }
+        *offset = 0;
+        return len <= tail;
+    }
+    *offset = head;
+    return head < tail && len <= tail - head;
+}
+
+int ReplayBufferInit(ReplayBuffer *buffer, size_t capacity, int maxFrames, int keyInterval,
+    unsigned long long maxAgeMs) {
+    memset(buffer, 0, sizeof(*buffer));
+    if (capacity == 0 || maxFrames <= 0)
+        return 0;
+
+    buffer->data = (unsigned char *)malloc(capacity);
+    buffer->frames = (ReplayFrame *)malloc((size_t)maxFrames * sizeof(ReplayFrame));
+    if (!buffer->data || !buffer->frames) {
+        ReplayBufferRelease(buffer);
+        return 0;
+    }
+
+    buffer->capacity = capacity;
+    buffer->frameCapacity = maxFrames;
+    buffer->keyInterval = keyInterval > 0 ? keyInterval : 1;
+    buffer->maxAgeMs = maxAgeMs;
+    buffer->needKeyframe = 1;
+    return 1;
+}
+
+int ReplayBufferPush(ReplayBuffer *buffer, const unsigned char *pixels, int stride, int width,
+    int height, unsigned long long timeMs) {
+    if (!buffer->data || !pixels || width <= 0 || height <= 0 ||
+        (unsigned long long)width * height > REPLAY_MAX_PIXELS) {
+        buffer->dropped++;
+        return 0;
+    }
+    if (stride == 0)
+        stride = width * 4;
+    if (!EnsureFrameStorage(buffer, (size_t)width * height)) {
+        buffer->dropped++;
+        return 0;
+    }
+
+    TrimToAge(buffer, timeMs);
+
+    int keyframe = buffer->count == 0 || buffer->needKeyframe ||
+                   width != buffer->previousWidth || height != buffer->previousHeight ||
+                   buffer->sinceKeyframe >= buffer->keyInterval;
+    size_t len = EncodeFrame(buffer, pixels, stride, width, height, keyframe);
+    buffer->previousWidth = width;
+    buffer->previousHeight = height;
+
+    size_t offset;
+    while (buffer->count >= buffer->frameCapacity || !FindSpace(buffer, len, &offset)) {
+        if (buffer->count == 0) {
+            /* Too big for the whole ring; previous now holds a frame nothing refers to. */
+            buffer->needKeyframe = 1;
+            buffer->dropped++;
+            return 0;
+        }
+        DropOldestGroup(buffer);
+        if (buffer->count == 0 && !keyframe) {
+            /* The frame this delta was taken against went with the group. */
+            keyframe = 1;
+            len = EncodeFrame(buffer, pixels, stride, width, height, 1);
+        }
+    }
+
+    memcpy(buffer->data + offset, buffer->scratch, len);
+    ReplayFrame *frame = &buffer->frames[(buffer->first + buffer->count) % buffer->frameCapacity];
+    frame->width = width;
+    frame->height = height;
+    frame->timeMs = timeMs;
+    frame->keyframe = keyframe;
+    frame->offset = offset;
+    frame->length = len;
+
+    buffer->count++;
+    buffer->used += len;
+    buffer->head = offset + len;
+    buffer->sinceKeyframe = keyframe ? 1 : buffer->sinceKeyframe + 1;
+    buffer->needKeyframe = 0;
+    return 1;
+}
+
+void ReplayBufferClear(ReplayBuffer *buffer) {
+    buffer->first = 0;
+    buffer->count = 0;
+    buffer->used = 0;
+    buffer->head = 0;
+    buffer->needKeyframe = 1;
+}
+
+void ReplayBufferRelease(ReplayBuffer *buffer) {
+    free(buffer->data);
+    free(buffer->frames);
+    free(buffer->previous);
+    free(buffer->scratch);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+const ReplayFrame *ReplayBufferFrame(const ReplayBuffer *buffer, int index) {
+    if (index < 0 || index >= buffer->count)
+        return NULL;
+    return &buffer->frames[(buffer->first + index) % buffer->frameCapacity];
+}
+
+size_t ReplayBufferBytesUsed(const ReplayBuffer *buffer) {
+    return buffer->used;
+}
+
+unsigned long long ReplayBufferSpanMs(const ReplayBuffer *buffer) {
+    if (buffer->count < 2)
+        return 0;
+    return ReplayBufferFrame(buffer, buffer->count - 1)->timeMs -
+           ReplayBufferFrame(buffer, 0)->timeMs;
+}
+
+void ReplayCursorInit(ReplayCursor *cursor, const ReplayBuffer *buffer) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->buffer = buffer;
+}
+
+static int GetVarint(const unsigned char **p, const unsigned char *end, unsigned int *value) {
+    unsigned int result = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+        if (*p == end)
+            return 0;
+        unsigned char byte = *(*p)++;
+        result |= (unsigned int)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void XorPixel(unsigned char *pixel, const unsigned char *value) {
+    pixel[0] ^= value[0];
+    pixel[1] ^= value[1];
+    pixel[2] ^= value[2];
+}
+
+static void GrowDirty(int *bounds, size_t start, size_t count, int width) {
+    int firstY = (int)(start / width);
+    int lastY = (int)((start + count - 1) / width);
+    int firstX = firstY == lastY ? (int)(start % width) : 0;
+    int lastX = firstY == lastY ? (int)((start + count - 1) % width) : width - 1;
+
+    if (firstX < bounds[0])
+        bounds[0] = firstX;
+    if (firstY < bounds[1])
+        bounds[1] = firstY;
+    if (lastX > bounds[2])
+        bounds[2] = lastX;
+    if (lastY > bounds[3])
+        bounds[3] = lastY;
+}
+
+static int ApplyFrame(ReplayCursor *cursor, const unsigned char *p, const unsigned char *end) {
+    size_t total = (size_t)cursor->width * cursor->height;
+    size_t pos = 0;
+    int bounds[4] = {cursor->width, cursor->height, -1, -1};
+
+    while (p < end) {
+        unsigned int header;
+        if (!GetVarint(&p, end, &header))
+            return 0;
+
+        size_t count = header >> 2;
+        int type = (int)(header & 3);
+        if (count == 0 || count > total - pos)
+            return 0;
+
+        unsigned char *pixel = cursor->pixels + pos * 4;
+        if (type == TOKEN_FILL) {
+            if (end - p < 3)
+                return 0;
+            for (size_t i = 0; i < count; i++, pixel += 4) {
+                XorPixel(pixel, p);
+            }
+            p += 3;
+        } else if (type == TOKEN_LITERAL) {
+            if ((size_t)(end - p) / 3 < count)
+                return 0;
+            for (size_t i = 0; i < count; i++, pixel += 4, p += 3) {
+                XorPixel(pixel, p);
+            }
+        } else if (type != TOKEN_SKIP) {
+            return 0;
+        }
+
+        if (type != TOKEN_SKIP)
+            GrowDirty(bounds, pos, count, cursor->width);
+        pos += count;
+    }
+    if (pos != total)
+        return 0;
+
+    cursor->dirtyX = bounds[0];
+    cursor->dirtyY = bounds[1];
+    cursor->dirtyWidth = bounds[2] >= bounds[0] ? bounds[2] - bounds[0] + 1 : 0;
+    cursor->dirtyHeight = bounds[3] >= bounds[1] ? bounds[3] - bounds[1] + 1 : 0;
+    return 1;
+}
+
+int ReplayCursorNext(ReplayCursor *cursor) {
+    const ReplayFrame *frame = ReplayBufferFrame(cursor->buffer, cursor->next);
+    if (!frame)
+        return 0;
+
+    size_t pixels = (size_t)frame->width * frame->height;
+    if (frame->keyframe) {
+        if (pixels > cursor->allocated) {
+            unsigned char *grown = (unsigned char *)realloc(cursor->pixels, pixels * 4);
+            if (!grown)
+                return 0;
+            cursor->pixels = grown;
+            cursor->allocated = pixels;
+        }
+        memset(cursor->pixels, 0, pixels * 4);
+        cursor->width = frame->width;
+        cursor->height = frame->height;
+    } else if (!cursor->pixels || frame->width != cursor->width ||
+               frame->height != cursor->height) {
+        return 0;
+    }
+
+    const unsigned char *data = cursor->buffer->data + frame->offset;
+    if (!ApplyFrame(cursor, data, data + frame->length))
+        return 0;
+
+    if (frame->keyframe) {
+        cursor->dirtyX = 0;
+        cursor->dirtyY = 0;
+        cursor->dirtyWidth = frame->width;
+        cursor->dirtyHeight = frame->height;
+    }
+    cursor->timeMs = frame->timeMs;
+    cursor->next++;
+    return 1;
+}
+
+void ReplayCursorRelease(ReplayCursor *cursor) {
+    free(cursor->pixels);
+    memset(cursor, 0, sizeof(*cursor));
+}
@@ -0,0 +1,99 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <stddef.h>
+
+/* Fixed-size history of recent frames for "save the last N seconds". Each frame is stored as
+ * the XOR against the frame before it, run-length coded, so an unchanged area costs next to
+ * nothing. Every keyInterval frames (and whenever the size changes) a keyframe is stored against
+ * black instead, and the oldest frames are dropped a whole keyframe group at a time so the
+ * remaining history always starts on a keyframe. Frames are 4-byte B,G,R,X pixels; X is not
+ * kept. Not thread-safe. */
+
+typedef struct {
+    int width;
+    int height;
+    unsigned long long timeMs;
+    int keyframe;
+    size_t offset; /* of the encoded frame in ReplayBuffer.data */
+    size_t length;
+} ReplayFrame;
+
+typedef struct {
+    unsigned char *data; /* encoded frames, used as a ring */
+    size_t capacity;
+    size_t head; /* where the next frame is stored */
+
+    ReplayFrame *frames; /* frameCapacity slots, oldest at index first */
+    int frameCapacity;
+    int first;
+    int count;
+    size_t used; /* bytes of encoded frames held */
+
+    int keyInterval;
+    int sinceKeyframe;
+    int needKeyframe; /* previous does not hold a stored frame, so no delta can be taken */
+    unsigned long long maxAgeMs;
+
+    /* Last stored frame, packed with X cleared, which the next delta is taken against. */
+    unsigned int *previous;
+    int previousWidth;
+    int previousHeight;
+    size_t previousPixels; /* allocated size of previous, in pixels */
+
+    unsigned char *scratch; /* one frame's worst-case encoding */
+    size_t scratchSize;
+
+    unsigned int dropped; /* frames that could not be stored at all */
+} ReplayBuffer;
+
+/* capacity bounds the encoded frames, maxFrames the frame count and maxAgeMs how far back the
+ * history reaches (0 for no limit). Returns 0 if allocation fails. */
+int ReplayBufferInit(ReplayBuffer *buffer, size_t capacity, int maxFrames, int keyInterval,
+    unsigned long long maxAgeMs);
+
+/* Appends a frame, dropping the oldest keyframe groups to make room. A stride of 0 means
+ * tightly packed rows. Returns 0 if the frame was not stored, either because it does not fit
+ * the buffer at all or allocation failed. */
+int ReplayBufferPush(ReplayBuffer *buffer, const unsigned char *pixels, int stride, int width,
+    int height, unsigned long long timeMs);
+
+/* Drops every frame but keeps the allocations. */
+void ReplayBufferClear(ReplayBuffer *buffer);
+
+void ReplayBufferRelease(ReplayBuffer *buffer);
+
+/* Frame index 0 is the oldest. */
+const ReplayFrame *ReplayBufferFrame(const ReplayBuffer *buffer, int index);
+
+/* Bytes of encoded frames currently held, not counting unused space at the end of the ring. */
+size_t ReplayBufferBytesUsed(const ReplayBuffer *buffer);
+
+/* Time between the oldest and newest frame. */
+unsigned long long ReplayBufferSpanMs(const ReplayBuffer *buffer);
+
+/* Decodes the history oldest first. Each step leaves the full frame in pixels (packed, X is 0)
+ * and the rectangle that changed since the previous step in dirty*. A keyframe reports the
+ * whole frame and a frame identical to the one before an empty rectangle. */
+typedef struct {
+    const ReplayBuffer *buffer;
+    int next;
+    unsigned char *pixels;
+    size_t allocated; /* in pixels */
+    int width;
+    int height;
+    unsigned long long timeMs;
+    int dirtyX;
+    int dirtyY;
+    int dirtyWidth;
+    int dirtyHeight;
+} ReplayCursor;
+
+void ReplayCursorInit(ReplayCursor *cursor, const ReplayBuffer *buffer);
+
+/* Returns 1 if a frame was decoded, 0 at the end of the history or on a corrupt frame. */
+int ReplayCursorNext(ReplayCursor *cursor);
+
+void ReplayCursorRelease(ReplayCursor *cursor);
+
+#endif
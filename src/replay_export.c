@@ -0,0 +1,71 @@
+#include "apng_writer.h"
+#include "replay_export.h"
+
+int ReplayExportApng(const ReplayBuffer *buffer, stbi_write_func *write, void *context,
+    const PngEncodeOptions *options, unsigned int lastDelayMs) {
+    const ReplayFrame *newest = ReplayBufferFrame(buffer, buffer->count - 1);
+    if (!newest)
+        return 0;
+
+    int width = newest->width, height = newest->height;
+    int frameCount = 0;
+    for (int i = 0; i < buffer->count; i++) {
+        const ReplayFrame *frame = ReplayBufferFrame(buffer, i);
+        if (frame->width == width && frame->height == height)
+            frameCount++;
+    }
+
+    PngEncodeOptions bgrx = {0};
+    if (options)
+        bgrx = *options;
+    bgrx.source = PNG_SOURCE_BGRX;
+
+    ApngWriter apng;
+    ApngBegin(&apng, write, context, width, height, 3, frameCount, &bgrx);
+
+    ReplayCursor cursor;
+    ReplayCursorInit(&cursor, buffer);
+    int written = 0;
+    while (ReplayCursorNext(&cursor)) {
+        if (cursor.width != width || cursor.height != height)
+            continue;
+
+        const ReplayFrame *next = ReplayBufferFrame(buffer, cursor.next);
+        unsigned int delayMs = next ? (unsigned int)(next->timeMs - cursor.timeMs) : lastDelayMs;
+
+        int x = cursor.dirtyX, y = cursor.dirtyY;
+        int w = cursor.dirtyWidth, h = cursor.dirtyHeight;
+        if (written == 0) {
+            x = y = 0;
+            w = width;
+            h = height;
+        } else if (w == 0) {
+            /* Nothing changed, but the frame still needs its own delay; redraw one pixel. */
+            x = y = 0;
+            w = h = 1;
+        }
+
+        const unsigned char *origin = cursor.pixels + ((size_t)y * width + x) * 4;
+        if (!ApngWriteFrame(&apng, origin, width * 4, x, y, w, h, delayMs))
+            break;
+        written++;
+    }
+    ReplayCursorRelease(&cursor);
+
+    return ApngEnd(&apng) ? written : 0;
+}
+
+int ReplayExportFrames(const ReplayBuffer *buffer, ReplayFrameFunc frame, void *context) {
+    ReplayCursor cursor;
+    ReplayCursorInit(&cursor, buffer);
+
+    int index = 0;
+    while (ReplayCursorNext(&cursor)) {
+        if (!frame(context, index, cursor.pixels, cursor.width, cursor.height, cursor.timeMs))
+            break;
+        index++;
+    }
+    ReplayCursorRelease(&cursor);
+
+    return index == buffer->count ? index : 0;
+}
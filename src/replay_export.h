@@ -0,0 +1,24 @@
+#ifndef REPLAY_EXPORT_H
+#define REPLAY_EXPORT_H
+
+#include "png_writer.h"
+#include "replay_buffer.h"
+
+/* Turns the replay history into files, decoding it oldest first. */
+
+/* Writes the history as an APNG. The canvas takes the newest frame's size and frames of any
+ * other size are left out. After the first frame only the rectangle that changed is encoded.
+ * lastDelayMs is how long the final frame shows. Returns the number of frames written, or 0 if
+ * the export failed. */
+int ReplayExportApng(const ReplayBuffer *buffer, stbi_write_func *write, void *context,
+    const PngEncodeOptions *options, unsigned int lastDelayMs);
+
+/* Receives one whole decoded frame as packed BGRX. Returns 0 to stop the export. */
+typedef int (*ReplayFrameFunc)(void *context, int index, const unsigned char *pixels,
+    int width, int height, unsigned long long timeMs);
+
+/* Hands every frame to frame in order. Returns the number of frames, or 0 if decoding failed
+ * or frame stopped the export. */
+int ReplayExportFrames(const ReplayBuffer *buffer, ReplayFrameFunc frame, void *context);
+
+#endif
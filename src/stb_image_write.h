@@ -26,6 +26,9 @@ BUILDING:
    You can #define STBIW_MALLOC(), STBIW_REALLOC(), and STBIW_FREE() to replace
    malloc,realloc,free.
    You can #define STBIW_MEMMOVE() to replace memmove()
+   You can #define STBIW_NO_SIMD to disable the SSE2 PNG filter path on x86/x64.
+   You can #define STBIW_CPU_HAS_AVX2() to an expression that is nonzero when the
+   running CPU and OS support AVX2, to also enable a 32-byte filter path on x64.
    You can #define STBIW_ZLIB_COMPRESS to use a custom zlib-style compress function
    for PNG compression (instead of the builtin one), it must have the following signature:
    unsigned char * my_compress(unsigned char *data, int data_len, int *out_len, int quality);
@@ -247,6 +250,23 @@ STBIWDEF void stbi_flip_vertically_on_write(int flip_boolean);
 
 #define STBIW_UCHAR(x) (unsigned char) ((x) & 0xff)
 
+// SSE2 is part of the x64 baseline, so no runtime check is needed there
+#if !defined(STBIW_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define STBIW_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is not part of the baseline; the runtime check is left to the includer
+#if defined(STBIW_SSE2) && defined(STBIW_CPU_HAS_AVX2) && (defined(__x86_64__) || defined(_M_X64))
+#define STBIW_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define STBIW_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define STBIW_AVX2_TARGET
+#endif
+#endif
+
 #ifdef STB_IMAGE_WRITE_STATIC
 static int stbi_write_png_compression_level = 8;
 static int stbi_write_tga_with_rle = 1;
@@ -890,14 +910,10 @@ static unsigned int stbiw__zhash(unsigned char *data)
 
 #define stbiw__ZHASH   16384
 
-#endif // STBIW_ZLIB_COMPRESS
-
-STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality)
+// when 'last' is 0 the stream is left open: no block has BFINAL set and the deflate data ends
+// with an empty stored block (a zlib sync flush), so another deflate stream can follow it
+static unsigned char * stbiw__zlib_compress_builtin(unsigned char *data, int data_len, int *out_len, int quality, int last)
 {
-#ifdef STBIW_ZLIB_COMPRESS
-   // user provided a zlib compress implementation, use that
-   return STBIW_ZLIB_COMPRESS(data, data_len, out_len, quality);
-#else // use builtin
    static unsigned short lengthc[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258, 259 };
    static unsigned char  lengtheb[]= { 0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0 };
    static unsigned short distc[]   = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577, 32768 };
@@ -912,7 +928,7 @@ STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, i
 
    stbiw__sbpush(out, 0x78);   // DEFLATE 32K window
    stbiw__sbpush(out, 0x5e);   // FLEVEL = 1
-   stbiw__zlib_add(1,1);  // BFINAL = 1
+   stbiw__zlib_add(last ? 1 : 0,1);  // BFINAL
    stbiw__zlib_add(1,2);  // BTYPE = 1 -- fixed huffman
 
    for (i=0; i < stbiw__ZHASH; ++i)
@@ -973,9 +989,19 @@ STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, i
    for (;i < data_len; ++i)
       stbiw__zlib_huffb(data[i]);
    stbiw__zlib_huff(256); // end of block
+   if (!last) {
+      stbiw__zlib_add(0,1);  // BFINAL = 0
+      stbiw__zlib_add(0,2);  // BTYPE = 0 -- empty stored block
+   }
    // pad with 0 bits to byte boundary
    while (bitcount)
       stbiw__zlib_add(0,1);
+   if (!last) {
+      stbiw__sbpush(out, 0x00); // LEN
+      stbiw__sbpush(out, 0x00);
+      stbiw__sbpush(out, 0xff); // NLEN
+      stbiw__sbpush(out, 0xff);
+   }
 
    for (i=0; i < stbiw__ZHASH; ++i)
       (void) stbiw__sbfree(hash_table[i]);
@@ -987,7 +1013,7 @@ STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, i
       for (j = 0; j < data_len;) {
          int blocklen = data_len - j;
          if (blocklen > 32767) blocklen = 32767;
-         stbiw__sbpush(out, data_len - j == blocklen); // BFINAL = ?, BTYPE = 0 -- no compression
+         stbiw__sbpush(out, last && data_len - j == blocklen); // BFINAL = ?, BTYPE = 0 -- no compression
          stbiw__sbpush(out, STBIW_UCHAR(blocklen)); // LEN
          stbiw__sbpush(out, STBIW_UCHAR(blocklen >> 8));
          stbiw__sbpush(out, STBIW_UCHAR(~blocklen)); // NLEN
@@ -1018,6 +1044,17 @@ STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, i
    // make returned pointer freeable
    STBIW_MEMMOVE(stbiw__sbraw(out), out, *out_len);
    return (unsigned char *) stbiw__sbraw(out);
+}
+
+#endif // STBIW_ZLIB_COMPRESS
+
+STBIWDEF unsigned char * stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality)
+{
+#ifdef STBIW_ZLIB_COMPRESS
+   // user provided a zlib compress implementation, use that
+   return STBIW_ZLIB_COMPRESS(data, data_len, out_len, quality);
+#else // use builtin
+   return stbiw__zlib_compress_builtin(data, data_len, out_len, quality, 1);
 #endif // STBIW_ZLIB_COMPRESS
 }
 
@@ -1088,20 +1125,216 @@ static unsigned char stbiw__paeth(int a, int b, int c)
    return STBIW_UCHAR(c);
 }
 
-// @OPTIMIZE: provide an option that always forces left-predict or paeth predict
-static void stbiw__encode_png_line(unsigned char *pixels, int stride_bytes, int width, int height, int y, int n, int filter_type, signed char *line_buffer)
+#ifdef STBIW_SSE2
+// accumulate sum of abs((signed char) v) into two 64-bit lanes
+static __m128i stbiw__sse2_abs_sum(__m128i v, __m128i acc)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i absv = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+   return _mm_add_epi64(acc, _mm_sad_epu8(absv, zero));
+}
+
+static int stbiw__sse2_acc_total(__m128i acc)
+{
+   return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+static __m128i stbiw__sse2_abs16(__m128i v)
+{
+   return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+static __m128i stbiw__sse2_select(__m128i mask, __m128i if_set, __m128i if_clear)
+{
+   return _mm_or_si128(_mm_and_si128(mask, if_set), _mm_andnot_si128(mask, if_clear));
+}
+
+// same decision as stbiw__paeth(), on 16-bit lanes; the encoder reads only source pixels,
+// so unlike decoding every lane is independent
+static __m128i stbiw__sse2_paeth16(__m128i a, __m128i b, __m128i c)
+{
+   __m128i bc = _mm_sub_epi16(b, c), ac = _mm_sub_epi16(a, c);
+   __m128i pa = stbiw__sse2_abs16(bc);
+   __m128i pb = stbiw__sse2_abs16(ac);
+   __m128i pc = stbiw__sse2_abs16(_mm_add_epi16(bc, ac));
+   __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+   __m128i b_or_c = stbiw__sse2_select(_mm_cmpgt_epi16(pb, pc), c, b);
+   return stbiw__sse2_select(not_a, b_or_c, a);
+}
+
+static __m128i stbiw__sse2_paeth(__m128i a, __m128i b, __m128i c)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i lo = stbiw__sse2_paeth16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+   __m128i hi = stbiw__sse2_paeth16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+   return _mm_packus_epi16(lo, hi);
+}
+
+// filters bytes [start, len) 16 at a time and adds their estimate to *est;
+// returns the index of the first byte left for the scalar loop
+static int stbiw__encode_png_span_sse2(unsigned char *z, int signed_stride, int n, int start, int len, int type, signed char *line_buffer, int *est)
+{
+   __m128i one = _mm_set1_epi8(1), low7 = _mm_set1_epi8(0x7f);
+   __m128i acc = _mm_setzero_si128();
+   int i;
+   for (i = start; i + 16 <= len; i += 16) {
+      __m128i cur = _mm_loadu_si128((const __m128i *) (z+i));
+      __m128i pred, a, b;
+      switch (type) {
+         case 1: case 6: // paeth(a,0,0) is always a
+            pred = _mm_loadu_si128((const __m128i *) (z+i-n));
+            break;
+         case 2:
+            pred = _mm_loadu_si128((const __m128i *) (z+i-signed_stride));
+            break;
+         case 3: // pavgb rounds up, the filter rounds down
+            a = _mm_loadu_si128((const __m128i *) (z+i-n));
+            b = _mm_loadu_si128((const __m128i *) (z+i-signed_stride));
+            pred = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            break;
+         case 4:
+            pred = stbiw__sse2_paeth(_mm_loadu_si128((const __m128i *) (z+i-n)),
+                                     _mm_loadu_si128((const __m128i *) (z+i-signed_stride)),
+                                     _mm_loadu_si128((const __m128i *) (z+i-signed_stride-n)));
+            break;
+         case 5:
+            a = _mm_loadu_si128((const __m128i *) (z+i-n));
+            pred = _mm_and_si128(_mm_srli_epi16(a, 1), low7);
+            break;
+         default:
+            return start;
+      }
+      cur = _mm_sub_epi8(cur, pred);
+      _mm_storeu_si128((__m128i *) (line_buffer+i), cur);
+      acc = stbiw__sse2_abs_sum(cur, acc);
+   }
+   *est += stbiw__sse2_acc_total(acc);
+   return i;
+}
+
+static int stbiw__sum_abs_sse2(signed char *line_buffer, int start, int len, int *est)
+{
+   __m128i acc = _mm_setzero_si128();
+   int i;
+   for (i = start; i + 16 <= len; i += 16)
+      acc = stbiw__sse2_abs_sum(_mm_loadu_si128((const __m128i *) (line_buffer+i)), acc);
+   *est += stbiw__sse2_acc_total(acc);
+   return i;
+}
+#endif // STBIW_SSE2
+
+#ifdef STBIW_AVX2
+// the SSE2 kernels above widened to 32 bytes; unpack and pack both work within 128-bit
+// lanes, so the paeth lanes come back in order
+static STBIW_AVX2_TARGET __m256i stbiw__avx2_abs_sum(__m256i v, __m256i acc)
+{
+   __m256i zero = _mm256_setzero_si256();
+   __m256i absv = _mm256_min_epu8(v, _mm256_sub_epi8(zero, v));
+   return _mm256_add_epi64(acc, _mm256_sad_epu8(absv, zero));
+}
+
+static STBIW_AVX2_TARGET int stbiw__avx2_acc_total(__m256i acc)
+{
+   __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+   return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+
+static STBIW_AVX2_TARGET __m256i stbiw__avx2_paeth16(__m256i a, __m256i b, __m256i c)
+{
+   __m256i bc = _mm256_sub_epi16(b, c), ac = _mm256_sub_epi16(a, c);
+   __m256i pa = _mm256_abs_epi16(bc);
+   __m256i pb = _mm256_abs_epi16(ac);
+   __m256i pc = _mm256_abs_epi16(_mm256_add_epi16(bc, ac));
+   __m256i not_a = _mm256_or_si256(_mm256_cmpgt_epi16(pa, pb), _mm256_cmpgt_epi16(pa, pc));
+   __m256i b_or_c = _mm256_blendv_epi8(b, c, _mm256_cmpgt_epi16(pb, pc));
+   return _mm256_blendv_epi8(a, b_or_c, not_a);
+}
+
+static STBIW_AVX2_TARGET __m256i stbiw__avx2_paeth(__m256i a, __m256i b, __m256i c)
+{
+   __m256i zero = _mm256_setzero_si256();
+   __m256i lo = stbiw__avx2_paeth16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(c, zero));
+   __m256i hi = stbiw__avx2_paeth16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(c, zero));
+   return _mm256_packus_epi16(lo, hi);
+}
+
+// filters bytes [n, len) 32 at a time; same contract as stbiw__encode_png_span_sse2
+static STBIW_AVX2_TARGET int stbiw__encode_png_span_avx2(unsigned char *z, int signed_stride, int n, int len, int type, signed char *line_buffer, int *est)
+{
+   __m256i one = _mm256_set1_epi8(1), low7 = _mm256_set1_epi8(0x7f);
+   __m256i acc = _mm256_setzero_si256();
+   int i;
+   for (i = n; i + 32 <= len; i += 32) {
+      __m256i cur = _mm256_loadu_si256((const __m256i *) (z+i));
+      __m256i pred, a, b;
+      switch (type) {
+         case 1: case 6:
+            pred = _mm256_loadu_si256((const __m256i *) (z+i-n));
+            break;
+         case 2:
+            pred = _mm256_loadu_si256((const __m256i *) (z+i-signed_stride));
+            break;
+         case 3:
+            a = _mm256_loadu_si256((const __m256i *) (z+i-n));
+            b = _mm256_loadu_si256((const __m256i *) (z+i-signed_stride));
+            pred = _mm256_sub_epi8(_mm256_avg_epu8(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), one));
+            break;
+         case 4:
+            pred = stbiw__avx2_paeth(_mm256_loadu_si256((const __m256i *) (z+i-n)),
+                                     _mm256_loadu_si256((const __m256i *) (z+i-signed_stride)),
+                                     _mm256_loadu_si256((const __m256i *) (z+i-signed_stride-n)));
+            break;
+         case 5:
+            a = _mm256_loadu_si256((const __m256i *) (z+i-n));
+            pred = _mm256_and_si256(_mm256_srli_epi16(a, 1), low7);
+            break;
+         default:
+            return n;
+      }
+      cur = _mm256_sub_epi8(cur, pred);
+      _mm256_storeu_si256((__m256i *) (line_buffer+i), cur);
+      acc = stbiw__avx2_abs_sum(cur, acc);
+   }
+   *est += stbiw__avx2_acc_total(acc);
+   return i;
+}
+
+static STBIW_AVX2_TARGET int stbiw__sum_abs_avx2(signed char *line_buffer, int len, int *est)
+{
+   __m256i acc = _mm256_setzero_si256();
+   int i;
+   for (i = 0; i + 32 <= len; i += 32)
+      acc = stbiw__avx2_abs_sum(_mm256_loadu_si256((const __m256i *) (line_buffer+i)), acc);
+   *est += stbiw__avx2_acc_total(acc);
+   return i;
+}
+#endif // STBIW_AVX2
+
+// filters one line into line_buffer and returns the filter-selection estimate for it
+// (the sum of the filtered bytes as signed values), computed in the same pass
+static int stbiw__encode_png_line(unsigned char *pixels, int stride_bytes, int width, int height, int y, int n, int filter_type, signed char *line_buffer)
 {
    static int mapping[] = { 0,1,2,3,4 };
    static int firstmap[] = { 0,1,0,5,6 };
    int *mymap = (y != 0) ? mapping : firstmap;
-   int i;
+   int i, len = width*n, vec_end = n, est = 0;
    int type = mymap[filter_type];
    unsigned char *z = pixels + stride_bytes * (stbi__flip_vertically_on_write ? height-1-y : y);
    int signed_stride = stbi__flip_vertically_on_write ? -stride_bytes : stride_bytes;
 
    if (type==0) {
-      memcpy(line_buffer, z, width*n);
-      return;
+      memcpy(line_buffer, z, len);
+      i = 0;
+#ifdef STBIW_AVX2
+      if (STBIW_CPU_HAS_AVX2())
+         i = stbiw__sum_abs_avx2(line_buffer, len, &est);
+#endif
+#ifdef STBIW_SSE2
+      i = stbiw__sum_abs_sse2(line_buffer, i, len, &est);
+#endif
+      for (; i < len; ++i)
+         est += abs(line_buffer[i]);
+      return est;
    }
 
    // first loop isn't optimized since it's just one pixel
@@ -1114,15 +1347,26 @@ static void stbiw__encode_png_line(unsigned char *pixels, int stride_bytes, int
          case 5: line_buffer[i] = z[i]; break;
          case 6: line_buffer[i] = z[i]; break;
       }
+      est += abs(line_buffer[i]);
    }
+#ifdef STBIW_AVX2
+   if (STBIW_CPU_HAS_AVX2())
+      vec_end = stbiw__encode_png_span_avx2(z, signed_stride, n, len, type, line_buffer, &est);
+#endif
+#ifdef STBIW_SSE2
+   vec_end = stbiw__encode_png_span_sse2(z, signed_stride, n, vec_end, len, type, line_buffer, &est);
+#endif
    switch (type) {
-      case 1: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - z[i-n]; break;
-      case 2: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - z[i-signed_stride]; break;
-      case 3: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - ((z[i-n] + z[i-signed_stride])>>1); break;
-      case 4: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i-n], z[i-signed_stride], z[i-signed_stride-n]); break;
-      case 5: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - (z[i-n]>>1); break;
-      case 6: for (i=n; i < width*n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i-n], 0,0); break;
+      case 1: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - z[i-n]; break;
+      case 2: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - z[i-signed_stride]; break;
+      case 3: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - ((z[i-n] + z[i-signed_stride])>>1); break;
+      case 4: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i-n], z[i-signed_stride], z[i-signed_stride-n]); break;
+      case 5: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - (z[i-n]>>1); break;
+      case 6: for (i=vec_end; i < len; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i-n], 0,0); break;
    }
+   for (i=vec_end; i < len; ++i)
+      est += abs(line_buffer[i]);
+   return est;
 }
 
 STBIWDEF unsigned char *stbi_write_png_to_mem(const unsigned char *pixels, int stride_bytes, int x, int y, int n, int *out_len)
@@ -1149,15 +1393,10 @@ STBIWDEF unsigned char *stbi_write_png_to_mem(const unsigned char *pixels, int s
          filter_type = force_filter;
          stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, force_filter, line_buffer);
       } else { // Estimate the best filter by running through all of them:
-         int best_filter = 0, best_filter_val = 0x7fffffff, est, i;
+         int best_filter = 0, best_filter_val = 0x7fffffff, est;
          for (filter_type = 0; filter_type < 5; filter_type++) {
-            stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, filter_type, line_buffer);
-
             // Estimate the entropy of the line using this filter; the less, the better.
-            est = 0;
-            for (i = 0; i < x*n; ++i) {
-               est += abs((signed char) line_buffer[i]);
-            }
+            est = stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, filter_type, line_buffer);
             if (est < best_filter_val) {
                best_filter_val = est;
                best_filter = filter_type;
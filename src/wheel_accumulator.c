@@ -0,0 +1,106 @@
+#include "wheel_accumulator.h"
+
+#include <string.h>
+
+#define WHEEL_STEP_SCALE (WHEEL_NOTCH * 100LL)
+#define WHEEL_IDLE_MS 1000 /* a pause this long starts a new gesture at normal speed */
+
+void WheelAccumulatorInit(WheelAccumulator *wheel, const WheelSettings *settings) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->settings = *settings;
+    wheel->gapPerNotchMs = WHEEL_IDLE_MS;
+}
+
+void WheelAccumulatorConfigure(WheelAccumulator *wheel, const WheelSettings *settings) {
+    wheel->settings = *settings;
+    wheel->remainder = 0;
+    wheel->pendingSteps = 0;
+    wheel->gapPerNotchMs = WHEEL_IDLE_MS;
+}
+
+static int MultiplierPercent(const WheelAccumulator *wheel) {
+    const WheelSettings *s = &wheel->settings;
+    if (s->accelerationPercent <= 0)
+        return 100;
+
+    unsigned int gap = wheel->gapPerNotchMs ? wheel->gapPerNotchMs : 1;
+    long long excess = 100000LL / gap - s->accelStartRate * 100LL; /* notches/s, scaled by 100 */
+    if (excess <= 0)
+        return 100;
+
+    long long percent = 100 + s->accelerationPercent * excess / 100;
+    return percent > WHEEL_MAX_MULTIPLIER_PERCENT ? WHEEL_MAX_MULTIPLIER_PERCENT : (int)percent;
+}
+
+/* Exponentially smoothed time per notch, so one burst of events landing in the same clock tick
+ * does not jump straight to full acceleration. */
+static void UpdateSpeed(WheelAccumulator *wheel, int delta, unsigned long long nowMs) {
+    unsigned long long elapsed = nowMs - wheel->lastEventMs;
+    if (wheel->events == 1 || nowMs < wheel->lastEventMs || elapsed >= WHEEL_IDLE_MS) {
+        wheel->gapPerNotchMs = WHEEL_IDLE_MS;
+        return;
+    }
+
+    unsigned int units = (unsigned int)(delta < 0 ? -delta : delta);
+    unsigned long long gap = units ? elapsed * WHEEL_NOTCH / units : WHEEL_IDLE_MS;
+    if (gap > WHEEL_IDLE_MS)
+        gap = WHEEL_IDLE_MS;
+    wheel->gapPerNotchMs = (unsigned int)((wheel->gapPerNotchMs * 3ULL + gap + 2) / 4);
+}
+
+static int Release(WheelAccumulator *wheel, unsigned long long nowMs) {
+    int steps = wheel->pendingSteps;
+    wheel->pendingSteps = 0;
+    wheel->lastFlushMs = nowMs;
+    wheel->flushed = 1;
+    wheel->flushes++;
+    wheel->steps += (unsigned int)(steps < 0 ? -steps : steps);
+    return steps;
+}
+
+int WheelAccumulatorReverses(const WheelAccumulator *wheel, int delta) {
+    return (delta < 0 && wheel->pendingSteps > 0) || (delta > 0 && wheel->pendingSteps < 0);
+}
+
+int WheelAccumulatorAdd(WheelAccumulator *wheel, int delta, unsigned long long nowMs) {
+    wheel->events++;
+    UpdateSpeed(wheel, delta, nowMs);
+    wheel->lastEventMs = nowMs;
+
+    /* Turning back drops the partial step in the old direction, so it responds at once. */
+    if ((delta < 0 && wheel->remainder > 0) || (delta > 0 && wheel->remainder < 0))
+        wheel->remainder = 0;
+
+    wheel->remainder +=
+        (long long)delta * wheel->settings.stepsPerNotch * MultiplierPercent(wheel);
+    long long whole = wheel->remainder / WHEEL_STEP_SCALE;
+    wheel->remainder -= whole * WHEEL_STEP_SCALE;
+    wheel->pendingSteps += (int)whole;
+
+    return WheelAccumulatorFlush(wheel, nowMs);
+}
+
+int WheelAccumulatorDueIn(const WheelAccumulator *wheel, unsigned long long nowMs) {
+    if (wheel->pendingSteps == 0)
+        return -1;
+    if (!wheel->flushed || nowMs < wheel->lastFlushMs)
+        return 0;
+
+    unsigned long long elapsed = nowMs - wheel->lastFlushMs;
+    return elapsed >= wheel->settings.intervalMs
+               ? 0
+               : (int)(wheel->settings.intervalMs - elapsed);
+}
+
+int WheelAccumulatorFlush(WheelAccumulator *wheel, unsigned long long nowMs) {
+    if (WheelAccumulatorDueIn(wheel, nowMs) != 0)
+        return 0;
+    return Release(wheel, nowMs);
+}
+
+int WheelAccumulatorTake(WheelAccumulator *wheel, unsigned long long nowMs) {
+    wheel->remainder = 0;
+    if (wheel->pendingSteps == 0)
+        return 0;
+    return Release(wheel, nowMs);
+}
@@ -0,0 +1,57 @@
+#ifndef WHEEL_ACCUMULATOR_H
+#define WHEEL_ACCUMULATOR_H
+
+/* Turns a stream of wheel deltas into action steps. Deltas are summed and released as whole
+ * steps at most once per interval, so a free-spinning or high-resolution wheel produces a few
+ * batched flushes instead of one action per event. Scrolling faster than accelStartRate
+ * notches per second multiplies the steps. Times are caller-supplied milliseconds. */
+
+#define WHEEL_NOTCH 120 /* WHEEL_DELTA: one detent of a standard wheel */
+#define WHEEL_MAX_MULTIPLIER_PERCENT 1000
+
+typedef struct {
+    int stepsPerNotch;
+    unsigned int intervalMs;   /* minimum time between flushes; 0 flushes on every event */
+    int accelStartRate;        /* notches per second where acceleration starts */
+    int accelerationPercent;   /* extra steps per notch/s above accelStartRate, in percent */
+} WheelSettings;
+
+typedef struct {
+    WheelSettings settings;
+    long long remainder;       /* fraction of a step, scaled by WHEEL_NOTCH * 100 */
+    int pendingSteps;          /* whole steps held back by the interval; signed */
+    unsigned long long lastEventMs;
+    unsigned long long lastFlushMs;
+    unsigned int gapPerNotchMs; /* smoothed time between notches */
+    int flushed;               /* nonzero once lastFlushMs is valid */
+
+    unsigned int events;
+    unsigned int flushes;
+    unsigned int steps;
+} WheelAccumulator;
+
+void WheelAccumulatorInit(WheelAccumulator *wheel, const WheelSettings *settings);
+
+/* Changes the settings and drops anything pending, keeping the counters. */
+void WheelAccumulatorConfigure(WheelAccumulator *wheel, const WheelSettings *settings);
+
+/* Nonzero if delta turns against steps still held back. Adding it would net the two directions
+ * out, so unless they run inverse actions the caller takes the held-back steps first. */
+int WheelAccumulatorReverses(const WheelAccumulator *wheel, int delta);
+
+/* Adds a delta (positive is away from the user). Returns the signed steps to run now, or 0 if
+ * they are held back until WheelAccumulatorFlush. */
+int WheelAccumulatorAdd(WheelAccumulator *wheel, int delta, unsigned long long nowMs);
+
+/* Milliseconds until held-back steps may be flushed, 0 if they may go now, or -1 if nothing is
+ * held back. */
+int WheelAccumulatorDueIn(const WheelAccumulator *wheel, unsigned long long nowMs);
+
+/* Returns the held-back steps if the interval has passed, otherwise 0. */
+int WheelAccumulatorFlush(WheelAccumulator *wheel, unsigned long long nowMs);
+
+/* Returns the held-back steps regardless of the interval and drops any partial step, for when
+ * the steps would otherwise go to a different action or be cancelled by a reversal. */
+int WheelAccumulatorTake(WheelAccumulator *wheel, unsigned long long nowMs);
+
+#endif
@@ -0,0 +1,62 @@
+#include <malloc.h>
+#include <stddef.h>
+#include "harness.h"
+
+/* Linked into the benchmark runner with -Wl,--wrap for each function, so every allocation made
+ * by the modules under test is counted without changing them. */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static BenchAllocs counters;
+static unsigned long long liveBytes;
+
+static void *Counted(void *ptr) {
+    if (ptr) {
+        size_t size = malloc_usable_size(ptr);
+        counters.allocs++;
+        counters.bytes += size;
+        liveBytes += size;
+        if (liveBytes > counters.peakBytes)
+            counters.peakBytes = liveBytes;
+    }
+    return ptr;
+}
+
+static void Released(void *ptr) {
+    if (ptr) {
+        size_t size = malloc_usable_size(ptr);
+        liveBytes = liveBytes > size ? liveBytes - size : 0;
+    }
+}
+
+void *__wrap_malloc(size_t size) {
+    return Counted(__real_malloc(size));
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    return Counted(__real_calloc(count, size));
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    Released(ptr);
+    return Counted(__real_realloc(ptr, size));
+}
+
+void __wrap_free(void *ptr) {
+    Released(ptr);
+    __real_free(ptr);
+}
+
+void BenchResetAllocs(void) {
+    counters.allocs = 0;
+    counters.bytes = 0;
+    counters.peakBytes = 0;
+    liveBytes = 0;
+}
+
+BenchAllocs BenchReadAllocs(void) {
+    return counters;
+}
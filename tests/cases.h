@@ -0,0 +1,70 @@
+#ifndef CASES_H
+#define CASES_H
+
+/* Every test and benchmark case; run_tests.c and run_bench.c list them. */
+
+void TestDispatchTable(void);
+void TestDispatchMatchesLinearScan(void);
+void TestModifierStates(void);
+void TestModifierTracker(void);
+void TestHookEngineWinRelease(void);
+void TestActionQueueBasics(void);
+void TestActionQueueStress(void);
+void TestPngFilterCorpus(void);
+void TestChecksumKnownValues(void);
+void TestChecksumLengthsAndAlignment(void);
+void TestChecksumLargeInputs(void);
+void TestChecksumSplits(void);
+void TestClipboardCacheDib(void);
+void TestClipboardCacheRenderOnDemand(void);
+void TestClipboardCacheRaces(void);
+void TestClipboardCacheFileAndEdges(void);
+void TestPngStreamMatchesInMemory(void);
+void TestPngStreamErrors(void);
+void TestQoiRoundTrip(void);
+void TestReplayCodecRoundTrip(void);
+void TestReplayRingEviction(void);
+void TestReplayMaxAge(void);
+void TestReplayCorruptFrames(void);
+void TestReplayExportApng(void);
+void TestWheelAccumulatorBatching(void);
+void TestWheelReversal(void);
+void TestWheelRepeatLimit(void);
+void TestConfigCompile(void);
+void TestConfigNames(void);
+void TestArena(void);
+void TestConfigDecoderMatchesTree(void);
+void TestConfigCache(void);
+void TestCjsonIndex(void);
+void TestCjsonSimdMatchesScalar(void);
+void TestTraceRecordReplay(void);
+void TestHistogramBuckets(void);
+void TestHistogramPercentiles(void);
+void TestLogBufferBasics(void);
+void TestLogBufferStress(void);
+void TestInputBatchOrdering(void);
+void TestInputBatchLimits(void);
+void TestInputBatchCounters(void);
+void TestFrameBufferReuse(void);
+void TestFrameBufferCreateFailure(void);
+void TestFrameBufferView(void);
+void TestPixelConvertMatchesPortable(void);
+
+void BenchDispatch(void);
+void BenchChecksum(void);
+void BenchScreenshotFormats(void);
+void BenchReplayHistory(void);
+void BenchTraceReplay(void);
+void BenchConfigNames(void);
+void BenchConfigParse(void);
+void BenchConfigScaling(void);
+void BenchCjsonIndex(void);
+void BenchHistogram(void);
+void BenchLogBuffer(void);
+void BenchPixelConvert(void);
+void BenchConfigCache(void);
+void BenchPngThreads(void);
+void BenchDeflate(void);
+void BenchPngFilter(void);
+
+#endif
@@ -0,0 +1,303 @@
+#include "config_gen.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_names.h"
+#include "harness.h"
+
+#define NAME_ONLY(name, ...) name,
+#define KEY_NAME(name, vk) "key_" name,
+
+static const char *const modifierNames[] = {CONFIG_MODIFIER_NAMES(NAME_ONLY)};
+static const char *const actionNames[] = {CONFIG_ACTION_NAMES(NAME_ONLY)};
+static const char *const triggerNames[] = {
+    CONFIG_MOUSE_TRIGGER_NAMES(NAME_ONLY) CONFIG_KEY_NAMES(KEY_NAME)};
+static const char *const modifierKeys[] = {"ctrl", "shift", "alt", "win"};
+
+const char sessionConfig[] =
+    "{\n"
+    "  \"bindings\": [\n"
+    "    { \"win\": \"left\", \"trigger\": \"wheel_up\", \"action\": \"volume_up\" },\n"
+    "    { \"win\": \"left\", \"trigger\": \"wheel_down\", \"action\": \"volume_down\" },\n"
+    "    { \"win\": \"left\", \"trigger\": \"mouse_x2\", \"action\": \"next_track\" },\n"
+    "    { \"win\": \"left\", \"trigger\": \"mouse_x1\", \"action\": \"prev_track\" },\n"
+    "    { \"win\": \"left\", \"trigger\": \"mouse_middle\", \"action\": \"play_pause\" },\n"
+    "    { \"win\": \"left\", \"shift\": \"left\", \"trigger\": \"key_printscreen\","
+    " \"action\": \"screenshot_client_clipboard\" },\n"
+    "    { \"ctrl\": \"either\", \"alt\": \"left\", \"trigger\": \"key_m\","
+    " \"action\": \"volume_mute\" },\n"
+    "    { \"ctrl\": \"right\", \"trigger\": \"key_f9\", \"action\": \"replay_save_apng\" }\n"
+    "  ]\n"
+    "}\n";
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} Text;
+
+static void Append(Text *text, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0 || text->failed) {
+        text->failed = 1;
+        return;
+    }
+
+    if (text->length + (size_t)needed + 1 > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 1024;
+        while (text->length + (size_t)needed + 1 > capacity)
+            capacity *= 2;
+        char *data = (char *)realloc(text->data, capacity);
+        if (!data) {
+            text->failed = 1;
+            return;
+        }
+        text->data = data;
+        text->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+    va_end(args);
+    text->length += (size_t)needed;
+}
+
+static void AppendNote(Text *text, int depth, int level, unsigned int *seed) {
+    if (level == depth) {
+        Append(text, "\"cycle \\\"%u\\\" \\u00e9\\t%u\"", HarnessRandom(seed) % 1000,
+            HarnessRandom(seed) % 100);
+    } else if (level % 2 == 0) {
+        Append(text, "{\"level\": %d, \"next\": ", level);
+        AppendNote(text, depth, level + 1, seed);
+        Append(text, "}");
+    } else {
+        Append(text, "[%d.5, true, null, ", level);
+        AppendNote(text, depth, level + 1, seed);
+        Append(text, "]");
+    }
+}
+
+char *GenerateConfig(size_t minBytes, int depth, unsigned int seed, size_t *length) {
+    Text text = {0};
+    Append(&text, "{\n"
+                  "  \"input_batch\": %u,\n"
+                  "  \"wheel\": { \"step\": %u, \"interval_ms\": 40, \"acceleration\": 0 },\n"
+                  "  \"replay\": { \"fps\": 10, \"seconds\": 30, \"memory_mb\": 256 },\n"
+                  "  \"bindings\": [",
+        16 + HarnessRandom(&seed) % 100, 1 + HarnessRandom(&seed) % 3);
+
+    int count = 0;
+    do {
+        Append(&text, "%s\n    {", count ? "," : "");
+        for (int m = 0; m < COUNT(modifierKeys); m++) {
+            unsigned int r = HarnessRandom(&seed);
+            if (r % 3 == 0)
+                Append(&text, " \"%s\": \"%s\",", modifierKeys[m],
+                    modifierNames[(r >> 2) % COUNT(modifierNames)]);
+        }
+        Append(&text, " \"trigger\": \"%s\", \"action\": \"%s\"",
+            triggerNames[HarnessRandom(&seed) % COUNT(triggerNames)],
+            actionNames[HarnessRandom(&seed) % COUNT(actionNames)]);
+        if (depth > 0) {
+            Append(&text, ",\n      \"note\": ");
+            AppendNote(&text, depth, 0, &seed);
+        }
+        Append(&text, " }");
+        count++;
+    } while (text.length < minBytes && !text.failed);
+    Append(&text, "\n  ]\n}\n");
+
+    if (text.failed) {
+        free(text.data);
+        return NULL;
+    }
+    *length = text.length;
+    return text.data;
+}
+
+/* Spells name the way a hand edit might: as is, capitalized, all caps or with its first
+ * letter as a \u escape. Only the exact spelling is a valid keyword value, but member names
+ * match in any case. */
+static void AppendSpelling(Text *text, const char *name, unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed) % 16;
+    Append(text, "\"");
+    for (const char *p = name; *p; p++) {
+        char c = *p;
+        if (p == name && r == 0)
+            Append(text, "\\u%04x", (unsigned char)c);
+        else if ((r == 1 && p == name) || r == 2)
+            Append(text, "%c", c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+        else
+            Append(text, "%c", c);
+    }
+    Append(text, "\"");
+}
+
+static void AppendJunk(Text *text, int depth, unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed) % 8;
+    if (depth <= 0 || r < 4) {
+        static const char *const scalars[] = {"0", "-1.5e2", "true", "false", "null", "\"\"",
+            "\"x\\n\\\"y\\\"\"", "1e400"};
+        Append(text, "%s", scalars[HarnessRandom(seed) % COUNT(scalars)]);
+    } else if (r < 6) {
+        Append(text, "[");
+        int count = (int)(HarnessRandom(seed) % 3);
+        for (int i = 0; i < count; i++) {
+            Append(text, i ? ", " : "");
+            AppendJunk(text, depth - 1, seed);
+        }
+        Append(text, "]");
+    } else {
+        Append(text, "{");
+        int count = (int)(HarnessRandom(seed) % 3);
+        for (int i = 0; i < count; i++) {
+            Append(text, "%s\"k%d\": ", i ? ", " : "", i);
+            AppendJunk(text, depth - 1, seed);
+        }
+        Append(text, "}");
+    }
+}
+
+static void AppendLongString(Text *text, unsigned int *seed) {
+    Append(text, "\"");
+    int length = 250 + (int)(HarnessRandom(seed) % 300);
+    for (int i = 0; i < length; i++)
+        Append(text, "%c", 'a' + (int)(HarnessRandom(seed) % 26));
+    Append(text, "\"");
+}
+
+/* A value for a binding member that expects one of names. */
+static void AppendKeywordValue(Text *text, const char *const *names, int count,
+    unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed) % 20;
+    if (r < 14)
+        AppendSpelling(text, names[HarnessRandom(seed) % (unsigned int)count], seed);
+    else if (r == 14)
+        Append(text, "\"key_0x%X\"", HarnessRandom(seed) % 300);
+    else if (r == 15)
+        Append(text, "\"key_%u\"", HarnessRandom(seed) % 300);
+    else if (r == 16)
+        AppendLongString(text, seed);
+    else if (r == 17)
+        Append(text, "\"nonsense\"");
+    else
+        AppendJunk(text, 2, seed);
+}
+
+static void AppendMessyBinding(Text *text, unsigned int *seed) {
+    static const char *const members[] = {"ctrl", "shift", "alt", "win", "trigger", "action",
+        "trigger", "action", "note"};
+    unsigned int r = HarnessRandom(seed) % 16;
+    if (r == 0) {
+        AppendJunk(text, 2, seed);
+        return;
+    }
+
+    Append(text, "{");
+    int count = (int)(HarnessRandom(seed) % 8);
+    for (int i = 0; i < count; i++) {
+        const char *member = members[HarnessRandom(seed) % COUNT(members)];
+        Append(text, i ? ", " : " ");
+        AppendSpelling(text, member, seed);
+        Append(text, ": ");
+        if (strcmp(member, "trigger") == 0)
+            AppendKeywordValue(text, triggerNames, COUNT(triggerNames), seed);
+        else if (strcmp(member, "action") == 0)
+            AppendKeywordValue(text, actionNames, COUNT(actionNames), seed);
+        else if (strcmp(member, "note") == 0)
+            AppendJunk(text, 3, seed);
+        else
+            AppendKeywordValue(text, modifierNames, COUNT(modifierNames), seed);
+    }
+    Append(text, " }");
+}
+
+static void AppendNumberOrJunk(Text *text, int min, int max, unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed) % 8;
+    if (r < 5)
+        Append(text, "%d", min - 2 + (int)(HarnessRandom(seed) % (unsigned int)(max - min + 5)));
+    else if (r == 5)
+        Append(text, "%d.5", min + (int)(HarnessRandom(seed) % (unsigned int)(max - min + 1)));
+    else
+        AppendJunk(text, 1, seed);
+}
+
+static void AppendSettings(Text *text, const char *const *names, int count, int max,
+    unsigned int *seed) {
+    if (HarnessRandom(seed) % 6 == 0) {
+        AppendJunk(text, 2, seed);
+        return;
+    }
+    Append(text, "{");
+    int members = (int)(HarnessRandom(seed) % (unsigned int)(count + 2));
+    for (int i = 0; i < members; i++) {
+        Append(text, i ? ", " : " ");
+        AppendSpelling(text, names[HarnessRandom(seed) % (unsigned int)count], seed);
+        Append(text, ": ");
+        AppendNumberOrJunk(text, 0, max, seed);
+    }
+    Append(text, " }");
+}
+
+char *GenerateMessyConfig(unsigned int seed, size_t *length) {
+    static const char *const rootMembers[] = {"bindings", "input_batch", "wheel", "replay",
+        "bindings", "extra"};
+    static const char *const wheelMembers[] = {"step", "interval_ms", "acceleration",
+        "acceleration_start"};
+    static const char *const replayMembers[] = {"fps", "seconds", "memory_mb"};
+
+    Text text = {0};
+    unsigned int shape = HarnessRandom(&seed) % 32;
+    if (shape == 0) {
+        AppendJunk(&text, 3, &seed);
+    } else {
+        Append(&text, "{");
+        int members = 1 + (int)(HarnessRandom(&seed) % 6);
+        for (int i = 0; i < members; i++) {
+            const char *member = rootMembers[HarnessRandom(&seed) % COUNT(rootMembers)];
+            Append(&text, "%s\n  ", i ? "," : "");
+            AppendSpelling(&text, member, &seed);
+            Append(&text, ": ");
+            if (strcmp(member, "bindings") == 0 && HarnessRandom(&seed) % 8 != 0) {
+                int bindings = (int)(HarnessRandom(&seed) % 12);
+                if (HarnessRandom(&seed) % 8 == 0)
+                    bindings += 60;
+                Append(&text, "[");
+                for (int b = 0; b < bindings; b++) {
+                    Append(&text, "%s\n    ", b ? "," : "");
+                    AppendMessyBinding(&text, &seed);
+                }
+                Append(&text, "\n  ]");
+            } else if (strcmp(member, "input_batch") == 0) {
+                AppendNumberOrJunk(&text, 2, 128, &seed);
+            } else if (strcmp(member, "wheel") == 0) {
+                AppendSettings(&text, wheelMembers, COUNT(wheelMembers), 1000, &seed);
+            } else if (strcmp(member, "replay") == 0) {
+                AppendSettings(&text, replayMembers, COUNT(replayMembers), 700, &seed);
+            } else {
+                AppendJunk(&text, 4, &seed);
+            }
+        }
+        Append(&text, "\n}\n");
+    }
+
+    if (text.failed) {
+        free(text.data);
+        return NULL;
+    }
+    /* Cut short now and then; the NUL moves with it. */
+    if (HarnessRandom(&seed) % 16 == 0 && text.length > 1) {
+        text.length = HarnessRandom(&seed) % text.length;
+        text.data[text.length] = '\0';
+    }
+    *length = text.length;
+    return text.data;
+}
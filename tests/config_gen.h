@@ -0,0 +1,27 @@
+#ifndef CONFIG_GEN_H
+#define CONFIG_GEN_H
+
+#include <stddef.h>
+
+/* Synthetic config.json documents for the parser tests and benchmarks, built from the keyword
+ * lists in config_names.h. */
+
+/* A pretty-printed config like a user would write: wheel and replay settings, then bindings
+ * with random modifiers, triggers and actions until the text is at least minBytes long (at
+ * least one binding). With depth > 0 every binding also carries a "note" that nests objects and
+ * arrays depth levels deep, which the decoder has to skip. Returns a NUL-terminated string to
+ * free with free, or NULL if out of memory. */
+char *GenerateConfig(size_t minBytes, int depth, unsigned int seed, size_t *length);
+
+/* A config that goes wrong in the ways hand-edited ones do, for checking that two decoders
+ * agree: members shuffled, repeated or in another case, values of the wrong type, unknown or
+ * nested members, elements of "bindings" that are not objects, more bindings than fit, \u
+ * escapes, strings longer than any scratch buffer, and now and then a document cut short or a
+ * root that is not an object. Returns a NUL-terminated string to free with free. */
+char *GenerateMessyConfig(unsigned int seed, size_t *length);
+
+/* The app's default bindings plus a few that exercise Ctrl, Alt and "either", for the tests
+ * that need one known config. */
+extern const char sessionConfig[];
+
+#endif
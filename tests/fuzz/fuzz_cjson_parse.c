@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+/* cJSON_ParseWithLength on any bytes, which need not end in a NUL. The event parser has to
+ * accept exactly what the tree parser does, and a tree that parses has to print, and printing
+ * what that parses back to has to give the same text (numbers out of range print as null, so
+ * the first round can change the tree). */
+
+static const cJSON_Events noEvents = {NULL, NULL, NULL, NULL, NULL};
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    cJSON *tree = cJSON_ParseWithLength((const char *)data, size);
+    if ((tree != NULL) != (cJSON_ParseWithEvents((const char *)data, size, &noEvents, NULL) != 0))
+        abort();
+    if (!tree)
+        return 0;
+
+    char *printed = cJSON_PrintUnformatted(tree);
+    cJSON *reparsed = printed ? cJSON_Parse(printed) : NULL;
+    char *reprinted = reparsed ? cJSON_PrintUnformatted(reparsed) : NULL;
+    if (!reprinted || strcmp(printed, reprinted) != 0)
+        abort();
+
+    cJSON_free(reprinted);
+    cJSON_Delete(reparsed);
+    cJSON_free(printed);
+    cJSON_Delete(tree);
+    return 0;
+}
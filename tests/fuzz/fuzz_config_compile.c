@@ -0,0 +1,78 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_compile.h"
+#include "input_batch.h"
+
+/* CompileConfig, the app's config decoder, on any bytes up to the first NUL, as it reads
+ * config.json. Whatever it accepts has to be a config the app can run: every count and
+ * setting in range and every binding field one of its enum's values. Warnings are formatted
+ * so a bad format argument shows up under the sanitizers. */
+
+static void FormatWarning(const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+}
+
+static void CheckConfig(const CompiledConfig *config) {
+    if (config->bindingCount < 0 || config->bindingCount > MAX_BINDINGS)
+        abort();
+    for (int i = 0; i < config->bindingCount; i++) {
+        const HotkeyBinding *b = &config->bindings[i];
+        if (b->ctrl > MODIFIER_BOTH || b->shift > MODIFIER_BOTH || b->alt > MODIFIER_BOTH ||
+            b->win > MODIFIER_BOTH || b->action > ACTION_REPLAY_SAVE_PNG_SEQUENCE)
+            abort();
+        switch (b->triggerType) {
+        case TRIGGER_KEYBOARD:
+            if (b->trigger.keyCode >= DISPATCH_KEY_COUNT)
+                abort();
+            break;
+        case TRIGGER_MOUSE_BUTTON:
+            if (b->trigger.mouseButton >= MOUSE_BUTTON_COUNT)
+                abort();
+            break;
+        case TRIGGER_MOUSE_WHEEL:
+            if (b->trigger.wheelDir >= WHEEL_DIRECTION_COUNT)
+                abort();
+            break;
+        default:
+            abort();
+        }
+    }
+    if (config->inputBatch < 2 || config->inputBatch > INPUT_BATCH_CAPACITY ||
+        config->wheel.stepsPerNotch < 1 || config->wheel.stepsPerNotch > 100 ||
+        config->wheel.intervalMs > 1000 || config->wheel.accelerationPercent < 0 ||
+        config->wheel.accelerationPercent > 1000 || config->wheel.accelStartRate < 0 ||
+        config->wheel.accelStartRate > 100 || config->replayFps < 0 ||
+        config->replayFps > REPLAY_MAX_FPS || config->replaySeconds < 1 ||
+        config->replaySeconds > REPLAY_MAX_SECONDS || config->replayMemoryMb < 1 ||
+        config->replayMemoryMb > REPLAY_MAX_MEMORY_MB)
+        abort();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    /* Kept across inputs, as the app keeps them across reloads. */
+    static Arena arena;
+    static CompiledConfig config;
+    static int ready;
+    if (!ready) {
+        ArenaInit(&arena, ARENA_MIN_BLOCK);
+        ready = 1;
+    }
+
+    char *json = (char *)malloc(size + 1);
+    if (!json)
+        return 0;
+    memcpy(json, data, size);
+    json[size] = '\0';
+    memset(&config, 0, sizeof(config));
+    if (CompileConfig(json, &config, &arena, FormatWarning))
+        CheckConfig(&config);
+    free(json);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Stands in for libFuzzer where there is none. Runs LLVMFuzzerTestOneInput once on each file
+ * named on the command line, or on each file in a named directory, so `make fuzz` can replay
+ * the corpus with the sanitizers on. With no arguments it runs the one input on stdin, which is
+ * how afl-fuzz feeds a target built with afl-cc. */
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int inputs;
+
+/* Exactly the file's bytes, so reading past the end shows up under ASan. */
+static int RunStream(FILE *file) {
+    size_t size = 0, capacity = 4096;
+    uint8_t *data = (uint8_t *)malloc(capacity);
+    size_t got;
+    if (!data)
+        return 0;
+    while ((got = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += got;
+        if (size == capacity) {
+            uint8_t *grown = (uint8_t *)realloc(data, capacity * 2);
+            if (!grown) {
+                free(data);
+                return 0;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    uint8_t *exact = (uint8_t *)malloc(size ? size : 1);
+    if (exact) {
+        memcpy(exact, data, size);
+        LLVMFuzzerTestOneInput(exact, size);
+        inputs++;
+    }
+    free(exact);
+    free(data);
+    return exact != NULL;
+}
+
+static int RunPath(const char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 0;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        DIR *dir = opendir(path);
+        if (!dir)
+            return 0;
+        int ok = 1;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.')
+                continue;
+            char child[4096];
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            ok &= RunPath(child);
+        }
+        closedir(dir);
+        return ok;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 0;
+    }
+    int ok = RunStream(file);
+    fclose(file);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2)
+        return RunStream(stdin) ? 0 : 1;
+
+    int ok = 1;
+    for (int i = 1; i < argc; i++)
+        ok &= RunPath(argv[i]);
+    printf("%s: %d inputs\n", argv[0], inputs);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "harness.h"
+
+static int failures;
+static FILE *benchOutput;
+static int benchFields;
+
+void HarnessFail(const char *file, int line, const char *expr) {
+    failures++;
+    if (failures <= 50)
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+}
+
+unsigned int HarnessRandom(unsigned int *state) {
+    unsigned int x = *state ? *state : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+unsigned long long BenchNowNs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+#define BENCH_ROUNDS 7
+
+double BenchMinNs(void (*body)(void *), void *context, int iterations) {
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        unsigned long long start = BenchNowNs();
+        for (int i = 0; i < iterations; i++)
+            body(context);
+        double perCall = (double)(BenchNowNs() - start) / iterations;
+        if (round == 0 || perCall < best)
+            best = perCall;
+    }
+    return best;
+}
+
+void BenchBegin(const char *suite, const char *name) {
+    printf("%-12s %-36s", suite, name);
+    if (benchOutput)
+        fprintf(benchOutput, "{\"suite\":\"%s\",\"case\":\"%s\"", suite, name);
+    benchFields = 0;
+}
+
+void BenchValue(const char *key, double value) {
+    printf("%s%s=%.6g", benchFields++ ? ", " : " ", key, value);
+    if (benchOutput)
+        fprintf(benchOutput, ",\"%s\":%.9g", key, value);
+}
+
+/* The test runner is linked without the malloc wrappers; bench_alloc.c overrides these in the
+ * benchmark runner so benchmarks can live next to the tests of the same module. */
+__attribute__((weak)) void BenchResetAllocs(void) {
+}
+
+__attribute__((weak)) BenchAllocs BenchReadAllocs(void) {
+    BenchAllocs none = {0, 0, 0};
+    return none;
+}
+
+void BenchAllocValues(const BenchAllocs *allocs) {
+    BenchValue("allocs", (double)allocs->allocs);
+    BenchValue("alloc_bytes", (double)allocs->bytes);
+    BenchValue("peak_bytes", (double)allocs->peakBytes);
+}
+
+void BenchEnd(void) {
+    printf("\n");
+    if (benchOutput)
+        fprintf(benchOutput, "}\n");
+}
+
+static int Selected(const char *name, int argc, char **argv, int first) {
+    if (first >= argc)
+        return 1;
+    for (int i = first; i < argc; i++) {
+        if (strstr(name, argv[i]))
+            return 1;
+    }
+    return 0;
+}
+
+/* Usage: runner [-o results.jsonl] [name-substring...] */
+int HarnessRun(const HarnessCase *cases, int count, int argc, char **argv) {
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        benchOutput = fopen(argv[2], "w");
+        if (!benchOutput) {
+            fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 2;
+        }
+        first = 3;
+    }
+
+    int ran = 0;
+    for (int i = 0; i < count; i++) {
+        if (!Selected(cases[i].name, argc, argv, first))
+            continue;
+        int before = failures;
+        cases[i].run();
+        ran++;
+        if (failures != before)
+            fprintf(stderr, "FAIL %s (%d checks)\n", cases[i].name, failures - before);
+    }
+
+    if (benchOutput && fclose(benchOutput) != 0) {
+        fprintf(stderr, "failed to write results\n");
+        failures++;
+    }
+    printf("%d cases, %d failed checks\n", ran, failures);
+    return failures ? 1 : 0;
+}
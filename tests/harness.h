@@ -0,0 +1,56 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stddef.h>
+
+/* Shared harness for the host-side tests and benchmarks of the portable modules in src/.
+ * Tests call CHECK and keep going after a failure; benchmarks report each case as one JSON
+ * object per line so runs can be compared by script. */
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} HarnessCase;
+
+/* Runs the cases whose names contain one of the arguments, or all of them. "-o path" first
+ * also writes benchmark records to path. Returns the process exit status. */
+int HarnessRun(const HarnessCase *cases, int count, int argc, char **argv);
+
+void HarnessFail(const char *file, int line, const char *expr);
+
+#define CHECK(cond)                                                                               \
+    do {                                                                                          \
+        if (!(cond))                                                                              \
+            HarnessFail(__FILE__, __LINE__, #cond);                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((long long)(a) == (long long)(b))
+
+/* Deterministic xorshift generator so failures reproduce. */
+unsigned int HarnessRandom(unsigned int *state);
+
+/* Monotonic clock in nanoseconds. */
+unsigned long long BenchNowNs(void);
+
+/* Smallest time of one call to body over several rounds of iterations calls each, in ns. The
+ * minimum is what the code costs; the rest is noise from the machine. */
+double BenchMinNs(void (*body)(void *), void *context, int iterations);
+
+/* Heap traffic since the last BenchResetAllocs, counted by the malloc wrappers the benchmark
+ * binary is linked with. */
+typedef struct {
+    unsigned long long allocs;
+    unsigned long long bytes;
+    unsigned long long peakBytes; /* most bytes live at once */
+} BenchAllocs;
+
+void BenchResetAllocs(void);
+BenchAllocs BenchReadAllocs(void);
+
+/* One result record: BenchBegin, any number of BenchValue, then BenchEnd. */
+void BenchBegin(const char *suite, const char *name);
+void BenchValue(const char *key, double value);
+void BenchAllocValues(const BenchAllocs *allocs);
+void BenchEnd(void);
+
+#endif
@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "image_decode.h"
+
+static unsigned int ReadBe32(const unsigned char *p) {
+    return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int Paeth(int a, int b, int c) {
+    int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+static int Unfilter(const unsigned char *filtered, unsigned char *out, int width, int height,
+    int comp) {
+    size_t rowBytes = (size_t)width * comp;
+    for (int y = 0; y < height; y++) {
+        const unsigned char *in = filtered + (rowBytes + 1) * y;
+        unsigned char *row = out + rowBytes * y;
+        const unsigned char *prev = y ? row - rowBytes : NULL;
+        int type = in[0];
+        in++;
+        for (size_t i = 0; i < rowBytes; i++) {
+            int a = i >= (size_t)comp ? row[i - comp] : 0;
+            int b = prev ? prev[i] : 0;
+            int c = prev && i >= (size_t)comp ? prev[i - comp] : 0;
+            int pred;
+            switch (type) {
+            case 0:
+                pred = 0;
+                break;
+            case 1:
+                pred = a;
+                break;
+            case 2:
+                pred = b;
+                break;
+            case 3:
+                pred = (a + b) >> 1;
+                break;
+            case 4:
+                pred = Paeth(a, b, c);
+                break;
+            default:
+                return 0;
+            }
+            row[i] = (unsigned char)(in[i] + pred);
+        }
+    }
+    return 1;
+}
+
+unsigned char *DecodePng(const unsigned char *png, size_t len, DecodedInfo *info) {
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    static const int channels[7] = {1, 0, 3, 0, 2, 0, 4};
+    memset(info, 0, sizeof(*info));
+    if (len < 8 || memcmp(png, signature, 8) != 0)
+        return NULL;
+
+    unsigned char *idat = NULL;
+    size_t idatLen = 0, pos = 8;
+    int sawEnd = 0;
+    while (!sawEnd && pos + 12 <= len) {
+        unsigned int chunkLen = ReadBe32(png + pos);
+        const unsigned char *type = png + pos + 4;
+        if (chunkLen > len - pos - 12)
+            break;
+        const unsigned char *data = type + 4;
+        unsigned int crc = (unsigned int)crc32(0, type, chunkLen + 4);
+        if (crc != ReadBe32(data + chunkLen))
+            break;
+
+        if (memcmp(type, "IHDR", 4) == 0 && chunkLen == 13) {
+            info->width = (int)ReadBe32(data);
+            info->height = (int)ReadBe32(data + 4);
+            if (data[8] != 8 || data[9] > 6 || data[12] != 0)
+                break;
+            info->comp = channels[data[9]];
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            unsigned char *grown = (unsigned char *)realloc(idat, idatLen + chunkLen + 1);
+            if (!grown)
+                break;
+            idat = grown;
+            memcpy(idat + idatLen, data, chunkLen);
+            idatLen += chunkLen;
+            info->idatChunks++;
+            if ((int)chunkLen > info->largestIdat)
+                info->largestIdat = (int)chunkLen;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            sawEnd = 1;
+        }
+        pos += 12 + chunkLen;
+    }
+
+    unsigned char *pixels = NULL;
+    if (sawEnd && pos == len && info->comp && info->width > 0 && info->height > 0) {
+        size_t rowBytes = (size_t)info->width * info->comp;
+        uLongf filteredLen = (uLongf)((rowBytes + 1) * info->height);
+        unsigned char *filtered = (unsigned char *)malloc(filteredLen + 1);
+        pixels = (unsigned char *)malloc(rowBytes * info->height);
+        uLongf expected = filteredLen;
+        if (!filtered || !pixels ||
+            uncompress(filtered, &filteredLen, idat ? idat : (const Bytef *)"", idatLen) != Z_OK ||
+            filteredLen != expected ||
+            !Unfilter(filtered, pixels, info->width, info->height, info->comp)) {
+            free(pixels);
+            pixels = NULL;
+        }
+        free(filtered);
+    }
+    free(idat);
+    return pixels;
+}
+
+typedef struct {
+    DecodedInfo *info;
+    unsigned char *canvas;
+    unsigned char *data; /* compressed data of the frame being collected */
+    size_t dataLen;
+    unsigned int x, y, width, height;
+    unsigned int delayMs;
+    int pending; /* an fcTL was read and its frame not yet drawn */
+    int frames;
+} ApngState;
+
+static int AppendData(ApngState *state, const unsigned char *data, size_t len) {
+    unsigned char *grown = (unsigned char *)realloc(state->data, state->dataLen + len + 1);
+    if (!grown)
+        return 0;
+    state->data = grown;
+    memcpy(state->data + state->dataLen, data, len);
+    state->dataLen += len;
+    return 1;
+}
+
+static int DrawFrame(ApngState *state, ApngFrameFunc frame, void *context) {
+    DecodedInfo *info = state->info;
+    int comp = info->comp;
+    size_t rowBytes = (size_t)state->width * comp;
+    uLongf filteredLen = (uLongf)((rowBytes + 1) * state->height);
+    uLongf expected = filteredLen;
+    unsigned char *filtered = (unsigned char *)malloc(filteredLen + 1);
+    unsigned char *rect = (unsigned char *)malloc(rowBytes * state->height + 1);
+    int ok = filtered && rect && state->dataLen &&
+             uncompress(filtered, &filteredLen, state->data, state->dataLen) == Z_OK &&
+             filteredLen == expected &&
+             Unfilter(filtered, rect, (int)state->width, (int)state->height, comp);
+    if (ok) {
+        for (unsigned int row = 0; row < state->height; row++) {
+            memcpy(state->canvas + ((size_t)(state->y + row) * info->width + state->x) * comp,
+                rect + rowBytes * row, rowBytes);
+        }
+    }
+    free(filtered);
+    free(rect);
+
+    state->pending = 0;
+    state->dataLen = 0;
+    if (!ok)
+        return -1;
+    /* 1 when the callback stopped the decode. */
+    return frame(context, state->frames++, state->canvas, info, state->delayMs) ? 0 : 1;
+}
+
+int DecodeApng(const unsigned char *png, size_t len, ApngFrameFunc frame, void *context,
+    DecodedInfo *info) {
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    static const int channels[7] = {1, 0, 3, 0, 2, 0, 4};
+    memset(info, 0, sizeof(*info));
+    if (len < 8 || memcmp(png, signature, 8) != 0)
+        return -1;
+
+    ApngState state;
+    memset(&state, 0, sizeof(state));
+    state.info = info;
+    unsigned int announced = 0, sequence = 0;
+    size_t pos = 8;
+    int result = 0, sawEnd = 0, sawActl = 0;
+    while (!sawEnd && result == 0 && pos + 12 <= len) {
+        unsigned int chunkLen = ReadBe32(png + pos);
+        const unsigned char *type = png + pos + 4;
+        if (chunkLen > len - pos - 12)
+            break;
+        const unsigned char *data = type + 4;
+        if ((unsigned int)crc32(0, type, chunkLen + 4) != ReadBe32(data + chunkLen))
+            break;
+        pos += 12 + chunkLen;
+
+        if (memcmp(type, "IHDR", 4) == 0 && chunkLen == 13) {
+            info->width = (int)ReadBe32(data);
+            info->height = (int)ReadBe32(data + 4);
+            if (data[8] != 8 || data[9] > 6 || data[12] != 0 || !channels[data[9]] ||
+                info->width <= 0 || info->height <= 0)
+                break;
+            info->comp = channels[data[9]];
+            state.canvas = (unsigned char *)calloc((size_t)info->width * info->height,
+                (size_t)info->comp);
+            if (!state.canvas)
+                break;
+        } else if (memcmp(type, "acTL", 4) == 0 && chunkLen == 8) {
+            announced = ReadBe32(data);
+            sawActl = 1;
+        } else if (memcmp(type, "fcTL", 4) == 0 && chunkLen == 26) {
+            if (!state.canvas || ReadBe32(data) != sequence++)
+                break;
+            if (state.pending && (result = DrawFrame(&state, frame, context)) != 0)
+                break;
+            state.width = ReadBe32(data + 4);
+            state.height = ReadBe32(data + 8);
+            state.x = ReadBe32(data + 12);
+            state.y = ReadBe32(data + 16);
+            unsigned int num = (unsigned int)data[20] << 8 | data[21];
+            unsigned int den = (unsigned int)data[22] << 8 | data[23];
+            state.delayMs = num * 1000 / (den ? den : 100);
+            if (data[24] != 0 || data[25] != 0 || state.width == 0 || state.height == 0 ||
+                state.x + state.width > (unsigned int)info->width ||
+                state.y + state.height > (unsigned int)info->height ||
+                (state.frames == 0 && (state.x || state.y ||
+                                          state.width != (unsigned int)info->width ||
+                                          state.height != (unsigned int)info->height)))
+                break;
+            state.pending = 1;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            if (!state.pending || state.frames != 0 || !AppendData(&state, data, chunkLen))
+                break;
+        } else if (memcmp(type, "fdAT", 4) == 0) {
+            if (!state.pending || state.frames == 0 || chunkLen < 4 ||
+                ReadBe32(data) != sequence++ || !AppendData(&state, data + 4, chunkLen - 4))
+                break;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            if (state.pending)
+                result = DrawFrame(&state, frame, context);
+            sawEnd = 1;
+        }
+    }
+
+    int frames = state.frames;
+    free(state.canvas);
+    free(state.data);
+    if (result < 0 || !sawActl)
+        return -1;
+    if (result == 0 && (!sawEnd || pos != len || (unsigned int)frames != announced))
+        return -1;
+    return frames;
+}
+
+/* Straight from the QOI specification. */
+unsigned char *DecodeQoi(const unsigned char *qoi, size_t len, DecodedInfo *info) {
+    static const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memset(info, 0, sizeof(*info));
+    if (len < 22 || memcmp(qoi, "qoif", 4) != 0 || memcmp(qoi + len - 8, end, 8) != 0)
+        return NULL;
+    info->width = (int)ReadBe32(qoi + 4);
+    info->height = (int)ReadBe32(qoi + 8);
+    info->comp = qoi[12];
+    if (info->width <= 0 || info->height <= 0 || (info->comp != 3 && info->comp != 4))
+        return NULL;
+
+    size_t pixelCount = (size_t)info->width * info->height;
+    unsigned char *pixels = (unsigned char *)malloc(pixelCount * info->comp);
+    if (!pixels)
+        return NULL;
+
+    unsigned char index[64][4];
+    unsigned char px[4] = {0, 0, 0, 255};
+    memset(index, 0, sizeof(index));
+    size_t pos = 14, dataEnd = len - 8;
+    int run = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (run > 0) {
+            run--;
+        } else if (pos < dataEnd) {
+            int b1 = qoi[pos++];
+            if (b1 == 0xFE && pos + 3 <= dataEnd) {
+                memcpy(px, qoi + pos, 3);
+                pos += 3;
+            } else if (b1 == 0xFF && pos + 4 <= dataEnd) {
+                memcpy(px, qoi + pos, 4);
+                pos += 4;
+            } else if ((b1 & 0xC0) == 0x00) {
+                memcpy(px, index[b1], 4);
+            } else if ((b1 & 0xC0) == 0x40) {
+                px[0] += ((b1 >> 4) & 3) - 2;
+                px[1] += ((b1 >> 2) & 3) - 2;
+                px[2] += (b1 & 3) - 2;
+            } else if ((b1 & 0xC0) == 0x80 && pos < dataEnd) {
+                int b2 = qoi[pos++];
+                int vg = (b1 & 0x3F) - 32;
+                px[0] += vg - 8 + ((b2 >> 4) & 0x0F);
+                px[1] += vg;
+                px[2] += vg - 8 + (b2 & 0x0F);
+            } else if ((b1 & 0xC0) == 0xC0) {
+                run = b1 & 0x3F;
+            } else {
+                free(pixels);
+                return NULL;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        } else {
+            free(pixels);
+            return NULL;
+        }
+        memcpy(pixels + i * info->comp, px, (size_t)info->comp);
+    }
+    if (pos != dataEnd) {
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+void ByteSinkWrite(void *context, void *data, int size) {
+    ByteSink *sink = (ByteSink *)context;
+    sink->writes++;
+    if (sink->len + (size_t)size > sink->capacity) {
+        size_t capacity = sink->capacity ? sink->capacity : 4096;
+        while (capacity < sink->len + (size_t)size)
+            capacity *= 2;
+        unsigned char *grown = (unsigned char *)realloc(sink->data, capacity);
+        if (!grown)
+            return;
+        sink->data = grown;
+        sink->capacity = capacity;
+    }
+    memcpy(sink->data + sink->len, data, (size_t)size);
+    sink->len += (size_t)size;
+}
+
+void ByteSinkFree(ByteSink *sink) {
+    free(sink->data);
+    memset(sink, 0, sizeof(*sink));
+}
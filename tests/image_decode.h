@@ -0,0 +1,47 @@
+#ifndef IMAGE_DECODE_H
+#define IMAGE_DECODE_H
+
+#include <stddef.h>
+
+/* Independent decoders for checking the encoders' output. PNG inflate goes through the
+ * system zlib so the app's deflate and checksums are not used to check themselves. */
+
+typedef struct {
+    int width;
+    int height;
+    int comp;
+    int idatChunks;
+    int largestIdat;
+} DecodedInfo;
+
+/* Decodes an 8-bit non-interlaced PNG into tightly packed rows in PNG channel order. Returns
+ * NULL if the file is malformed, including any chunk CRC or the zlib Adler-32 not matching.
+ * Free the result with free. */
+unsigned char *DecodePng(const unsigned char *png, size_t len, DecodedInfo *info);
+
+/* Receives each frame of an APNG as the whole canvas after the frame was drawn, in PNG channel
+ * order. Returns 0 to stop decoding. */
+typedef int (*ApngFrameFunc)(void *context, int index, const unsigned char *canvas,
+    const DecodedInfo *info, unsigned int delayMs);
+
+/* Decodes an APNG whose frames leave themselves in place and replace their rectangle, the only
+ * modes ApngWriter uses. Returns the number of frames, or -1 if the file is malformed, including
+ * sequence numbers out of order or a frame count not matching acTL. */
+int DecodeApng(const unsigned char *png, size_t len, ApngFrameFunc frame, void *context,
+    DecodedInfo *info);
+
+/* Decodes a QOI image into tightly packed RGB or RGBA rows. Returns NULL if it is malformed. */
+unsigned char *DecodeQoi(const unsigned char *qoi, size_t len, DecodedInfo *info);
+
+/* Growable byte buffer matching stbi_write_func and QoiWriteFunc, for collecting output. */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t capacity;
+    int writes;
+} ByteSink;
+
+void ByteSinkWrite(void *context, void *data, int size);
+void ByteSinkFree(ByteSink *sink);
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_compile.h"
+#include "harness.h"
+#include "input_trace.h"
+
+/* Replays .mktrace files recorded by the app through HookEngine, with the bindings compiled
+ * from the config stored in each trace. Reports how many events were swallowed and which
+ * actions fired, every event whose decision differs from the recording, and the replay speed.
+ * Exits with 1 if any trace is unreadable or replays differently. */
+
+static const char *eventNames[TRACE_EVENT_TYPE_COUNT] = {
+    "key_down", "key_up", "button_down", "button_up", "wheel"};
+
+static void PrintWarning(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fputs("  config: ", stderr);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static unsigned char *ReadWholeFile(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    unsigned char *data = NULL;
+    long length = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0)
+        data = (unsigned char *)malloc((size_t)length + 1);
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+typedef struct {
+    int verbose;
+    unsigned int fired[MAX_BINDINGS];
+    unsigned int index;
+} ReplayReport;
+
+static void DescribeEvent(const TraceEvent *event, char *text, size_t size) {
+    if (event->type == TRACE_WHEEL)
+        snprintf(text, size, "%s %+d", eventNames[event->type], event->wheelDelta);
+    else
+        snprintf(text, size, "%s 0x%02X%s", eventNames[event->type], event->code,
+            event->extended ? " ext" : "");
+}
+
+static void OnEvent(void *context, const TraceEvent *event, const HookDecision *decision) {
+    ReplayReport *report = (ReplayReport *)context;
+    unsigned int index = report->index++;
+    if (decision->binding >= 0 && decision->binding < MAX_BINDINGS)
+        report->fired[decision->binding]++;
+
+    int mismatch = decision->swallow != event->swallowed || decision->binding != event->binding;
+    if (!mismatch && !report->verbose)
+        return;
+
+    char text[48];
+    DescribeEvent(event, text, sizeof(text));
+    printf("  %s#%u t=%u mods=0x%02X %-22s swallow=%d binding=%d%s", mismatch ? "MISMATCH " : "",
+        index, event->timeMs, event->modifiers, text, decision->swallow, decision->binding,
+        decision->tapControl ? " tap_ctrl" : "");
+    if (mismatch)
+        printf(" (recorded swallow=%d binding=%d)", event->swallowed, event->binding);
+    printf("\n");
+}
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const DispatchTable *dispatch;
+} TimedReplay;
+
+static void ReplayOnce(void *context) {
+    TimedReplay *timed = (TimedReplay *)context;
+    HookEngine engine;
+    TraceReplayStats stats;
+    HookEngineInit(&engine, timed->dispatch);
+    TraceReplay(timed->data, timed->size, &engine, NULL, NULL, &stats);
+}
+
+static int ReplayFile(const char *path, int verbose, int iterations) {
+    size_t size;
+    unsigned char *data = ReadWholeFile(path, &size);
+    TraceReader reader;
+    if (!data || !TraceReaderInit(&reader, data, size)) {
+        fprintf(stderr, "%s: not a version %d input trace\n", path, INPUT_TRACE_VERSION);
+        free(data);
+        return 0;
+    }
+
+    static CompiledConfig config;
+    Arena arena;
+    ArenaInit(&arena, ARENA_MIN_BLOCK);
+    char *json = (char *)malloc(reader.configLength + 1);
+    memcpy(json, reader.config, reader.configLength);
+    json[reader.configLength] = '\0';
+    printf("%s\n", path);
+    int compiled = CompileConfig(json, &config, &arena, PrintWarning);
+    free(json);
+    if (!compiled) {
+        fprintf(stderr, "%s: the config stored in the trace does not compile\n", path);
+        free(data);
+        return 0;
+    }
+
+    static DispatchTable dispatch;
+    BuildDispatchTable(&dispatch, config.bindings, config.bindingCount);
+    HookEngine engine;
+    HookEngineInit(&engine, &dispatch);
+
+    ReplayReport report;
+    memset(&report, 0, sizeof(report));
+    report.verbose = verbose;
+    TraceReplayStats stats;
+    int complete = TraceReplay(data, size, &engine, OnEvent, &report, &stats);
+
+    printf("  %u events, %u swallowed, %u fired, %u ctrl taps, %d bindings\n", stats.events,
+        stats.swallowed, stats.fired, stats.controlTaps, config.bindingCount);
+    for (int i = 0; i < config.bindingCount; i++) {
+        if (!report.fired[i])
+            continue;
+        const char *action = ConfigActionName(config.bindings[i].action);
+        printf("  binding %d (%s): %u\n", i, action ? action : "none", report.fired[i]);
+    }
+    printf("  decision mismatches: %u, modifier mismatches: %u%s\n", stats.decisionMismatches,
+        stats.modifierMismatches, complete ? "" : ", trace cut short or corrupt");
+
+    if (iterations > 0 && stats.events > 0) {
+        TimedReplay timed = {data, size, &dispatch};
+        double ns = BenchMinNs(ReplayOnce, &timed, iterations);
+        printf("  replay: %.1f ns/event, %.2fM events/s\n", ns / stats.events,
+            stats.events / ns * 1e3);
+    }
+
+    free(data);
+    return complete && stats.decisionMismatches == 0;
+}
+
+int main(int argc, char **argv) {
+    int verbose = 0, iterations = 20, first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (strcmp(argv[first], "-v") == 0)
+            verbose = 1;
+        else if (strcmp(argv[first], "-n") == 0 && first + 1 < argc)
+            iterations = atoi(argv[++first]);
+        else
+            break;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [-v] [-n timing-iterations] trace.mktrace...\n", argv[0]);
+        return 2;
+    }
+
+    int ok = 1;
+    for (int i = first; i < argc; i++)
+        ok &= ReplayFile(argv[i], verbose, iterations);
+    return ok ? 0 : 1;
+}
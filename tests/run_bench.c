@@ -0,0 +1,25 @@
+#include "cases.h"
+#include "harness.h"
+
+static const HarnessCase benchmarks[] = {
+    {"dispatch", BenchDispatch},
+    {"checksum", BenchChecksum},
+    {"screenshot_formats", BenchScreenshotFormats},
+    {"replay_history", BenchReplayHistory},
+    {"trace_replay", BenchTraceReplay},
+    {"config_names", BenchConfigNames},
+    {"config_parse", BenchConfigParse},
+    {"config_scaling", BenchConfigScaling},
+    {"cjson_index", BenchCjsonIndex},
+    {"histogram", BenchHistogram},
+    {"log_buffer", BenchLogBuffer},
+    {"pixel_convert", BenchPixelConvert},
+    {"config_cache", BenchConfigCache},
+    {"png_threads", BenchPngThreads},
+    {"deflate", BenchDeflate},
+    {"png_filter", BenchPngFilter},
+};
+
+int main(int argc, char **argv) {
+    return HarnessRun(benchmarks, (int)(sizeof(benchmarks) / sizeof(benchmarks[0])), argc, argv);
+}
@@ -0,0 +1,55 @@
+#include "cases.h"
+#include "harness.h"
+
+static const HarnessCase tests[] = {
+    {"dispatch_table", TestDispatchTable},
+    {"dispatch_linear_scan", TestDispatchMatchesLinearScan},
+    {"modifier_states", TestModifierStates},
+    {"modifier_tracker", TestModifierTracker},
+    {"hook_engine_win_release", TestHookEngineWinRelease},
+    {"action_queue_basics", TestActionQueueBasics},
+    {"action_queue_stress", TestActionQueueStress},
+    {"png_filter_corpus", TestPngFilterCorpus},
+    {"checksum_known_values", TestChecksumKnownValues},
+    {"checksum_lengths_alignment", TestChecksumLengthsAndAlignment},
+    {"checksum_large_inputs", TestChecksumLargeInputs},
+    {"checksum_splits", TestChecksumSplits},
+    {"clipboard_cache_dib", TestClipboardCacheDib},
+    {"clipboard_cache_render_on_demand", TestClipboardCacheRenderOnDemand},
+    {"clipboard_cache_races", TestClipboardCacheRaces},
+    {"clipboard_cache_file_and_edges", TestClipboardCacheFileAndEdges},
+    {"png_stream_matches_in_memory", TestPngStreamMatchesInMemory},
+    {"png_stream_errors", TestPngStreamErrors},
+    {"qoi_round_trip", TestQoiRoundTrip},
+    {"replay_codec_round_trip", TestReplayCodecRoundTrip},
+    {"replay_ring_eviction", TestReplayRingEviction},
+    {"replay_max_age", TestReplayMaxAge},
+    {"replay_corrupt_frames", TestReplayCorruptFrames},
+    {"replay_export_apng", TestReplayExportApng},
+    {"wheel_accumulator_batching", TestWheelAccumulatorBatching},
+    {"wheel_reversal", TestWheelReversal},
+    {"wheel_repeat_limit", TestWheelRepeatLimit},
+    {"config_compile", TestConfigCompile},
+    {"config_names", TestConfigNames},
+    {"arena", TestArena},
+    {"config_decoder_matches_tree", TestConfigDecoderMatchesTree},
+    {"config_cache", TestConfigCache},
+    {"cjson_index", TestCjsonIndex},
+    {"cjson_simd_matches_scalar", TestCjsonSimdMatchesScalar},
+    {"trace_record_replay", TestTraceRecordReplay},
+    {"histogram_buckets", TestHistogramBuckets},
+    {"histogram_percentiles", TestHistogramPercentiles},
+    {"log_buffer_basics", TestLogBufferBasics},
+    {"log_buffer_stress", TestLogBufferStress},
+    {"input_batch_ordering", TestInputBatchOrdering},
+    {"input_batch_limits", TestInputBatchLimits},
+    {"input_batch_counters", TestInputBatchCounters},
+    {"frame_buffer_reuse", TestFrameBufferReuse},
+    {"frame_buffer_create_failure", TestFrameBufferCreateFailure},
+    {"frame_buffer_view", TestFrameBufferView},
+    {"pixel_convert_matches_portable", TestPixelConvertMatchesPortable},
+};
+
+int main(int argc, char **argv) {
+    return HarnessRun(tests, (int)(sizeof(tests) / sizeof(tests[0])), argc, argv);
+}
@@ -0,0 +1,23 @@
+#include "stb_baseline.h"
+
+#define STBIW_NO_SIMD
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "stb_image_write.h"
+
+unsigned char *BaselinePngToMem(const unsigned char *pixels, int stride, int width, int height,
+    int comp, int *len) {
+    return stbi_write_png_to_mem(pixels, stride, width, height, comp, len);
+}
+
+unsigned char *BaselineZlibCompress(unsigned char *data, int len, int *outLen, int quality) {
+    return stbi_zlib_compress(data, len, outLen, quality);
+}
+
+int BaselineEncodePngLine(unsigned char *pixels, int stride, int width, int height, int y,
+    int n, int filterType, signed char *lineBuffer) {
+    return stbiw__encode_png_line(pixels, stride, width, height, y, n, filterType, lineBuffer);
+}
@@ -0,0 +1,21 @@
+#ifndef STB_BASELINE_H
+#define STB_BASELINE_H
+
+/* The encoder the app used before png_writer.c and deflate.c: stb_image_write.h with its
+ * scalar row filters and its own zlib compressor, compiled privately so the benchmarks can
+ * measure the replacements against it. */
+
+/* stbi_write_png_to_mem at stb's default compression level. pixels hold comp channels in PNG
+ * order. Returns a malloc'd PNG or NULL. */
+unsigned char *BaselinePngToMem(const unsigned char *pixels, int stride, int width, int height,
+    int comp, int *len);
+
+/* stbi_zlib_compress: stb's hash table of growing per-bucket arrays and fixed Huffman codes. */
+unsigned char *BaselineZlibCompress(unsigned char *data, int len, int *outLen, int quality);
+
+/* stbiw__encode_png_line: filters row y of the image with filter_type into line_buffer and
+ * returns the sum of absolute values stb picks the filter by. */
+int BaselineEncodePngLine(unsigned char *pixels, int stride, int width, int height, int y,
+    int n, int filterType, signed char *lineBuffer);
+
+#endif
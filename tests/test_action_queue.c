@@ -0,0 +1,89 @@
+#include <pthread.h>
+#include <sched.h>
+#include "action_queue.h"
+#include "cases.h"
+#include "harness.h"
+
+void TestActionQueueBasics(void) {
+    ActionQueue queue;
+    ActionQueueInit(&queue);
+    QueuedAction item;
+
+    CHECK(!ActionQueuePop(&queue, &item));
+    for (int i = 0; i < ACTION_QUEUE_CAPACITY; i++)
+        CHECK(ActionQueuePush(&queue, i, 100 + i));
+    CHECK(!ActionQueuePush(&queue, 99, 0));
+    CHECK_EQ(ActionQueueDepth(&queue), ACTION_QUEUE_CAPACITY);
+
+    for (int i = 0; i < ACTION_QUEUE_CAPACITY; i++) {
+        CHECK(ActionQueuePop(&queue, &item));
+        CHECK_EQ(item.action, i);
+        ActionQueueComplete(&queue, &item, 200);
+    }
+    CHECK(!ActionQueuePop(&queue, &item));
+
+    ActionQueueStats stats;
+    ActionQueueGetStats(&queue, &stats);
+    CHECK_EQ(stats.pushed, ACTION_QUEUE_CAPACITY);
+    CHECK_EQ(stats.dropped, 1);
+    CHECK_EQ(stats.completed, ACTION_QUEUE_CAPACITY);
+    CHECK_EQ(stats.maxDepth, ACTION_QUEUE_CAPACITY);
+    CHECK_EQ(stats.maxLatencyTicks, 100);
+}
+
+#define STRESS_PUSHES 2000000
+
+typedef struct {
+    ActionQueue queue;
+    atomic_int producerDone;
+    int accepted;
+} StressState;
+
+/* The producer stands in for the hook thread: it never waits, and whatever does not fit is
+ * dropped. Actions carry a sequence number so the consumer can check order. */
+static void *StressProducer(void *param) {
+    StressState *state = (StressState *)param;
+    for (int i = 0; i < STRESS_PUSHES; i++) {
+        state->accepted += ActionQueuePush(&state->queue, i, (unsigned long long)i);
+        if ((i & 0xFFF) == 0)
+            sched_yield();
+    }
+    atomic_store(&state->producerDone, 1);
+    return NULL;
+}
+
+void TestActionQueueStress(void) {
+    static StressState state;
+    ActionQueueInit(&state.queue);
+    atomic_init(&state.producerDone, 0);
+    state.accepted = 0;
+
+    pthread_t producer;
+    CHECK(pthread_create(&producer, NULL, StressProducer, &state) == 0);
+
+    int popped = 0, outOfOrder = 0, last = -1;
+    QueuedAction item;
+    for (;;) {
+        int done = atomic_load(&state.producerDone);
+        while (ActionQueuePop(&state.queue, &item)) {
+            if (item.action <= last || item.enqueueTicks != (unsigned long long)item.action)
+                outOfOrder++;
+            last = item.action;
+            ActionQueueComplete(&state.queue, &item, item.enqueueTicks);
+            popped++;
+        }
+        if (done)
+            break;
+    }
+    pthread_join(producer, NULL);
+
+    ActionQueueStats stats;
+    ActionQueueGetStats(&state.queue, &stats);
+    CHECK_EQ(outOfOrder, 0);
+    CHECK_EQ(popped, state.accepted);
+    CHECK_EQ(stats.pushed, state.accepted);
+    CHECK_EQ(stats.completed, popped);
+    CHECK_EQ(stats.pushed + stats.dropped, STRESS_PUSHES);
+    CHECK(stats.maxDepth <= ACTION_QUEUE_CAPACITY);
+    CHECK_EQ(ActionQueueDepth(&state.queue), 0);
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "checksum.h"
+#include "cpu_features.h"
+#include "harness.h"
+
+/* Each accelerated path on its own, then everything the CPU has. */
+static const unsigned int featureSets[] = {
+    0,
+    CPU_FEATURE_SSSE3,
+    CPU_FEATURE_PCLMUL | CPU_FEATURE_SSE41,
+    CPU_FEATURE_AVX2,
+    ~0u,
+};
+
+#define FEATURE_SET_COUNT (sizeof(featureSets) / sizeof(featureSets[0]))
+
+/* Bit-at-a-time CRC and byte-at-a-time Adler straight from their definitions. */
+static unsigned int ReferenceCrc32(unsigned int crc, const unsigned char *p, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+            crc = (crc & 1) ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+    }
+    return ~crc;
+}
+
+static unsigned int ReferenceAdler32(unsigned int adler, const unsigned char *p, size_t len) {
+    unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+    while (len--) {
+        s1 = (s1 + *p++) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+void TestChecksumKnownValues(void) {
+    static const char digits[] = "123456789";
+    for (size_t set = 0; set < FEATURE_SET_COUNT; set++) {
+        ChecksumLimitFeatures(featureSets[set]);
+        CHECK_EQ(Crc32(0, digits, 9), 0xCBF43926u);
+        CHECK_EQ(Crc32(0, "", 0), 0);
+        CHECK_EQ(Adler32(1, "Wikipedia", 9), 0x11E60398u);
+        CHECK_EQ(Adler32(1, "", 0), 1);
+    }
+    ChecksumLimitFeatures(~0u);
+}
+
+/* Every length up to 1 KiB at every offset within a 64-byte line, so each vector loop meets
+ * every split between its body and the scalar head and tail. */
+void TestChecksumLengthsAndAlignment(void) {
+    enum { MAX_LEN = 1024, MAX_OFFSET = 64 };
+    unsigned char *buffer = (unsigned char *)malloc(MAX_LEN + MAX_OFFSET);
+    unsigned int seed = 9;
+    for (int i = 0; i < MAX_LEN + MAX_OFFSET; i++)
+        buffer[i] = (unsigned char)HarnessRandom(&seed);
+
+    for (size_t set = 0; set < FEATURE_SET_COUNT; set++) {
+        ChecksumLimitFeatures(featureSets[set]);
+        for (int offset = 0; offset < MAX_OFFSET; offset++) {
+            for (int len = 0; len <= MAX_LEN; len++) {
+                const unsigned char *p = buffer + offset;
+                CHECK_EQ(Crc32(0x12345678u, p, len), ReferenceCrc32(0x12345678u, p, len));
+                CHECK_EQ(Adler32(0x00ab0cdeu, p, len), ReferenceAdler32(0x00ab0cdeu, p, len));
+            }
+        }
+    }
+    ChecksumLimitFeatures(~0u);
+    free(buffer);
+}
+
+/* All-0xFF input maximises the sums, so lengths around multiples of the modulo interval are
+ * where an accumulator would overflow. Starting sums just under the modulus push it further. */
+void TestChecksumLargeInputs(void) {
+    enum { LEN = 5552 * 4 + 97 };
+    unsigned char *ones = (unsigned char *)malloc(LEN);
+    unsigned char *noise = (unsigned char *)malloc(LEN);
+    unsigned int seed = 3;
+    memset(ones, 0xFF, LEN);
+    for (int i = 0; i < LEN; i++)
+        noise[i] = (unsigned char)HarnessRandom(&seed);
+
+    static const size_t lengths[] = {5551, 5552, 5553, 5552 * 2 - 1, 5552 * 2 + 31, 5552 * 3,
+        LEN};
+    for (size_t set = 0; set < FEATURE_SET_COUNT; set++) {
+        ChecksumLimitFeatures(featureSets[set]);
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t len = lengths[l];
+            unsigned int start = (65520u << 16) | 65520u;
+            CHECK_EQ(Adler32(start, ones, len), ReferenceAdler32(start, ones, len));
+            CHECK_EQ(Adler32(1, noise, len), Adler32Portable(1, noise, len));
+            CHECK_EQ(Crc32(0, ones, len), Crc32Portable(0, ones, len));
+            CHECK_EQ(Crc32(0, noise, len), ReferenceCrc32(0, noise, len));
+        }
+    }
+    ChecksumLimitFeatures(~0u);
+    free(ones);
+    free(noise);
+}
+
+/* Checksumming in two pieces, or combining the pieces' Adler-32s, matches one pass at every
+ * split point. */
+void TestChecksumSplits(void) {
+    enum { LEN = 700 };
+    unsigned char data[LEN];
+    unsigned int seed = 11;
+    for (int i = 0; i < LEN; i++)
+        data[i] = (unsigned char)HarnessRandom(&seed);
+
+    unsigned int crc = Crc32(0, data, LEN), adler = Adler32(1, data, LEN);
+    for (int split = 0; split <= LEN; split++) {
+        CHECK_EQ(Crc32(Crc32(0, data, split), data + split, LEN - split), crc);
+        unsigned int head = Adler32(1, data, split);
+        unsigned int tail = Adler32(1, data + split, LEN - split);
+        CHECK_EQ(Adler32(head, data + split, LEN - split), adler);
+        CHECK_EQ(Adler32Combine(head, tail, LEN - split), adler);
+    }
+}
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    unsigned int sink;
+} ChecksumBench;
+
+static void RunCrc(void *context) {
+    ChecksumBench *bench = (ChecksumBench *)context;
+    bench->sink += Crc32(0, bench->data, bench->len);
+}
+
+static void RunAdler(void *context) {
+    ChecksumBench *bench = (ChecksumBench *)context;
+    bench->sink += Adler32(1, bench->data, bench->len);
+}
+
+void BenchChecksum(void) {
+    static const char *names[] = {"portable", "ssse3", "pclmul", "avx2", "best"};
+    ChecksumBench bench = {NULL, 1 << 20, 0};
+    bench.data = (unsigned char *)malloc(bench.len);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < bench.len; i++)
+        bench.data[i] = (unsigned char)HarnessRandom(&seed);
+
+    char name[32];
+    for (size_t set = 0; set < FEATURE_SET_COUNT; set++) {
+        unsigned int features = featureSets[set];
+        if (features != ~0u && (CpuFeatures() & features) != features)
+            continue;
+        ChecksumLimitFeatures(features);
+        snprintf(name, sizeof(name), "crc32_%s", names[set]);
+        BenchBegin("checksum", name);
+        BenchValue("ns_per_byte", BenchMinNs(RunCrc, &bench, 20) / bench.len);
+        BenchEnd();
+        snprintf(name, sizeof(name), "adler32_%s", names[set]);
+        BenchBegin("checksum", name);
+        BenchValue("ns_per_byte", BenchMinNs(RunAdler, &bench, 20) / bench.len);
+        BenchEnd();
+    }
+    ChecksumLimitFeatures(~0u);
+    free(bench.data);
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "cases.h"
+#include "harness.h"
+
+/* Two copies of one object go through the same edits; only the first is indexed. Every lookup
+ * must find the member with the same id in both, which is what walking the list finds. */
+typedef struct {
+    cJSON *indexed;
+    cJSON *walked;
+    int nextId;
+    unsigned int seed;
+} IndexPair;
+
+#define NAME_POOL 300
+
+/* Mostly distinct names, some only differing in case, so indexes go unusable and back. */
+static void RandomName(char *name, size_t size, unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed);
+    snprintf(name, size, "%s%u", r % 16 == 0 ? "Member" : "member", (r >> 4) % NAME_POOL);
+}
+
+/* A new member with the given name and id, unlinked. Names can only be set by adding. */
+static cJSON *NamedItem(const char *name, int id) {
+    cJSON *holder = cJSON_CreateObject();
+    cJSON *item = cJSON_CreateNumber(id);
+    cJSON_AddItemToObject(holder, name, item);
+    cJSON_DetachItemViaPointer(holder, item);
+    cJSON_Delete(holder);
+    return item;
+}
+
+static double IdOf(const cJSON *item) {
+    return item ? item->valuedouble : -1;
+}
+
+static void CheckLookups(IndexPair *pair) {
+    char name[32];
+    for (int i = 0; i < 40; i++) {
+        RandomName(name, sizeof(name), &pair->seed);
+        CHECK(IdOf(cJSON_GetObjectItem(pair->indexed, name)) ==
+              IdOf(cJSON_GetObjectItem(pair->walked, name)));
+        CHECK(IdOf(cJSON_GetObjectItemCaseSensitive(pair->indexed, name)) ==
+              IdOf(cJSON_GetObjectItemCaseSensitive(pair->walked, name)));
+    }
+    CHECK(cJSON_GetObjectItem(pair->indexed, "absent") == NULL);
+    CHECK_EQ(cJSON_GetArraySize(pair->indexed), cJSON_GetArraySize(pair->walked));
+}
+
+static void RandomEdit(IndexPair *pair) {
+    char name[32];
+    unsigned int r = HarnessRandom(&pair->seed) % 100;
+    int size = cJSON_GetArraySize(pair->walked);
+    int which = size ? (int)(HarnessRandom(&pair->seed) % (unsigned int)size) : 0;
+    int id = pair->nextId++;
+    RandomName(name, sizeof(name), &pair->seed);
+
+    if (r < 40) {
+        cJSON_AddItemToObject(pair->indexed, name, cJSON_CreateNumber(id));
+        cJSON_AddItemToObject(pair->walked, name, cJSON_CreateNumber(id));
+    } else if (r < 42) {
+        /* a member without a name */
+        cJSON_AddItemToArray(pair->indexed, cJSON_CreateNumber(id));
+        cJSON_AddItemToArray(pair->walked, cJSON_CreateNumber(id));
+    } else if (r < 50) {
+        cJSON_InsertItemInArray(pair->indexed, which, NamedItem(name, id));
+        cJSON_InsertItemInArray(pair->walked, which, NamedItem(name, id));
+    } else if (r < 60) {
+        cJSON_DeleteItemFromObject(pair->indexed, name);
+        cJSON_DeleteItemFromObject(pair->walked, name);
+    } else if (r < 65) {
+        cJSON_DeleteItemFromObjectCaseSensitive(pair->indexed, name);
+        cJSON_DeleteItemFromObjectCaseSensitive(pair->walked, name);
+    } else if (r < 75) {
+        cJSON *a = cJSON_DetachItemFromArray(pair->indexed, which);
+        cJSON *b = cJSON_DetachItemFromArray(pair->walked, which);
+        CHECK(IdOf(a) == IdOf(b));
+        /* while the detached member is still alive, so a stale slot would find it */
+        if (a && a->string)
+            CHECK(IdOf(cJSON_GetObjectItem(pair->indexed, a->string)) ==
+                  IdOf(cJSON_GetObjectItem(pair->walked, a->string)));
+        cJSON_Delete(a);
+        cJSON_Delete(b);
+    } else if (r < 83) {
+        cJSON *a = cJSON_CreateNumber(id), *b = cJSON_CreateNumber(id);
+        cJSON_bool replacedA = cJSON_ReplaceItemInObject(pair->indexed, name, a);
+        cJSON_bool replacedB = cJSON_ReplaceItemInObject(pair->walked, name, b);
+        CHECK_EQ(replacedA, replacedB);
+        if (!replacedA)
+            cJSON_Delete(a);
+        if (!replacedB)
+            cJSON_Delete(b);
+    } else if (r < 90) {
+        /* renames a member: the replacement can have any name */
+        cJSON *a = NamedItem(name, id), *b = NamedItem(name, id);
+        if (!cJSON_ReplaceItemInArray(pair->indexed, which, a))
+            cJSON_Delete(a);
+        if (!cJSON_ReplaceItemInArray(pair->walked, which, b))
+            cJSON_Delete(b);
+    } else if (r < 94) {
+        /* an indexed member object, which cJSON_Delete has to unindex when it goes */
+        cJSON *a = cJSON_CreateObject(), *b = cJSON_CreateObject();
+        cJSON_AddNumberToObject(a, "id", id);
+        cJSON_AddNumberToObject(b, "id", id);
+        CHECK(cJSON_IndexObject(a));
+        cJSON_AddItemToObject(pair->indexed, name, a);
+        cJSON_AddItemToObject(pair->walked, name, b);
+    } else if (r < 97) {
+        cJSON_UnindexObject(pair->indexed);
+        CHECK(cJSON_IndexObject(pair->indexed));
+    } else {
+        CHECK(cJSON_IndexObject(pair->indexed));
+    }
+}
+
+static int hookAllocs;
+
+static void *CountingMalloc(size_t size) {
+    hookAllocs++;
+    return malloc(size);
+}
+
+void TestCjsonIndex(void) {
+    /* Only plain objects can be indexed. */
+    cJSON *array = cJSON_CreateArray();
+    cJSON *object = cJSON_CreateObject();
+    cJSON *reference = cJSON_CreateObjectReference(object);
+    CHECK(!cJSON_IndexObject(NULL));
+    CHECK(!cJSON_IndexObject(array));
+    CHECK(!cJSON_IndexObject(reference));
+    CHECK(cJSON_IndexObject(object));
+    CHECK(cJSON_IndexObject(object));
+    cJSON_UnindexObject(array);
+    cJSON_UnindexObject(NULL);
+    cJSON_Delete(reference);
+    cJSON_Delete(array);
+
+    /* Lookups in a large unindexed object do not allocate, so they leave it alone. */
+    cJSON *large = cJSON_CreateObject();
+    char name[32];
+    for (int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "member%d", i);
+        cJSON_AddNumberToObject(large, name, i);
+    }
+    cJSON_Hooks hooks = {CountingMalloc, free};
+    cJSON_InitHooks(&hooks);
+    hookAllocs = 0;
+    for (int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "MEMBER%d", i);
+        CHECK(IdOf(cJSON_GetObjectItem(large, name)) == i);
+        CHECK(cJSON_GetObjectItemCaseSensitive(large, name) == NULL);
+    }
+    CHECK_EQ(hookAllocs, 0);
+    cJSON_InitHooks(NULL);
+    cJSON_Delete(large);
+
+    /* Random edits, checked against walking after each one. */
+    for (unsigned int round = 0; round < 8; round++) {
+        IndexPair pair = {cJSON_CreateObject(), cJSON_CreateObject(), 0, 0x1D3 + round};
+        CHECK(cJSON_IndexObject(pair.indexed));
+        for (int step = 0; step < 3000; step++) {
+            RandomEdit(&pair);
+            CheckLookups(&pair);
+        }
+        cJSON_Delete(pair.indexed);
+        cJSON_Delete(pair.walked);
+    }
+
+    /* Objects freed while indexed must not hand their index to whatever reuses the memory. */
+    for (int i = 0; i < 2000; i++) {
+        cJSON *o = cJSON_CreateObject();
+        for (int j = 0; j <= i % 4; j++) {
+            snprintf(name, sizeof(name), "k%d", i + j);
+            cJSON_AddNumberToObject(o, name, i + j);
+        }
+        if (i % 3 != 0)
+            CHECK(cJSON_IndexObject(o));
+        for (int j = 0; j <= i % 4; j++) {
+            snprintf(name, sizeof(name), "k%d", i + j);
+            CHECK(IdOf(cJSON_GetObjectItem(o, name)) == i + j);
+        }
+        snprintf(name, sizeof(name), "k%d", i - 1);
+        CHECK(cJSON_GetObjectItem(o, name) == NULL);
+        cJSON_Delete(o);
+    }
+    cJSON_Delete(object);
+}
+
+#define LOOKUP_NAMES 64
+
+typedef struct {
+    cJSON *object;
+    char names[LOOKUP_NAMES][32];
+    int found;
+} IndexRun;
+
+static void Lookup(void *context) {
+    IndexRun *run = (IndexRun *)context;
+    for (int i = 0; i < LOOKUP_NAMES; i++)
+        run->found += cJSON_GetObjectItem(run->object, run->names[i]) != NULL;
+}
+
+static void IndexAgain(void *context) {
+    cJSON_IndexObject(((IndexRun *)context)->object);
+}
+
+void BenchCjsonIndex(void) {
+    static const int sizes[] = {10, 100, 1000, 10000, 100000};
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        static IndexRun run;
+        int members = sizes[s];
+        unsigned int seed = 29;
+        run.object = cJSON_CreateObject();
+        for (int i = 0; i < members; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "member%d", i);
+            cJSON_AddNumberToObject(run.object, name, i);
+        }
+        /* One in eight misses, the walk's worst case. */
+        for (int i = 0; i < LOOKUP_NAMES; i++) {
+            unsigned int r = HarnessRandom(&seed);
+            snprintf(run.names[i], sizeof(run.names[i]), r % 8 ? "member%u" : "missing%u",
+                (r >> 3) % (unsigned int)members);
+        }
+
+        int iterations = members >= 10000 ? 2 : 200;
+        double walk = BenchMinNs(Lookup, &run, iterations) / LOOKUP_NAMES;
+        cJSON_IndexObject(run.object);
+        double indexed = BenchMinNs(Lookup, &run, 200) / LOOKUP_NAMES;
+        double build = BenchMinNs(IndexAgain, &run, members >= 10000 ? 5 : 200);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%d_members", members);
+        BenchBegin("cjson_index", name);
+        BenchValue("members", members);
+        BenchValue("ns_per_lookup", indexed);
+        BenchValue("walk_ns_per_lookup", walk);
+        BenchValue("speedup", walk / indexed);
+        BenchValue("index_ns", build);
+        BenchEnd();
+        cJSON_Delete(run.object);
+    }
+}
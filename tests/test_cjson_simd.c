@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "cases.h"
+#include "config_gen.h"
+#include "cpu_features.h"
+#include "harness.h"
+
+/* cJSON built again with CJSON_DISABLE_SIMD and its public functions renamed scalar_cJSON_*;
+ * see the Makefile. Its trees are ordinary cJSON trees. */
+cJSON *scalar_cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length,
+    const char **return_parse_end, cJSON_bool require_null_terminated);
+cJSON_bool scalar_cJSON_ParseWithEvents(const char *value, size_t buffer_length,
+    const cJSON_Events *events, void *context);
+void scalar_cJSON_Delete(cJSON *item);
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Bytes;
+
+static void Put(Bytes *bytes, const void *data, size_t length) {
+    if (bytes->length + length + 1 > bytes->capacity) {
+        size_t capacity = bytes->capacity ? bytes->capacity : 256;
+        while (bytes->length + length + 1 > capacity)
+            capacity *= 2;
+        bytes->data = (char *)realloc(bytes->data, capacity);
+        bytes->capacity = capacity;
+    }
+    memcpy(bytes->data + bytes->length, data, length);
+    bytes->length += length;
+    bytes->data[bytes->length] = '\0';
+}
+
+static void PutText(Bytes *bytes, const char *text) {
+    Put(bytes, text, strlen(text));
+}
+
+static void PutByte(Bytes *bytes, unsigned char c) {
+    Put(bytes, &c, 1);
+}
+
+/* Whitespace runs of every length around the 16- and 32-byte chunks, now and then ending in a
+ * byte that is not whitespace but compares low if bytes are taken as signed. */
+static void PutWhitespace(Bytes *bytes, unsigned int *seed) {
+    static const char spaces[] = " \t\r\n";
+    unsigned int r = HarnessRandom(seed) % 8;
+    int length = r < 3 ? (int)(HarnessRandom(seed) % 4) : (int)(HarnessRandom(seed) % 150);
+    for (int i = 0; i < length; i++)
+        PutByte(bytes, (unsigned char)spaces[HarnessRandom(seed) % 4]);
+    if (HarnessRandom(seed) % 32 == 0)
+        PutByte(bytes, (unsigned char)(HarnessRandom(seed) % 2 ? 0x80 + HarnessRandom(seed) % 128
+                                                                : 1 + HarnessRandom(seed) % 31));
+}
+
+/* A string literal of any length with escapes, \u sequences (some broken, some surrogate
+ * pairs), UTF-8 and bytes below 32 at random offsets. */
+static void PutString(Bytes *bytes, unsigned int *seed) {
+    static const char *const escapes[] = {"\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9",
+        "\\ud83d\\ude00", "\\ud83d", "\\u12", "\\x", "\\"};
+    int length = (int)(HarnessRandom(seed) % (HarnessRandom(seed) % 4 ? 24 : 300));
+    PutByte(bytes, '"');
+    for (int i = 0; i < length; i++) {
+        unsigned int r = HarnessRandom(seed) % 64;
+        if (r == 0)
+            PutText(bytes, escapes[HarnessRandom(seed) % (sizeof(escapes) / sizeof(escapes[0]))]);
+        else if (r == 1)
+            PutByte(bytes, (unsigned char)(0x80 + HarnessRandom(seed) % 128));
+        else if (r == 2 && HarnessRandom(seed) % 8 == 0)
+            PutByte(bytes, (unsigned char)(HarnessRandom(seed) % 32));
+        else
+            PutByte(bytes, (unsigned char)('a' + HarnessRandom(seed) % 26));
+    }
+    PutByte(bytes, '"');
+}
+
+static void PutValue(Bytes *bytes, int depth, unsigned int *seed) {
+    unsigned int r = HarnessRandom(seed) % 8;
+    PutWhitespace(bytes, seed);
+    if (depth <= 0 || r < 3) {
+        if (r % 2)
+            PutString(bytes, seed);
+        else
+            PutText(bytes, r == 0 ? "-12.5e3" : r == 2 ? "true" : "null");
+    } else {
+        int object = r < 6;
+        int count = (int)(HarnessRandom(seed) % 6);
+        PutByte(bytes, object ? '{' : '[');
+        for (int i = 0; i < count; i++) {
+            if (i)
+                PutByte(bytes, ',');
+            if (object) {
+                PutWhitespace(bytes, seed);
+                PutString(bytes, seed);
+                PutWhitespace(bytes, seed);
+                PutByte(bytes, ':');
+            }
+            PutValue(bytes, depth - 1, seed);
+        }
+        PutWhitespace(bytes, seed);
+        PutByte(bytes, object ? '}' : ']');
+    }
+    PutWhitespace(bytes, seed);
+}
+
+/* One document: a generated config or a tree of the above, then maybe flipped bytes, an extra
+ * whitespace run or a cut. */
+static void MakeDocument(Bytes *bytes, unsigned int *seed) {
+    bytes->length = 0;
+    unsigned int shape = HarnessRandom(seed) % 8;
+    if (shape == 0) {
+        size_t length;
+        char *config = GenerateMessyConfig(HarnessRandom(seed), &length);
+        Put(bytes, config, length);
+        free(config);
+    } else if (shape == 1) {
+        size_t length;
+        char *config = GenerateConfig(HarnessRandom(seed) % 4000, (int)(HarnessRandom(seed) % 4),
+            HarnessRandom(seed), &length);
+        Put(bytes, config, length);
+        free(config);
+    } else {
+        PutValue(bytes, 4, seed);
+    }
+
+    unsigned int mutation = HarnessRandom(seed) % 8;
+    if (mutation == 0 && bytes->length > 0) {
+        for (int flips = 1 + (int)(HarnessRandom(seed) % 3); flips > 0; flips--)
+            bytes->data[HarnessRandom(seed) % bytes->length] = (char)HarnessRandom(seed);
+    } else if (mutation == 1 && bytes->length > 0) {
+        size_t at = HarnessRandom(seed) % bytes->length;
+        Bytes tail = {0};
+        Put(&tail, bytes->data + at, bytes->length - at);
+        bytes->length = at;
+        PutWhitespace(bytes, seed);
+        Put(bytes, tail.data, tail.length);
+        free(tail.data);
+    } else if (mutation == 2 && bytes->length > 0) {
+        bytes->length = HarnessRandom(seed) % bytes->length;
+    }
+}
+
+/* Writes the events as text, so two parses can be compared with one strcmp. */
+static cJSON_bool LogStartObject(void *context, const char *key) {
+    PutText((Bytes *)context, "{");
+    PutText((Bytes *)context, key ? key : "-");
+    return 1;
+}
+
+static cJSON_bool LogEndObject(void *context) {
+    PutText((Bytes *)context, "}");
+    return 1;
+}
+
+static cJSON_bool LogStartArray(void *context, const char *key) {
+    PutText((Bytes *)context, "[");
+    PutText((Bytes *)context, key ? key : "-");
+    return 1;
+}
+
+static cJSON_bool LogEndArray(void *context) {
+    PutText((Bytes *)context, "]");
+    return 1;
+}
+
+static cJSON_bool LogValue(void *context, const cJSON *item) {
+    char number[64];
+    snprintf(number, sizeof(number), "=%d:%.17g:", item->type, item->valuedouble);
+    PutText((Bytes *)context, item->string ? item->string : "-");
+    PutText((Bytes *)context, number);
+    PutText((Bytes *)context, item->valuestring ? item->valuestring : "-");
+    return 1;
+}
+
+static const cJSON_Events logEvents = {LogStartObject, LogEndObject, LogStartArray, LogEndArray,
+    LogValue};
+
+static int CheckDocument(const char *text, size_t length, cJSON_bool terminated) {
+    int failures = 0;
+    const char *simdEnd = NULL, *scalarEnd = NULL;
+    cJSON *simd = cJSON_ParseWithLengthOpts(text, length, &simdEnd, terminated);
+    cJSON *scalar = scalar_cJSON_ParseWithLengthOpts(text, length, &scalarEnd, terminated);
+    failures += (simd == NULL) != (scalar == NULL);
+    failures += simdEnd != scalarEnd;
+    if (simd && scalar) {
+        char *a = cJSON_PrintUnformatted(simd), *b = cJSON_PrintUnformatted(scalar);
+        failures += !a || !b || strcmp(a, b) != 0;
+        free(a);
+        free(b);
+    }
+    cJSON_Delete(simd);
+    scalar_cJSON_Delete(scalar);
+
+    Bytes simdLog = {0}, scalarLog = {0};
+    PutText(&simdLog, cJSON_ParseWithEvents(text, length, &logEvents, &simdLog) ? "ok" : "fail");
+    PutText(&scalarLog,
+        scalar_cJSON_ParseWithEvents(text, length, &logEvents, &scalarLog) ? "ok" : "fail");
+    failures += strcmp(simdLog.data, scalarLog.data) != 0;
+    free(simdLog.data);
+    free(scalarLog.data);
+    return failures;
+}
+
+void TestCjsonSimdMatchesScalar(void) {
+    int avx2 = (CpuFeatures() & CPU_FEATURE_AVX2) != 0;
+    for (int mode = 0; mode <= avx2; mode++) {
+        cJSON_SetCpuHasAvx2(mode);
+        unsigned int seed = 0x5EED + (unsigned int)mode;
+        Bytes document = {0};
+        for (int i = 0; i < 10000; i++) {
+            MakeDocument(&document, &seed);
+            /* Exactly sized, so reading past the end shows up under ASan; then with its NUL. */
+            char *exact = (char *)malloc(document.length ? document.length : 1);
+            memcpy(exact, document.data, document.length);
+            int failures = CheckDocument(exact, document.length, 0);
+            free(exact);
+            document.data[document.length] = '\0';
+            failures += CheckDocument(document.data, document.length + 1, 1);
+            if (failures) {
+                fprintf(stderr, "document %d (%s): %.200s\n", i, mode ? "avx2" : "sse2",
+                    document.data);
+                CHECK_EQ(failures, 0);
+            }
+        }
+        free(document.data);
+    }
+    cJSON_SetCpuHasAvx2(0);
+}
@@ -0,0 +1,222 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "clipboard_cache.h"
+#include "harness.h"
+#include "png_writer.h"
+
+/* Stands in for the Win32 clipboard and the window procedure in main.c: offers, additions
+ * to an offer, pastes and another application taking the clipboard, all driven by hand so the
+ * ordering races between the worker and the window can be replayed exactly. */
+typedef struct {
+    ClipboardCache cache;
+    unsigned int offered;  /* generation on the clipboard, 0 once someone else owns it */
+    unsigned int formats;  /* CLIPBOARD_OFFER_* bits announced for it */
+    unsigned char *pasted; /* last rendered data */
+    size_t pastedLen;
+} MockClipboard;
+
+static void MockInit(MockClipboard *mock) {
+    memset(mock, 0, sizeof(*mock));
+    ClipboardCacheInit(&mock->cache);
+}
+
+static void MockFree(MockClipboard *mock) {
+    free(mock->pasted);
+    ClipboardCacheRelease(&mock->cache, mock->cache.generation);
+}
+
+/* WM_CLIPBOARD_OFFER. */
+static void MockOffer(MockClipboard *mock, unsigned int generation, unsigned int added) {
+    if (added && generation != mock->offered)
+        return;
+    unsigned int ready = ClipboardCacheReady(&mock->cache, generation) & (added ? added : ~0u);
+    if (!ready)
+        return;
+    if (!added) {
+        mock->offered = generation;
+        mock->formats = 0;
+    }
+    mock->formats |= ready;
+}
+
+/* WM_RENDERFORMAT: only copies what is ready. Returns 0 where the real window would fail. */
+static int MockPaste(MockClipboard *mock, unsigned int format) {
+    if (!(mock->formats & format))
+        return 0;
+    unsigned int ready = ClipboardCacheReady(&mock->cache, mock->offered);
+    if (!(ready & format))
+        return 0;
+
+    free(mock->pasted);
+    mock->pasted = NULL;
+    mock->pastedLen = 0;
+    if (format == CLIPBOARD_OFFER_DIB) {
+        mock->pastedLen = ClipboardCacheDibSize(&mock->cache);
+        mock->pasted = (unsigned char *)malloc(mock->pastedLen);
+        ClipboardCacheWriteDib(&mock->cache, mock->pasted);
+    } else if (format == CLIPBOARD_OFFER_PNG) {
+        int len = 0;
+        const unsigned char *png = ClipboardCachePng(&mock->cache, &len);
+        mock->pastedLen = (size_t)len;
+        mock->pasted = (unsigned char *)malloc(mock->pastedLen);
+        memcpy(mock->pasted, png, mock->pastedLen);
+    }
+    return 1;
+}
+
+/* WM_DESTROYCLIPBOARD: another application copied something. */
+static void MockLoseOwnership(MockClipboard *mock) {
+    ClipboardCacheRelease(&mock->cache, mock->offered);
+    mock->offered = 0;
+    mock->formats = 0;
+}
+
+/* The worker side of CaptureClientAreaToClipboard, split at the point where the window may
+ * run in between. */
+static unsigned int MockCapture(MockClipboard *mock, const unsigned char *pixels, int stride,
+    int width, int height) {
+    unsigned char *packed = ClipboardCachePackPixels(pixels, stride, width, height);
+    CHECK(packed != NULL);
+    unsigned int generation = ClipboardCacheSet(&mock->cache, packed, width, height,
+        CLIPBOARD_OFFER_DIB | CLIPBOARD_OFFER_PNG);
+    MockOffer(mock, generation, 0);
+    return generation;
+}
+
+static unsigned char *EncodePng(const unsigned char *pixels, int stride, int width, int height,
+    int *len) {
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+    return PngEncodeToMemory(pixels, stride, width, height, 3, &options, len);
+}
+
+static int MockAttachPng(MockClipboard *mock, unsigned int generation,
+    const unsigned char *pixels, int stride, int width, int height) {
+    int len = 0;
+    unsigned char *png = EncodePng(pixels, stride, width, height, &len);
+    if (!ClipboardCacheSetPng(&mock->cache, generation, png, len)) {
+        PngFree(png);
+        return 0;
+    }
+    MockOffer(mock, generation, CLIPBOARD_OFFER_PNG);
+    return 1;
+}
+
+static void FillCapture(unsigned char *pixels, int stride, int height, unsigned char seed) {
+    for (int i = 0; i < stride * height; i++)
+        pixels[i] = (unsigned char)(seed + i * 13);
+}
+
+static unsigned int Read32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+void TestClipboardCacheDib(void) {
+    /* A 3x2 capture in a wider surface, so the stride is not the packed row size. */
+    unsigned char surface[2 * 16];
+    FillCapture(surface, 16, 2, 1);
+    MockClipboard mock;
+    MockInit(&mock);
+    MockCapture(&mock, surface, 16, 3, 2);
+
+    CHECK(MockPaste(&mock, CLIPBOARD_OFFER_DIB));
+    CHECK_EQ(mock.pastedLen, 40 + 3 * 4 * 2);
+    CHECK_EQ(Read32(mock.pasted), 40);
+    CHECK_EQ(Read32(mock.pasted + 4), 3);
+    CHECK_EQ(Read32(mock.pasted + 8), 2);
+    CHECK_EQ(mock.pasted[14], 32);
+    CHECK_EQ(Read32(mock.pasted + 20), 24);
+    /* Bottom-up: the last capture row comes first. */
+    CHECK(memcmp(mock.pasted + 40, surface + 16, 12) == 0);
+    CHECK(memcmp(mock.pasted + 52, surface, 12) == 0);
+    MockFree(&mock);
+}
+
+/* The DIB is pasteable straight away; the PNG is announced and pasteable only once the worker
+ * has attached its encode, and it is the same PNG as encoding the capture directly. */
+void TestClipboardCacheRenderOnDemand(void) {
+    enum { W = 40, H = 30 };
+    static unsigned char surface[W * 4 * H];
+    FillCapture(surface, W * 4, H, 7);
+    MockClipboard mock;
+    MockInit(&mock);
+
+    unsigned int generation = MockCapture(&mock, surface, W * 4, W, H);
+    CHECK(generation != 0);
+    CHECK_EQ(mock.offered, generation);
+    CHECK_EQ(mock.formats, CLIPBOARD_OFFER_DIB);
+    CHECK(!MockPaste(&mock, CLIPBOARD_OFFER_PNG));
+    CHECK(MockPaste(&mock, CLIPBOARD_OFFER_DIB));
+
+    CHECK(MockAttachPng(&mock, generation, surface, W * 4, W, H));
+    CHECK_EQ(mock.formats, CLIPBOARD_OFFER_DIB | CLIPBOARD_OFFER_PNG);
+    CHECK(MockPaste(&mock, CLIPBOARD_OFFER_PNG));
+
+    int len = 0;
+    unsigned char *direct = EncodePng(surface, W * 4, W, H, &len);
+    CHECK_EQ(mock.pastedLen, len);
+    CHECK(direct && memcmp(mock.pasted, direct, (size_t)len) == 0);
+    PngFree(direct);
+
+    /* A second encode for the same capture is refused rather than leaked or swapped in. */
+    CHECK(!MockAttachPng(&mock, generation, surface, W * 4, W, H));
+    MockFree(&mock);
+}
+
+/* A newer capture, or another application's copy, lands while the PNG is still encoding. */
+void TestClipboardCacheRaces(void) {
+    enum { W = 8, H = 8 };
+    unsigned char first[W * 4 * H], second[W * 4 * H];
+    FillCapture(first, W * 4, H, 1);
+    FillCapture(second, W * 4, H, 2);
+    MockClipboard mock;
+    MockInit(&mock);
+
+    unsigned int a = MockCapture(&mock, first, W * 4, W, H);
+    unsigned int b = MockCapture(&mock, second, W * 4, W, H);
+    CHECK(a != b);
+    CHECK(!MockAttachPng(&mock, a, first, W * 4, W, H));
+    CHECK_EQ(mock.offered, b);
+    CHECK_EQ(mock.formats, CLIPBOARD_OFFER_DIB);
+    CHECK(MockPaste(&mock, CLIPBOARD_OFFER_DIB));
+    CHECK(memcmp(mock.pasted + 40 + (H - 1) * W * 4, second, W * 4) == 0);
+
+    /* A release for the replaced generation leaves the current one alone. */
+    ClipboardCacheRelease(&mock.cache, a);
+    CHECK(ClipboardCacheIsCurrent(&mock.cache, b));
+
+    /* Once the user copies something else the late PNG is dropped and nothing is re-offered. */
+    MockLoseOwnership(&mock);
+    CHECK(!ClipboardCacheIsCurrent(&mock.cache, b));
+    CHECK(!MockAttachPng(&mock, b, second, W * 4, W, H));
+    CHECK_EQ(mock.offered, 0);
+    CHECK_EQ(mock.formats, 0);
+    MockFree(&mock);
+}
+
+void TestClipboardCacheFileAndEdges(void) {
+    ClipboardCache cache;
+    ClipboardCacheInit(&cache);
+
+    /* The file offer carries no pixels and is ready as soon as it is set. */
+    unsigned int generation = ClipboardCacheSet(&cache, NULL, 0, 0, CLIPBOARD_OFFER_FILE);
+    CHECK_EQ(ClipboardCacheReady(&cache, generation), CLIPBOARD_OFFER_FILE);
+    CHECK_EQ(ClipboardCacheDibSize(&cache), 0);
+    CHECK_EQ(ClipboardCacheReady(&cache, generation + 1), 0);
+    CHECK_EQ(ClipboardCacheReady(&cache, 0), 0);
+
+    /* A DIB offer without pixels (the copy failed) is withdrawn instead of offered empty. */
+    generation = ClipboardCacheSet(&cache, NULL, 4, 4, CLIPBOARD_OFFER_DIB | CLIPBOARD_OFFER_PNG);
+    CHECK_EQ(ClipboardCacheReady(&cache, generation), 0);
+    CHECK_EQ(cache.offers, CLIPBOARD_OFFER_PNG);
+
+    /* The generation skips 0 when it wraps, since 0 means nothing is on the clipboard. */
+    cache.generation = UINT_MAX;
+    generation = ClipboardCacheSet(&cache, NULL, 0, 0, CLIPBOARD_OFFER_FILE);
+    CHECK_EQ(generation, 1);
+    ClipboardCacheRelease(&cache, generation);
+    CHECK(!ClipboardCacheIsCurrent(&cache, generation));
+}
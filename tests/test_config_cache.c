@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "cases.h"
+#include "checksum.h"
+#include "config_cache.h"
+#include "config_compile.h"
+#include "config_gen.h"
+#include "harness.h"
+
+void TestConfigCache(void) {
+    static CompiledConfig config, loaded;
+    static Arena arena;
+    ArenaInit(&arena, ARENA_MIN_BLOCK);
+    memset(&config, 0, sizeof(config));
+    CHECK(CompileConfig(sessionConfig, &config, &arena, NULL));
+
+    ConfigSource source = {strlen(sessionConfig), 1234, 0, ConfigCacheLayout()};
+    source.crc = Crc32(0, sessionConfig, strlen(sessionConfig));
+    size_t size = ConfigCacheBytes();
+    unsigned char *image = (unsigned char *)malloc(size);
+    ConfigCacheBuild(image, &source, &config);
+    CHECK(ConfigCacheLoad(image, size, &source, &loaded));
+    CHECK(memcmp(&loaded, &config, sizeof(config)) == 0);
+    CHECK(!ConfigCacheLoad(image, size - 1, &source, &loaded));
+
+    /* Another build, another edit or a touched file each miss. */
+    ConfigSource other = source;
+    other.build ^= 1;
+    CHECK(!ConfigCacheLoad(image, size, &other, &loaded));
+    CHECK(!ConfigSourceSameContent(&source, &other));
+    other = source;
+    other.crc ^= 1;
+    CHECK(!ConfigCacheLoad(image, size, &other, &loaded));
+    other = source;
+    other.modified++;
+    CHECK(!ConfigCacheLoad(image, size, &other, &loaded));
+    /* ...but a touched file still has the content that is applied already. */
+    CHECK(ConfigSourceSameContent(&source, &other));
+
+    image[size - 1] ^= 0x40;
+    CHECK(!ConfigCacheLoad(image, size, &source, &loaded));
+    free(image);
+
+    CHECK_EQ(ConfigCacheLayout(), ConfigCacheLayout());
+    CHECK(ConfigCacheLayout() != 0);
+}
+
+
+/* A generated config cut to exactly count bindings. */
+static char *ConfigWithBindings(int count, size_t *length) {
+    size_t generated;
+    char *json = GenerateConfig((size_t)count * 200, 0, 13, &generated);
+    if (!json)
+        return NULL;
+
+    char *p = strstr(json, "\"bindings\": [");
+    for (int i = 0; p && i <= count; i++)
+        p = strstr(p + 1, "\n    {");
+    if (p) {
+        if (p[-1] == ',')
+            p--;
+        strcpy(p, "\n  ]\n}\n");
+    }
+    *length = strlen(json);
+    return json;
+}
+
+typedef struct {
+    const char *json;
+    size_t length;
+    ConfigSource source;
+    unsigned char *image;
+    size_t imageSize;
+    Arena arena;
+    CompiledConfig config;
+    int ok;
+} CacheRun;
+
+/* What LoadConfig does on a hit: checksum the JSON it read, then load the image. */
+static void LoadFromCache(void *context) {
+    CacheRun *run = (CacheRun *)context;
+    run->source.crc = Crc32(0, run->json, run->length);
+    run->ok = ConfigCacheLoad(run->image, run->imageSize, &run->source, &run->config);
+}
+
+/* And on a miss: checksum, compile, and build the image to write back. */
+static void CompileAndBuild(void *context) {
+    CacheRun *run = (CacheRun *)context;
+    run->source.crc = Crc32(0, run->json, run->length);
+    memset(&run->config, 0, sizeof(run->config));
+    run->ok = CompileConfig(run->json, &run->config, &run->arena, NULL);
+    ConfigCacheBuild(run->image, &run->source, &run->config);
+}
+
+#define EVICT_BYTES (64u << 20)
+#define COLD_ROUNDS 5
+
+/* One call after the CPU caches have been flushed by writing more than they hold, and with an
+ * arena that has not learned a size yet, as on the first load after startup. */
+static double ColdNs(void (*body)(void *), CacheRun *run, unsigned char *evict) {
+    double best = 0;
+    for (int round = 0; round < COLD_ROUNDS; round++) {
+        memset(evict, round, EVICT_BYTES);
+        ArenaInit(&run->arena, ARENA_MIN_BLOCK);
+        unsigned long long start = BenchNowNs();
+        body(run);
+        double ns = (double)(BenchNowNs() - start);
+        ArenaReset(&run->arena);
+        if (round == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+/* The config cache against compiling: a hit is a checksum of the JSON and a load of a fixed-size
+ * image, a miss parses the whole document. Cold runs start with flushed CPU caches. */
+void BenchConfigCache(void) {
+    static const int bindingCounts[] = {64, 10000};
+    static const struct {
+        const char *name;
+        void (*body)(void *);
+    } paths[] = {{"cache_load", LoadFromCache}, {"compile", CompileAndBuild}};
+
+    unsigned char *evict = (unsigned char *)malloc(EVICT_BYTES);
+    if (!evict)
+        return;
+    for (int b = 0; b < (int)(sizeof(bindingCounts) / sizeof(bindingCounts[0])); b++) {
+        static CacheRun run;
+        char *json = ConfigWithBindings(bindingCounts[b], &run.length);
+        if (!json)
+            break;
+        run.json = json;
+        run.source.size = run.length;
+        run.source.modified = 1;
+        run.source.build = ConfigCacheLayout();
+        run.imageSize = ConfigCacheBytes();
+        run.image = (unsigned char *)malloc(run.imageSize);
+        ArenaInit(&run.arena, ARENA_MIN_BLOCK);
+        CompileAndBuild(&run);
+        LoadFromCache(&run);
+        int hit = run.ok;
+        int iterations = bindingCounts[b] > 1000 ? 20 : 2000;
+
+        for (int p = 0; p < (int)(sizeof(paths) / sizeof(paths[0])); p++) {
+            double warm = BenchMinNs(paths[p].body, &run, iterations);
+            ArenaReset(&run.arena);
+            double cold = ColdNs(paths[p].body, &run, evict);
+            ArenaInit(&run.arena, ARENA_MIN_BLOCK);
+
+            char name[64];
+            snprintf(name, sizeof(name), "%d_bindings_%s", bindingCounts[b], paths[p].name);
+            BenchBegin("config_cache", name);
+            BenchValue("json_bytes", (double)run.length);
+            BenchValue("image_bytes", (double)run.imageSize);
+            BenchValue("hit", hit);
+            BenchValue("warm_us", warm / 1e3);
+            BenchValue("cold_us", cold / 1e3);
+            BenchEnd();
+        }
+        ArenaReset(&run.arena);
+        free(run.image);
+        free(json);
+    }
+    free(evict);
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <string.h>
+#include "cases.h"
+#include "config_compile.h"
+#include "config_name_tables.h"
+#include "config_names.h"
+#include "harness.h"
+
+/* The lists straight from config_names.h, to hold the generated tables against. */
+#define NAME_ENTRY(name, value, description) {name, value},
+#define MOUSE_TRIGGER_ENTRY(name, type, code, description) {name, TRIGGER_NAME_VALUE(type, code)},
+#define KEY_TRIGGER_ENTRY(name, vk) {"key_" name, TRIGGER_NAME_VALUE(TRIGGER_KEYBOARD, vk)},
+
+static const NameEntry sourceModifiers[] = {CONFIG_MODIFIER_NAMES(NAME_ENTRY)};
+static const NameEntry sourceActions[] = {CONFIG_ACTION_NAMES(NAME_ENTRY)};
+static const NameEntry sourceTriggers[] = {
+    CONFIG_MOUSE_TRIGGER_NAMES(MOUSE_TRIGGER_ENTRY) CONFIG_KEY_NAMES(KEY_TRIGGER_ENTRY)};
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+/* What the lookups replaced: a strcmp per name until one matches. */
+static const NameEntry *LadderFind(const NameEntry *entries, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+/* A word that is not in the list must miss; one that is (key_f1 is a prefix of key_f10) must
+ * find the same entry the ladder does. */
+static void CheckLookup(const NameTable *table, const NameEntry *source, int count,
+    const char *word) {
+    const NameEntry *expected = LadderFind(source, count, word);
+    const NameEntry *found = NameTableFind(table, word);
+    CHECK((found == NULL) == (expected == NULL));
+    if (found && expected)
+        CHECK_EQ(found - table->entries, expected - source);
+}
+
+static void CheckTable(const NameTable *table, const NameEntry *source, int count) {
+    CHECK_EQ(table->count, count);
+    for (int i = 0; i < count && i < table->count; i++) {
+        CHECK_EQ(strcmp(table->entries[i].name, source[i].name), 0);
+        CHECK_EQ(table->entries[i].value, source[i].value);
+        CHECK(NameTableFind(table, source[i].name) == &table->entries[i]);
+
+        /* Near misses: another case for the last letter, a prefix and an extension. */
+        char word[64];
+        size_t length = strlen(source[i].name);
+        memcpy(word, source[i].name, length + 1);
+        word[length - 1] ^= 0x20;
+        CheckLookup(table, source, count, word);
+        word[length - 1] = '\0';
+        CheckLookup(table, source, count, word);
+        snprintf(word, sizeof(word), "%s0", source[i].name);
+        CheckLookup(table, source, count, word);
+    }
+    CHECK(NameTableFind(table, "") == NULL);
+    CHECK(NameTableFind(table, NULL) == NULL);
+
+    /* The generated layout is what NameTableBuild gives on the build machine. */
+    NameTable built;
+    CHECK(NameTableBuild(&built, table->entries, table->count));
+    CHECK_EQ(built.seed, table->seed);
+    CHECK_EQ(built.buckets, table->buckets);
+    CHECK(memcmp(built.displace, table->displace, sizeof(built.displace)) == 0);
+    CHECK(memcmp(built.slots, table->slots, sizeof(built.slots)) == 0);
+}
+
+static int warnings;
+
+static void CountWarning(const char *format, ...) {
+    (void)format;
+    warnings++;
+}
+
+static const HotkeyBinding *CompileOne(const char *binding, CompiledConfig *config) {
+    static Arena arena;
+    static int ready;
+    if (!ready) {
+        ArenaInit(&arena, ARENA_MIN_BLOCK);
+        ready = 1;
+    }
+    char json[256];
+    snprintf(json, sizeof(json), "{\"bindings\": [{%s}]}", binding);
+    warnings = 0;
+    if (!CompileConfig(json, config, &arena, CountWarning) || config->bindingCount != 1)
+        return NULL;
+    return &config->bindings[0];
+}
+
+void TestConfigNames(void) {
+    CheckTable(&modifierTable, sourceModifiers, COUNT(sourceModifiers));
+    CheckTable(&actionTable, sourceActions, COUNT(sourceActions));
+    CheckTable(&triggerTable, sourceTriggers, COUNT(sourceTriggers));
+
+    /* Every name, through the whole config compiler. */
+    static CompiledConfig config;
+    char binding[160];
+    for (int i = 0; i < COUNT(sourceModifiers); i++) {
+        snprintf(binding, sizeof(binding),
+            "\"alt\": \"%s\", \"trigger\": \"key_a\", \"action\": \"play_pause\"",
+            sourceModifiers[i].name);
+        const HotkeyBinding *b = CompileOne(binding, &config);
+        CHECK(b && b->alt == (ModifierState)sourceModifiers[i].value);
+        CHECK_EQ(warnings, 0);
+    }
+    for (int i = 0; i < COUNT(sourceActions); i++) {
+        snprintf(binding, sizeof(binding), "\"trigger\": \"key_a\", \"action\": \"%s\"",
+            sourceActions[i].name);
+        const HotkeyBinding *b = CompileOne(binding, &config);
+        CHECK(b && b->action == (MediaAction)sourceActions[i].value);
+        CHECK_EQ(warnings, 0);
+        CHECK_EQ(strcmp(ConfigActionName((MediaAction)sourceActions[i].value),
+                     sourceActions[i].name), 0);
+    }
+    for (int i = 0; i < COUNT(sourceTriggers); i++) {
+        snprintf(binding, sizeof(binding), "\"trigger\": \"%s\", \"action\": \"play_pause\"",
+            sourceTriggers[i].name);
+        const HotkeyBinding *b = CompileOne(binding, &config);
+        CHECK(b != NULL);
+        CHECK_EQ(warnings, 0);
+        if (!b)
+            continue;
+        int type = sourceTriggers[i].value >> 16, code = sourceTriggers[i].value & 0xFFFF;
+        CHECK_EQ(b->triggerType, type);
+        if (type == TRIGGER_KEYBOARD)
+            CHECK_EQ(b->trigger.keyCode, code);
+        else if (type == TRIGGER_MOUSE_BUTTON)
+            CHECK_EQ(b->trigger.mouseButton, code);
+        else
+            CHECK_EQ(b->trigger.wheelDir, code);
+    }
+}
+
+#define LOOKUP_WORDS 256
+
+typedef struct {
+    const NameTable *table;
+    const char *words[LOOKUP_WORDS];
+    int found;
+} LookupRun;
+
+static void LookupHashed(void *context) {
+    LookupRun *run = (LookupRun *)context;
+    for (int i = 0; i < LOOKUP_WORDS; i++)
+        run->found += NameTableFind(run->table, run->words[i]) != NULL;
+}
+
+static void LookupLadder(void *context) {
+    LookupRun *run = (LookupRun *)context;
+    for (int i = 0; i < LOOKUP_WORDS; i++)
+        run->found += LadderFind(run->table->entries, run->table->count, run->words[i]) != NULL;
+}
+
+void BenchConfigNames(void) {
+    static const struct {
+        const char *name;
+        const NameTable *table;
+    } tables[] = {
+        {"modifiers", &modifierTable}, {"actions", &actionTable}, {"triggers", &triggerTable}};
+    /* Numeric key codes and typos miss the table, and a miss is the ladder's worst case. */
+    static const char *const misses[] = {"key_0x41", "key_0xAD", "key_nope", "volume", "Left"};
+
+    for (int t = 0; t < COUNT(tables); t++) {
+        static LookupRun run;
+        unsigned int seed = 17;
+        run.table = tables[t].table;
+        for (int i = 0; i < LOOKUP_WORDS; i++) {
+            unsigned int r = HarnessRandom(&seed);
+            run.words[i] = r % 8 == 0 ? misses[(r >> 3) % COUNT(misses)]
+                                      : run.table->entries[(r >> 3) % run.table->count].name;
+        }
+
+        double hashed = BenchMinNs(LookupHashed, &run, 200) / LOOKUP_WORDS;
+        double ladder = BenchMinNs(LookupLadder, &run, 200) / LOOKUP_WORDS;
+        BenchBegin("config_names", tables[t].name);
+        BenchValue("names", run.table->count);
+        BenchValue("ns_per_lookup", hashed);
+        BenchValue("ladder_ns_per_lookup", ladder);
+        BenchValue("speedup", ladder / hashed);
+        BenchEnd();
+    }
+}
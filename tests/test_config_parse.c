@@ -0,0 +1,476 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "cJSON.h"
+#include "cases.h"
+#include "config_compile.h"
+#include "config_gen.h"
+#include "config_name_tables.h"
+#include "cpu_features.h"
+#include "harness.h"
+#include "input_batch.h"
+
+/* cJSON hooks that allocate from an arena, as CompileConfig installs them. */
+static Arena *hookArena;
+
+static void *ArenaHookAlloc(size_t size) {
+    return ArenaAlloc(hookArena, size);
+}
+
+static void ArenaHookFree(void *p) {
+    (void)p;
+}
+
+static cJSON *ParseIntoArena(const char *json, Arena *arena) {
+    cJSON_Hooks hooks = {ArenaHookAlloc, ArenaHookFree};
+    hookArena = arena;
+    cJSON_InitHooks(&hooks);
+    cJSON *root = cJSON_Parse(json);
+    cJSON_InitHooks(NULL);
+    return root;
+}
+
+void TestArena(void) {
+    Arena arena;
+    ArenaInit(&arena, 0);
+    CHECK_EQ(arena.nextBlockSize, ARENA_MIN_BLOCK);
+
+    /* Alignment, zero-size requests and a request bigger than any block so far. */
+    for (int i = 0; i < 1000; i++) {
+        unsigned char *p = (unsigned char *)ArenaAlloc(&arena, (size_t)(i % 37));
+        CHECK(p != NULL);
+        CHECK_EQ((uintptr_t)p % ARENA_ALIGNMENT, 0);
+        if (p)
+            memset(p, 0xA5, (size_t)(i % 37));
+    }
+    CHECK(ArenaAlloc(&arena, 100000) != NULL);
+    CHECK_EQ(arena.allocations, 1001);
+    CHECK(arena.blockCount > 1);
+    size_t used = arena.used;
+
+    /* The next round learns the size and fits in one block. */
+    ArenaReset(&arena);
+    CHECK_EQ(arena.blocks, NULL);
+    CHECK_EQ(arena.used, 0);
+    CHECK(arena.nextBlockSize >= used);
+    for (int i = 0; i < 1000; i++)
+        ArenaAlloc(&arena, (size_t)(i % 37));
+    ArenaAlloc(&arena, 100000);
+    CHECK_EQ(arena.blockCount, 1);
+    ArenaReset(&arena);
+
+    /* A round with nothing in it keeps the size it had. */
+    size_t learned = arena.nextBlockSize;
+    ArenaReset(&arena);
+    CHECK_EQ(arena.nextBlockSize, learned);
+
+    /* A tree parsed into the arena is the same tree malloc gives. */
+    size_t length;
+    char *json = GenerateConfig(64 * 1024, 3, 7, &length);
+    cJSON *expected = cJSON_Parse(json);
+    cJSON *parsed = ParseIntoArena(json, &arena);
+    CHECK(expected && parsed);
+    CHECK(cJSON_Compare(expected, parsed, 1));
+    CHECK(arena.allocations > 1000);
+    ArenaReset(&arena);
+    parsed = ParseIntoArena(json, &arena);
+    CHECK_EQ(arena.blockCount, 1);
+    ArenaReset(&arena);
+    cJSON_Delete(expected);
+    free(json);
+}
+
+static int warnings;
+
+static void CountWarning(const char *format, ...) {
+    (void)format;
+    warnings++;
+}
+
+static int Compile(const char *json, CompiledConfig *config) {
+    static Arena arena;
+    static int ready;
+    if (!ready) {
+        ArenaInit(&arena, ARENA_MIN_BLOCK);
+        ready = 1;
+    }
+    warnings = 0;
+    return CompileConfig(json, config, &arena, CountWarning);
+}
+
+void TestConfigCompile(void) {
+    static CompiledConfig config;
+    CHECK(Compile(sessionConfig, &config));
+    CHECK_EQ(warnings, 0);
+    CHECK_EQ(config.bindingCount, 8);
+    CHECK_EQ(config.bindings[0].triggerType, TRIGGER_MOUSE_WHEEL);
+    CHECK_EQ(config.bindings[0].trigger.wheelDir, WHEEL_UP);
+    CHECK_EQ(config.bindings[0].win, MODIFIER_LEFT);
+    CHECK_EQ(config.bindings[0].ctrl, MODIFIER_NONE);
+    CHECK_EQ(config.bindings[0].action, ACTION_VOLUME_UP);
+    CHECK_EQ(config.bindings[2].trigger.mouseButton, MOUSE_BUTTON_X2);
+    CHECK_EQ(config.bindings[5].trigger.keyCode, 0x2C);
+    CHECK_EQ(config.bindings[5].shift, MODIFIER_LEFT);
+    CHECK_EQ(config.bindings[6].ctrl, MODIFIER_EITHER);
+    CHECK_EQ(config.bindings[6].trigger.keyCode, 'M');
+    CHECK_EQ(config.bindings[7].trigger.keyCode, 0x78);
+    CHECK_EQ(config.bindings[7].action, ACTION_REPLAY_SAVE_APNG);
+    CHECK_EQ(config.inputBatch, INPUT_BATCH_DEFAULT);
+    CHECK_EQ(config.wheel.stepsPerNotch, 1);
+    CHECK_EQ(config.wheel.intervalMs, WHEEL_DEFAULT_INTERVAL_MS);
+    CHECK_EQ(config.replayFps, 0);
+
+    /* Skipped bindings, unknown names, out-of-range settings and duplicate members: the first
+     * member wins and member names ignore case, like cJSON_GetObjectItem. */
+    CHECK(Compile("{\"Bindings\": [\n"
+                  "  {\"trigger\": \"key_0x41\", \"action\": \"play_pause\", \"ACTION\": \"x\"},\n"
+                  "  {\"trigger\": \"key_nope\", \"action\": \"play_pause\"},\n"
+                  "  {\"trigger\": \"key_0x100\", \"action\": \"play_pause\"},\n"
+                  "  {\"shift\": \"sideways\", \"trigger\": \"mouse_left\", \"action\": \"fly\"},\n"
+                  "  3, [], {\"trigger\": 5}\n"
+                  "], \"input_batch\": 1000, \"wheel\": {\"step\": 3, \"interval_ms\": \"x\"},\n"
+                  " \"replay\": {\"fps\": 30, \"seconds\": 0}, \"bindings\": []}",
+        &config));
+    CHECK_EQ(config.bindingCount, 2);
+    CHECK_EQ(config.bindings[0].trigger.keyCode, 0x41);
+    CHECK_EQ(config.bindings[0].action, ACTION_PLAY_PAUSE);
+    CHECK_EQ(config.bindings[1].triggerType, TRIGGER_MOUSE_BUTTON);
+    CHECK_EQ(config.bindings[1].shift, MODIFIER_NONE);
+    CHECK_EQ(config.bindings[1].action, ACTION_NONE);
+    CHECK_EQ(config.inputBatch, INPUT_BATCH_DEFAULT);
+    CHECK_EQ(config.wheel.stepsPerNotch, 3);
+    CHECK_EQ(config.wheel.intervalMs, WHEEL_DEFAULT_INTERVAL_MS);
+    CHECK_EQ(config.replayFps, 30);
+    CHECK_EQ(config.replaySeconds, REPLAY_DEFAULT_SECONDS);
+    /* Two bad triggers, a bad modifier, a bad action, three elements without a trigger, then
+     * input_batch, interval_ms and seconds. */
+    CHECK_EQ(warnings, 10);
+
+    CHECK(!Compile("{\"bindings\": {}}", &config));
+    CHECK(!Compile("[]", &config));
+    CHECK(!Compile("{\"bindings\": [", &config));
+
+    CHECK_EQ(strcmp(ConfigActionName(ACTION_VOLUME_MUTE), "volume_mute"), 0);
+    CHECK(ConfigActionName(ACTION_NONE) == NULL);
+}
+
+/* The decoder CompileConfig replaced: build the whole tree, then look each member up with
+ * cJSON_GetObjectItem. Kept here as the reference the event decoder must agree with. */
+static ConfigLogFunc treeLog;
+
+static ModifierState TreeModifier(const char *str) {
+    if (!str)
+        return MODIFIER_NONE;
+    const NameEntry *entry = NameTableFind(&modifierTable, str);
+    if (entry)
+        return (ModifierState)entry->value;
+    treeLog("Warning: unrecognized modifier '%s', using 'none'", str);
+    return MODIFIER_NONE;
+}
+
+static MediaAction TreeAction(const char *str) {
+    if (!str) {
+        treeLog("Warning: missing action");
+        return ACTION_NONE;
+    }
+    const NameEntry *entry = NameTableFind(&actionTable, str);
+    if (entry)
+        return (MediaAction)entry->value;
+    treeLog("Warning: unrecognized action '%s'", str);
+    return ACTION_NONE;
+}
+
+static int TreeTrigger(const char *str, HotkeyBinding *binding) {
+    if (!str) {
+        treeLog("Warning: missing trigger");
+        return 0;
+    }
+
+    const NameEntry *entry = NameTableFind(&triggerTable, str);
+    if (entry) {
+        int code = entry->value & 0xFFFF;
+        binding->triggerType = (TriggerType)(entry->value >> 16);
+        if (binding->triggerType == TRIGGER_MOUSE_WHEEL)
+            binding->trigger.wheelDir = (WheelDirection)code;
+        else if (binding->triggerType == TRIGGER_MOUSE_BUTTON)
+            binding->trigger.mouseButton = (MouseButton)code;
+        else
+            binding->trigger.keyCode = (unsigned int)code;
+        return 1;
+    }
+
+    if (strncmp(str, "key_", 4) == 0) {
+        char *end;
+        unsigned long code = strtoul(str + 4, &end, 0);
+        if (end == str + 4 || *end != '\0' || code >= DISPATCH_KEY_COUNT) {
+            treeLog("Warning: invalid key code '%s'", str);
+            return 0;
+        }
+        binding->triggerType = TRIGGER_KEYBOARD;
+        binding->trigger.keyCode = (unsigned int)code;
+        return 1;
+    }
+
+    treeLog("Warning: unrecognized trigger '%s'", str);
+    return 0;
+}
+
+static int TreeInt(const cJSON *object, const char *name, int fallback, int min, int max) {
+    const cJSON *item = cJSON_GetObjectItem(object, name);
+    if (!item)
+        return fallback;
+    if (!cJSON_IsNumber(item)) {
+        treeLog("Warning: '%s' is not a number, using %d", name, fallback);
+        return fallback;
+    }
+    double value = cJSON_GetNumberValue(item);
+    if (value < min || value > max) {
+        treeLog("Warning: '%s' must be between %d and %d, using %d", name, min, max, fallback);
+        return fallback;
+    }
+    return (int)value;
+}
+
+static int CompileTree(const char *json, CompiledConfig *config, ConfigLogFunc log) {
+    treeLog = log;
+    cJSON *root = cJSON_Parse(json);
+    const cJSON *bindings = cJSON_GetObjectItem(root, "bindings");
+    if (!cJSON_IsArray(bindings)) {
+        cJSON_Delete(root);
+        return 0;
+    }
+
+    memset(config, 0, sizeof(*config));
+    const cJSON *item;
+    cJSON_ArrayForEach(item, bindings) {
+        if (config->bindingCount >= MAX_BINDINGS)
+            break;
+        HotkeyBinding *b = &config->bindings[config->bindingCount];
+        b->ctrl = TreeModifier(cJSON_GetStringValue(cJSON_GetObjectItem(item, "ctrl")));
+        b->shift = TreeModifier(cJSON_GetStringValue(cJSON_GetObjectItem(item, "shift")));
+        b->alt = TreeModifier(cJSON_GetStringValue(cJSON_GetObjectItem(item, "alt")));
+        b->win = TreeModifier(cJSON_GetStringValue(cJSON_GetObjectItem(item, "win")));
+        if (!TreeTrigger(cJSON_GetStringValue(cJSON_GetObjectItem(item, "trigger")), b)) {
+            memset(b, 0, sizeof(*b));
+            continue;
+        }
+        b->action = TreeAction(cJSON_GetStringValue(cJSON_GetObjectItem(item, "action")));
+        config->bindingCount++;
+    }
+
+    config->inputBatch = TreeInt(root, "input_batch", INPUT_BATCH_DEFAULT, 2,
+        INPUT_BATCH_CAPACITY);
+
+    const cJSON *wheel = cJSON_GetObjectItem(root, "wheel");
+    config->wheel.stepsPerNotch = 1;
+    config->wheel.intervalMs = WHEEL_DEFAULT_INTERVAL_MS;
+    config->wheel.accelStartRate = WHEEL_DEFAULT_ACCEL_START;
+    if (cJSON_IsObject(wheel)) {
+        config->wheel.stepsPerNotch = TreeInt(wheel, "step", 1, 1, 100);
+        config->wheel.intervalMs = (unsigned int)TreeInt(wheel, "interval_ms",
+            WHEEL_DEFAULT_INTERVAL_MS, 0, 1000);
+        config->wheel.accelerationPercent = TreeInt(wheel, "acceleration", 0, 0, 1000);
+        config->wheel.accelStartRate = TreeInt(wheel, "acceleration_start",
+            WHEEL_DEFAULT_ACCEL_START, 0, 100);
+    }
+
+    const cJSON *replay = cJSON_GetObjectItem(root, "replay");
+    config->replaySeconds = REPLAY_DEFAULT_SECONDS;
+    config->replayMemoryMb = REPLAY_DEFAULT_MEMORY_MB;
+    if (cJSON_IsObject(replay)) {
+        config->replayFps = TreeInt(replay, "fps", REPLAY_DEFAULT_FPS, 0, REPLAY_MAX_FPS);
+        config->replaySeconds = TreeInt(replay, "seconds", REPLAY_DEFAULT_SECONDS, 1,
+            REPLAY_MAX_SECONDS);
+        config->replayMemoryMb = TreeInt(replay, "memory_mb", REPLAY_DEFAULT_MEMORY_MB, 1,
+            REPLAY_MAX_MEMORY_MB);
+    }
+    cJSON_Delete(root);
+    return 1;
+}
+
+/* Collects warnings so two decoders' logs can be compared word for word. */
+static char warningLog[1 << 16];
+static size_t warningLength;
+
+static void RecordWarning(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (warningLength < sizeof(warningLog)) {
+        int n = vsnprintf(warningLog + warningLength, sizeof(warningLog) - warningLength, format,
+            args);
+        if (n > 0)
+            warningLength += (size_t)n;
+        if (warningLength < sizeof(warningLog))
+            warningLog[warningLength++] = '\n';
+    }
+    va_end(args);
+}
+
+void TestConfigDecoderMatchesTree(void) {
+    static CompiledConfig decoded, tree;
+    static char treeWarnings[sizeof(warningLog)];
+    Arena arena;
+    ArenaInit(&arena, ARENA_MIN_BLOCK);
+
+    int mismatches = 0, compiled = 0, withBindings = 0;
+    for (unsigned int seed = 1; seed <= 20000; seed++) {
+        size_t length;
+        char *json = seed % 50 == 0 ? GenerateConfig(20000, (int)(seed / 50 % 5), seed, &length)
+                                    : GenerateMessyConfig(seed, &length);
+        if (!json)
+            continue;
+
+        memset(&tree, 0, sizeof(tree));
+        warningLength = 0;
+        int treeResult = CompileTree(json, &tree, RecordWarning);
+        size_t treeWarningLength = warningLength;
+        memcpy(treeWarnings, warningLog, warningLength);
+
+        warningLength = 0;
+        int decodedResult = CompileConfig(json, &decoded, &arena, RecordWarning);
+
+        /* A document that turns out malformed is rejected by both, but the decoder may already
+         * have logged warnings for the bindings before the error. */
+        int same = treeResult == decodedResult;
+        if (same && treeResult) {
+            same = memcmp(&tree, &decoded, sizeof(tree)) == 0 &&
+                   treeWarningLength == warningLength &&
+                   memcmp(treeWarnings, warningLog, warningLength) == 0;
+            compiled++;
+            withBindings += tree.bindingCount > 0;
+        }
+        if (!same && mismatches++ < 3)
+            printf("  decoder and tree disagree on seed %u:\n%s\n", seed, json);
+        free(json);
+    }
+    CHECK_EQ(mismatches, 0);
+    /* The corpus has to reach the interesting paths to mean anything. */
+    CHECK(compiled > 10000);
+    CHECK(withBindings > 5000);
+    ArenaReset(&arena);
+}
+
+typedef struct {
+    const char *json;
+    Arena arena;
+    CompiledConfig config;
+} ParseRun;
+
+static void IgnoreWarning(const char *format, ...) {
+    (void)format;
+}
+
+static void ParseWithMalloc(void *context) {
+    ParseRun *run = (ParseRun *)context;
+    cJSON_Delete(cJSON_Parse(run->json));
+}
+
+static void ParseWithArena(void *context) {
+    ParseRun *run = (ParseRun *)context;
+    ParseIntoArena(run->json, &run->arena);
+    ArenaReset(&run->arena);
+}
+
+static void CompileWithTree(void *context) {
+    ParseRun *run = (ParseRun *)context;
+    CompileTree(run->json, &run->config, IgnoreWarning);
+}
+
+static void CompileWithArena(void *context) {
+    ParseRun *run = (ParseRun *)context;
+    CompileConfig(run->json, &run->config, &run->arena, NULL);
+}
+
+/* One warmed-up call, so the arena has learned the size, with the heap traffic it made. */
+static BenchAllocs CountAllocs(void (*body)(void *), ParseRun *run) {
+    body(run);
+    BenchResetAllocs();
+    body(run);
+    return BenchReadAllocs();
+}
+
+void BenchConfigParse(void) {
+    static const struct {
+        const char *name;
+        size_t bytes;
+        int iterations;
+    } sizes[] = {{"small", 0, 5000}, {"64_bindings", 8 * 1024, 500}, {"1mb", 1 << 20, 5}};
+    static const struct {
+        const char *name;
+        void (*body)(void *);
+    } paths[] = {{"tree_malloc", ParseWithMalloc}, {"tree_arena", ParseWithArena},
+        {"tree_compile", CompileWithTree}, {"compile", CompileWithArena}};
+
+    /* Scan with AVX2 where the app would; see WinMain. */
+    cJSON_SetCpuHasAvx2((CpuFeatures() & CPU_FEATURE_AVX2) != 0);
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        size_t length;
+        char *json = GenerateConfig(sizes[s].bytes, 0, 3, &length);
+        if (!json)
+            return;
+        static ParseRun run;
+        run.json = json;
+        ArenaInit(&run.arena, ARENA_MIN_BLOCK);
+
+        for (int p = 0; p < (int)(sizeof(paths) / sizeof(paths[0])); p++) {
+            double ns = BenchMinNs(paths[p].body, &run, sizes[s].iterations);
+            BenchAllocs allocs = CountAllocs(paths[p].body, &run);
+            char name[64];
+            snprintf(name, sizeof(name), "%s_%s", sizes[s].name, paths[p].name);
+            BenchBegin("config_parse", name);
+            BenchValue("bytes", (double)length);
+            BenchValue("us", ns / 1e3);
+            BenchValue("ns_per_byte", ns / (double)length);
+            BenchAllocValues(&allocs);
+            BenchEnd();
+        }
+        ArenaReset(&run.arena);
+        free(json);
+    }
+}
+
+/* How parse time and memory grow with the document: from a few bindings to megabytes, with
+ * bindings that carry no note, a shallow one or one nested 64 levels deep. */
+void BenchConfigScaling(void) {
+    static const size_t sizes[] = {1 << 10, 16 << 10, 256 << 10, 4 << 20};
+    static const int depths[] = {0, 8, 64};
+    static const struct {
+        const char *name;
+        void (*body)(void *);
+    } paths[] = {{"tree", ParseWithMalloc}, {"compile", CompileWithArena}};
+
+    cJSON_SetCpuHasAvx2((CpuFeatures() & CPU_FEATURE_AVX2) != 0);
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        for (int d = 0; d < (int)(sizeof(depths) / sizeof(depths[0])); d++) {
+            size_t length;
+            char *json = GenerateConfig(sizes[s], depths[d], 5, &length);
+            if (!json)
+                return;
+            static ParseRun run;
+            run.json = json;
+            ArenaInit(&run.arena, ARENA_MIN_BLOCK);
+            /* About 8 MB of input per timed round, whatever the size. */
+            int iterations = (int)((8u << 20) / length) + 1;
+
+            for (int p = 0; p < (int)(sizeof(paths) / sizeof(paths[0])); p++) {
+                double ns = BenchMinNs(paths[p].body, &run, iterations);
+                BenchAllocs allocs = CountAllocs(paths[p].body, &run);
+                char name[64];
+                snprintf(name, sizeof(name), "%zuk_depth%d_%s", sizes[s] >> 10, depths[d],
+                    paths[p].name);
+                BenchBegin("config_scaling", name);
+                BenchValue("bytes", (double)length);
+                BenchValue("depth", depths[d]);
+                BenchValue("us", ns / 1e3);
+                BenchValue("ns_per_byte", ns / (double)length);
+                BenchAllocValues(&allocs);
+                BenchEnd();
+            }
+            ArenaReset(&run.arena);
+            free(json);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "cases.h"
+#include "config_gen.h"
+#include "deflate.h"
+#include "harness.h"
+#include "stb_baseline.h"
+
+#define CAPTURE_WIDTH 1280
+#define CAPTURE_HEIGHT 720
+
+/* What the PNG encoder hands the compressor for a window capture: RGB rows of flat background,
+ * text-like strokes and a noisy panel, each with the filter stb's adaptive choice picks in
+ * front of it. */
+static unsigned char *MakeFilteredCapture(int *len) {
+    int rowBytes = CAPTURE_WIDTH * 3;
+    unsigned char *pixels = (unsigned char *)malloc((size_t)rowBytes * CAPTURE_HEIGHT);
+    unsigned int seed = 61;
+    for (int y = 0; y < CAPTURE_HEIGHT; y++) {
+        for (int x = 0; x < CAPTURE_WIDTH; x++) {
+            unsigned char *px = pixels + (size_t)rowBytes * y + x * 3;
+            if (x > CAPTURE_WIDTH * 2 / 3) {
+                unsigned int noise = HarnessRandom(&seed);
+                px[0] = (unsigned char)(128 + (noise & 31));
+                px[1] = (unsigned char)(y / 3 + ((noise >> 8) & 15));
+                px[2] = (unsigned char)(x / 4 + ((noise >> 16) & 15));
+            } else {
+                int stroke = (y % 18) < 12 && ((x * 7 + y / 18 * 13) % 23) < 3;
+                px[0] = px[1] = px[2] = (unsigned char)(stroke ? 0x20 : 0xFA);
+            }
+        }
+    }
+
+    *len = (rowBytes + 1) * CAPTURE_HEIGHT;
+    unsigned char *filtered = (unsigned char *)malloc((size_t)*len);
+    signed char *line = (signed char *)malloc((size_t)rowBytes);
+    for (int y = 0; y < CAPTURE_HEIGHT; y++) {
+        int best = 0, bestEstimate = 0x7FFFFFFF;
+        for (int filter = 0; filter < 5; filter++) {
+            int estimate = BaselineEncodePngLine(pixels, rowBytes, CAPTURE_WIDTH, CAPTURE_HEIGHT,
+                y, 3, filter, line);
+            if (estimate < bestEstimate) {
+                best = filter;
+                bestEstimate = estimate;
+            }
+        }
+        unsigned char *out = filtered + (size_t)(rowBytes + 1) * y;
+        BaselineEncodePngLine(pixels, rowBytes, CAPTURE_WIDTH, CAPTURE_HEIGHT, y, 3, best, line);
+        out[0] = (unsigned char)best;
+        memcpy(out + 1, line, (size_t)rowBytes);
+    }
+    free(line);
+    free(pixels);
+    return filtered;
+}
+
+typedef struct {
+    unsigned char *data;
+    int len;
+    int level;
+    int stb;
+    int outLen;
+} DeflateRun;
+
+static unsigned char *Compress(DeflateRun *run) {
+    if (run->stb)
+        return BaselineZlibCompress(run->data, run->len, &run->outLen, run->level);
+    return DeflateZlib(run->data, run->len, &run->outLen, run->level);
+}
+
+static void CompressOnce(void *context) {
+    free(Compress((DeflateRun *)context));
+}
+
+/* Ratio, throughput and peak heap use of DeflateZlib at each level against stb's own
+ * stbi_zlib_compress at the same quality, on filtered capture rows and on config text. Every
+ * stream must inflate back with the system zlib, and DeflateZlib must stay within
+ * DeflateMemoryBound. stb treats qualities below 5 as 5. */
+void BenchDeflate(void) {
+    struct {
+        const char *name;
+        unsigned char *data;
+        int len;
+    } inputs[2] = {{"capture", NULL, 0}, {"config", NULL, 0}};
+    inputs[0].data = MakeFilteredCapture(&inputs[0].len);
+    size_t configLength = 0;
+    inputs[1].data = (unsigned char *)GenerateConfig(1 << 20, 0, 29, &configLength);
+    inputs[1].len = (int)configLength;
+
+    for (int i = 0; i < 2; i++) {
+        unsigned char *inflated = (unsigned char *)malloc((size_t)inputs[i].len);
+        for (int level = 1; level <= 9; level++) {
+            for (int stb = 1; stb >= 0; stb--) {
+                DeflateRun run = {inputs[i].data, inputs[i].len, level, stb, 0};
+                BenchResetAllocs();
+                unsigned char *out = Compress(&run);
+                BenchAllocs allocs = BenchReadAllocs();
+                CHECK(out != NULL);
+                if (!out)
+                    continue;
+                uLongf inflatedLen = (uLongf)inputs[i].len;
+                CHECK(uncompress(inflated, &inflatedLen, out, (uLong)run.outLen) == Z_OK);
+                CHECK(inflatedLen == (uLongf)inputs[i].len &&
+                      memcmp(inflated, inputs[i].data, inflatedLen) == 0);
+                free(out);
+                double ns = BenchMinNs(CompressOnce, &run, 1);
+
+                char name[48];
+                snprintf(name, sizeof(name), "%s_%s_%d", inputs[i].name,
+                    stb ? "stb" : "deflate", level);
+                BenchBegin("deflate", name);
+                BenchValue("level", level);
+                BenchValue("ms", ns / 1e6);
+                BenchValue("mb_per_sec", (double)inputs[i].len / ns * 1e3);
+                BenchValue("bytes", run.outLen);
+                BenchValue("ratio", (double)run.outLen / inputs[i].len);
+                BenchValue("peak_bytes", (double)allocs.peakBytes);
+                if (!stb) {
+                    size_t bound = DeflateMemoryBound(inputs[i].len);
+                    /* The wrappers count usable sizes, which malloc rounds up by at most a
+                     * page. */
+                    CHECK(allocs.peakBytes <= bound + allocs.allocs * 4096);
+                    BenchValue("memory_bound", (double)bound);
+                }
+                BenchValue("allocs", (double)allocs.allocs);
+                BenchEnd();
+            }
+        }
+        free(inflated);
+        free(inputs[i].data);
+    }
+}
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "frame_buffer.h"
+#include "harness.h"
+
+#define STRIDE_PADDING 48 /* what a platform might add to each row */
+
+/* Stands in for the DIB sections main.c creates: heap surfaces with padded rows, counted, and
+ * made to fail on request. */
+typedef struct {
+    int live;
+    int created;
+    int destroyed;
+    int fail;
+    int lastWidth;
+    int lastHeight;
+} FakeSurfaces;
+
+typedef struct {
+    unsigned char *pixels;
+} FakeSurface;
+
+static void *CreateFake(void *user, int width, int height, unsigned char **pixels, int *stride) {
+    FakeSurfaces *fakes = (FakeSurfaces *)user;
+    fakes->lastWidth = width;
+    fakes->lastHeight = height;
+    if (fakes->fail)
+        return NULL;
+
+    FakeSurface *surface = (FakeSurface *)malloc(sizeof(FakeSurface));
+    *stride = width * 4 + STRIDE_PADDING;
+    surface->pixels = (unsigned char *)calloc((size_t)*stride * (size_t)height, 1);
+    *pixels = surface->pixels;
+    fakes->live++;
+    fakes->created++;
+    return surface;
+}
+
+static void DestroyFake(void *user, void *surface) {
+    FakeSurfaces *fakes = (FakeSurfaces *)user;
+    free(((FakeSurface *)surface)->pixels);
+    free(surface);
+    fakes->live--;
+    fakes->destroyed++;
+}
+
+static void InitFake(FrameBuffer *buffer, FakeSurfaces *fakes) {
+    memset(fakes, 0, sizeof(*fakes));
+    FrameSurfaceOps ops = {CreateFake, DestroyFake, fakes};
+    FrameBufferInit(buffer, &ops);
+}
+
+void TestFrameBufferReuse(void) {
+    FakeSurfaces fakes;
+    FrameBuffer buffer;
+    InitFake(&buffer, &fakes);
+
+    CHECK(!FrameBufferReserve(&buffer, 0, 10));
+    CHECK(!FrameBufferReserve(&buffer, 10, -1));
+    CHECK_EQ(fakes.created, 0);
+
+    /* Sizes round up to the granularity, and the stride is whatever the surface reports. */
+    CHECK(FrameBufferReserve(&buffer, 1000, 700));
+    CHECK_EQ(fakes.lastWidth, 1024);
+    CHECK_EQ(fakes.lastHeight, 704);
+    CHECK_EQ(buffer.width, 1024);
+    CHECK_EQ(buffer.height, 704);
+    CHECK_EQ(buffer.stride, 1024 * 4 + STRIDE_PADDING);
+    CHECK_EQ(buffer.allocations, 1);
+    for (int size = 1; size <= 3 * FRAME_BUFFER_GRANULARITY; size++) {
+        FakeSurfaces counts;
+        FrameBuffer exact;
+        InitFake(&exact, &counts);
+        CHECK(FrameBufferReserve(&exact, size, size + 1));
+        CHECK_EQ(exact.width % FRAME_BUFFER_GRANULARITY, 0);
+        CHECK(exact.width >= size && exact.width < size + FRAME_BUFFER_GRANULARITY);
+        CHECK(exact.height >= size + 1 && exact.height < size + 1 + FRAME_BUFFER_GRANULARITY);
+        FrameBufferRelease(&exact);
+        CHECK_EQ(counts.live, 0);
+    }
+
+    FrameBufferRelease(&buffer);
+    CHECK_EQ(fakes.live, 0);
+
+    /* Same size, a little smaller, or anything down to a quarter of the area: kept. */
+    InitFake(&buffer, &fakes);
+    CHECK(FrameBufferReserve(&buffer, 1920, 1080));
+    unsigned char *pixels = buffer.pixels;
+    static const int kept[][2] = {{1920, 1080}, {1920, 1088}, {1900, 1000}, {960, 544},
+        {1024, 510}, {1920, 272}};
+    for (int i = 0; i < (int)(sizeof(kept) / sizeof(kept[0])); i++) {
+        CHECK(FrameBufferReserve(&buffer, kept[i][0], kept[i][1]));
+        CHECK(buffer.pixels == pixels);
+    }
+    CHECK_EQ(fakes.created, 1);
+    CHECK_EQ(buffer.allocations, 1);
+
+    /* Below a quarter of the area it shrinks; larger in either direction it grows. */
+    CHECK(FrameBufferReserve(&buffer, 959, 543));
+    CHECK_EQ(fakes.created, 2);
+    CHECK_EQ(buffer.width, 960);
+    CHECK_EQ(buffer.height, 576);
+    CHECK(FrameBufferReserve(&buffer, 961, 100));
+    CHECK_EQ(buffer.width, 1024);
+    CHECK(FrameBufferReserve(&buffer, 500, 577));
+    CHECK_EQ(buffer.height, 640);
+    CHECK_EQ(fakes.created, 4);
+    CHECK_EQ(fakes.live, 1);
+    CHECK_EQ(buffer.allocations, 4);
+
+    FrameBufferRelease(&buffer);
+    FrameBufferRelease(&buffer);
+    CHECK_EQ(fakes.live, 0);
+    CHECK(buffer.surface == NULL && buffer.pixels == NULL && buffer.width == 0);
+}
+
+void TestFrameBufferCreateFailure(void) {
+    FakeSurfaces fakes;
+    FrameBuffer buffer;
+    InitFake(&buffer, &fakes);
+
+    fakes.fail = 1;
+    CHECK(!FrameBufferReserve(&buffer, 100, 100));
+    CHECK(buffer.surface == NULL);
+    CHECK_EQ(buffer.allocations, 0);
+
+    /* A failed grow leaves the old surface and what was drawn into it. */
+    fakes.fail = 0;
+    CHECK(FrameBufferReserve(&buffer, 640, 480));
+    void *surface = buffer.surface;
+    unsigned char *pixels = buffer.pixels;
+    pixels[0] = 0x5A;
+    fakes.fail = 1;
+    CHECK(!FrameBufferReserve(&buffer, 3840, 2160));
+    CHECK(!FrameBufferReserve(&buffer, 64, 64));
+    CHECK(buffer.surface == surface);
+    CHECK(buffer.pixels == pixels && pixels[0] == 0x5A);
+    CHECK_EQ(buffer.width, 640);
+    CHECK_EQ(buffer.height, 512);
+    CHECK_EQ(buffer.stride, 640 * 4 + STRIDE_PADDING);
+    CHECK_EQ(buffer.allocations, 1);
+    CHECK_EQ(fakes.live, 1);
+    CHECK_EQ(fakes.destroyed, 0);
+
+    FrameView view;
+    CHECK(FrameBufferView(&buffer, 0, 0, 10, 10, &view));
+    CHECK(view.pixels == pixels);
+
+    /* Once creating works again the grow goes through and the old surface is freed. */
+    fakes.fail = 0;
+    CHECK(FrameBufferReserve(&buffer, 3840, 2160));
+    CHECK_EQ(buffer.width, 3840);
+    CHECK_EQ(fakes.live, 1);
+    CHECK_EQ(fakes.destroyed, 1);
+    FrameBufferRelease(&buffer);
+    CHECK_EQ(fakes.live, 0);
+}
+
+void TestFrameBufferView(void) {
+    FakeSurfaces fakes;
+    FrameBuffer buffer;
+    InitFake(&buffer, &fakes);
+
+    FrameView view;
+    CHECK(!FrameBufferView(&buffer, 0, 0, 10, 10, &view));
+
+    CHECK(FrameBufferReserve(&buffer, 200, 100));
+    int stride = buffer.stride;
+    CHECK_EQ(buffer.width, 256);
+    CHECK_EQ(buffer.height, 128);
+
+    /* Inside: the view points into the surface and uses its stride. */
+    CHECK(FrameBufferView(&buffer, 10, 20, 30, 40, &view));
+    CHECK(view.pixels == buffer.pixels + 20 * stride + 10 * 4);
+    CHECK_EQ(view.width, 30);
+    CHECK_EQ(view.height, 40);
+    CHECK_EQ(view.stride, stride);
+
+    /* Off the top left, as a window partly off screen: the part inside. */
+    CHECK(FrameBufferView(&buffer, -5, -7, 30, 40, &view));
+    CHECK(view.pixels == buffer.pixels);
+    CHECK_EQ(view.width, 25);
+    CHECK_EQ(view.height, 33);
+
+    /* Past the bottom right. */
+    CHECK(FrameBufferView(&buffer, 250, 120, 30, 40, &view));
+    CHECK(view.pixels == buffer.pixels + 120 * stride + 250 * 4);
+    CHECK_EQ(view.width, 6);
+    CHECK_EQ(view.height, 8);
+
+    /* Larger than the surface on every side. */
+    CHECK(FrameBufferView(&buffer, -100, -100, 1000, 1000, &view));
+    CHECK(view.pixels == buffer.pixels);
+    CHECK_EQ(view.width, 256);
+    CHECK_EQ(view.height, 128);
+
+    /* Nothing inside, or nothing at all. */
+    CHECK(!FrameBufferView(&buffer, 256, 0, 10, 10, &view));
+    CHECK(!FrameBufferView(&buffer, 0, 128, 10, 10, &view));
+    CHECK(!FrameBufferView(&buffer, -20, 0, 20, 10, &view));
+    CHECK(!FrameBufferView(&buffer, 0, -10, 10, 10, &view));
+    CHECK(!FrameBufferView(&buffer, 5, 5, 0, 10, &view));
+    CHECK(!FrameBufferView(&buffer, 5, 5, 10, -3, &view));
+
+    /* Every view of random rectangles stays inside the surface's memory. */
+    unsigned int seed = 23;
+    const unsigned char *end = buffer.pixels + (long long)stride * buffer.height;
+    for (int i = 0; i < 10000; i++) {
+        int x = (int)(HarnessRandom(&seed) % 400) - 100;
+        int y = (int)(HarnessRandom(&seed) % 300) - 100;
+        int w = (int)(HarnessRandom(&seed) % 400);
+        int h = (int)(HarnessRandom(&seed) % 300);
+        if (!FrameBufferView(&buffer, x, y, w, h, &view))
+            continue;
+        CHECK(view.width > 0 && view.height > 0);
+        CHECK(view.pixels >= buffer.pixels);
+        CHECK(view.pixels + (long long)(view.height - 1) * view.stride + view.width * 4 <= end);
+        CHECK((view.pixels - buffer.pixels) % stride + view.width * 4 <= buffer.width * 4);
+    }
+    FrameBufferRelease(&buffer);
+    CHECK_EQ(fakes.live, 0);
+}
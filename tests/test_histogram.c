@@ -0,0 +1,156 @@
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "histogram.h"
+
+#define LAST_BUCKET (HISTOGRAM_BUCKETS - 1)
+
+void TestHistogramBuckets(void) {
+    /* Below HISTOGRAM_SUB_COUNT every value has a bucket of its own. */
+    for (int value = 0; value < HISTOGRAM_SUB_COUNT; value++) {
+        CHECK_EQ(HistogramBucket((unsigned long long)value), value);
+        CHECK_EQ(HistogramBucketLow(value), value);
+        CHECK_EQ(HistogramBucketHigh(value), value);
+    }
+
+    /* The buckets tile the range with no gaps or overlaps, both ends of each map back to it,
+     * and none is wider than an eighth of its lower bound. */
+    for (int bucket = 0; bucket < LAST_BUCKET; bucket++) {
+        unsigned long long low = HistogramBucketLow(bucket);
+        unsigned long long high = HistogramBucketHigh(bucket);
+        CHECK(low <= high);
+        CHECK_EQ(HistogramBucket(low), bucket);
+        CHECK_EQ(HistogramBucket(high), bucket);
+        CHECK_EQ(HistogramBucketLow(bucket + 1), high + 1);
+        CHECK(bucket < HISTOGRAM_SUB_COUNT || high - low + 1 <= low / HISTOGRAM_SUB_COUNT);
+    }
+
+    /* Either side of each power of two. */
+    for (int bit = HISTOGRAM_SUB_BITS; bit <= HISTOGRAM_MAX_EXPONENT; bit++) {
+        unsigned long long power = 1ULL << bit;
+        CHECK_EQ(HistogramBucket(power), HistogramBucket(power - 1) + 1);
+        CHECK_EQ(HistogramBucketLow(HistogramBucket(power)), power);
+    }
+
+    /* Everything from 2^40 up shares the last bucket, whose high end is unbounded. */
+    unsigned long long top = 1ULL << (HISTOGRAM_MAX_EXPONENT + 1);
+    CHECK_EQ(HistogramBucket(top - 1), LAST_BUCKET);
+    CHECK_EQ(HistogramBucket(top), LAST_BUCKET);
+    CHECK_EQ(HistogramBucket(~0ULL), LAST_BUCKET);
+    CHECK(HistogramBucketHigh(LAST_BUCKET) == ~0ULL);
+
+    /* Random values land in the bucket whose bounds hold them. */
+    unsigned int seed = 41;
+    for (int i = 0; i < 100000; i++) {
+        unsigned long long value = ((unsigned long long)HarnessRandom(&seed) << 32 |
+                                    HarnessRandom(&seed)) >> (HarnessRandom(&seed) % 64);
+        int bucket = HistogramBucket(value);
+        CHECK(bucket >= 0 && bucket <= LAST_BUCKET);
+        CHECK(HistogramBucketLow(bucket) <= value && value <= HistogramBucketHigh(bucket));
+    }
+}
+
+void TestHistogramPercentiles(void) {
+    static Histogram histogram;
+    HistogramReset(&histogram);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.5), 0);
+
+    /* A single sample is every percentile, not its bucket's upper bound. */
+    HistogramRecord(&histogram, 1000);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.0), 1000);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.99), 1000);
+    CHECK(HistogramBucketHigh(HistogramBucket(1000)) > 1000);
+
+    /* With exact buckets the quantile picks the nearest rank: of the 8 samples 0..7, 0.25 is the
+     * second, 0.32 rounds to the third. Quantiles outside 0-1 are clamped. */
+    HistogramReset(&histogram);
+    for (int value = 0; value < HISTOGRAM_SUB_COUNT; value++)
+        HistogramRecord(&histogram, (unsigned long long)value);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.25), 1);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.32), 2);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.5), 3);
+    CHECK_EQ(HistogramPercentile(&histogram, 1.0), HISTOGRAM_SUB_COUNT - 1);
+    CHECK_EQ(HistogramPercentile(&histogram, -1.0), 0);
+    CHECK_EQ(HistogramPercentile(&histogram, 2.0), HISTOGRAM_SUB_COUNT - 1);
+
+    /* 1..100000: each percentile is the upper bound of the bucket holding that rank, capped at
+     * the maximum, so within an eighth above the exact answer. */
+    HistogramReset(&histogram);
+    for (int value = 1; value <= 100000; value++)
+        HistogramRecord(&histogram, (unsigned long long)value);
+    static const double quantiles[] = {0.01, 0.1, 0.5, 0.9, 0.99, 0.999};
+    for (int i = 0; i < (int)(sizeof(quantiles) / sizeof(quantiles[0])); i++) {
+        unsigned long long exact = (unsigned long long)(quantiles[i] * 100000 + 0.5);
+        unsigned long long reported = HistogramPercentile(&histogram, quantiles[i]);
+        CHECK(reported >= exact);
+        CHECK(reported <= exact + exact / HISTOGRAM_SUB_COUNT);
+        unsigned long long high = HistogramBucketHigh(HistogramBucket(exact));
+        CHECK_EQ(reported, high < 100000 ? high : 100000);
+    }
+    CHECK_EQ(HistogramPercentile(&histogram, 1.0), 100000);
+
+    /* Values past the last bucket's lower bound report the recorded maximum, not 2^64 - 1. */
+    HistogramReset(&histogram);
+    HistogramRecord(&histogram, 5);
+    HistogramRecord(&histogram, 1ULL << 50);
+    CHECK_EQ(histogram.counts[LAST_BUCKET], 1);
+    CHECK(HistogramPercentile(&histogram, 1.0) == 1ULL << 50);
+    CHECK_EQ(HistogramPercentile(&histogram, 0.5), 5);
+    HistogramRecord(&histogram, ~0ULL);
+    CHECK(histogram.max == ~0ULL);
+    CHECK(HistogramPercentile(&histogram, 1.0) == ~0ULL);
+
+    HistogramReset(&histogram);
+    CHECK_EQ(histogram.count, 0);
+    CHECK_EQ(histogram.max, 0);
+    CHECK_EQ(HistogramPercentile(&histogram, 1.0), 0);
+}
+
+#define RECORD_VALUES 4096
+
+typedef struct {
+    Histogram histogram;
+    unsigned long long values[RECORD_VALUES];
+    unsigned long long percentile;
+} RecordRun;
+
+static void RecordAll(void *context) {
+    RecordRun *run = (RecordRun *)context;
+    for (int i = 0; i < RECORD_VALUES; i++)
+        HistogramRecord(&run->histogram, run->values[i]);
+}
+
+static void ReadPercentiles(void *context) {
+    RecordRun *run = (RecordRun *)context;
+    run->percentile += HistogramPercentile(&run->histogram, 0.5);
+    run->percentile += HistogramPercentile(&run->histogram, 0.99);
+}
+
+/* What recording one latency sample costs the thread that takes it, for tick-sized values as
+ * the hook and worker record them and for values spread over the whole range. */
+void BenchHistogram(void) {
+    static RecordRun run;
+    static const struct {
+        const char *name;
+        int maxShift;
+    } shapes[] = {{"ticks", 20}, {"full_range", 63}};
+
+    for (int s = 0; s < (int)(sizeof(shapes) / sizeof(shapes[0])); s++) {
+        unsigned int seed = 53;
+        HistogramReset(&run.histogram);
+        for (int i = 0; i < RECORD_VALUES; i++) {
+            unsigned long long value = (unsigned long long)HarnessRandom(&seed) << 32 |
+                                       HarnessRandom(&seed);
+            run.values[i] = value >> (63 - HarnessRandom(&seed) % shapes[s].maxShift);
+        }
+
+        double record = BenchMinNs(RecordAll, &run, 200) / RECORD_VALUES;
+        double percentile = BenchMinNs(ReadPercentiles, &run, 2000) / 2;
+
+        BenchBegin("histogram", shapes[s].name);
+        BenchValue("ns_per_record", record);
+        BenchValue("records_per_sec", 1e9 / record);
+        BenchValue("ns_per_percentile", percentile);
+        BenchEnd();
+    }
+}
@@ -0,0 +1,317 @@
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "hotkeys.h"
+
+/* The matching rules written out directly, as the hooks applied them before the dispatch
+ * table: scan every binding in config order and take the first whose trigger and modifiers
+ * match. */
+static int ReferenceModifierMatches(ModifierState state, unsigned int down, unsigned int leftBit) {
+    int left = (down & leftBit) != 0;
+    int right = (down & (leftBit << 1)) != 0;
+    switch (state) {
+    case MODIFIER_NONE:
+        return !left && !right;
+    case MODIFIER_LEFT:
+        return left && !right;
+    case MODIFIER_RIGHT:
+        return !left && right;
+    case MODIFIER_EITHER:
+        return left || right;
+    case MODIFIER_BOTH:
+        return left && right;
+    }
+    return 0;
+}
+
+static int ReferenceMatches(const HotkeyBinding *b, unsigned int down) {
+    return ReferenceModifierMatches(b->ctrl, down, MODIFIER_BIT_LCTRL) &&
+           ReferenceModifierMatches(b->shift, down, MODIFIER_BIT_LSHIFT) &&
+           ReferenceModifierMatches(b->alt, down, MODIFIER_BIT_LALT) &&
+           ReferenceModifierMatches(b->win, down, MODIFIER_BIT_LWIN);
+}
+
+static int LinearScan(const HotkeyBinding *bindings, int count, TriggerType type,
+    unsigned int code, unsigned int down) {
+    for (int i = 0; i < count; i++) {
+        const HotkeyBinding *b = &bindings[i];
+        if (b->triggerType != type)
+            continue;
+        unsigned int bound = type == TRIGGER_KEYBOARD       ? b->trigger.keyCode
+                             : type == TRIGGER_MOUSE_BUTTON ? (unsigned int)b->trigger.mouseButton
+                                                            : (unsigned int)b->trigger.wheelDir;
+        if (bound == code && ReferenceMatches(b, down))
+            return i;
+    }
+    return -1;
+}
+
+static int DispatchLookup(const DispatchTable *table, TriggerType type, unsigned int code,
+    unsigned int down) {
+    int candidate = type == TRIGGER_KEYBOARD       ? DispatchFirstKey(table, code)
+                    : type == TRIGGER_MOUSE_BUTTON ? DispatchFirstButton(table, (MouseButton)code)
+                                                   : DispatchFirstWheel(table, (WheelDirection)code);
+    for (; candidate != DISPATCH_END; candidate = DispatchNext(table, candidate)) {
+        if (DispatchMatches(table, candidate, down))
+            return candidate;
+    }
+    return -1;
+}
+
+static HotkeyBinding KeyBinding(unsigned int keyCode, ModifierState ctrl, ModifierState shift,
+    MediaAction action) {
+    HotkeyBinding b;
+    memset(&b, 0, sizeof(b));
+    b.ctrl = ctrl;
+    b.shift = shift;
+    b.triggerType = TRIGGER_KEYBOARD;
+    b.trigger.keyCode = keyCode;
+    b.action = action;
+    return b;
+}
+
+/* Random bindings over a small set of triggers, so most triggers have several candidates. */
+static void RandomBindings(HotkeyBinding *bindings, int count, unsigned int *seed) {
+    static const unsigned int keys[] = {0x41, 0x70, 0x2C, 0xAD, 0xFF};
+    for (int i = 0; i < count; i++) {
+        HotkeyBinding *b = &bindings[i];
+        memset(b, 0, sizeof(*b));
+        b->ctrl = (ModifierState)(HarnessRandom(seed) % 5);
+        b->shift = (ModifierState)(HarnessRandom(seed) % 5);
+        b->alt = (ModifierState)(HarnessRandom(seed) % 5);
+        b->win = (ModifierState)(HarnessRandom(seed) % 5);
+        b->triggerType = (TriggerType)(HarnessRandom(seed) % 3);
+        if (b->triggerType == TRIGGER_KEYBOARD)
+            b->trigger.keyCode = keys[HarnessRandom(seed) % 5];
+        else if (b->triggerType == TRIGGER_MOUSE_BUTTON)
+            b->trigger.mouseButton = (MouseButton)(HarnessRandom(seed) % MOUSE_BUTTON_COUNT);
+        else
+            b->trigger.wheelDir = (WheelDirection)(HarnessRandom(seed) % WHEEL_DIRECTION_COUNT);
+        b->action = (MediaAction)(1 + i % 6);
+    }
+}
+
+void TestDispatchTable(void) {
+    HotkeyBinding bindings[4];
+    bindings[0] = KeyBinding(0x41, MODIFIER_LEFT, MODIFIER_NONE, ACTION_VOLUME_UP);
+    bindings[1] = KeyBinding(0x42, MODIFIER_NONE, MODIFIER_NONE, ACTION_VOLUME_DOWN);
+    bindings[2] = KeyBinding(0x41, MODIFIER_EITHER, MODIFIER_EITHER, ACTION_PLAY_PAUSE);
+    bindings[3] = KeyBinding(0x41, MODIFIER_EITHER, MODIFIER_NONE, ACTION_NEXT_TRACK);
+
+    DispatchTable table;
+    BuildDispatchTable(&table, bindings, 4);
+
+    /* Candidates for one key chain in config order. */
+    CHECK_EQ(DispatchFirstKey(&table, 0x41), 0);
+    CHECK_EQ(DispatchNext(&table, 0), 2);
+    CHECK_EQ(DispatchNext(&table, 2), 3);
+    CHECK_EQ(DispatchNext(&table, 3), DISPATCH_END);
+    CHECK_EQ(DispatchFirstKey(&table, 0x42), 1);
+    CHECK_EQ(DispatchNext(&table, 1), DISPATCH_END);
+
+    /* Unbound and out-of-range triggers cost one load and find nothing. */
+    CHECK_EQ(DispatchFirstKey(&table, 0x43), DISPATCH_END);
+    CHECK_EQ(DispatchFirstKey(&table, 0x1000), DISPATCH_END);
+    CHECK_EQ(DispatchFirstButton(&table, MOUSE_BUTTON_X1), DISPATCH_END);
+    CHECK_EQ(DispatchFirstButton(&table, MOUSE_BUTTON_COUNT), DISPATCH_END);
+    CHECK_EQ(DispatchFirstWheel(&table, WHEEL_UP), DISPATCH_END);
+
+    /* The first matching candidate wins, even when a later one also matches. */
+    CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, 0x41, MODIFIER_BIT_LCTRL), 0);
+    CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, 0x41, MODIFIER_BIT_RCTRL), 3);
+    CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, 0x41,
+                 MODIFIER_BIT_RCTRL | MODIFIER_BIT_LSHIFT), 2);
+    CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, 0x41, 0), -1);
+
+    /* Bindings past MAX_BINDINGS are dropped rather than overflowing the chains. */
+    HotkeyBinding many[MAX_BINDINGS + 8];
+    for (int i = 0; i < MAX_BINDINGS + 8; i++)
+        many[i] = KeyBinding(0x20, MODIFIER_NONE, MODIFIER_NONE, ACTION_VOLUME_UP);
+    BuildDispatchTable(&table, many, MAX_BINDINGS + 8);
+    int chain = 0;
+    for (int c = DispatchFirstKey(&table, 0x20); c != DISPATCH_END; c = DispatchNext(&table, c))
+        chain++;
+    CHECK_EQ(chain, MAX_BINDINGS);
+}
+
+void TestDispatchMatchesLinearScan(void) {
+    unsigned int seed = 1;
+    HotkeyBinding bindings[MAX_BINDINGS];
+    DispatchTable table;
+
+    for (int round = 0; round < 200; round++) {
+        int count = 1 + (int)(HarnessRandom(&seed) % MAX_BINDINGS);
+        RandomBindings(bindings, count, &seed);
+        BuildDispatchTable(&table, bindings, count);
+
+        for (unsigned int down = 0; down < 256; down++) {
+            for (unsigned int key = 0; key < DISPATCH_KEY_COUNT; key += 0x0F)
+                CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, key, down),
+                    LinearScan(bindings, count, TRIGGER_KEYBOARD, key, down));
+            CHECK_EQ(DispatchLookup(&table, TRIGGER_KEYBOARD, 0xAD, down),
+                LinearScan(bindings, count, TRIGGER_KEYBOARD, 0xAD, down));
+            for (unsigned int button = 0; button < MOUSE_BUTTON_COUNT; button++)
+                CHECK_EQ(DispatchLookup(&table, TRIGGER_MOUSE_BUTTON, button, down),
+                    LinearScan(bindings, count, TRIGGER_MOUSE_BUTTON, button, down));
+            for (unsigned int dir = 0; dir < WHEEL_DIRECTION_COUNT; dir++)
+                CHECK_EQ(DispatchLookup(&table, TRIGGER_MOUSE_WHEEL, dir, down),
+                    LinearScan(bindings, count, TRIGGER_MOUSE_WHEEL, dir, down));
+        }
+    }
+}
+
+static int MaskMatches(ModifierState ctrl, unsigned int down) {
+    HotkeyBinding b = KeyBinding(0x41, ctrl, MODIFIER_NONE, ACTION_VOLUME_UP);
+    ModifierMask mask = CompileModifierMask(&b);
+    return ModifierMaskMatches(&mask, down);
+}
+
+void TestModifierStates(void) {
+    const unsigned int left = MODIFIER_BIT_LCTRL, right = MODIFIER_BIT_RCTRL;
+
+    CHECK(MaskMatches(MODIFIER_NONE, 0));
+    CHECK(!MaskMatches(MODIFIER_NONE, left));
+    CHECK(!MaskMatches(MODIFIER_NONE, right));
+
+    CHECK(MaskMatches(MODIFIER_LEFT, left));
+    CHECK(!MaskMatches(MODIFIER_LEFT, right));
+    CHECK(!MaskMatches(MODIFIER_LEFT, left | right));
+    CHECK(!MaskMatches(MODIFIER_LEFT, 0));
+
+    CHECK(MaskMatches(MODIFIER_RIGHT, right));
+    CHECK(!MaskMatches(MODIFIER_RIGHT, left));
+    CHECK(!MaskMatches(MODIFIER_RIGHT, left | right));
+
+    CHECK(MaskMatches(MODIFIER_EITHER, left));
+    CHECK(MaskMatches(MODIFIER_EITHER, right));
+    CHECK(MaskMatches(MODIFIER_EITHER, left | right));
+    CHECK(!MaskMatches(MODIFIER_EITHER, 0));
+
+    CHECK(MaskMatches(MODIFIER_BOTH, left | right));
+    CHECK(!MaskMatches(MODIFIER_BOTH, left));
+    CHECK(!MaskMatches(MODIFIER_BOTH, right));
+
+    /* The compiled masks agree with the rules for every state of all four modifiers. */
+    for (int combo = 0; combo < 5 * 5 * 5 * 5; combo++) {
+        HotkeyBinding b = KeyBinding(0x41, (ModifierState)(combo % 5),
+            (ModifierState)(combo / 5 % 5), ACTION_VOLUME_UP);
+        b.alt = (ModifierState)(combo / 25 % 5);
+        b.win = (ModifierState)(combo / 125);
+        ModifierMask mask = CompileModifierMask(&b);
+        for (unsigned int down = 0; down < 256; down++)
+            CHECK_EQ(ModifierMaskMatches(&mask, down), ReferenceMatches(&b, down));
+    }
+}
+
+void TestModifierTracker(void) {
+    ModifierTracker tracker = {0};
+
+    /* Generic Ctrl and Alt codes use the extended flag for the right-hand key. */
+    CHECK(ModifierTrackerUpdate(&tracker, 0x11, 0, 1));
+    CHECK_EQ(tracker.down, MODIFIER_BIT_LCTRL);
+    CHECK(ModifierTrackerUpdate(&tracker, 0x11, 1, 1));
+    CHECK_EQ(tracker.down, MODIFIER_BIT_LCTRL | MODIFIER_BIT_RCTRL);
+    CHECK(ModifierTrackerUpdate(&tracker, 0x11, 0, 0));
+    CHECK_EQ(tracker.down, MODIFIER_BIT_RCTRL);
+    CHECK(ModifierTrackerUpdate(&tracker, 0x12, 1, 1));
+    CHECK_EQ(tracker.down, MODIFIER_BIT_RCTRL | MODIFIER_BIT_RALT);
+
+    /* Sided codes ignore the flag. */
+    CHECK(ModifierTrackerUpdate(&tracker, 0xA1, 0, 1));
+    CHECK(ModifierTrackerUpdate(&tracker, 0xA0, 1, 1));
+    CHECK(ModifierTrackerUpdate(&tracker, 0x5C, 0, 1));
+    CHECK_EQ(tracker.down, MODIFIER_BIT_RCTRL | MODIFIER_BIT_RALT | MODIFIER_BIT_RSHIFT |
+                               MODIFIER_BIT_LSHIFT | MODIFIER_BIT_RWIN);
+
+    /* Other keys leave the state alone. */
+    unsigned char before = tracker.down;
+    CHECK(!ModifierTrackerUpdate(&tracker, 0x41, 0, 1));
+    CHECK(!ModifierTrackerUpdate(&tracker, 0x41, 1, 0));
+    CHECK_EQ(tracker.down, before);
+
+    CHECK(ModifierTrackerUpdate(&tracker, 0xA3, 0, 0));
+    CHECK(ModifierTrackerUpdate(&tracker, 0xA5, 0, 0));
+    CHECK(ModifierTrackerUpdate(&tracker, 0x10, 0, 0));
+    CHECK(ModifierTrackerUpdate(&tracker, 0xA1, 0, 0));
+    CHECK(ModifierTrackerUpdate(&tracker, 0x5C, 0, 0));
+    CHECK_EQ(tracker.down, 0);
+}
+
+/* A binding that fires with Win held swallows the key and asks for a Ctrl tap on the Win
+ * release, and only that release. */
+void TestHookEngineWinRelease(void) {
+    HotkeyBinding b = KeyBinding(0x41, MODIFIER_NONE, MODIFIER_NONE, ACTION_VOLUME_UP);
+    b.win = MODIFIER_LEFT;
+    DispatchTable table;
+    BuildDispatchTable(&table, &b, 1);
+    HookEngine engine;
+    HookEngineInit(&engine, &table);
+
+    HookDecision d = HookEngineKey(&engine, 0x41, 0, 1);
+    CHECK(!d.swallow && d.binding == -1);
+
+    d = HookEngineKey(&engine, 0x5B, 0, 1);
+    CHECK(!d.swallow && !d.tapControl);
+    d = HookEngineKey(&engine, 0x41, 0, 1);
+    CHECK(d.swallow && d.binding == 0);
+    d = HookEngineKey(&engine, 0x41, 0, 0);
+    CHECK(!d.swallow && d.binding == -1);
+    d = HookEngineKey(&engine, 0x5B, 0, 0);
+    CHECK(d.tapControl);
+
+    d = HookEngineKey(&engine, 0x5B, 0, 1);
+    d = HookEngineKey(&engine, 0x5B, 0, 0);
+    CHECK(!d.tapControl);
+
+    /* Right Win does not match a left-Win binding. */
+    HookEngineKey(&engine, 0x5C, 0, 1);
+    d = HookEngineKey(&engine, 0x41, 0, 1);
+    CHECK(!d.swallow && d.binding == -1);
+}
+
+typedef struct {
+    HotkeyBinding bindings[MAX_BINDINGS];
+    DispatchTable table;
+    unsigned int keys[1024];
+    unsigned int mods[1024];
+    int hits;
+} DispatchBench;
+
+static void RunLinearScan(void *context) {
+    DispatchBench *bench = (DispatchBench *)context;
+    for (int i = 0; i < 1024; i++)
+        bench->hits += LinearScan(bench->bindings, MAX_BINDINGS, TRIGGER_KEYBOARD,
+                           bench->keys[i], bench->mods[i]) >= 0;
+}
+
+static void RunDispatchTable(void *context) {
+    DispatchBench *bench = (DispatchBench *)context;
+    for (int i = 0; i < 1024; i++)
+        bench->hits += DispatchLookup(&bench->table, TRIGGER_KEYBOARD, bench->keys[i],
+                           bench->mods[i]) >= 0;
+}
+
+/* A full table of keyboard bindings against mostly unbound keys, which is what the hooks see
+ * for ordinary typing. */
+void BenchDispatch(void) {
+    static DispatchBench bench;
+    unsigned int seed = 7;
+    for (int i = 0; i < MAX_BINDINGS; i++) {
+        bench.bindings[i] = KeyBinding(0x70 + (unsigned int)(i % 24), (ModifierState)(i % 5),
+            (ModifierState)(i / 5 % 5), ACTION_VOLUME_UP);
+    }
+    BuildDispatchTable(&bench.table, bench.bindings, MAX_BINDINGS);
+    for (int i = 0; i < 1024; i++) {
+        bench.keys[i] = HarnessRandom(&seed) % 8 == 0 ? 0x70 + HarnessRandom(&seed) % 24
+                                                        : 0x41 + HarnessRandom(&seed) % 26;
+        bench.mods[i] = HarnessRandom(&seed) % 4 == 0 ? HarnessRandom(&seed) & 0xFF : 0;
+    }
+
+    BenchBegin("dispatch", "linear_scan_64_bindings");
+    BenchValue("ns_per_event", BenchMinNs(RunLinearScan, &bench, 200) / 1024);
+    BenchEnd();
+
+    BenchBegin("dispatch", "dispatch_table_64_bindings");
+    BenchValue("ns_per_event", BenchMinNs(RunDispatchTable, &bench, 200) / 1024);
+    BenchEnd();
+}
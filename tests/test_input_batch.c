@@ -0,0 +1,208 @@
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "input_batch.h"
+
+#define SINK_EVENTS 4096
+#define SINK_CALLS 1024
+#define TAP_KEY 0x100 /* taps use codes from here up, single events codes below */
+
+/* Stands in for SendSyntheticKeys: logs every event and where each call started, and accepts
+ * at most accept events per call (or returns accept if it is negative). */
+typedef struct {
+    SyntheticKey events[SINK_EVENTS];
+    int eventCount;
+    int callStart[SINK_CALLS];
+    int callCount;
+    int accept;
+} FakeSink;
+
+static int FakeSend(void *context, const SyntheticKey *keys, int count) {
+    FakeSink *sink = (FakeSink *)context;
+    if (sink->callCount < SINK_CALLS)
+        sink->callStart[sink->callCount] = sink->eventCount;
+    sink->callCount++;
+    for (int i = 0; i < count && sink->eventCount < SINK_EVENTS; i++)
+        sink->events[sink->eventCount++] = keys[i];
+    if (sink->accept < 0)
+        return sink->accept;
+    return count < sink->accept ? count : sink->accept;
+}
+
+static void ResetSink(FakeSink *sink) {
+    memset(sink, 0, sizeof(*sink));
+    sink->accept = INPUT_BATCH_CAPACITY;
+}
+
+static int CallLength(const FakeSink *sink, int call) {
+    int end = call + 1 < sink->callCount ? sink->callStart[call + 1] : sink->eventCount;
+    return end - sink->callStart[call];
+}
+
+/* No call may end on the press of a tap or start on its release. */
+static int SplitTaps(const FakeSink *sink) {
+    int splits = 0;
+    for (int call = 0; call < sink->callCount; call++) {
+        int length = CallLength(sink, call);
+        if (length == 0)
+            continue;
+        const SyntheticKey *first = &sink->events[sink->callStart[call]];
+        const SyntheticKey *last = first + length - 1;
+        splits += first->keyCode >= TAP_KEY && first->keyUp;
+        splits += last->keyCode >= TAP_KEY && !last->keyUp;
+    }
+    return splits;
+}
+
+void TestInputBatchOrdering(void) {
+    static FakeSink sink;
+    ResetSink(&sink);
+    InputBatch batch;
+    InputBatchInit(&batch, 16, FakeSend, &sink);
+
+    /* Nothing goes out until the flush, then everything in one call, in order. */
+    CHECK_EQ(InputBatchFlush(&batch), 0);
+    InputBatchKey(&batch, 0x10, 0);
+    InputBatchTap(&batch, TAP_KEY + 1, 2);
+    InputBatchKey(&batch, 0x10, 1);
+    InputBatchTap(&batch, TAP_KEY + 2, 1);
+    InputBatchTap(&batch, TAP_KEY + 3, 0);
+    CHECK_EQ(sink.callCount, 0);
+    CHECK_EQ(InputBatchFlush(&batch), 8);
+    CHECK_EQ(sink.callCount, 1);
+
+    static const SyntheticKey expected[] = {{0x10, 0}, {TAP_KEY + 1, 0}, {TAP_KEY + 1, 1},
+        {TAP_KEY + 1, 0}, {TAP_KEY + 1, 1}, {0x10, 1}, {TAP_KEY + 2, 0}, {TAP_KEY + 2, 1}};
+    CHECK_EQ(sink.eventCount, 8);
+    for (int i = 0; i < 8; i++) {
+        CHECK_EQ(sink.events[i].keyCode, expected[i].keyCode);
+        CHECK_EQ(sink.events[i].keyUp, expected[i].keyUp);
+    }
+    CHECK_EQ(InputBatchFlush(&batch), 0);
+    CHECK_EQ(sink.callCount, 1);
+
+    /* Random mixes of taps and single events with odd batch sizes: the order survives every
+     * early send, and no tap is split between two calls. */
+    unsigned int seed = 17;
+    for (int round = 0; round < 200; round++) {
+        ResetSink(&sink);
+        InputBatchInit(&batch, 2 + (int)(HarnessRandom(&seed) % 20), FakeSend, &sink);
+        SyntheticKey added[SINK_EVENTS];
+        int addedCount = 0;
+        while (addedCount < 300) {
+            unsigned short key = (unsigned short)(HarnessRandom(&seed) % 64);
+            if (HarnessRandom(&seed) % 3) {
+                int taps = (int)(HarnessRandom(&seed) % 5);
+                InputBatchTap(&batch, (unsigned short)(TAP_KEY + key), taps);
+                for (int i = 0; i < taps * 2; i++) {
+                    added[addedCount].keyCode = (unsigned short)(TAP_KEY + key);
+                    added[addedCount++].keyUp = (unsigned char)(i % 2);
+                }
+            } else {
+                int up = (int)(HarnessRandom(&seed) % 2);
+                InputBatchKey(&batch, key, up);
+                added[addedCount].keyCode = key;
+                added[addedCount++].keyUp = (unsigned char)up;
+            }
+        }
+        InputBatchFlush(&batch);
+
+        CHECK_EQ(sink.eventCount, addedCount);
+        CHECK(memcmp(sink.events, added, sizeof(SyntheticKey) * (size_t)addedCount) == 0);
+        CHECK_EQ(SplitTaps(&sink), 0);
+        for (int call = 0; call < sink.callCount; call++)
+            CHECK(CallLength(&sink, call) <= batch.maxBatch);
+        CHECK_EQ(batch.calls, sink.callCount);
+        CHECK_EQ(batch.rejected, 0);
+    }
+}
+
+void TestInputBatchLimits(void) {
+    static FakeSink sink;
+    ResetSink(&sink);
+    InputBatch batch;
+
+    /* maxBatch is clamped so a tap always fits, and to the storage there is. */
+    InputBatchInit(&batch, 0, FakeSend, &sink);
+    CHECK_EQ(batch.maxBatch, 2);
+    InputBatchInit(&batch, -5, FakeSend, &sink);
+    CHECK_EQ(batch.maxBatch, 2);
+    InputBatchInit(&batch, 1, FakeSend, &sink);
+    CHECK_EQ(batch.maxBatch, 2);
+    InputBatchInit(&batch, INPUT_BATCH_CAPACITY + 1, FakeSend, &sink);
+    CHECK_EQ(batch.maxBatch, INPUT_BATCH_CAPACITY);
+
+    /* A batch of two sends each tap on its own, and a single event before a tap goes alone. */
+    InputBatchInit(&batch, 1, FakeSend, &sink);
+    InputBatchKey(&batch, 0x20, 0);
+    InputBatchTap(&batch, TAP_KEY, 3);
+    InputBatchFlush(&batch);
+    CHECK_EQ(sink.callCount, 4);
+    CHECK_EQ(CallLength(&sink, 0), 1);
+    for (int call = 1; call < 4; call++)
+        CHECK_EQ(CallLength(&sink, call), 2);
+
+    /* Far more taps than the capacity go out in full batches, never past INPUT_BATCH_CAPACITY. */
+    ResetSink(&sink);
+    InputBatchInit(&batch, 100000, FakeSend, &sink);
+    InputBatchTap(&batch, TAP_KEY, 1000);
+    InputBatchFlush(&batch);
+    CHECK_EQ(sink.eventCount, 2000);
+    CHECK_EQ(sink.callCount, (2000 + INPUT_BATCH_CAPACITY - 1) / INPUT_BATCH_CAPACITY);
+    for (int call = 0; call < sink.callCount; call++)
+        CHECK(CallLength(&sink, call) <= INPUT_BATCH_CAPACITY);
+    CHECK_EQ(SplitTaps(&sink), 0);
+
+    /* Changing the size sends what is pending under the old one first. */
+    ResetSink(&sink);
+    InputBatchInit(&batch, 8, FakeSend, &sink);
+    InputBatchTap(&batch, TAP_KEY, 3);
+    InputBatchSetMax(&batch, 0);
+    CHECK_EQ(sink.callCount, 1);
+    CHECK_EQ(sink.eventCount, 6);
+    CHECK_EQ(batch.count, 0);
+    CHECK_EQ(batch.maxBatch, 2);
+}
+
+void TestInputBatchCounters(void) {
+    static FakeSink sink;
+    ResetSink(&sink);
+    InputBatch batch;
+    InputBatchInit(&batch, 16, FakeSend, &sink);
+
+    /* Ten taps and two single events are 22 events: one early call when the batch of 16 fills,
+     * one at the flush, ten calls saved. */
+    InputBatchTap(&batch, TAP_KEY, 5);
+    InputBatchKey(&batch, 0x30, 0);
+    InputBatchTap(&batch, TAP_KEY, 5);
+    InputBatchKey(&batch, 0x30, 1);
+    CHECK_EQ(batch.submissions, 12);
+    CHECK_EQ(batch.calls, 1);
+    InputBatchFlush(&batch);
+    CHECK_EQ(batch.calls, 2);
+    CHECK_EQ(InputBatchCallsSaved(&batch), 10);
+
+    /* What the platform does not take is counted, not retried. */
+    ResetSink(&sink);
+    InputBatchInit(&batch, 16, FakeSend, &sink);
+    sink.accept = 3;
+    InputBatchTap(&batch, TAP_KEY, 4);
+    CHECK_EQ(InputBatchFlush(&batch), 3);
+    CHECK_EQ(batch.rejected, 5);
+    CHECK_EQ(batch.count, 0);
+    CHECK_EQ(sink.callCount, 1);
+
+    sink.accept = -1;
+    InputBatchTap(&batch, TAP_KEY, 2);
+    CHECK_EQ(InputBatchFlush(&batch), 0);
+    CHECK_EQ(batch.rejected, 9);
+    CHECK_EQ(batch.calls, 2);
+    CHECK_EQ(sink.callCount, 2);
+
+    sink.accept = INPUT_BATCH_CAPACITY;
+    InputBatchKey(&batch, 0x30, 0);
+    CHECK_EQ(InputBatchFlush(&batch), 1);
+    CHECK_EQ(batch.rejected, 9);
+    CHECK_EQ(batch.submissions, 7);
+    CHECK_EQ(InputBatchCallsSaved(&batch), 4);
+}
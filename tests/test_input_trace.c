@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "config_compile.h"
+#include "config_gen.h"
+#include "harness.h"
+#include "input_trace.h"
+
+static int Compile(const char *json, CompiledConfig *config) {
+    static Arena arena;
+    static int ready;
+    if (!ready) {
+        ArenaInit(&arena, ARENA_MIN_BLOCK);
+        ready = 1;
+    }
+    return CompileConfig(json, config, &arena, NULL);
+}
+
+/* Key codes the synthetic session presses. */
+static const unsigned int sessionKeys[] = {
+    0x5B, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, /* LWin, shifts, ctrls, alts */
+    0x2C, 'M', 'A', 'S', 0x78, 0x0D, 0x20,   /* PrintScreen, letters, F9, Enter, Space */
+};
+
+/* Drives engine with a random but plausible session: modifiers are held across other input
+ * and released in any order. Each event is recorded with the engine's decision the way the
+ * hooks record them. Returns the number of events recorded. */
+static int RecordSession(TraceRecorder *recorder, HookEngine *engine, int count,
+    unsigned int seed) {
+    int keyCount = (int)(sizeof(sessionKeys) / sizeof(sessionKeys[0]));
+    unsigned char held[256] = {0};
+    unsigned char buttonsHeld[MOUSE_BUTTON_COUNT] = {0};
+    unsigned int timeMs = 0xFFFFF000u; /* wraps like GetTickCount during the session */
+
+    for (int i = 0; i < count; i++) {
+        TraceEvent event;
+        memset(&event, 0, sizeof(event));
+        timeMs += HarnessRandom(&seed) % 300;
+        event.timeMs = timeMs;
+        event.modifiers = engine->modifiers.down;
+
+        unsigned int roll = HarnessRandom(&seed) % 100;
+        HookDecision decision;
+        if (roll < 60) {
+            unsigned int key = sessionKeys[HarnessRandom(&seed) % (unsigned int)keyCount];
+            int pressed = !held[key] || HarnessRandom(&seed) % 4 == 0; /* with auto-repeat */
+            held[key] = (unsigned char)pressed;
+            event.type = pressed ? TRACE_KEY_DOWN : TRACE_KEY_UP;
+            event.code = key;
+            event.extended = key == 0xA3 || key == 0xA5 || key == 0x5B;
+            decision = HookEngineKey(engine, key, event.extended, pressed);
+        } else if (roll < 85) {
+            MouseButton button = (MouseButton)(HarnessRandom(&seed) % MOUSE_BUTTON_COUNT);
+            int pressed = !buttonsHeld[button];
+            buttonsHeld[button] = (unsigned char)pressed;
+            event.type = pressed ? TRACE_BUTTON_DOWN : TRACE_BUTTON_UP;
+            event.code = (unsigned int)button;
+            decision = HookEngineButton(engine, button, pressed);
+        } else {
+            event.type = TRACE_WHEEL;
+            event.wheelDelta = (HarnessRandom(&seed) % 2 ? 120 : -120) *
+                               (1 + (int)(HarnessRandom(&seed) % 3));
+            decision = HookEngineWheel(engine, event.wheelDelta);
+        }
+        event.swallowed = decision.swallow;
+        event.binding = decision.binding;
+        if (!TraceRecorderAdd(recorder, &event))
+            return i;
+    }
+    return count;
+}
+
+void TestTraceRecordReplay(void) {
+    static CompiledConfig config;
+    static DispatchTable dispatch;
+    CHECK(Compile(sessionConfig, &config));
+    BuildDispatchTable(&dispatch, config.bindings, config.bindingCount);
+
+    size_t capacity = 1u << 20;
+    unsigned char *buffer = (unsigned char *)malloc(capacity);
+    TraceRecorder recorder;
+    size_t configLength = strlen(sessionConfig);
+    CHECK(!TraceRecorderInit(&recorder, buffer, INPUT_TRACE_HEADER_BYTES + configLength - 1,
+        sessionConfig, configLength));
+    CHECK(TraceRecorderInit(&recorder, buffer, capacity, sessionConfig, configLength));
+
+    HookEngine engine;
+    HookEngineInit(&engine, &dispatch);
+    CHECK_EQ(RecordSession(&recorder, &engine, 50000, 5), 50000);
+    CHECK(!recorder.full);
+
+    /* The trace carries the config, which compiles to the same bindings. */
+    TraceReader reader;
+    CHECK(TraceReaderInit(&reader, buffer, recorder.used));
+    CHECK_EQ(reader.configLength, configLength);
+    CHECK(memcmp(reader.config, sessionConfig, configLength) == 0);
+
+    HookEngineInit(&engine, &dispatch);
+    TraceReplayStats stats;
+    CHECK(TraceReplay(buffer, recorder.used, &engine, NULL, NULL, &stats));
+    CHECK_EQ(stats.events, 50000);
+    CHECK_EQ(stats.decisionMismatches, 0);
+    CHECK_EQ(stats.modifierMismatches, 0);
+    CHECK(stats.fired > 20);
+    CHECK(stats.swallowed >= stats.fired);
+    CHECK(stats.controlTaps > 0);
+
+    /* Dropping a binding changes decisions, which the replay must notice. */
+    static CompiledConfig fewer;
+    static DispatchTable fewerDispatch;
+    fewer = config;
+    fewer.bindingCount = 5;
+    BuildDispatchTable(&fewerDispatch, fewer.bindings, fewer.bindingCount);
+    HookEngineInit(&engine, &fewerDispatch);
+    CHECK(TraceReplay(buffer, recorder.used, &engine, NULL, NULL, &stats));
+    CHECK(stats.decisionMismatches > 0);
+
+    /* A cut-short record, a config longer than the file and an older version are rejected. */
+    HookEngineInit(&engine, &dispatch);
+    CHECK(!TraceReplay(buffer, recorder.used - 1, &engine, NULL, NULL, &stats));
+    CHECK(!TraceReaderInit(&reader, buffer, INPUT_TRACE_HEADER_BYTES + configLength - 1));
+    buffer[4] = 1;
+    CHECK(!TraceReaderInit(&reader, buffer, recorder.used));
+    buffer[4] = INPUT_TRACE_VERSION;
+
+    /* An empty config is allowed; recording without bindings still works. */
+    CHECK(TraceRecorderInit(&recorder, buffer, capacity, NULL, 0));
+    CHECK(TraceReaderInit(&reader, buffer, recorder.used));
+    CHECK_EQ(reader.configLength, 0);
+    free(buffer);
+}
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const DispatchTable *dispatch;
+} ReplayBench;
+
+static void ReplayAll(void *context) {
+    ReplayBench *bench = (ReplayBench *)context;
+    HookEngine engine;
+    TraceReplayStats stats;
+    HookEngineInit(&engine, bench->dispatch);
+    TraceReplay(bench->data, bench->size, &engine, NULL, NULL, &stats);
+}
+
+/* Decode plus HookEngine decisions per recorded event. */
+void BenchTraceReplay(void) {
+    enum { EVENTS = 1000000 };
+    static CompiledConfig config;
+    static DispatchTable dispatch;
+    if (!Compile(sessionConfig, &config))
+        return;
+    BuildDispatchTable(&dispatch, config.bindings, config.bindingCount);
+
+    size_t capacity = (size_t)EVENTS * INPUT_TRACE_MAX_RECORD_BYTES + 4096;
+    unsigned char *buffer = (unsigned char *)malloc(capacity);
+    TraceRecorder recorder;
+    TraceRecorderInit(&recorder, buffer, capacity, sessionConfig, strlen(sessionConfig));
+    HookEngine engine;
+    HookEngineInit(&engine, &dispatch);
+    RecordSession(&recorder, &engine, EVENTS, 11);
+
+    ReplayBench bench = {buffer, recorder.used, &dispatch};
+    double ns = BenchMinNs(ReplayAll, &bench, 1);
+    BenchBegin("trace", "replay");
+    BenchValue("ns_per_event", ns / EVENTS);
+    BenchValue("events_per_second", EVENTS / ns * 1e9);
+    BenchValue("bytes_per_event",
+        (double)(recorder.used - INPUT_TRACE_HEADER_BYTES - strlen(sessionConfig)) / EVENTS);
+    BenchEnd();
+    free(buffer);
+}
@@ -0,0 +1,292 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "cases.h"
+#include "harness.h"
+#include "histogram.h"
+#include "log_buffer.h"
+
+static unsigned int Write(LogBuffer *buffer, unsigned long long timestamp, const char *format,
+    ...) {
+    va_list args;
+    va_start(args, format);
+    unsigned int pending = LogBufferWrite(buffer, timestamp, format, args);
+    va_end(args);
+    return pending;
+}
+
+void TestLogBufferBasics(void) {
+    static LogBuffer buffer;
+    LogBufferInit(&buffer);
+    CHECK(LogBufferPeek(&buffer) == NULL);
+
+    /* Writes report how many records wait, up to a full ring; the next one is dropped. */
+    for (int i = 0; i < LOG_BUFFER_CAPACITY; i++)
+        CHECK_EQ(Write(&buffer, 100 + (unsigned long long)i, "line %d", i), i + 1);
+    CHECK_EQ(Write(&buffer, 0, "dropped"), 0);
+    CHECK_EQ(Write(&buffer, 0, "dropped"), 0);
+    CHECK_EQ(LogBufferTakeDropped(&buffer), 2);
+    CHECK_EQ(LogBufferTakeDropped(&buffer), 0);
+
+    char expected[32];
+    for (int i = 0; i < LOG_BUFFER_CAPACITY; i++) {
+        const LogRecord *record = LogBufferPeek(&buffer);
+        CHECK(record != NULL);
+        if (!record)
+            return;
+        snprintf(expected, sizeof(expected), "line %d", i);
+        CHECK(strcmp(record->text, expected) == 0);
+        CHECK_EQ(record->length, strlen(expected));
+        CHECK_EQ(record->timestamp, 100 + i);
+        CHECK(LogBufferPeek(&buffer) == record);
+        LogBufferRelease(&buffer);
+    }
+    CHECK(LogBufferPeek(&buffer) == NULL);
+
+    /* Released slots are reused as the positions wrap around the ring. */
+    for (int round = 0; round < 3 * LOG_BUFFER_CAPACITY; round++) {
+        CHECK_EQ(Write(&buffer, 0, "%s", "again"), 1);
+        const LogRecord *record = LogBufferPeek(&buffer);
+        CHECK(record && strcmp(record->text, "again") == 0);
+        LogBufferRelease(&buffer);
+    }
+
+    /* Long lines are cut to fit the record and still terminated. */
+    char *longLine = (char *)malloc(LOG_RECORD_TEXT * 2);
+    memset(longLine, 'x', LOG_RECORD_TEXT * 2 - 1);
+    longLine[LOG_RECORD_TEXT * 2 - 1] = '\0';
+    CHECK_EQ(Write(&buffer, 0, "%s", longLine), 1);
+    const LogRecord *record = LogBufferPeek(&buffer);
+    CHECK(record && record->length == LOG_RECORD_TEXT - 1);
+    CHECK(record && strlen(record->text) == LOG_RECORD_TEXT - 1);
+    LogBufferRelease(&buffer);
+    free(longLine);
+    CHECK_EQ(LogBufferTakeDropped(&buffer), 0);
+}
+
+#define STRESS_PRODUCERS 4
+#define STRESS_LINES 200000
+
+typedef struct {
+    LogBuffer buffer;
+    atomic_int producersDone;
+    unsigned int failedWrites[STRESS_PRODUCERS];
+} LogStress;
+
+typedef struct {
+    LogStress *stress;
+    int id;
+} LogProducer;
+
+/* Each producer stands in for a thread that logs: it numbers its lines, and where the app would
+ * lose a line to a full ring it waits and writes it again, so every line must arrive. */
+static void *LogStressProducer(void *param) {
+    LogProducer *producer = (LogProducer *)param;
+    LogStress *stress = producer->stress;
+    for (int i = 0; i < STRESS_LINES; i++) {
+        while (Write(&stress->buffer, (unsigned long long)producer->id, "producer %d line %d",
+                   producer->id, i) == 0) {
+            stress->failedWrites[producer->id]++;
+            sched_yield();
+        }
+    }
+    atomic_fetch_add(&stress->producersDone, 1);
+    return NULL;
+}
+
+void TestLogBufferStress(void) {
+    static LogStress stress;
+    LogBufferInit(&stress.buffer);
+    atomic_init(&stress.producersDone, 0);
+    memset(stress.failedWrites, 0, sizeof(stress.failedWrites));
+
+    pthread_t threads[STRESS_PRODUCERS];
+    LogProducer producers[STRESS_PRODUCERS];
+    for (int p = 0; p < STRESS_PRODUCERS; p++) {
+        producers[p].stress = &stress;
+        producers[p].id = p;
+        CHECK(pthread_create(&threads[p], NULL, LogStressProducer, &producers[p]) == 0);
+    }
+
+    /* Each producer's lines must come out complete and in the order it wrote them. */
+    int next[STRESS_PRODUCERS] = {0};
+    int consumed = 0, malformed = 0, outOfOrder = 0;
+    for (;;) {
+        int done = atomic_load(&stress.producersDone) == STRESS_PRODUCERS;
+        const LogRecord *record;
+        while ((record = LogBufferPeek(&stress.buffer)) != NULL) {
+            int id, line;
+            if (sscanf(record->text, "producer %d line %d", &id, &line) != 2 || id < 0 ||
+                id >= STRESS_PRODUCERS || record->timestamp != (unsigned long long)id ||
+                record->length != strlen(record->text)) {
+                malformed++;
+            } else if (line != next[id]++) {
+                outOfOrder++;
+            }
+            consumed++;
+            LogBufferRelease(&stress.buffer);
+        }
+        if (done)
+            break;
+    }
+    for (int p = 0; p < STRESS_PRODUCERS; p++)
+        pthread_join(threads[p], NULL);
+
+    unsigned int failedWrites = 0;
+    for (int p = 0; p < STRESS_PRODUCERS; p++) {
+        CHECK_EQ(next[p], STRESS_LINES);
+        failedWrites += stress.failedWrites[p];
+    }
+    CHECK_EQ(malformed, 0);
+    CHECK_EQ(outOfOrder, 0);
+    CHECK_EQ(consumed, STRESS_PRODUCERS * STRESS_LINES);
+    CHECK_EQ(LogBufferTakeDropped(&stress.buffer), failedWrites);
+    CHECK(LogBufferPeek(&stress.buffer) == NULL);
+}
+
+/* The logger the ring replaced: open the file, append one timestamped line, close it. */
+static void WriteLogFileDirect(const char *path, const char *format, ...) {
+    FILE *f = fopen(path, "a");
+    if (!f)
+        return;
+
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    fprintf(f, "[%04d-%02d-%02d %02d:%02d:%02d] ", local.tm_year + 1900, local.tm_mon + 1,
+        local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+    va_list args;
+    va_start(args, format);
+    vfprintf(f, format, args);
+    va_end(args);
+    fputc('\n', f);
+    fclose(f);
+}
+
+#define BENCH_LOG_CALLS 20000
+#define BENCH_LOG_MAX_THREADS 4
+
+typedef struct {
+    int ring;
+    char path[64];
+    LogBuffer buffer;
+    atomic_int producersDone;
+    int producers;
+} LogBench;
+
+typedef struct {
+    LogBench *bench;
+    int id;
+    Histogram latency; /* ns per call, one writer each */
+} LogBenchProducer;
+
+static void *LogBenchProducerProc(void *param) {
+    LogBenchProducer *producer = (LogBenchProducer *)param;
+    LogBench *bench = producer->bench;
+    for (int i = 0; i < BENCH_LOG_CALLS; i++) {
+        unsigned long long start = BenchNowNs();
+        if (bench->ring) {
+            /* Only the write that lands is timed; the flusher is given time to make room. */
+            while (Write(&bench->buffer, start, "Hook: action %d took %d us on thread %d",
+                       i % 14, i, producer->id) == 0) {
+                sched_yield();
+                start = BenchNowNs();
+            }
+        } else {
+            WriteLogFileDirect(bench->path, "Hook: action %d took %d us on thread %d", i % 14,
+                i, producer->id);
+        }
+        HistogramRecord(&producer->latency, BenchNowNs() - start);
+    }
+    atomic_fetch_add(&bench->producersDone, 1);
+    return NULL;
+}
+
+/* The flusher thread of the app: drains the ring into a file that stays open. */
+static void *LogBenchFlusherProc(void *param) {
+    LogBench *bench = (LogBench *)param;
+    FILE *f = fopen(bench->path, "a");
+    for (;;) {
+        int done = atomic_load(&bench->producersDone) == bench->producers;
+        const LogRecord *record;
+        while ((record = LogBufferPeek(&bench->buffer)) != NULL) {
+            if (f)
+                fprintf(f, "[%llu] %s\n", record->timestamp, record->text);
+            LogBufferRelease(&bench->buffer);
+        }
+        if (done)
+            break;
+        sched_yield();
+    }
+    if (f)
+        fclose(f);
+    return NULL;
+}
+
+/* Cost of one log call to the thread making it, for the ring with its flusher draining to disk
+ * and for the old open/append/close logger, from one thread and from several at once. Every
+ * line is delivered: a line the full ring turns away is written again and counted in dropped,
+ * so calls_per_sec is bounded by how fast the flusher writes. */
+void BenchLogBuffer(void) {
+    static LogBench bench;
+    static LogBenchProducer producers[BENCH_LOG_MAX_THREADS];
+    static const int threadCounts[] = {1, BENCH_LOG_MAX_THREADS};
+
+    for (int ring = 1; ring >= 0; ring--) {
+        for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); t++) {
+            snprintf(bench.path, sizeof(bench.path), "/tmp/log_bench_XXXXXX");
+            int fd = mkstemp(bench.path);
+            if (fd < 0)
+                return;
+            close(fd);
+            bench.ring = ring;
+            bench.producers = threadCounts[t];
+            LogBufferInit(&bench.buffer);
+            atomic_init(&bench.producersDone, 0);
+
+            pthread_t flusher, threads[BENCH_LOG_MAX_THREADS];
+            unsigned long long start = BenchNowNs();
+            if (ring)
+                pthread_create(&flusher, NULL, LogBenchFlusherProc, &bench);
+            for (int p = 0; p < bench.producers; p++) {
+                producers[p].bench = &bench;
+                producers[p].id = p;
+                HistogramReset(&producers[p].latency);
+                pthread_create(&threads[p], NULL, LogBenchProducerProc, &producers[p]);
+            }
+            for (int p = 0; p < bench.producers; p++)
+                pthread_join(threads[p], NULL);
+            double seconds = (double)(BenchNowNs() - start) / 1e9;
+            if (ring)
+                pthread_join(flusher, NULL);
+            remove(bench.path);
+
+            static Histogram latency;
+            HistogramReset(&latency);
+            for (int p = 0; p < bench.producers; p++) {
+                for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+                    latency.counts[i] += producers[p].latency.counts[i];
+                latency.count += producers[p].latency.count;
+                if (producers[p].latency.max > latency.max)
+                    latency.max = producers[p].latency.max;
+            }
+
+            char name[48];
+            snprintf(name, sizeof(name), "%s_%d_threads", ring ? "ring" : "open_append_close",
+                bench.producers);
+            BenchBegin("log_buffer", name);
+            BenchValue("threads", bench.producers);
+            BenchValue("calls_per_sec", (double)latency.count / seconds);
+            BenchValue("p50_ns", (double)HistogramPercentile(&latency, 0.5));
+            BenchValue("p99_ns", (double)HistogramPercentile(&latency, 0.99));
+            BenchValue("max_ns", (double)latency.max);
+            BenchValue("dropped", ring ? LogBufferTakeDropped(&bench.buffer) : 0);
+            BenchEnd();
+        }
+    }
+}
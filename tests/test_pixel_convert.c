@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "cpu_features.h"
+#include "harness.h"
+#include "pixel_convert.h"
+
+#define MAX_PIXELS 64
+#define MAX_OFFSET 16
+
+typedef void (*ConvertFunc)(unsigned char *dst, const unsigned char *src, int count);
+
+/* Runs one conversion from src + srcOffset into dst + dstOffset with buffers sized exactly, so
+ * ASan sees a read or write past either end, and compares against the portable version. */
+static int CompareConversion(ConvertFunc convert, ConvertFunc portable, int dstBytesPerPixel,
+    const unsigned char *pattern, int count, int srcOffset, int dstOffset) {
+    size_t srcSize = (size_t)srcOffset + (size_t)count * 4;
+    size_t dstSize = (size_t)dstOffset + (size_t)count * dstBytesPerPixel;
+    unsigned char *src = (unsigned char *)malloc(srcSize ? srcSize : 1);
+    unsigned char *dst = (unsigned char *)malloc(dstSize ? dstSize : 1);
+    unsigned char *expected = (unsigned char *)malloc(dstSize ? dstSize : 1);
+    memcpy(src, pattern, srcSize);
+    memset(dst, 0xA5, dstSize);
+    memset(expected, 0xA5, dstSize);
+
+    convert(dst + dstOffset, src + srcOffset, count);
+    portable(expected + dstOffset, src + srcOffset, count);
+    int mismatches = memcmp(dst, expected, dstSize) != 0;
+    mismatches += memcmp(src, pattern, srcSize) != 0;
+
+    free(src);
+    free(dst);
+    free(expected);
+    return mismatches;
+}
+
+/* Every count up to 64 pixels, which crosses the 16 + 2 and 4 + 2 bounds where the vector loops
+ * hand over to the next loop, from every src and dst alignment within a vector. */
+void TestPixelConvertMatchesPortable(void) {
+    unsigned char pattern[MAX_OFFSET + MAX_PIXELS * 4];
+    unsigned int seed = 37;
+    for (int i = 0; i < (int)sizeof(pattern); i++)
+        pattern[i] = (unsigned char)HarnessRandom(&seed);
+
+    for (int count = 0; count <= MAX_PIXELS; count++) {
+        for (int srcOffset = 0; srcOffset < MAX_OFFSET; srcOffset++) {
+            for (int dstOffset = 0; dstOffset < MAX_OFFSET; dstOffset++) {
+                CHECK_EQ(CompareConversion(ConvertBgrxToRgb, ConvertBgrxToRgbPortable, 3, pattern,
+                             count, srcOffset, dstOffset),
+                    0);
+                CHECK_EQ(CompareConversion(ConvertBgraToRgba, ConvertBgraToRgbaPortable, 4,
+                             pattern, count, srcOffset, dstOffset),
+                    0);
+            }
+        }
+
+        /* In place, which ConvertBgraToRgba allows. */
+        for (int offset = 0; offset < MAX_OFFSET; offset++) {
+            unsigned char inPlace[MAX_OFFSET + MAX_PIXELS * 4];
+            unsigned char expected[MAX_PIXELS * 4];
+            memcpy(inPlace, pattern, sizeof(inPlace));
+            ConvertBgraToRgbaPortable(expected, pattern + offset, count);
+            ConvertBgraToRgba(inPlace + offset, inPlace + offset, count);
+            CHECK(memcmp(inPlace + offset, expected, (size_t)count * 4) == 0);
+            CHECK(memcmp(inPlace, pattern, (size_t)offset) == 0);
+        }
+    }
+
+    /* The portable versions against the definition. */
+    unsigned char rgb[MAX_PIXELS * 3], rgba[MAX_PIXELS * 4];
+    ConvertBgrxToRgbPortable(rgb, pattern, MAX_PIXELS);
+    ConvertBgraToRgbaPortable(rgba, pattern, MAX_PIXELS);
+    for (int i = 0; i < MAX_PIXELS; i++) {
+        const unsigned char *p = pattern + i * 4;
+        CHECK(rgb[i * 3] == p[2] && rgb[i * 3 + 1] == p[1] && rgb[i * 3 + 2] == p[0]);
+        CHECK(rgba[i * 4] == p[2] && rgba[i * 4 + 1] == p[1] && rgba[i * 4 + 2] == p[0] &&
+              rgba[i * 4 + 3] == p[3]);
+    }
+}
+
+typedef struct {
+    ConvertFunc convert;
+    unsigned char *dst;
+    const unsigned char *src;
+    int count;
+} ConvertRun;
+
+static void RunConversion(void *context) {
+    ConvertRun *run = (ConvertRun *)context;
+    run->convert(run->dst, run->src, run->count);
+}
+
+/* One frame through each conversion, as a screenshot does before encoding, with the accelerated
+ * version the CPU picks and the portable one. */
+void BenchPixelConvert(void) {
+    static const struct {
+        const char *name;
+        int width;
+        int height;
+    } frames[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    static const struct {
+        const char *name;
+        ConvertFunc convert;
+        ConvertFunc portable;
+    } conversions[] = {{"bgrx_to_rgb", ConvertBgrxToRgb, ConvertBgrxToRgbPortable},
+        {"bgra_to_rgba", ConvertBgraToRgba, ConvertBgraToRgbaPortable}};
+
+    for (int f = 0; f < (int)(sizeof(frames) / sizeof(frames[0])); f++) {
+        int count = frames[f].width * frames[f].height;
+        unsigned char *src = (unsigned char *)malloc((size_t)count * 4);
+        unsigned char *dst = (unsigned char *)malloc((size_t)count * 4);
+        unsigned int seed = 3;
+        for (int i = 0; i < count * 4; i++)
+            src[i] = (unsigned char)HarnessRandom(&seed);
+
+        for (int c = 0; c < (int)(sizeof(conversions) / sizeof(conversions[0])); c++) {
+            ConvertRun run = {conversions[c].convert, dst, src, count};
+            double accelerated = BenchMinNs(RunConversion, &run, 5);
+            run.convert = conversions[c].portable;
+            double portable = BenchMinNs(RunConversion, &run, 5);
+
+            char name[48];
+            snprintf(name, sizeof(name), "%s_%s", conversions[c].name, frames[f].name);
+            BenchBegin("pixel_convert", name);
+            BenchValue("ssse3", (CpuFeatures() & CPU_FEATURE_SSSE3) != 0);
+            BenchValue("ms", accelerated / 1e6);
+            BenchValue("mb_per_sec", (double)count * 4 / accelerated * 1e3);
+            BenchValue("portable_mb_per_sec", (double)count * 4 / portable * 1e3);
+            BenchValue("speedup", portable / accelerated);
+            BenchEnd();
+        }
+        free(src);
+        free(dst);
+    }
+}
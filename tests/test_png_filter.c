@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "cpu_features.h"
+#include "harness.h"
+#include "stb_baseline.h"
+
+/* A private static copy of the encoder, with the AVX2 check wired to a switch so one run
+ * covers the AVX2+SSE2 and SSE2-only paths. */
+static int allowAvx2;
+#define STBIW_CPU_HAS_AVX2() (allowAvx2)
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "stb_image_write.h"
+
+/* The PNG filters as the spec defines them, with a zero row above the first one. */
+static int ReferenceFilter(const unsigned char *row, const unsigned char *prev, int len, int n,
+    int filter, signed char *out) {
+    int est = 0;
+    for (int i = 0; i < len; i++) {
+        int a = i >= n ? row[i - n] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = prev && i >= n ? prev[i - n] : 0;
+        int pred = 0;
+        switch (filter) {
+        case 1:
+            pred = a;
+            break;
+        case 2:
+            pred = b;
+            break;
+        case 3:
+            pred = (a + b) >> 1;
+            break;
+        case 4: {
+            int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+            pred = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+            break;
+        }
+        }
+        out[i] = (signed char)(unsigned char)(row[i] - pred);
+        est += abs(out[i]);
+    }
+    return est;
+}
+
+/* Patterns that exercise each filter's edge cases: flat runs, wraparound at 0 and 255,
+ * ramps and noise. */
+static void FillPattern(unsigned char *pixels, size_t size, int pattern, unsigned int *seed) {
+    for (size_t i = 0; i < size; i++) {
+        switch (pattern) {
+        case 0:
+            pixels[i] = 0;
+            break;
+        case 1:
+            pixels[i] = 255;
+            break;
+        case 2:
+            pixels[i] = (unsigned char)(i * 7);
+            break;
+        case 3:
+            pixels[i] = (i / 3) & 1 ? 0 : 255;
+            break;
+        case 4:
+            pixels[i] = (unsigned char)(HarnessRandom(seed) & 0x81 ? 255 : 0);
+            break;
+        default:
+            pixels[i] = (unsigned char)HarnessRandom(seed);
+            break;
+        }
+    }
+}
+
+static void CheckCorpus(void) {
+    static const int widths[] = {1, 2, 5, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 300};
+    unsigned int seed = 5;
+    int height = 3;
+    signed char got[1200], want[1200];
+
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        for (int n = 1; n <= 4; n++) {
+            int len = widths[w] * n;
+            unsigned char *pixels = (unsigned char *)malloc((size_t)len * height);
+            for (int pattern = 0; pattern < 6; pattern++) {
+                FillPattern(pixels, (size_t)len * height, pattern, &seed);
+                for (int flip = 0; flip <= 1; flip++) {
+                    stbi_flip_vertically_on_write(flip);
+                    for (int y = 0; y < height; y++) {
+                        /* With flip set the encoder reads row y from the bottom up. */
+                        int srcY = flip ? height - 1 - y : y;
+                        const unsigned char *row = pixels + (size_t)len * srcY;
+                        const unsigned char *prev =
+                            y == 0 ? NULL : pixels + (size_t)len * (flip ? srcY + 1 : srcY - 1);
+                        for (int filter = 0; filter < 5; filter++) {
+                            int estimate = stbiw__encode_png_line(pixels, len, widths[w], height,
+                                y, n, filter, got);
+                            CHECK_EQ(estimate, ReferenceFilter(row, prev, len, n, filter, want));
+                            CHECK(memcmp(got, want, (size_t)len) == 0);
+                        }
+                    }
+                }
+            }
+            free(pixels);
+        }
+    }
+    stbi_flip_vertically_on_write(0);
+}
+
+void TestPngFilterCorpus(void) {
+    allowAvx2 = 0;
+    CheckCorpus();
+    allowAvx2 = (CpuFeatures() & CPU_FEATURE_AVX2) != 0;
+    if (allowAvx2)
+        CheckCorpus();
+}
+
+typedef int (*EncodeLineFunc)(unsigned char *pixels, int stride, int width, int height, int y,
+    int n, int filterType, signed char *lineBuffer);
+
+static int EncodeLineSimd(unsigned char *pixels, int stride, int width, int height, int y, int n,
+    int filterType, signed char *lineBuffer) {
+    return stbiw__encode_png_line(pixels, stride, width, height, y, n, filterType, lineBuffer);
+}
+
+typedef struct {
+    EncodeLineFunc encode;
+    unsigned char *pixels;
+    int width;
+    int height;
+    signed char *line;
+    unsigned char *filtered; /* filter byte and filtered row, as stbi_write_png_to_mem builds */
+} FilterRun;
+
+/* The filtering half of stbi_write_png_to_mem: all five filters on each row, then the one
+ * with the smallest estimate again into the output. */
+static void FilterFrame(void *context) {
+    FilterRun *run = (FilterRun *)context;
+    int rowBytes = run->width * 4;
+    for (int y = 0; y < run->height; y++) {
+        int best = 0, bestEstimate = 0x7FFFFFFF;
+        for (int filter = 0; filter < 5; filter++) {
+            int estimate = run->encode(run->pixels, rowBytes, run->width, run->height, y, 4,
+                filter, run->line);
+            if (estimate < bestEstimate) {
+                best = filter;
+                bestEstimate = estimate;
+            }
+        }
+        unsigned char *out = run->filtered + (size_t)(rowBytes + 1) * y;
+        run->encode(run->pixels, rowBytes, run->width, run->height, y, 4, best, run->line);
+        out[0] = (unsigned char)best;
+        memcpy(out + 1, run->line, (size_t)rowBytes);
+    }
+}
+
+/* Adaptive filtering of whole BGRA frames with the SSE2 and AVX2 kernels against stb's scalar
+ * loops. The frames are screen-like: flat areas, a gradient and a noisy band, so every filter
+ * wins some rows. Each kernel's output must match the scalar one byte for byte. */
+void BenchPngFilter(void) {
+    static const struct {
+        const char *name;
+        int width;
+        int height;
+    } frames[] = {{"1080p", 1920, 1080}, {"1440p", 2560, 1440}, {"4k", 3840, 2160}};
+    static const char *kernels[] = {"scalar", "sse2", "avx2"};
+    int hasAvx2 = (CpuFeatures() & CPU_FEATURE_AVX2) != 0;
+
+    for (int f = 0; f < (int)(sizeof(frames) / sizeof(frames[0])); f++) {
+        int width = frames[f].width, height = frames[f].height;
+        size_t filteredSize = (size_t)(width * 4 + 1) * height;
+        unsigned char *pixels = (unsigned char *)malloc((size_t)width * 4 * height);
+        unsigned char *scalar = (unsigned char *)malloc(filteredSize);
+        FilterRun run = {BaselineEncodePngLine, pixels, width, height,
+            (signed char *)malloc((size_t)width * 4), scalar};
+        unsigned int seed = 71;
+        for (int y = 0; y < height; y++) {
+            FillPattern(pixels + (size_t)width * 4 * y, (size_t)width * 4,
+                y < height / 2 ? (y / 64) % 4 : 5, &seed);
+        }
+
+        FilterFrame(&run);
+        double scalarNs = BenchMinNs(FilterFrame, &run, 1);
+        run.filtered = (unsigned char *)malloc(filteredSize);
+        for (int k = 0; k < 3; k++) {
+            double ns = scalarNs;
+            if (k > 0) {
+                if (k == 2 && !hasAvx2)
+                    continue;
+                allowAvx2 = k == 2;
+                run.encode = EncodeLineSimd;
+                FilterFrame(&run);
+                CHECK(memcmp(run.filtered, scalar, filteredSize) == 0);
+                ns = BenchMinNs(FilterFrame, &run, 1);
+            }
+
+            char name[48];
+            snprintf(name, sizeof(name), "%s_%s", kernels[k], frames[f].name);
+            BenchBegin("png_filter", name);
+            BenchValue("ms", ns / 1e6);
+            BenchValue("mb_per_sec", (double)width * 4 * height / ns * 1e3);
+            BenchValue("speedup", scalarNs / ns);
+            BenchEnd();
+        }
+        allowAvx2 = 0;
+        free(run.filtered);
+        free(run.line);
+        free(scalar);
+        free(pixels);
+    }
+}
@@ -0,0 +1,262 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cases.h"
+#include "harness.h"
+#include "image_decode.h"
+#include "pixel_convert.h"
+#include "png_writer.h"
+#include "stb_baseline.h"
+
+/* Runs the bands last to first, so nothing can depend on them finishing in order. */
+static void ReverseParallelFor(PngParallelBody body, void *context, int count, void *user) {
+    (void)user;
+    for (int i = count - 1; i >= 0; i--)
+        body(context, i);
+}
+
+/* A screen-like BGRX capture: flat areas, a gradient, and a noisy band. */
+static unsigned char *MakeCapture(int width, int height, int stride, unsigned int seed) {
+    unsigned char *pixels = (unsigned char *)malloc((size_t)stride * height);
+    for (int y = 0; y < height; y++) {
+        unsigned char *row = pixels + (size_t)stride * y;
+        for (int x = 0; x < width; x++) {
+            unsigned char *px = row + x * 4;
+            if (y < height / 3) {
+                px[0] = 0xF0, px[1] = 0xF0, px[2] = (unsigned char)(x < width / 2 ? 0xF0 : 0x20);
+            } else if (y < 2 * height / 3) {
+                px[0] = (unsigned char)x, px[1] = (unsigned char)y, px[2] = (unsigned char)(x + y);
+            } else {
+                px[0] = (unsigned char)HarnessRandom(&seed);
+                px[1] = (unsigned char)HarnessRandom(&seed);
+                px[2] = (unsigned char)HarnessRandom(&seed);
+            }
+            px[3] = (unsigned char)(x * 3 + y);
+        }
+    }
+    return pixels;
+}
+
+/* Decodes png and compares it with the BGRX capture it was made from. */
+static void CheckPngMatches(const unsigned char *png, size_t len, const unsigned char *pixels,
+    int stride, int width, int height, int comp, DecodedInfo *info) {
+    unsigned char *decoded = DecodePng(png, len, info);
+    CHECK(decoded != NULL);
+    if (!decoded)
+        return;
+    CHECK_EQ(info->width, width);
+    CHECK_EQ(info->height, height);
+    CHECK_EQ(info->comp, comp);
+
+    int mismatches = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const unsigned char *src = pixels + (size_t)stride * y + x * 4;
+            const unsigned char *out = decoded + ((size_t)width * y + x) * comp;
+            mismatches += out[0] != src[2] || out[1] != src[1] || out[2] != src[0] ||
+                          (comp == 4 && out[3] != src[3]);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+    free(decoded);
+}
+
+static unsigned char *EncodeInMemory(const unsigned char *pixels, int stride, int width,
+    int height, int comp, PngFilterMode filter, int threads, int *len) {
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+    options.filter = filter;
+    options.threads = threads;
+    options.parallelFor = threads > 1 ? ReverseParallelFor : NULL;
+    return PngEncodeToMemory(pixels, stride, width, height, comp, &options, len);
+}
+
+static int EncodeStreaming(const unsigned char *pixels, int stride, int width, int height,
+    int comp, PngFilterMode filter, int rowsPerCall, ByteSink *sink) {
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+    options.filter = filter;
+    PngStream *stream = PngStreamBegin(ByteSinkWrite, sink, width, height, comp, &options);
+    if (!stream)
+        return 0;
+    for (int y = 0; y < height; y += rowsPerCall) {
+        int rows = height - y < rowsPerCall ? height - y : rowsPerCall;
+        PngStreamWriteRows(stream, pixels + (size_t)stride * y, stride, rows);
+    }
+    return PngStreamEnd(stream);
+}
+
+/* Both encoders decode to the capture for each filter mode, channel count and feed pattern,
+ * the in-memory one with and without bands. The stream keeps its IDAT chunks bounded. */
+void TestPngStreamMatchesInMemory(void) {
+    static const int sizes[][2] = {{1, 1}, {7, 3}, {33, 65}, {640, 480}, {1200, 700}};
+    static const int feeds[] = {1, 7, 1000};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s][0], height = sizes[s][1], stride = width * 4 + 12;
+        unsigned char *pixels = MakeCapture(width, height, stride, (unsigned int)s + 1);
+        for (int comp = 3; comp <= 4; comp++) {
+            for (int filter = PNG_FILTER_ADAPTIVE; filter <= PNG_FILTER_UP; filter++) {
+                DecodedInfo info;
+                for (int threads = 1; threads <= 4; threads += 3) {
+                    int len = 0;
+                    unsigned char *png = EncodeInMemory(pixels, stride, width, height, comp,
+                        (PngFilterMode)filter, threads, &len);
+                    CHECK(png != NULL);
+                    if (png)
+                        CheckPngMatches(png, (size_t)len, pixels, stride, width, height, comp,
+                            &info);
+                    PngFree(png);
+                }
+                for (size_t f = 0; f < sizeof(feeds) / sizeof(feeds[0]); f++) {
+                    ByteSink sink = {0};
+                    CHECK(EncodeStreaming(pixels, stride, width, height, comp,
+                        (PngFilterMode)filter, feeds[f], &sink));
+                    CheckPngMatches(sink.data, sink.len, pixels, stride, width, height, comp,
+                        &info);
+                    CHECK(info.largestIdat <= PNG_STREAM_IDAT_BYTES);
+                    ByteSinkFree(&sink);
+                }
+            }
+        }
+        free(pixels);
+    }
+}
+
+void TestPngStreamErrors(void) {
+    unsigned char *pixels = MakeCapture(16, 4, 64, 1);
+    ByteSink sink = {0};
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+
+    CHECK(PngStreamBegin(ByteSinkWrite, &sink, 0, 4, 3, &options) == NULL);
+    CHECK(PngStreamBegin(ByteSinkWrite, &sink, 16, 4, 2, &options) == NULL);
+    CHECK(PngStreamBegin(NULL, &sink, 16, 4, 3, &options) == NULL);
+
+    /* Too many rows fails the stream; too few leaves it incomplete. */
+    PngStream *stream = PngStreamBegin(ByteSinkWrite, &sink, 16, 4, 3, &options);
+    CHECK(PngStreamWriteRows(stream, pixels, 64, 3));
+    CHECK(!PngStreamWriteRows(stream, pixels, 64, 2));
+    CHECK(!PngStreamEnd(stream));
+
+    stream = PngStreamBegin(ByteSinkWrite, &sink, 16, 4, 3, &options);
+    CHECK(PngStreamWriteRows(stream, pixels, 64, 3));
+    CHECK(!PngStreamEnd(stream));
+
+    ByteSinkFree(&sink);
+    free(pixels);
+}
+
+typedef struct {
+    PngParallelBody body;
+    void *context;
+    int count;
+    atomic_int next;
+} ParallelJob;
+
+static void *RunParallelJobs(void *param) {
+    ParallelJob *job = (ParallelJob *)param;
+    int index;
+    while ((index = atomic_fetch_add(&job->next, 1)) < job->count)
+        job->body(job->context, index);
+    return NULL;
+}
+
+/* Stands in for the app's thread pool: a thread per band besides the calling one, which works
+ * through bands too. Starting the threads costs tens of microseconds, little beside an encode. */
+static void ThreadParallelFor(PngParallelBody body, void *context, int count, void *user) {
+    (void)user;
+    ParallelJob job = {body, context, count, 0};
+    pthread_t threads[PNG_MAX_BANDS];
+    int started = 0;
+    while (started < count - 1 && started < PNG_MAX_BANDS &&
+           pthread_create(&threads[started], NULL, RunParallelJobs, &job) == 0)
+        started++;
+    RunParallelJobs(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+}
+
+typedef struct {
+    const unsigned char *capture; /* BGRX, as the app hands captures to PngEncodeToMemory */
+    const unsigned char *rgb;     /* the same pixels packed as RGB, as stb takes them */
+    int width;
+    int height;
+    int threads; /* 0 encodes with stb */
+    int bytes;
+} ThreadBench;
+
+static void EncodeThreadBench(void *context) {
+    ThreadBench *bench = (ThreadBench *)context;
+    if (bench->threads == 0) {
+        free(BaselinePngToMem(bench->rgb, 0, bench->width, bench->height, 3, &bench->bytes));
+        return;
+    }
+
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+    options.threads = bench->threads;
+    options.parallelFor = bench->threads > 1 ? ThreadParallelFor : NULL;
+    PngFree(PngEncodeToMemory(bench->capture, 0, bench->width, bench->height, 3, &options,
+        &bench->bytes));
+}
+
+/* Encode throughput and size of a large capture with 1, 2, 4 and (if more) as many threads as
+ * there are CPUs, against stbi_write_png_to_mem as the app used it before. MB/s counts the RGB
+ * bytes going in; stb is given them already converted from BGRX, the band encoder converts as
+ * it goes. Thread counts past the number of CPUs only show the cost of the extra bands. */
+void BenchPngThreads(void) {
+    static const struct {
+        const char *name;
+        int width;
+        int height;
+    } frames[] = {{"1080p", 1920, 1080}, {"4k", 3840, 2160}};
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCounts[] = {0, 1, 2, 4, cpus < PNG_MAX_BANDS ? cpus : PNG_MAX_BANDS};
+    int runs = threadCounts[4] > 4 ? 5 : 4;
+
+    for (int f = 0; f < (int)(sizeof(frames) / sizeof(frames[0])); f++) {
+        ThreadBench bench = {NULL, NULL, frames[f].width, frames[f].height, 0, 0};
+        int pixelCount = bench.width * bench.height;
+        unsigned char *capture = MakeCapture(bench.width, bench.height, bench.width * 4, 7);
+        unsigned char *rgb = (unsigned char *)malloc((size_t)pixelCount * 3);
+        ConvertBgrxToRgbPortable(rgb, capture, pixelCount);
+        bench.capture = capture;
+        bench.rgb = rgb;
+
+        double stbNs = 0;
+        int stbBytes = 0;
+        for (int r = 0; r < runs; r++) {
+            bench.threads = threadCounts[r];
+            double ns = BenchMinNs(EncodeThreadBench, &bench, 1);
+            if (r == 0) {
+                stbNs = ns;
+                stbBytes = bench.bytes;
+            }
+
+            char name[48];
+            if (r == 0)
+                snprintf(name, sizeof(name), "stb_%s", frames[f].name);
+            else
+                snprintf(name, sizeof(name), "%d_threads_%s", bench.threads, frames[f].name);
+            BenchBegin("png_threads", name);
+            BenchValue("threads", bench.threads);
+            BenchValue("cpus", cpus);
+            BenchValue("ms", ns / 1e6);
+            BenchValue("mb_per_sec", (double)pixelCount * 3 / ns * 1e3);
+            BenchValue("bytes", bench.bytes);
+            BenchValue("speedup_vs_stb", stbNs / ns);
+            BenchValue("size_vs_stb", (double)bench.bytes / stbBytes);
+            BenchEnd();
+        }
+        free(capture);
+        free(rgb);
+    }
+}
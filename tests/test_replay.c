@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "image_decode.h"
+#include "replay_buffer.h"
+#include "replay_export.h"
+
+/* Synthetic client areas standing in for the capture: what a window looks like from one frame
+ * to the next while idle, typing, scrolling or playing video. */
+typedef enum { SCENE_IDLE, SCENE_TYPING, SCENE_SCROLL, SCENE_VIDEO, SCENE_COUNT } Scene;
+
+static const char *sceneNames[SCENE_COUNT] = {"idle", "typing", "scroll", "video"};
+
+/* Writes frame index of scene as BGRX rows of stride bytes. X is noise, which the history must
+ * not keep. */
+static void RenderScene(unsigned char *pixels, int stride, int width, int height, Scene scene,
+    int index) {
+    unsigned int noise = 0x1234567u + (unsigned int)index * 7919u;
+    int scroll = scene == SCENE_SCROLL ? index * 3 : 0;
+    int typed = scene == SCENE_TYPING ? index * 5 : 0;
+
+    for (int y = 0; y < height; y++) {
+        unsigned char *row = pixels + (size_t)y * stride;
+        int line = (y + scroll) / 14, inLine = (y + scroll) % 14;
+        for (int x = 0; x < width; x++) {
+            unsigned char *px = row + (size_t)x * 4;
+            unsigned int b = 0xF0, g = 0xF0, r = 0xF0;
+            if (y < 12) {
+                b = g = 0x40 + (unsigned int)y * 4, r = 0x50;
+            } else if (scene == SCENE_VIDEO && x >= width / 2 && y >= height / 2) {
+                unsigned int v = HarnessRandom(&noise);
+                b = v & 0xFF, g = (v >> 8) & 0xFF, r = (v >> 16) & 0xFF;
+            } else if (inLine < 9 && ((x * 5 + line * 11) % 17) < 3 &&
+                       (line != 3 || x < typed)) {
+                b = g = r = 0x18;
+            }
+            /* A caret blinking at the end of line 3. */
+            if (y > 12 && line == 3 && inLine < 10 && x == typed + 1 && (index / 3) % 2 == 0)
+                b = g = r = 0;
+            px[0] = (unsigned char)b;
+            px[1] = (unsigned char)g;
+            px[2] = (unsigned char)r;
+            px[3] = (unsigned char)HarnessRandom(&noise);
+        }
+    }
+}
+
+/* The frame as the history should give it back: packed, X cleared. */
+static unsigned char *Expected(const unsigned char *pixels, int stride, int width, int height) {
+    unsigned char *packed = (unsigned char *)malloc((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        memcpy(packed + (size_t)y * width * 4, pixels + (size_t)y * stride, (size_t)width * 4);
+        for (int x = 0; x < width; x++)
+            packed[((size_t)y * width + x) * 4 + 3] = 0;
+    }
+    return packed;
+}
+
+/* Smallest rectangle holding every pixel that differs, {x, y, width, height}. */
+static void DiffBounds(const unsigned char *a, const unsigned char *b, int width, int height,
+    int *rect) {
+    int minX = width, minY = height, maxX = -1, maxY = -1;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = ((size_t)y * width + x) * 4;
+            if (memcmp(a + i, b + i, 4) != 0) {
+                minX = x < minX ? x : minX;
+                maxX = x > maxX ? x : maxX;
+                minY = y < minY ? y : minY;
+                maxY = y > maxY ? y : maxY;
+            }
+        }
+    }
+    rect[0] = maxX < 0 ? 0 : minX;
+    rect[1] = maxY < 0 ? 0 : minY;
+    rect[2] = maxX < 0 ? 0 : maxX - minX + 1;
+    rect[3] = maxY < 0 ? 0 : maxY - minY + 1;
+}
+
+typedef struct {
+    unsigned char **frames;
+    int *widths;
+    int count;
+    int mismatches;
+} ExpectedFrames;
+
+static int CheckExportedFrame(void *context, int index, const unsigned char *pixels, int width,
+    int height, unsigned long long timeMs) {
+    ExpectedFrames *expected = (ExpectedFrames *)context;
+    (void)timeMs;
+    if (index >= expected->count || width != expected->widths[index] ||
+        memcmp(pixels, expected->frames[index], (size_t)width * height * 4) != 0)
+        expected->mismatches++;
+    return 1;
+}
+
+void TestReplayCodecRoundTrip(void) {
+    enum { WIDTH = 160, HEIGHT = 90, STRIDE = WIDTH * 4 + 12, FRAMES = 40, KEY_INTERVAL = 8 };
+    unsigned char *pixels = (unsigned char *)malloc((size_t)STRIDE * HEIGHT);
+    unsigned char *expected[FRAMES];
+    int widths[FRAMES];
+
+    for (int scene = 0; scene < SCENE_COUNT; scene++) {
+        ReplayBuffer buffer;
+        CHECK(ReplayBufferInit(&buffer, 16u << 20, FRAMES, KEY_INTERVAL, 0));
+        for (int i = 0; i < FRAMES; i++) {
+            /* The same frame twice now and then, which must come back with nothing dirty. */
+            RenderScene(pixels, STRIDE, WIDTH, HEIGHT, (Scene)scene, i % 10 == 5 ? i - 1 : i);
+            expected[i] = Expected(pixels, STRIDE, WIDTH, HEIGHT);
+            widths[i] = WIDTH;
+            CHECK(ReplayBufferPush(&buffer, pixels, STRIDE, WIDTH, HEIGHT, 1000 + i * 100ull));
+        }
+        CHECK_EQ(buffer.count, FRAMES);
+        CHECK_EQ(ReplayBufferSpanMs(&buffer), (FRAMES - 1) * 100);
+
+        ReplayCursor cursor;
+        ReplayCursorInit(&cursor, &buffer);
+        for (int i = 0; i < FRAMES; i++) {
+            const ReplayFrame *frame = ReplayBufferFrame(&buffer, i);
+            CHECK_EQ(frame->keyframe, i % KEY_INTERVAL == 0);
+            CHECK(ReplayCursorNext(&cursor));
+            CHECK_EQ(cursor.timeMs, 1000 + i * 100);
+            CHECK(memcmp(cursor.pixels, expected[i], (size_t)WIDTH * HEIGHT * 4) == 0);
+
+            int rect[4] = {0, 0, WIDTH, HEIGHT};
+            if (!frame->keyframe)
+                DiffBounds(expected[i - 1], expected[i], WIDTH, HEIGHT, rect);
+            CHECK_EQ(cursor.dirtyWidth, rect[2]);
+            CHECK_EQ(cursor.dirtyHeight, rect[3]);
+            if (rect[2] > 0) {
+                CHECK_EQ(cursor.dirtyX, rect[0]);
+                CHECK_EQ(cursor.dirtyY, rect[1]);
+            }
+        }
+        CHECK(!ReplayCursorNext(&cursor));
+        ReplayCursorRelease(&cursor);
+
+        ExpectedFrames check = {expected, widths, FRAMES, 0};
+        CHECK_EQ(ReplayExportFrames(&buffer, CheckExportedFrame, &check), FRAMES);
+        CHECK_EQ(check.mismatches, 0);
+
+        for (int i = 0; i < FRAMES; i++)
+            free(expected[i]);
+        ReplayBufferRelease(&buffer);
+    }
+    free(pixels);
+}
+
+/* The stored frames must be exactly the newest pushes, start on a keyframe, and occupy disjoint
+ * parts of the ring, whatever the sizes of the frames and of the ring. */
+static void CheckRing(const ReplayBuffer *buffer, unsigned char **history, int *widths,
+    int *heights, int pushed, int historyLength) {
+    CHECK(buffer->count <= buffer->frameCapacity);
+    if (buffer->count == 0)
+        return;
+    CHECK(ReplayBufferFrame(buffer, 0)->keyframe);
+
+    size_t used = 0;
+    for (int i = 0; i < buffer->count; i++) {
+        const ReplayFrame *frame = ReplayBufferFrame(buffer, i);
+        used += frame->length;
+        CHECK(frame->offset + frame->length <= buffer->capacity);
+        for (int j = 0; j < i; j++) {
+            const ReplayFrame *other = ReplayBufferFrame(buffer, j);
+            CHECK(frame->offset >= other->offset + other->length ||
+                  other->offset >= frame->offset + frame->length);
+        }
+    }
+    CHECK_EQ(used, ReplayBufferBytesUsed(buffer));
+    CHECK(used <= buffer->capacity);
+
+    ReplayCursor cursor;
+    ReplayCursorInit(&cursor, buffer);
+    for (int i = 0; i < buffer->count; i++) {
+        /* Frame timestamps are the push index, which finds the frame in the history. */
+        const ReplayFrame *frame = ReplayBufferFrame(buffer, i);
+        int pushIndex = (int)frame->timeMs;
+        CHECK_EQ(pushIndex, pushed - buffer->count + i);
+        CHECK(ReplayCursorNext(&cursor));
+        int slot = pushIndex % historyLength;
+        CHECK_EQ(cursor.width, widths[slot]);
+        CHECK_EQ(cursor.height, heights[slot]);
+        if (cursor.width == widths[slot] && cursor.height == heights[slot]) {
+            CHECK(memcmp(cursor.pixels, history[slot], (size_t)cursor.width * cursor.height * 4) ==
+                  0);
+        }
+    }
+    ReplayCursorRelease(&cursor);
+}
+
+void TestReplayRingEviction(void) {
+    enum { MAX_FRAMES = 16, HISTORY = 64, PUSHES = 600, MAX_SIDE = 72 };
+    unsigned char *history[HISTORY] = {0};
+    int widths[HISTORY], heights[HISTORY];
+    unsigned char *pixels = (unsigned char *)malloc((size_t)MAX_SIDE * 4 * MAX_SIDE);
+    unsigned int seed = 99;
+
+    static const size_t capacities[] = {6000, 24000, 200000};
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        ReplayBuffer buffer;
+        CHECK(ReplayBufferInit(&buffer, capacities[c], MAX_FRAMES, 5, 0));
+        int width = 48, height = 32, scene = SCENE_TYPING, pushed = 0;
+        unsigned int dropped = 0;
+
+        for (int i = 0; i < PUSHES; i++) {
+            unsigned int roll = HarnessRandom(&seed) % 100;
+            if (roll < 4) {
+                width = 8 + (int)(HarnessRandom(&seed) % (MAX_SIDE - 8));
+                height = 8 + (int)(HarnessRandom(&seed) % (MAX_SIDE - 8));
+            } else if (roll < 10) {
+                scene = (int)(HarnessRandom(&seed) % SCENE_COUNT);
+            }
+
+            RenderScene(pixels, width * 4, width, height, (Scene)scene, i);
+            int slot = pushed % HISTORY;
+            free(history[slot]);
+            history[slot] = Expected(pixels, width * 4, width, height);
+            widths[slot] = width;
+            heights[slot] = height;
+
+            /* A frame too big for the ring is refused and the next one starts over. */
+            if (ReplayBufferPush(&buffer, pixels, 0, width, height, (unsigned long long)pushed)) {
+                CHECK(ReplayBufferFrame(&buffer, buffer.count - 1)->timeMs == (unsigned)pushed);
+                pushed++;
+            } else {
+                dropped++;
+                CHECK_EQ(buffer.dropped, dropped);
+                CHECK(buffer.needKeyframe);
+                CHECK_EQ(buffer.count, 0);
+                free(history[slot]);
+                history[slot] = NULL;
+            }
+            CheckRing(&buffer, history, widths, heights, pushed, HISTORY);
+        }
+        CHECK(pushed > PUSHES / 2);
+
+        ReplayBufferClear(&buffer);
+        CHECK_EQ(buffer.count, 0);
+        CHECK_EQ(ReplayBufferBytesUsed(&buffer), 0);
+        RenderScene(pixels, width * 4, width, height, SCENE_IDLE, 0);
+        if (ReplayBufferPush(&buffer, pixels, 0, width, height, 0))
+            CHECK(ReplayBufferFrame(&buffer, 0)->keyframe);
+        ReplayBufferRelease(&buffer);
+    }
+
+    for (int i = 0; i < HISTORY; i++)
+        free(history[i]);
+    free(pixels);
+}
+
+void TestReplayMaxAge(void) {
+    enum { WIDTH = 40, HEIGHT = 30 };
+    static unsigned char pixels[WIDTH * HEIGHT * 4];
+    const unsigned long long maxAgeMs = 1000;
+    ReplayBuffer buffer;
+    CHECK(ReplayBufferInit(&buffer, 1u << 20, 1000, 4, maxAgeMs));
+
+    for (unsigned long long now = 0; now <= 5000; now += 100) {
+        RenderScene(pixels, WIDTH * 4, WIDTH, HEIGHT, SCENE_TYPING, (int)(now / 100));
+        CHECK(ReplayBufferPush(&buffer, pixels, 0, WIDTH, HEIGHT, now));
+
+        /* The history reaches back at least maxAgeMs once there is that much, and no whole
+         * group older than that is kept. */
+        unsigned long long oldest = ReplayBufferFrame(&buffer, 0)->timeMs;
+        if (now >= maxAgeMs)
+            CHECK(now - oldest >= maxAgeMs);
+        for (int i = 1; i < buffer.count; i++) {
+            const ReplayFrame *frame = ReplayBufferFrame(&buffer, i);
+            if (frame->keyframe) {
+                CHECK(now - frame->timeMs < maxAgeMs);
+                break;
+            }
+        }
+    }
+    CHECK(ReplayBufferSpanMs(&buffer) < maxAgeMs + 4 * 100);
+    ReplayBufferRelease(&buffer);
+}
+
+void TestReplayCorruptFrames(void) {
+    enum { WIDTH = 32, HEIGHT = 24, FRAMES = 6 };
+    static unsigned char pixels[WIDTH * HEIGHT * 4];
+    ReplayBuffer buffer;
+    CHECK(ReplayBufferInit(&buffer, 1u << 20, FRAMES, FRAMES, 0));
+    for (int i = 0; i < FRAMES; i++) {
+        RenderScene(pixels, WIDTH * 4, WIDTH, HEIGHT, SCENE_VIDEO, i);
+        CHECK(ReplayBufferPush(&buffer, pixels, 0, WIDTH, HEIGHT, (unsigned long long)i));
+    }
+
+    /* A frame cut short, an unknown token, and a token covering more pixels than the frame:
+     * decoding stops at that frame instead of reading or writing out of bounds. */
+    ReplayFrame *frame = &buffer.frames[(buffer.first + 3) % buffer.frameCapacity];
+    unsigned char *data = buffer.data + frame->offset;
+    size_t length = frame->length;
+    unsigned char *saved = (unsigned char *)malloc(length);
+    memcpy(saved, data, length);
+    for (int corruption = 0; corruption < 3; corruption++) {
+        if (corruption == 0)
+            frame->length = length - 1;
+        else if (corruption == 1)
+            data[0] |= 3;
+        else
+            memset(data, 0xFF, 4);
+
+        ReplayCursor cursor;
+        ReplayCursorInit(&cursor, &buffer);
+        int decoded = 0;
+        while (ReplayCursorNext(&cursor))
+            decoded++;
+        CHECK_EQ(decoded, 3);
+        ReplayCursorRelease(&cursor);
+
+        ExpectedFrames none = {NULL, NULL, 0, 0};
+        CHECK_EQ(ReplayExportFrames(&buffer, CheckExportedFrame, &none), 0);
+
+        frame->length = length;
+        memcpy(data, saved, length);
+    }
+    free(saved);
+    ReplayBufferRelease(&buffer);
+}
+
+typedef struct {
+    unsigned char **frames; /* expected BGRX canvases */
+    unsigned int *delays;
+    int count;
+    int width;
+    int mismatches;
+} ExpectedApng;
+
+static int CheckApngFrame(void *context, int index, const unsigned char *canvas,
+    const DecodedInfo *info, unsigned int delayMs) {
+    ExpectedApng *expected = (ExpectedApng *)context;
+    if (index >= expected->count || info->comp != 3 || info->width != expected->width) {
+        expected->mismatches++;
+        return 1;
+    }
+    const unsigned char *bgrx = expected->frames[index];
+    for (int i = 0; i < info->width * info->height; i++) {
+        if (canvas[i * 3] != bgrx[i * 4 + 2] || canvas[i * 3 + 1] != bgrx[i * 4 + 1] ||
+            canvas[i * 3 + 2] != bgrx[i * 4]) {
+            expected->mismatches++;
+            break;
+        }
+    }
+    if (delayMs != expected->delays[index])
+        expected->mismatches++;
+    return 1;
+}
+
+/* Frames of an older size are left out of the APNG; every frame kept must show exactly what was
+ * captured, with its own delay, including frames where nothing changed. */
+void TestReplayExportApng(void) {
+    enum { FRAMES = 30, OLD_SIZE_FRAMES = 7, WIDTH = 96, HEIGHT = 60 };
+    unsigned char *pixels = (unsigned char *)malloc((size_t)WIDTH * HEIGHT * 4);
+    unsigned char *expected[FRAMES];
+    unsigned int delays[FRAMES];
+    int kept = 0;
+
+    ReplayBuffer buffer;
+    CHECK(ReplayBufferInit(&buffer, 8u << 20, FRAMES, 6, 0));
+    unsigned long long timeMs = 0;
+    for (int i = 0; i < FRAMES; i++) {
+        int width = i < OLD_SIZE_FRAMES ? WIDTH / 2 : WIDTH;
+        int index = i % 9 == 4 ? i - 1 : i;
+        RenderScene(pixels, width * 4, width, HEIGHT, i < 20 ? SCENE_TYPING : SCENE_SCROLL,
+            index);
+        CHECK(ReplayBufferPush(&buffer, pixels, 0, width, HEIGHT, timeMs));
+        if (i >= OLD_SIZE_FRAMES)
+            expected[kept++] = Expected(pixels, WIDTH * 4, WIDTH, HEIGHT);
+        timeMs += 33 + (unsigned long long)(i % 3) * 17;
+    }
+
+    /* The delay of each kept frame is the gap to the next one. */
+    unsigned long long previous = 0;
+    int k = 0;
+    for (int i = 0; i < buffer.count; i++) {
+        const ReplayFrame *frame = ReplayBufferFrame(&buffer, i);
+        if (frame->width != WIDTH)
+            continue;
+        if (k > 0)
+            delays[k - 1] = (unsigned int)(frame->timeMs - previous);
+        previous = frame->timeMs;
+        k++;
+    }
+    CHECK_EQ(k, kept);
+    delays[kept - 1] = 250;
+
+    ByteSink sink = {0};
+    CHECK_EQ(ReplayExportApng(&buffer, ByteSinkWrite, &sink, NULL, 250), kept);
+
+    ExpectedApng check = {expected, delays, kept, WIDTH, 0};
+    DecodedInfo info;
+    CHECK_EQ(DecodeApng(sink.data, sink.len, CheckApngFrame, &check, &info), kept);
+    CHECK_EQ(check.mismatches, 0);
+    CHECK_EQ(info.height, HEIGHT);
+
+    ByteSinkFree(&sink);
+    for (int i = 0; i < kept; i++)
+        free(expected[i]);
+    ReplayBufferRelease(&buffer);
+    free(pixels);
+}
+
+typedef struct {
+    ReplayBuffer *buffer;
+    unsigned char *pixels;
+    int width;
+    int height;
+    Scene scene;
+    int frames;
+} ReplayBench;
+
+static void RenderFrames(void *context) {
+    ReplayBench *bench = (ReplayBench *)context;
+    for (int i = 0; i < bench->frames; i++) {
+        RenderScene(bench->pixels, bench->width * 4, bench->width, bench->height, bench->scene,
+            i);
+    }
+}
+
+static void PushScene(void *context) {
+    ReplayBench *bench = (ReplayBench *)context;
+    ReplayBufferClear(bench->buffer);
+    for (int i = 0; i < bench->frames; i++) {
+        RenderScene(bench->pixels, bench->width * 4, bench->width, bench->height, bench->scene,
+            i);
+        ReplayBufferPush(bench->buffer, bench->pixels, 0, bench->width, bench->height,
+            (unsigned long long)i * 100);
+    }
+}
+
+static void DecodeHistory(void *context) {
+    ReplayBench *bench = (ReplayBench *)context;
+    ReplayCursor cursor;
+    ReplayCursorInit(&cursor, bench->buffer);
+    while (ReplayCursorNext(&cursor)) {
+    }
+    ReplayCursorRelease(&cursor);
+}
+
+/* Memory per second of history at the default 10 fps with 2-second keyframe groups, for a
+ * 1080p window doing different things, plus what storing and decoding a frame costs. Rendering
+ * the synthetic frames is timed on its own and taken out of the push time. */
+void BenchReplayHistory(void) {
+    enum { WIDTH = 1920, HEIGHT = 1080, FPS = 10, FRAMES = 4 * FPS };
+    const double defaultSeconds = 30;
+    ReplayBench bench = {NULL, NULL, WIDTH, HEIGHT, SCENE_IDLE, FRAMES};
+    ReplayBuffer buffer;
+    if (!ReplayBufferInit(&buffer, 512u << 20, FRAMES, 2 * FPS, 0))
+        return;
+    bench.buffer = &buffer;
+    bench.pixels = (unsigned char *)malloc((size_t)WIDTH * HEIGHT * 4);
+    double pixelsPushed = (double)WIDTH * HEIGHT * FRAMES;
+
+    for (int scene = 0; scene < SCENE_COUNT; scene++) {
+        bench.scene = (Scene)scene;
+        double renderNs = BenchMinNs(RenderFrames, &bench, 1);
+        double pushNs = BenchMinNs(PushScene, &bench, 1);
+        double decodeNs = BenchMinNs(DecodeHistory, &bench, 1);
+        double perSecond = (double)ReplayBufferBytesUsed(&buffer) * FPS / buffer.count;
+
+        BenchBegin("replay", sceneNames[scene]);
+        BenchValue("bytes_per_frame", (double)ReplayBufferBytesUsed(&buffer) / buffer.count);
+        BenchValue("mb_per_second", perSecond / (1024.0 * 1024.0));
+        BenchValue("mb_for_30s", perSecond * defaultSeconds / (1024.0 * 1024.0));
+        BenchValue("render_ns_per_pixel", renderNs / pixelsPushed);
+        BenchValue("push_ns_per_pixel", (pushNs - renderNs) / pixelsPushed);
+        BenchValue("decode_ns_per_pixel", decodeNs / pixelsPushed);
+        BenchEnd();
+    }
+    free(bench.pixels);
+    ReplayBufferRelease(&buffer);
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "image_decode.h"
+#include "png_writer.h"
+#include "qoi_writer.h"
+
+/* The screenshot file formats as main.c configures them, compared on the same captures. */
+
+/* A window-like BGRX capture: a flat background with text-like strokes, a toolbar gradient and
+ * a photo-like noisy panel. */
+static unsigned char *MakeWindow(int width, int height, unsigned int seed) {
+    unsigned char *pixels = (unsigned char *)malloc((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char *px = pixels + ((size_t)width * y + x) * 4;
+            unsigned int v;
+            if (y < 40) {
+                v = 0x30 + y * 2;
+                px[0] = (unsigned char)v, px[1] = (unsigned char)v, px[2] = (unsigned char)(v + 8);
+            } else if (x > width * 2 / 3) {
+                unsigned int noise = HarnessRandom(&seed);
+                px[0] = (unsigned char)(x / 4 + (noise & 15));
+                px[1] = (unsigned char)(y / 3 + ((noise >> 4) & 15));
+                px[2] = (unsigned char)(128 + ((noise >> 8) & 31));
+            } else {
+                int stroke = (y % 18) < 12 && ((x * 7 + y / 18 * 13) % 23) < 3;
+                v = stroke ? 0x20 : 0xFA;
+                px[0] = (unsigned char)v, px[1] = (unsigned char)v, px[2] = (unsigned char)v;
+            }
+            px[3] = 0;
+        }
+    }
+    return pixels;
+}
+
+void TestQoiRoundTrip(void) {
+    static const int sizes[][2] = {{1, 1}, {3, 5}, {64, 64}, {333, 97}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s][0], height = sizes[s][1];
+        unsigned char *pixels = MakeWindow(width, height, (unsigned int)s + 3);
+        /* Runs longer than one QOI run op, and alpha that changes, for the 4-channel case. */
+        for (int i = 0; i < width * height; i++)
+            pixels[i * 4 + 3] = (unsigned char)(i / 70 * 40);
+
+        for (int channels = 3; channels <= 4; channels++) {
+            ByteSink sink = {0};
+            CHECK(QoiWriteBgrx(ByteSinkWrite, &sink, pixels, 0, width, height, channels));
+            DecodedInfo info;
+            unsigned char *decoded = DecodeQoi(sink.data, sink.len, &info);
+            CHECK(decoded != NULL);
+            if (decoded) {
+                CHECK_EQ(info.width, width);
+                CHECK_EQ(info.height, height);
+                CHECK_EQ(info.comp, channels);
+                int mismatches = 0;
+                for (int i = 0; i < width * height; i++) {
+                    const unsigned char *src = pixels + i * 4, *out = decoded + i * channels;
+                    mismatches += out[0] != src[2] || out[1] != src[1] || out[2] != src[0] ||
+                                  (channels == 4 && out[3] != src[3]);
+                }
+                CHECK_EQ(mismatches, 0);
+            }
+            free(decoded);
+            ByteSinkFree(&sink);
+        }
+        free(pixels);
+    }
+    CHECK(!QoiWriteBgrx(ByteSinkWrite, NULL, NULL, 0, 1, 1, 3));
+}
+
+typedef enum { FORMAT_PNG, FORMAT_PNG_FAST, FORMAT_QOI } BenchFormat;
+
+typedef struct {
+    const unsigned char *pixels;
+    int width;
+    int height;
+    BenchFormat format;
+    size_t bytes;
+} FormatBench;
+
+static void EncodeOnce(void *context) {
+    static const DeflateParams fastDeflate = {0, 0, 0, 1};
+    FormatBench *bench = (FormatBench *)context;
+    if (bench->format == FORMAT_QOI) {
+        ByteSink sink = {0};
+        QoiWriteBgrx(ByteSinkWrite, &sink, bench->pixels, 0, bench->width, bench->height, 3);
+        bench->bytes = sink.len;
+        ByteSinkFree(&sink);
+        return;
+    }
+
+    PngEncodeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.source = PNG_SOURCE_BGRX;
+    if (bench->format == FORMAT_PNG_FAST) {
+        options.filter = PNG_FILTER_UP;
+        options.deflate = &fastDeflate;
+    }
+    int len = 0;
+    unsigned char *png = PngEncodeToMemory(bench->pixels, 0, bench->width, bench->height, 3,
+        &options, &len);
+    bench->bytes = (size_t)len;
+    PngFree(png);
+}
+
+/* Single-threaded encode time and output size per format, at two capture sizes. */
+void BenchScreenshotFormats(void) {
+    static const char *formatNames[] = {"png", "png_fast", "qoi"};
+    static const int sizes[][2] = {{800, 600}, {1920, 1080}};
+    char name[64];
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        FormatBench bench = {NULL, sizes[s][0], sizes[s][1], FORMAT_PNG, 0};
+        unsigned char *pixels = MakeWindow(bench.width, bench.height, 1);
+        bench.pixels = pixels;
+        double rawBytes = (double)bench.width * bench.height * 3;
+
+        for (int format = FORMAT_PNG; format <= FORMAT_QOI; format++) {
+            bench.format = (BenchFormat)format;
+            BenchResetAllocs();
+            EncodeOnce(&bench);
+            BenchAllocs allocs = BenchReadAllocs();
+            double ns = BenchMinNs(EncodeOnce, &bench, 1);
+
+            snprintf(name, sizeof(name), "%s_%dx%d", formatNames[format], bench.width,
+                bench.height);
+            BenchBegin("formats", name);
+            BenchValue("ms", ns / 1e6);
+            BenchValue("ns_per_pixel", ns / ((double)bench.width * bench.height));
+            BenchValue("bytes", (double)bench.bytes);
+            BenchValue("ratio", (double)bench.bytes / rawBytes);
+            BenchAllocValues(&allocs);
+            BenchEnd();
+        }
+        free(pixels);
+    }
+}
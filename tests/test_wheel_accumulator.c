@@ -0,0 +1,156 @@
+#include <string.h>
+#include "cases.h"
+#include "harness.h"
+#include "hotkeys.h"
+#include "wheel_accumulator.h"
+
+static const WheelSettings batched = {1, 50, 0, 0};
+
+void TestWheelAccumulatorBatching(void) {
+    WheelAccumulator wheel;
+    WheelAccumulatorInit(&wheel, &batched);
+
+    /* The first notch goes at once, the rest of the interval is held back and released in one
+     * flush when it ends. */
+    CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 1000), 1);
+    CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 1010), 0);
+    CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 1020), 0);
+    CHECK_EQ(WheelAccumulatorDueIn(&wheel, 1020), 30);
+    CHECK_EQ(WheelAccumulatorFlush(&wheel, 1049), 0);
+    CHECK_EQ(WheelAccumulatorFlush(&wheel, 1050), 2);
+    CHECK_EQ(WheelAccumulatorDueIn(&wheel, 1050), -1);
+
+    /* High-resolution deltas add up to whole steps; a partial step is not released. */
+    for (int i = 0; i < 4; i++)
+        CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH / 4, 2000 + i), i == 3);
+    CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH / 2, 3000), 0);
+    CHECK_EQ(WheelAccumulatorDueIn(&wheel, 3000), -1);
+    CHECK_EQ(WheelAccumulatorTake(&wheel, 3000), 0);
+    CHECK_EQ(WheelAccumulatorAdd(&wheel, WHEEL_NOTCH / 2, 4000), 0);
+
+    CHECK_EQ(wheel.events, 9);
+    CHECK_EQ(wheel.steps, 4);
+
+    /* Fast spinning multiplies the steps, up to the cap. */
+    WheelSettings accelerated = {1, 0, 5, 100};
+    WheelAccumulatorConfigure(&wheel, &accelerated);
+    int steps = 0;
+    for (int i = 0; i < 200; i++)
+        steps += WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 10000 + (unsigned long long)i * 5);
+    CHECK(steps > 200);
+    CHECK(steps <= 200 * WHEEL_MAX_MULTIPLIER_PERCENT / 100);
+}
+
+/* Drives the accumulator the way the hook thread does, counting what each action ran after
+ * ExecuteAction's limit. */
+typedef struct {
+    WheelAccumulator wheel;
+    MediaAction actions[WHEEL_DIRECTION_COUNT];
+    int ran[ACTION_REPLAY_SAVE_PNG_SEQUENCE + 1];
+} WheelDriver;
+
+static void RunSteps(WheelDriver *driver, int steps) {
+    MediaAction action = driver->actions[steps > 0 ? WHEEL_UP : WHEEL_DOWN];
+    driver->ran[action] += ActionRepeatLimit(action, steps > 0 ? steps : -steps);
+}
+
+static void DriveWheel(WheelDriver *driver, MediaAction action, int delta,
+    unsigned long long nowMs) {
+    WheelDirection dir = delta > 0 ? WHEEL_UP : WHEEL_DOWN;
+    if (action != driver->actions[dir]) {
+        RunSteps(driver, WheelAccumulatorTake(&driver->wheel, nowMs));
+        driver->actions[dir] = action;
+    } else if (WheelAccumulatorReverses(&driver->wheel, delta) &&
+               !ActionsAreInverse(driver->actions[WHEEL_UP], driver->actions[WHEEL_DOWN])) {
+        RunSteps(driver, WheelAccumulatorTake(&driver->wheel, nowMs));
+    }
+    RunSteps(driver, WheelAccumulatorAdd(&driver->wheel, delta, nowMs));
+}
+
+static void ReverseWithin(WheelDriver *driver, MediaAction up, MediaAction down) {
+    memset(driver, 0, sizeof(*driver));
+    WheelAccumulatorInit(&driver->wheel, &batched);
+    /* Both directions were used before, so a change of action is not what flushes here. */
+    driver->actions[WHEEL_UP] = up;
+    driver->actions[WHEEL_DOWN] = down;
+    /* Three notches up, two down, all inside one interval, then let it flush. */
+    DriveWheel(driver, up, WHEEL_NOTCH, 1000);
+    DriveWheel(driver, up, WHEEL_NOTCH, 1005);
+    DriveWheel(driver, up, WHEEL_NOTCH, 1010);
+    DriveWheel(driver, down, -WHEEL_NOTCH, 1015);
+    DriveWheel(driver, down, -WHEEL_NOTCH, 1020);
+    RunSteps(driver, WheelAccumulatorFlush(&driver->wheel, 2000));
+}
+
+void TestWheelReversal(void) {
+    CHECK(ActionsAreInverse(ACTION_VOLUME_UP, ACTION_VOLUME_DOWN));
+    CHECK(ActionsAreInverse(ACTION_NEXT_TRACK, ACTION_PREV_TRACK));
+    CHECK(!ActionsAreInverse(ACTION_VOLUME_UP, ACTION_VOLUME_UP));
+    CHECK(!ActionsAreInverse(ACTION_VOLUME_UP, ACTION_NEXT_TRACK));
+    CHECK(!ActionsAreInverse(ACTION_PLAY_PAUSE, ACTION_PLAY_PAUSE));
+    CHECK(!ActionsAreInverse(ACTION_NONE, ACTION_NONE));
+
+    WheelAccumulator wheel;
+    WheelAccumulatorInit(&wheel, &batched);
+    CHECK(!WheelAccumulatorReverses(&wheel, -WHEEL_NOTCH));
+    WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 0);
+    WheelAccumulatorAdd(&wheel, WHEEL_NOTCH, 1);
+    CHECK(WheelAccumulatorReverses(&wheel, -1));
+    CHECK(!WheelAccumulatorReverses(&wheel, 1));
+    CHECK(!WheelAccumulatorReverses(&wheel, 0));
+
+    WheelDriver driver;
+
+    /* Volume up and down undo each other, so netting the reversal out is what the user asked
+     * for: one step up overall. */
+    ReverseWithin(&driver, ACTION_VOLUME_UP, ACTION_VOLUME_DOWN);
+    CHECK_EQ(driver.ran[ACTION_VOLUME_UP], 1);
+    CHECK_EQ(driver.ran[ACTION_VOLUME_DOWN], 0);
+
+    /* Next track both ways does not cancel out; every notch must run. */
+    ReverseWithin(&driver, ACTION_NEXT_TRACK, ACTION_NEXT_TRACK);
+    CHECK_EQ(driver.ran[ACTION_NEXT_TRACK], 5);
+
+    /* Screenshots one way and volume the other. The screenshot notches go in two flushes, the
+     * first notch and the two held back, and each flush takes one. */
+    ReverseWithin(&driver, ACTION_SCREENSHOT_CLIENT_FILE, ACTION_VOLUME_DOWN);
+    CHECK_EQ(driver.ran[ACTION_SCREENSHOT_CLIENT_FILE], 2);
+    CHECK_EQ(driver.ran[ACTION_VOLUME_DOWN], 2);
+
+    ReverseWithin(&driver, ACTION_PLAY_PAUSE, ACTION_PLAY_PAUSE);
+    CHECK_EQ(driver.ran[ACTION_PLAY_PAUSE], 5);
+    CHECK_EQ(driver.wheel.steps, 5);
+}
+
+/* A fast spin inside one interval, then the flush that releases it. */
+static void Spin(WheelDriver *driver, MediaAction action, int notches) {
+    memset(driver, 0, sizeof(*driver));
+    WheelAccumulatorInit(&driver->wheel, &batched);
+    driver->actions[WHEEL_UP] = action;
+    for (int i = 0; i < notches; i++)
+        DriveWheel(driver, action, WHEEL_NOTCH, 1000 + (unsigned long long)i / 3);
+    RunSteps(driver, WheelAccumulatorFlush(&driver->wheel, 2000));
+}
+
+void TestWheelRepeatLimit(void) {
+    CHECK_EQ(ActionRepeatLimit(ACTION_VOLUME_UP, 5), 5);
+    CHECK_EQ(ActionRepeatLimit(ACTION_VOLUME_UP, 1000), ACTION_MAX_REPEAT);
+    CHECK_EQ(ActionRepeatLimit(ACTION_VOLUME_UP, 0), 0);
+    CHECK_EQ(ActionRepeatLimit(ACTION_NONE, 5), 0);
+    for (int action = ACTION_SCREENSHOT_CLIENT_CLIPBOARD; action <= ACTION_REPLAY_SAVE_PNG_SEQUENCE;
+         action++) {
+        CHECK_EQ(ActionRepeatLimit((MediaAction)action, 1), 1);
+        CHECK_EQ(ActionRepeatLimit((MediaAction)action, 1000), 1);
+    }
+
+    /* 100 notches: the first goes at once, the other 99 in one flush. */
+    WheelDriver driver;
+    Spin(&driver, ACTION_VOLUME_UP, 100);
+    CHECK_EQ(driver.wheel.flushes, 2);
+    CHECK_EQ(driver.ran[ACTION_VOLUME_UP], 1 + ACTION_MAX_REPEAT);
+
+    Spin(&driver, ACTION_SCREENSHOT_CLIENT_FILE_QOI, 100);
+    CHECK_EQ(driver.ran[ACTION_SCREENSHOT_CLIENT_FILE_QOI], 2);
+    Spin(&driver, ACTION_REPLAY_SAVE_APNG, 100);
+    CHECK_EQ(driver.ran[ACTION_REPLAY_SAVE_APNG], 2);
+}
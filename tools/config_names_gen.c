@@ -0,0 +1,323 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_names.h"
+#include "hotkeys.h"
+#include "name_table.h"
+
+/* Build-time generator for everything derived from the keyword lists in config_names.h. It runs
+ * on the build machine, from build.zig and tests/Makefile:
+ *
+ *   config_names_gen tables <out.h>             the lookup tables config_compile.c includes
+ *   config_names_gen readme <README.md>         rewrites the generated README sections
+ *   config_names_gen readme <README.md> --check exits with 1 if they are out of date instead */
+
+#define NAME_ENTRY(name, value, description) {name, value},
+#define MOUSE_TRIGGER_ENTRY(name, type, code, description) {name, TRIGGER_NAME_VALUE(type, code)},
+#define KEY_TRIGGER_ENTRY(name, vk) {"key_" name, TRIGGER_NAME_VALUE(TRIGGER_KEYBOARD, vk)},
+
+static const NameEntry modifierNames[] = {CONFIG_MODIFIER_NAMES(NAME_ENTRY)};
+static const NameEntry actionNames[] = {CONFIG_ACTION_NAMES(NAME_ENTRY)};
+static const NameEntry triggerNames[] = {
+    CONFIG_MOUSE_TRIGGER_NAMES(MOUSE_TRIGGER_ENTRY) CONFIG_KEY_NAMES(KEY_TRIGGER_ENTRY)};
+
+typedef struct {
+    const char *name;
+    const char *description;
+} NameDoc;
+
+#define NAME_DOC(name, value, description) {name, description},
+#define MOUSE_TRIGGER_DOC(name, type, code, description) {name, description},
+
+static const NameDoc modifierDocs[] = {CONFIG_MODIFIER_NAMES(NAME_DOC)};
+static const NameDoc actionDocs[] = {CONFIG_ACTION_NAMES(NAME_DOC)};
+static const NameDoc mouseTriggerDocs[] = {CONFIG_MOUSE_TRIGGER_NAMES(MOUSE_TRIGGER_DOC)};
+
+typedef struct {
+    const char *name;
+    int code;
+} KeyDoc;
+
+#define KEY_DOC(name, vk) {name, vk},
+
+static const KeyDoc keyDocs[] = {CONFIG_KEY_NAMES(KEY_DOC)};
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+/* Lines of the README's named-key paragraph are wrapped to this width. */
+#define README_WIDTH 100
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Text;
+
+static void Append(Text *text, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0)
+        exit(1);
+
+    if (text->length + (size_t)needed + 1 > text->capacity) {
+        size_t capacity = text->capacity ? text->capacity : 4096;
+        while (text->length + (size_t)needed + 1 > capacity)
+            capacity *= 2;
+        char *data = (char *)realloc(text->data, capacity);
+        if (!data) {
+            fprintf(stderr, "config_names_gen: out of memory\n");
+            exit(1);
+        }
+        text->data = data;
+        text->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+    va_end(args);
+    text->length += (size_t)needed;
+}
+
+static char *ReadWholeFile(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    char *data = NULL;
+    long length = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0)
+        data = (char *)malloc((size_t)length + 1);
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data)
+        data[length] = '\0';
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+static int WriteWholeFile(const char *path, const char *data, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return 0;
+    int written = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && written;
+}
+
+/* The names go into C string literals and Markdown code spans as they are. */
+static int NamesArePlain(const NameEntry *entries, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strpbrk(entries[i].name, "\"\\`|") != NULL) {
+            fprintf(stderr, "config_names_gen: '%s' needs escaping\n", entries[i].name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void AppendNumbers(Text *text, const char *indent, const unsigned int *values, int count) {
+    for (int i = 0; i < count; i++)
+        Append(text, "%s%u,%s", i % 16 ? " " : indent, values[i],
+            i % 16 == 15 || i == count - 1 ? "\n" : "");
+}
+
+static int AppendTable(Text *text, const char *name, const NameEntry *entries, int count) {
+    NameTable table;
+    if (!NamesArePlain(entries, count) || !NameTableBuild(&table, entries, count)) {
+        fprintf(stderr, "config_names_gen: could not build the %s table\n", name);
+        return 0;
+    }
+
+    Append(text, "\nstatic const NameEntry %sNames[%d] = {\n", name, count);
+    for (int i = 0; i < count; i++)
+        Append(text, "    {\"%s\", %d},\n", entries[i].name, entries[i].value);
+    Append(text, "};\n\n");
+
+    unsigned int numbers[NAME_TABLE_MAX];
+    Append(text, "static const NameTable %sTable = {\n", name);
+    Append(text, "    %sNames, %d, %d, %uu,\n", name, table.count, table.buckets, table.seed);
+    Append(text, "    {\n");
+    for (int i = 0; i < table.buckets; i++)
+        numbers[i] = table.displace[i];
+    AppendNumbers(text, "        ", numbers, table.buckets);
+    Append(text, "    },\n    {\n");
+    for (int i = 0; i < table.count; i++)
+        numbers[i] = table.slots[i];
+    AppendNumbers(text, "        ", numbers, table.count);
+    Append(text, "    },\n};\n");
+    return 1;
+}
+
+static int GenerateTables(const char *path) {
+    Text text = {0};
+    Append(&text, "/* Generated from config_names.h by tools/config_names_gen.c; do not edit. */\n"
+                  "#ifndef CONFIG_NAME_TABLES_H\n"
+                  "#define CONFIG_NAME_TABLES_H\n\n"
+                  "#include \"name_table.h\"\n");
+    int ok = AppendTable(&text, "modifier", modifierNames, COUNT(modifierNames)) &&
+             AppendTable(&text, "action", actionNames, COUNT(actionNames)) &&
+             AppendTable(&text, "trigger", triggerNames, COUNT(triggerNames));
+    Append(&text, "\n#endif\n");
+    if (ok && !WriteWholeFile(path, text.data, text.length)) {
+        fprintf(stderr, "config_names_gen: could not write %s\n", path);
+        ok = 0;
+    }
+    free(text.data);
+    return ok;
+}
+
+/* Splits off a trailing number, or a lone character, so runs like f1..f12 and a..z can be
+ * written as ranges. Returns the prefix length, or -1 if name has no such suffix. */
+static int RangePrefix(const char *name) {
+    size_t length = strlen(name);
+    size_t prefix = length;
+    while (prefix > 0 && name[prefix - 1] >= '0' && name[prefix - 1] <= '9')
+        prefix--;
+    if (prefix < length)
+        return (int)prefix;
+    return length == 1 ? 0 : -1;
+}
+
+static int ContinuesRange(const KeyDoc *previous, const KeyDoc *key) {
+    int prefix = RangePrefix(key->name);
+    return prefix >= 0 && prefix == RangePrefix(previous->name) &&
+           strncmp(key->name, previous->name, (size_t)prefix) == 0 &&
+           key->code == previous->code + 1;
+}
+
+static void AppendNamedKeys(Text *text) {
+    const char *lead = "Named keys: ";
+    size_t column = strlen(lead);
+    Append(text, "%s", lead);
+
+    for (int i = 0; i < COUNT(keyDocs);) {
+        int end = i + 1;
+        while (end < COUNT(keyDocs) && ContinuesRange(&keyDocs[end - 1], &keyDocs[end]))
+            end++;
+
+        char item[96];
+        if (end - i >= 3) {
+            snprintf(item, sizeof(item), "`key_%s` through `key_%s`", keyDocs[i].name,
+                keyDocs[end - 1].name);
+        } else {
+            snprintf(item, sizeof(item), "`key_%s`", keyDocs[i].name);
+            end = i + 1;
+        }
+        int last = end == COUNT(keyDocs);
+
+        size_t width = strlen(item) + (last ? 0 : 1);
+        if (i > 0 && column + 1 + width > README_WIDTH) {
+            Append(text, "\n");
+            column = 0;
+        } else if (i > 0) {
+            Append(text, " ");
+            column++;
+        }
+        Append(text, "%s%s", item, last ? "\n" : ",");
+        column += width;
+        i = end;
+    }
+}
+
+static void AppendDocRows(Text *text, const char *format, const NameDoc *docs, int count) {
+    for (int i = 0; i < count; i++)
+        Append(text, format, docs[i].name, docs[i].description);
+}
+
+/* Emits the body of the README section called name; returns 0 for an unknown section. */
+static int AppendSection(Text *text, const char *name, size_t nameLength) {
+    if (nameLength == 9 && strncmp(name, "modifiers", nameLength) == 0) {
+        Append(text, "| Value | Description |\n|-------|-------------|\n");
+        AppendDocRows(text, "| `\"%s\"` | %s |\n", modifierDocs, COUNT(modifierDocs));
+    } else if (nameLength == 8 && strncmp(name, "triggers", nameLength) == 0) {
+        Append(text, "| Trigger | Description |\n|---------|-------------|\n");
+        AppendDocRows(text, "| `%s` | %s |\n", mouseTriggerDocs, COUNT(mouseTriggerDocs));
+        Append(text, "| `key_<name>` | Keyboard key by name (see below) |\n"
+                     "| `key_<code>` | Keyboard key by virtual key code (e.g., `key_0x41` for 'A') |"
+                     "\n\n");
+        AppendNamedKeys(text);
+    } else if (nameLength == 7 && strncmp(name, "actions", nameLength) == 0) {
+        Append(text, "| Action | Description |\n|--------|-------------|\n");
+        AppendDocRows(text, "| `%s` | %s |\n", actionDocs, COUNT(actionDocs));
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/* Each generated section sits between "<!-- config_names:<section> -->" and
+ * "<!-- /config_names -->" lines, which are kept. */
+static int GenerateReadme(const char *path, int check) {
+    static const char beginMarker[] = "<!-- config_names:";
+    static const char endMarker[] = "<!-- /config_names -->";
+
+    size_t size;
+    char *readme = ReadWholeFile(path, &size);
+    if (!readme) {
+        fprintf(stderr, "config_names_gen: could not read %s\n", path);
+        return 0;
+    }
+
+    Text text = {0};
+    int sections = 0, ok = 1;
+    const char *p = readme;
+    const char *begin;
+    while (ok && (begin = strstr(p, beginMarker)) != NULL) {
+        const char *name = begin + sizeof(beginMarker) - 1;
+        const char *nameEnd = strstr(name, " -->");
+        const char *lineEnd = nameEnd ? strchr(nameEnd, '\n') : NULL;
+        const char *end = lineEnd ? strstr(lineEnd, endMarker) : NULL;
+        if (!end) {
+            fprintf(stderr, "%s: unterminated config_names section\n", path);
+            ok = 0;
+            break;
+        }
+
+        Append(&text, "%.*s", (int)(lineEnd + 1 - p), p);
+        if (!AppendSection(&text, name, (size_t)(nameEnd - name))) {
+            fprintf(stderr, "%s: unknown config_names section '%.*s'\n", path,
+                (int)(nameEnd - name), name);
+            ok = 0;
+        }
+        sections++;
+        p = end;
+    }
+    if (ok && sections != 3) {
+        fprintf(stderr, "%s: expected the modifiers, triggers and actions sections\n", path);
+        ok = 0;
+    }
+    if (ok)
+        Append(&text, "%s", p);
+
+    if (ok && (text.length != size || memcmp(text.data, readme, size) != 0)) {
+        if (check) {
+            fprintf(stderr, "%s: the keyword tables are out of date; run `zig build readme`\n",
+                path);
+            ok = 0;
+        } else if (!WriteWholeFile(path, text.data, text.length)) {
+            fprintf(stderr, "config_names_gen: could not write %s\n", path);
+            ok = 0;
+        }
+    }
+    free(text.data);
+    free(readme);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "tables") == 0)
+        return GenerateTables(argv[2]) ? 0 : 1;
+    if (argc == 3 && strcmp(argv[1], "readme") == 0)
+        return GenerateReadme(argv[2], 0) ? 0 : 1;
+    if (argc == 4 && strcmp(argv[1], "readme") == 0 && strcmp(argv[3], "--check") == 0)
+        return GenerateReadme(argv[2], 1) ? 0 : 1;
+
+    fprintf(stderr, "usage: %s tables <out.h>\n"
+                    "       %s readme <README.md> [--check]\n",
+        argv[0], argv[0]);
+    return 2;
+}